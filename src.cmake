@@ -56,6 +56,7 @@ set(COMMONLIST
     ${COMMON_DIR}/Math.h
     ${COMMON_DIR}/Optional.h
     ${COMMON_DIR}/Platform.h
+    ${COMMON_DIR}/RadixSort.h
     ${COMMON_DIR}/Serialize.h
     ${COMMON_DIR}/String.cpp
     ${COMMON_DIR}/String.h
@@ -94,24 +95,29 @@ set(RENDERERLIST
     ${ENGINE_DIR}/renderer/tr_animation.cpp
     ${ENGINE_DIR}/renderer/tr_backend.cpp
     ${ENGINE_DIR}/renderer/tr_bsp.cpp
+    ${ENGINE_DIR}/renderer/tr_cache.cpp
     ${ENGINE_DIR}/renderer/tr_cmds.cpp
     ${ENGINE_DIR}/renderer/tr_curve.cpp
     ${ENGINE_DIR}/renderer/tr_decals.cpp
     ${ENGINE_DIR}/renderer/tr_fbo.cpp
     ${ENGINE_DIR}/renderer/tr_flares.cpp
     ${ENGINE_DIR}/renderer/tr_font.cpp
+    ${ENGINE_DIR}/renderer/FrustumCull.h
     ${ENGINE_DIR}/renderer/InternalImage.cpp
     ${ENGINE_DIR}/renderer/InternalImage.h
     ${ENGINE_DIR}/renderer/tr_image.cpp
     ${ENGINE_DIR}/renderer/tr_image.h
+    ${ENGINE_DIR}/renderer/tr_image_cache.cpp
     ${ENGINE_DIR}/renderer/tr_image_crn.cpp
     ${ENGINE_DIR}/renderer/tr_image_dds.cpp
     ${ENGINE_DIR}/renderer/tr_image_jpg.cpp
     ${ENGINE_DIR}/renderer/tr_image_ktx.cpp
+    ${ENGINE_DIR}/renderer/tr_image_streaming.cpp
     ${ENGINE_DIR}/renderer/tr_image_png.cpp
     ${ENGINE_DIR}/renderer/tr_image_tga.cpp
     ${ENGINE_DIR}/renderer/tr_image_webp.cpp
     ${ENGINE_DIR}/renderer/tr_init.cpp
+    ${ENGINE_DIR}/renderer/tr_jobs.cpp
     ${ENGINE_DIR}/renderer/tr_light.cpp
     ${ENGINE_DIR}/renderer/tr_local.h
     ${ENGINE_DIR}/renderer/tr_main.cpp
@@ -124,6 +130,8 @@ set(RENDERERLIST
     ${ENGINE_DIR}/renderer/tr_model_skel.cpp
     ${ENGINE_DIR}/renderer/tr_model_skel.h
     ${ENGINE_DIR}/renderer/tr_noise.cpp
+    ${ENGINE_DIR}/renderer/OcclusionCull.h
+    ${ENGINE_DIR}/renderer/TextureStreaming.h
     ${ENGINE_DIR}/renderer/tr_public.h
     ${ENGINE_DIR}/renderer/tr_scene.cpp
     ${ENGINE_DIR}/renderer/tr_shade.cpp
@@ -215,6 +223,7 @@ set(SERVERLIST
     ${ENGINE_DIR}/server/sv_snapshot.cpp
     ${ENGINE_DIR}/server/CryptoChallenge.cpp
     ${ENGINE_DIR}/server/CryptoChallenge.h
+    ${ENGINE_DIR}/server/SnapshotBudget.h
 )
 
 set(ENGINELIST
@@ -239,6 +248,8 @@ set(ENGINELIST
     ${ENGINE_DIR}/framework/CvarSystem.h
     ${ENGINE_DIR}/framework/LogSystem.cpp
     ${ENGINE_DIR}/framework/LogSystem.h
+    ${ENGINE_DIR}/framework/MessageProfiler.cpp
+    ${ENGINE_DIR}/framework/MessageProfiler.h
     ${ENGINE_DIR}/framework/Resource.cpp
     ${ENGINE_DIR}/framework/Resource.h
     ${ENGINE_DIR}/framework/System.cpp
@@ -273,8 +284,13 @@ set(ENGINETESTLIST
     ${COMMON_DIR}/ColorTest.cpp
     ${COMMON_DIR}/StringTest.cpp
     ${COMMON_DIR}/cm/unittest.cpp
+    ${COMMON_DIR}/RadixSortTest.cpp
     ${COMMON_DIR}/UtilTest.cpp
     ${ENGINE_DIR}/framework/CommandSystemTest.cpp
+    ${ENGINE_DIR}/renderer/FrustumCullTest.cpp
+    ${ENGINE_DIR}/renderer/OcclusionCullTest.cpp
+    ${ENGINE_DIR}/renderer/TextureStreamingTest.cpp
+    ${ENGINE_DIR}/server/SnapshotBudgetTest.cpp
 )
 
 set(QCOMMONLIST
@@ -1079,6 +1079,22 @@ static std::unordered_set<std::pair<std::string, std::string>, stdStringPairHash
 // the offset_t is the position within the zip archive (unused for PAK_DIR).
 static std::unordered_map<std::string, std::pair<uint32_t, offset_t>> fileMap;
 
+// Map of filenames without their extension to the extensions they have, in
+// pak priority order. Files without an extension are not listed.
+static std::unordered_map<std::string, std::vector<FileExtension>> extensionMap;
+
+// Add a file which was just inserted in fileMap to extensionMap
+static void AddFileExtension(Str::StringRef filename, uint32_t pakIndex)
+{
+	std::string ext = Path::Extension(filename);
+	if (ext.size() <= 1)
+		return;
+	std::vector<FileExtension>& extensions = extensionMap[std::string(filename.begin(), filename.end() - ext.size())];
+
+	// Paks are loaded in priority order so this keeps the list sorted
+	extensions.push_back({ext.substr(1), pakIndex});
+}
+
 #ifndef BUILD_VM
 /* Parse the deleted file list file of a package.
 
@@ -1307,7 +1323,8 @@ static void InternalLoadPak(
 					Log::Debug("Ignoring deleted file %s from %s", *it, pak.path);
 				}
 				else {
-					fileMap.emplace(*it, std::pair<uint32_t, offset_t>(loadedPaks.size() - 1, 0));
+					if (fileMap.emplace(*it, std::pair<uint32_t, offset_t>(loadedPaks.size() - 1, 0)).second)
+						AddFileExtension(*it, loadedPaks.size() - 1);
 				}
 			}
 			it.increment(err);
@@ -1362,7 +1379,8 @@ static void InternalLoadPak(
 				Log::Debug("Ignoring deleted file %s from %s", filename, pak.path);
 			}
 			else {
-				fileMap.emplace(filename, std::pair<uint32_t, offset_t>(loadedPaks.size() - 1, offset));
+				if (fileMap.emplace(filename, std::pair<uint32_t, offset_t>(loadedPaks.size() - 1, offset)).second)
+					AddFileExtension(filename, loadedPaks.size() - 1);
 			}
 		}, err);
 		if (err)
@@ -1484,6 +1502,7 @@ void ClearPaks()
 	fsLogs.Verbose("^5Unloading all paks");
 	deletedFileSet.clear();
 	fileMap.clear();
+	extensionMap.clear();
 	for (LoadedPakInfo& x: loadedPaks) {
 		if (x.fd != -1)
 			close(x.fd);
@@ -1661,6 +1680,16 @@ const LoadedPakInfo* LocateFile(Str::StringRef path)
 		return &loadedPaks[it->second.first];
 }
 
+const std::vector<FileExtension>& LocateExtensions(Str::StringRef pathWithoutExtension)
+{
+	static const std::vector<FileExtension> noExtensions;
+	auto it = extensionMap.find(pathWithoutExtension);
+	if (it == extensionMap.end())
+		return noExtensions;
+	else
+		return it->second;
+}
+
 std::chrono::system_clock::time_point FileTimestamp(Str::StringRef path, std::error_code& err)
 {
 	auto it = fileMap.find(path);
@@ -2381,6 +2410,16 @@ void Initialize()
 	}
 
 	VM::SendMsg<VM::FSInitializeMsg>(homePath, libPath, availablePaks, PakPath::loadedPaks, PakPath::fileMap);
+
+	// The engine doesn't send its extension index, rebuild it from the file map
+	PakPath::extensionMap.clear();
+	for (const auto& x: PakPath::fileMap)
+		PakPath::AddFileExtension(x.first, x.second.first);
+	for (auto& x: PakPath::extensionMap) {
+		std::sort(x.second.begin(), x.second.end(), [](const PakPath::FileExtension& a, const PakPath::FileExtension& b) {
+			return a.pakIndex < b.pakIndex;
+		});
+	}
 }
 #else
 // Get an absolute path from a relative one. This may fail if the path does not
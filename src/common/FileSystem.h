@@ -339,6 +339,22 @@ namespace PakPath {
 	// Get the pak a file is in, or null if the file does not exist
 	const LoadedPakInfo* LocateFile(Str::StringRef path);
 
+	// A file found by its path without extension, see LocateExtensions
+	struct FileExtension {
+		// Extension of the file, without the dot
+		std::string extension;
+
+		// Index of the pak the file is in, in GetLoadedPaks(). Paks with a
+		// lower index take precedence over those with a higher index.
+		uint32_t pakIndex;
+	};
+
+	// Get the extensions of the files that have the given path once their
+	// extension is removed, sorted by the priority of the pak they are in.
+	// This allows finding an asset of any format with a single lookup.
+	// BEWARE: this doesn't work inside a VM if a pak was loaded after the VM starts!
+	const std::vector<FileExtension>& LocateExtensions(Str::StringRef pathWithoutExtension);
+
 	// Get the timestamp of a file
 	std::chrono::system_clock::time_point FileTimestamp(Str::StringRef path, std::error_code& err = throws());
 
@@ -73,6 +73,10 @@ namespace IPC {
      * the same time pass references to where the output should be written.
      * After the lambda has been called, it will serialize the outputs and
      * send it in the socket.
+     *
+     * For a VM running as a native DLL, the channel can wrap an InProcessPipe
+     * instead of a socket. The messages are serialized and dispatched by ID
+     * the same way, only the bytes are passed through memory.
      */
 
     #ifdef BUILD_ENGINE
@@ -84,31 +88,69 @@ namespace IPC {
     class Channel {
     public:
         Channel()
-            : canSendSyncMsg(TOPLEVEL_MSG_ALLOWED), canSendAsyncMsg(TOPLEVEL_MSG_ALLOWED) {}
+            : canSendSyncMsg(TOPLEVEL_MSG_ALLOWED), canSendAsyncMsg(TOPLEVEL_MSG_ALLOWED), bytesSent(0), bytesReceived(0), repliesSent(0) {}
         Channel(Socket socket)
-            : socket(std::move(socket)), canSendSyncMsg(TOPLEVEL_MSG_ALLOWED), canSendAsyncMsg(TOPLEVEL_MSG_ALLOWED) {}
+            : socket(std::move(socket)), canSendSyncMsg(TOPLEVEL_MSG_ALLOWED), canSendAsyncMsg(TOPLEVEL_MSG_ALLOWED), bytesSent(0), bytesReceived(0), repliesSent(0) {}
+#ifndef __native_client__
+        // The pipe must outlive the channel
+        Channel(InProcessPipe* pipe, InProcessPipe::Side side)
+            : pipe(pipe), pipeSide(side), canSendSyncMsg(TOPLEVEL_MSG_ALLOWED), canSendAsyncMsg(TOPLEVEL_MSG_ALLOWED), bytesSent(0), bytesReceived(0), repliesSent(0) {}
+#endif
         Channel(Channel&& other)
-            : socket(std::move(other.socket)), canSendSyncMsg(TOPLEVEL_MSG_ALLOWED), canSendAsyncMsg(TOPLEVEL_MSG_ALLOWED) {}
+            : socket(std::move(other.socket)),
+#ifndef __native_client__
+              pipe(other.pipe), pipeSide(other.pipeSide),
+#endif
+              canSendSyncMsg(TOPLEVEL_MSG_ALLOWED), canSendAsyncMsg(TOPLEVEL_MSG_ALLOWED), bytesSent(0), bytesReceived(0), repliesSent(0)
+        {
+#ifndef __native_client__
+            other.pipe = nullptr;
+#endif
+        }
         Channel& operator=(Channel&& other)
         {
             std::swap(socket, other.socket);
+#ifndef __native_client__
+            std::swap(pipe, other.pipe);
+            std::swap(pipeSide, other.pipeSide);
+#endif
             canSendSyncMsg = other.canSendSyncMsg;
             canSendAsyncMsg = other.canSendAsyncMsg;
+            bytesSent = 0;
+            bytesReceived = 0;
+            repliesSent = 0;
             return *this;
         }
         explicit operator bool() const
         {
+#ifndef __native_client__
+            if (pipe)
+                return true;
+#endif
             return bool(socket);
         }
 
-        // Wrappers around socket functions
-        void SendMsg(const Util::Writer& writer) const
+        // Wrappers around socket or in-process pipe functions
+        void SendMsg(const Util::Writer& writer)
         {
+            bytesSent += writer.GetData().size();
+#ifndef __native_client__
+            if (pipe) {
+                pipe->SendMsg(pipeSide, writer);
+                return;
+            }
+#endif
             socket.SendMsg(writer);
         }
-        Util::Reader RecvMsg() const
+        Util::Reader RecvMsg()
         {
-            return socket.RecvMsg();
+#ifndef __native_client__
+            Util::Reader reader = pipe ? pipe->RecvMsg(pipeSide) : socket.RecvMsg();
+#else
+            Util::Reader reader = socket.RecvMsg();
+#endif
+            bytesReceived += reader.GetData().size();
+            return reader;
         }
         void SetRecvTimeout(std::chrono::nanoseconds timeout)
         {
@@ -126,11 +168,20 @@ namespace IPC {
 
     private:
         Socket socket;
+#ifndef __native_client__
+        InProcessPipe* pipe = nullptr;
+        InProcessPipe::Side pipeSide = InProcessPipe::ENGINE_SIDE;
+#endif
         std::unordered_map<uint32_t, Util::Reader> replies;
 
     public:
         bool canSendSyncMsg;
         bool canSendAsyncMsg;
+
+        // Traffic counters, used by the engine to profile messages
+        uint64_t bytesSent;
+        uint64_t bytesReceived;
+        uint64_t repliesSent;
     };
 
     namespace detail {
@@ -222,6 +273,7 @@ namespace IPC {
             writer.Write<uint32_t>(ID_RETURN);
             writer.WriteTuple(Util::TypeListFromTuple<typename Message::Outputs>(), std::move(outputs));
             channel.SendMsg(writer);
+            channel.repliesSent++;
         }
 
     } // namespace detail
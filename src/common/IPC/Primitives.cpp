@@ -30,6 +30,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "common/Common.h"
 #include "Primitives.h"
+#include <thread>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -586,4 +587,79 @@ SharedMemory SharedMemory::Create(size_t size)
 }
 #endif
 
+#ifndef __native_client__
+static FileDesc DuplicateDesc(const FileDesc& desc)
+{
+	FileDesc out = desc;
+#ifdef _WIN32
+	if (!DuplicateHandle(GetCurrentProcess(), desc.handle, GetCurrentProcess(), &out.handle, 0, FALSE, DUPLICATE_SAME_ACCESS))
+		Sys::Drop("IPC: Failed to duplicate handle: %s", Sys::Win32StrError(GetLastError()));
+#else
+	out.handle = dup(desc.handle);
+	if (out.handle == -1)
+		Sys::Drop("IPC: Failed to duplicate handle: %s", strerror(errno));
+#endif
+	return out;
+}
+
+void InProcessPipe::SendMsg(Side from, const Util::Writer& writer)
+{
+	Util::Reader reader;
+	reader.GetData() = writer.GetData();
+	for (const FileDesc& desc : writer.GetHandles()) {
+		if (!Sys::IsValidHandle(desc.handle))
+			Sys::Drop("IPC: Tried to send an invalid handle");
+		reader.GetHandles().push_back(DuplicateDesc(desc));
+	}
+
+	Queue& queue = queues[from == ENGINE_SIDE ? VM_SIDE : ENGINE_SIDE];
+	std::lock_guard<std::mutex> lock(queue.mutex);
+	if (closed)
+		Sys::Drop("IPC: Failed to send message: in-process pipe closed");
+
+	queue.messages.push(std::move(reader));
+	queue.pending.fetch_add(1, std::memory_order_release);
+	if (queue.waiting)
+		queue.condition.notify_one();
+}
+
+Util::Reader InProcessPipe::RecvMsg(Side to)
+{
+	// Replies usually come back within a few microseconds, give the core
+	// to the other side for about that long before going to sleep.
+	static const int YIELD_COUNT = 100;
+
+	Queue& queue = queues[to];
+	for (int i = 0; i < YIELD_COUNT; i++) {
+		if (queue.pending.load(std::memory_order_acquire) != 0 || closed)
+			break;
+		std::this_thread::yield();
+	}
+
+	std::unique_lock<std::mutex> lock(queue.mutex);
+	queue.waiting = true;
+	queue.condition.wait(lock, [&] {
+		return !queue.messages.empty() || closed;
+	});
+	queue.waiting = false;
+
+	if (queue.messages.empty())
+		Sys::Drop("IPC: Failed to receive message: in-process pipe closed");
+
+	Util::Reader out = std::move(queue.messages.front());
+	queue.messages.pop();
+	queue.pending.fetch_sub(1, std::memory_order_relaxed);
+	return out;
+}
+
+void InProcessPipe::Close()
+{
+	closed = true;
+	for (Queue& queue : queues) {
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.condition.notify_all();
+	}
+}
+#endif
+
 } // namespace IPC
@@ -155,6 +155,43 @@ namespace IPC {
 		size_t size;
 	};
 
+#ifndef __native_client__
+	// In-memory replacement for a socket pair, used between the engine and a
+	// VM running as a native DLL in a thread of the engine process. Only the
+	// transport changes: messages are still serialized with Util::Writer and
+	// read back with Util::Reader, but they don't go through the kernel, and
+	// the receiver yields a bit before sleeping since the other side usually
+	// replies quickly. Handles are duplicated on send, like a socket would.
+	class InProcessPipe {
+	public:
+		enum Side {
+			ENGINE_SIDE,
+			VM_SIDE,
+		};
+
+		InProcessPipe() : closed(false) {}
+
+		void SendMsg(Side from, const Util::Writer& writer);
+		Util::Reader RecvMsg(Side to);
+
+		// Wakes up the receivers, which will drop once they have read the
+		// remaining messages.
+		void Close();
+
+	private:
+		struct Queue {
+			std::mutex mutex;
+			std::condition_variable condition;
+			std::queue<Util::Reader> messages;
+			std::atomic<uint32_t> pending{0};
+			bool waiting = false;
+		};
+
+		Queue queues[2];
+		std::atomic<bool> closed;
+	};
+#endif
+
 } // namespace IPC
 
 namespace Util {
@@ -0,0 +1,136 @@
+/*
+===========================================================================
+Daemon BSD Source Code
+Copyright (c) 2026, Daemon Developers
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Daemon developers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL DAEMON DEVELOPERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+===========================================================================
+*/
+
+#ifndef COMMON_RADIXSORT_H_
+#define COMMON_RADIXSORT_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace Util {
+
+/**
+ * @brief Stable LSD radix sort of items by a 64 bit key, 8 bits per pass.
+ *
+ * The keys are sorted along with the item indexes and the items are moved
+ * once at the end. Passes on bytes that are the same for all the keys are
+ * skipped, so keys that only use their low bits are cheap. The buffers are
+ * kept between calls, keep one sorter per use to not reallocate them.
+ */
+template<typename Item> class RadixSorter {
+	public:
+		/**
+		 * @brief Sorts the items by increasing keyOf(item), items with the
+		 *        same key keep their order.
+		 */
+		template<typename KeyOf> void Sort(Item* items, size_t count, KeyOf keyOf) {
+			if (count < 2) {
+				return;
+			}
+
+			if (count < SMALL_COUNT) {
+				std::stable_sort(items, items + count, [&](const Item& a, const Item& b) {
+					return keyOf(a) < keyOf(b);
+				});
+				return;
+			}
+
+			entries.resize(count);
+			temp.resize(count);
+
+			size_t histograms[8][256] = {};
+			uint64_t firstKey = keyOf(items[0]);
+			uint64_t differences = 0;
+
+			// count all the digits in a single read
+			for (size_t i = 0; i < count; i++) {
+				uint64_t key = keyOf(items[i]);
+				entries[i] = {key, static_cast<uint32_t>(i)};
+				differences |= key ^ firstKey;
+
+				for (int digit = 0; digit < 8; digit++) {
+					histograms[digit][(key >> (8 * digit)) & 0xff]++;
+				}
+			}
+
+			bool moved = false;
+
+			for (int digit = 0; digit < 8; digit++) {
+				int shift = 8 * digit;
+
+				if (!((differences >> shift) & 0xff)) {
+					continue;
+				}
+
+				size_t offsets[256];
+				size_t offset = 0;
+
+				for (int value = 0; value < 256; value++) {
+					offsets[value] = offset;
+					offset += histograms[digit][value];
+				}
+
+				for (const Entry& entry : entries) {
+					temp[offsets[(entry.key >> shift) & 0xff]++] = entry;
+				}
+
+				entries.swap(temp);
+				moved = true;
+			}
+
+			if (!moved) {
+				return;
+			}
+
+			sorted.assign(items, items + count);
+
+			for (size_t i = 0; i < count; i++) {
+				items[i] = sorted[entries[i].index];
+			}
+		}
+
+	private:
+		// under this, the histograms cost more than a comparison sort
+		static const size_t SMALL_COUNT = 64;
+
+		struct Entry {
+			uint64_t key;
+			uint32_t index;
+		};
+
+		std::vector<Entry> entries;
+		std::vector<Entry> temp;
+		std::vector<Item> sorted;
+};
+
+} // namespace Util
+
+#endif // COMMON_RADIXSORT_H_
@@ -0,0 +1,169 @@
+/*
+===========================================================================
+Daemon BSD Source Code
+Copyright (c) 2026, Daemon Developers
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Daemon developers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL DAEMON DEVELOPERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+===========================================================================
+*/
+
+#include <chrono>
+#include <random>
+#include <gtest/gtest.h>
+
+#include "RadixSort.h"
+
+namespace Util {
+	namespace {
+		// same size and key layout as the renderer's drawSurf_t
+		struct FakeDrawSurf
+		{
+			void *entity;
+			void *surface;
+			void *shader;
+			uint64_t sort;
+			bool bspSurface;
+		};
+
+		uint64_t SortKey(const FakeDrawSurf& surf)
+		{
+			return surf.sort;
+		}
+
+		// shader, lightmap, entity and fog in the high bits, the unique
+		// index of the surface in the low 20 bits
+		std::vector<FakeDrawSurf> MakeDrawSurfs(size_t count, unsigned seed)
+		{
+			std::mt19937 rng(seed);
+			std::vector<FakeDrawSurf> surfs(count);
+			for (size_t i = 0; i < count; i++) {
+				uint64_t shader = rng() % 1500;
+				uint64_t lightmap = rng() % 32;
+				uint64_t entity = rng() % 8 ? 0 : rng() % 1024;
+				surfs[i].sort = (shader << 48) | (lightmap << 40) | (entity << 24) | (i & 0xfffff);
+				surfs[i].surface = &surfs[i];
+			}
+			return surfs;
+		}
+
+		void ExpectSameAsStableSort(std::vector<FakeDrawSurf> surfs)
+		{
+			std::vector<FakeDrawSurf> expected = surfs;
+			std::stable_sort(expected.begin(), expected.end(), [](const FakeDrawSurf& a, const FakeDrawSurf& b) {
+				return a.sort < b.sort;
+			});
+
+			RadixSorter<FakeDrawSurf> sorter;
+			sorter.Sort(surfs.data(), surfs.size(), SortKey);
+
+			ASSERT_EQ(expected.size(), surfs.size());
+			for (size_t i = 0; i < surfs.size(); i++) {
+				ASSERT_EQ(expected[i].sort, surfs[i].sort);
+				ASSERT_EQ(expected[i].surface, surfs[i].surface);
+			}
+		}
+
+		TEST(RadixSortTest, Empty)
+		{
+			ExpectSameAsStableSort({});
+		}
+
+		TEST(RadixSortTest, Small)
+		{
+			ExpectSameAsStableSort(MakeDrawSurfs(40, 1));
+		}
+
+		TEST(RadixSortTest, DrawSurfs)
+		{
+			ExpectSameAsStableSort(MakeDrawSurfs(20000, 2));
+		}
+
+		TEST(RadixSortTest, Stable)
+		{
+			std::mt19937 rng(3);
+			std::vector<FakeDrawSurf> surfs(5000);
+			for (auto& surf : surfs) {
+				surf.sort = uint64_t(rng() % 7) << 33;
+				surf.surface = &surf;
+			}
+			ExpectSameAsStableSort(surfs);
+		}
+
+		TEST(RadixSortTest, AllKeysEqual)
+		{
+			std::vector<FakeDrawSurf> surfs(1000);
+			for (auto& surf : surfs) {
+				surf.sort = 42;
+				surf.surface = &surf;
+			}
+			ExpectSameAsStableSort(surfs);
+		}
+
+		TEST(RadixSortTest, ReusedSorter)
+		{
+			RadixSorter<FakeDrawSurf> sorter;
+			for (size_t count : {30000, 100, 12000}) {
+				std::vector<FakeDrawSurf> surfs = MakeDrawSurfs(count, count);
+				sorter.Sort(surfs.data(), surfs.size(), SortKey);
+				ASSERT_TRUE(std::is_sorted(surfs.begin(), surfs.end(), [](const FakeDrawSurf& a, const FakeDrawSurf& b) {
+					return a.sort < b.sort;
+				}));
+			}
+		}
+
+		// Run with --gtest_also_run_disabled_tests
+		TEST(RadixSortTest, DISABLED_Benchmark)
+		{
+			using Clock = std::chrono::steady_clock;
+			RadixSorter<FakeDrawSurf> sorter;
+
+			for (size_t count : {10000, 20000, 40000, 60000}) {
+				std::vector<FakeDrawSurf> input = MakeDrawSurfs(count, 4);
+				std::shuffle(input.begin(), input.end(), std::mt19937(5));
+				const int rounds = 50;
+				Clock::duration comparison{}, radix{};
+
+				for (int round = 0; round < rounds; round++) {
+					std::vector<FakeDrawSurf> surfs = input;
+					auto start = Clock::now();
+					std::sort(surfs.begin(), surfs.end(), [](const FakeDrawSurf& a, const FakeDrawSurf& b) {
+						return a.sort < b.sort;
+					});
+					comparison += Clock::now() - start;
+
+					surfs = input;
+					start = Clock::now();
+					sorter.Sort(surfs.data(), surfs.size(), SortKey);
+					radix += Clock::now() - start;
+				}
+
+				auto usec = [&](Clock::duration d) {
+					return std::chrono::duration_cast<std::chrono::microseconds>(d).count() / rounds;
+				};
+				std::printf("%6zu drawsurfs: std::sort %5ld us, radix sort %5ld us\n",
+				            count, static_cast<long>(usec(comparison)), static_cast<long>(usec(radix)));
+			}
+		}
+	} // namespace
+} // namespace Util
@@ -71,6 +71,39 @@ struct snapshot_t
 	std::vector<std::string> serverCommands;
 };
 
+// The client's snapshot ring is also published in a shared memory region
+// created by the cgame, so that it can read snapshots in place instead of
+// having the entity array serialized for every GetSnapshotMsg.
+// Must be the same as PACKET_BACKUP on the engine side.
+#define SHARED_SNAPSHOT_BACKUP 32
+#define SHARED_SNAPSHOT_MASK   ( SHARED_SNAPSHOT_BACKUP - 1 )
+
+struct sharedSnapshot_t
+{
+	// Incremented by the engine before and after writing the slot, the slot
+	// is being written when it is odd. A reader must see the same even value
+	// before and after reading for the data to be consistent.
+	std::atomic<uint32_t> generation;
+
+	int           messageNum; // snapshot number held by this slot, -1 if none
+
+	int           snapFlags;
+	int           ping;
+	int           serverTime;
+	byte          areamask[ MAX_MAP_AREA_BYTES ];
+	OpaquePlayerState ps;
+
+	// -1 if the snapshot had more than MAX_ENTITIES_IN_SNAPSHOT entities, in
+	// which case it must be fetched with GetSnapshotMsg
+	int           numEntities;
+	entityState_t entities[ MAX_ENTITIES_IN_SNAPSHOT ];
+};
+
+struct sharedSnapshotRing_t
+{
+	sharedSnapshot_t snapshots[ SHARED_SNAPSHOT_BACKUP ];
+};
+
 struct cgClientState_t
 {
 	connstate_t connState;
@@ -130,6 +163,7 @@ void            trap_R_GetTextureSize( qhandle_t handle, int *x, int *y );
 qhandle_t       trap_R_GenerateTexture( const byte *data, int x, int y );
 void            trap_GetCurrentSnapshotNumber( int *snapshotNumber, int *serverTime );
 bool        trap_GetSnapshot( int snapshotNumber, snapshot_t *snapshot );
+const sharedSnapshot_t *trap_GetSharedSnapshot( int snapshotNumber, std::vector<std::string> &serverCommands );
 int             trap_GetCurrentCmdNumber();
 bool        trap_GetUserCmd( int cmdNumber, usercmd_t *ucmd );
 void            trap_SetUserCmdValue( int stateValue, int flags, float sensitivityScale );
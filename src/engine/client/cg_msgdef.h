@@ -228,6 +228,10 @@ enum cgameImport_t
   CG_LAN_RESETPINGS,
   CG_LAN_SERVERSTATUS,
   CG_LAN_RESETSERVERSTATUS,
+
+  // Shared snapshots
+  CG_SNAPSHOT_LOCATE,
+  CG_GETSNAPSHOTCOMMANDS,
 };
 
 // All Miscs
@@ -254,6 +258,16 @@ using GetSnapshotMsg = IPC::SyncMessage<
 	IPC::Message<IPC::Id<VM::QVM, CG_GETSNAPSHOT>, int>,
 	IPC::Reply<bool, snapshot_t>
 >;
+// The cgame creates the shared snapshot ring and hands it to the engine
+using SnapshotLocateMsg = IPC::SyncMessage<
+	IPC::Message<IPC::Id<VM::QVM, CG_SNAPSHOT_LOCATE>, IPC::SharedMemory>
+>;
+// Like GetSnapshotMsg but only the server commands are sent, the rest is read
+// from the shared snapshot ring
+using GetSnapshotCommandsMsg = IPC::SyncMessage<
+	IPC::Message<IPC::Id<VM::QVM, CG_GETSNAPSHOTCOMMANDS>, int>,
+	IPC::Reply<bool, std::vector<std::string>>
+>;
 using GetCurrentCmdNumberMsg = IPC::SyncMessage<
 	IPC::Message<IPC::Id<VM::QVM, CG_GETCURRENTCMDNUMBER>>,
 	IPC::Reply<int>
@@ -269,6 +269,23 @@ void CL_FillServerCommands(std::vector<std::string>& commands, int start, int en
 	for (int i = start; i <= end; i++) {
 		const char* s = clc.serverCommands[ i & ( MAX_RELIABLE_COMMANDS - 1 ) ];
 
+		// the server packs several configstring updates in a single cs
+		// command, see SV_UpdateConfigStrings, the cgame gets them one by one
+		if (!strncmp(s, "cs ", 3)) {
+			Cmd::Args args(s);
+
+			if (args.Argc() > 3) {
+				for (int j = 1; j + 1 < args.Argc(); j += 2) {
+					std::string csText = Str::Format("cs %s %s", args.Argv(j), Cmd_QuoteString(args.Argv(j + 1).c_str()));
+					std::string cmdText = csText;
+					if (CL_HandleServerCommand(csText, cmdText)) {
+						commands.push_back(std::move(cmdText));
+					}
+				}
+				continue;
+			}
+		}
+
 		std::string cmdText = s;
 		if (CL_HandleServerCommand(s, cmdText)) {
 			commands.push_back(std::move(cmdText));
@@ -278,12 +295,15 @@ void CL_FillServerCommands(std::vector<std::string>& commands, int start, int en
 
 /*
 ====================
-CL_GetSnapshot
+CL_FindSnapshot
+
+Returns the snapshot the cgame asked for, or nullptr if it is not available
+anymore.
 ====================
 */
-bool CL_GetSnapshot( int snapshotNumber, snapshot_t *snapshot )
+static const clSnapshot_t *CL_FindSnapshot( int snapshotNumber )
 {
-	clSnapshot_t *clSnap;
+	const clSnapshot_t *clSnap;
 
 	if ( snapshotNumber > cl.snap.messageNum )
 	{
@@ -293,13 +313,53 @@ bool CL_GetSnapshot( int snapshotNumber, snapshot_t *snapshot )
 	// if the frame has fallen out of the circular buffer, we can't return it
 	if ( cl.snap.messageNum - snapshotNumber >= PACKET_BACKUP )
 	{
-		return false;
+		return nullptr;
 	}
 
 	// if the frame is not valid, we can't return it
 	clSnap = &cl.snapshots[ snapshotNumber & PACKET_MASK ];
 
 	if ( !clSnap->valid )
+	{
+		return nullptr;
+	}
+
+	return clSnap;
+}
+
+/*
+====================
+CL_GetSnapshotCommands
+
+Hands the server commands of a snapshot to the cgame, which reads the rest of
+it from the shared snapshot ring.
+====================
+*/
+bool CL_GetSnapshotCommands( int snapshotNumber, std::vector<std::string> &serverCommands )
+{
+	const clSnapshot_t *clSnap = CL_FindSnapshot( snapshotNumber );
+
+	if ( !clSnap )
+	{
+		return false;
+	}
+
+	CL_FillServerCommands(serverCommands, clc.lastExecutedServerCommand + 1, clSnap->serverCommandNum);
+	clc.lastExecutedServerCommand = clSnap->serverCommandNum;
+
+	return true;
+}
+
+/*
+====================
+CL_GetSnapshot
+====================
+*/
+bool CL_GetSnapshot( int snapshotNumber, snapshot_t *snapshot )
+{
+	const clSnapshot_t *clSnap = CL_FindSnapshot( snapshotNumber );
+
+	if ( !clSnap )
 	{
 		return false;
 	}
@@ -956,7 +1016,7 @@ void  CL_OnTeamChanged( int newTeam )
 	Cmd::BufferCommandText( "exec -f " TEAMCONFIG_NAME );
 }
 
-CGameVM::CGameVM(): VM::VMBase("cgame", Cvar::CHEAT), services(nullptr), cmdBuffer("client")
+CGameVM::CGameVM(): VM::VMBase("cgame", Cvar::CHEAT), services(nullptr), snapshotRing(nullptr), cmdBuffer("client")
 {
 }
 
@@ -993,6 +1053,60 @@ void CGameVM::CGameShutdown()
 	}
 	this->Free();
 	services = nullptr;
+	snapshotRing = nullptr;
+	snapshotShm = IPC::SharedMemory();
+}
+
+void CGameVM::SnapshotLocate(IPC::SharedMemory mem)
+{
+	static_assert(SHARED_SNAPSHOT_BACKUP == PACKET_BACKUP, "The shared snapshot ring must match the client's");
+
+	if (mem.GetSize() < sizeof(sharedSnapshotRing_t)) {
+		Sys::Drop("CGame: shared snapshot ring too small: %zu < %zu", mem.GetSize(), sizeof(sharedSnapshotRing_t));
+	}
+
+	snapshotShm = std::move(mem);
+	snapshotRing = static_cast<sharedSnapshotRing_t*>(snapshotShm.GetBase());
+
+	for (int i = 0; i < PACKET_BACKUP; i++) {
+		snapshotRing->snapshots[i].messageNum = -1;
+	}
+
+	// Publish what we already have, the cgame might look back a few snapshots
+	for (const clSnapshot_t& snap : cl.snapshots) {
+		if (snap.valid) {
+			PublishSnapshot(snap);
+		}
+	}
+}
+
+void CGameVM::PublishSnapshot(const clSnapshot_t& snap)
+{
+	if (!snapshotRing) {
+		return;
+	}
+
+	sharedSnapshot_t& slot = snapshotRing->snapshots[snap.messageNum & PACKET_MASK];
+	uint32_t generation = slot.generation.load(std::memory_order_relaxed);
+
+	slot.generation.store(generation + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	slot.messageNum = snap.messageNum;
+	slot.snapFlags = snap.snapFlags;
+	slot.ping = snap.ping;
+	slot.serverTime = snap.serverTime;
+	memcpy(slot.areamask, snap.areamask, sizeof(slot.areamask));
+	slot.ps = snap.ps;
+
+	if (snap.entities.size() > MAX_ENTITIES_IN_SNAPSHOT) {
+		slot.numEntities = -1;
+	} else {
+		slot.numEntities = snap.entities.size();
+		std::copy(snap.entities.begin(), snap.entities.end(), slot.entities);
+	}
+
+	slot.generation.store(generation + 2, std::memory_order_release);
 }
 
 void CGameVM::CGameDrawActiveFrame(int serverTime,  bool demoPlayback)
@@ -1105,6 +1219,18 @@ void CGameVM::QVMSyscall(int syscallNum, Util::Reader& reader, IPC::Channel& cha
 			});
 			break;
 
+		case CG_SNAPSHOT_LOCATE:
+			IPC::HandleMsg<SnapshotLocateMsg>(channel, std::move(reader), [this] (IPC::SharedMemory mem) {
+				SnapshotLocate(std::move(mem));
+			});
+			break;
+
+		case CG_GETSNAPSHOTCOMMANDS:
+			IPC::HandleMsg<GetSnapshotCommandsMsg>(channel, std::move(reader), [this] (int number, bool& res, std::vector<std::string>& serverCommands) {
+				res = CL_GetSnapshotCommands(number, serverCommands);
+			});
+			break;
+
 		case CG_GETCURRENTCMDNUMBER:
 			IPC::HandleMsg<GetCurrentCmdNumberMsg>(channel, std::move(reader), [this] (int& number) {
 				number = CL_GetCurrentCmdNumber();
@@ -888,23 +888,8 @@ void Con_DrawConsoleContent()
 			Con_MarginFadeAlpha( consoleState.currentAlphaFactor, lineDrawPosition, textDistanceToTop, lineDrawLowestPosition, charHeight )
 		);
 
-		re.SetColor( console_color_alpha );
-
-        for ( const auto& token : Color::Parser( consoleState.lines[row].c_str(), console_color_alpha ) )
-		{
-			if ( token.Type() == Color::Token::TokenType::COLOR )
-			{
-				Color::Color color = token.Color();
-				color.SetAlpha( console_color_alpha.Alpha() );
-				re.SetColor( color );
-			}
-			else
-			{
-				int ch = Q_UTF8_CodePoint( token.PlainText().begin() );
-				SCR_DrawConsoleFontUnichar( currentWidthLocation, floor( lineDrawPosition + 0.5 ), ch );
-				currentWidthLocation += SCR_ConsoleFontUnicharWidth( ch );
-			}
-		}
+		SCR_DrawSmallStringExt( currentWidthLocation, floor( lineDrawPosition + 0.5 ), consoleState.lines[ row ].c_str(),
+		                        console_color_alpha, false, false );
 	}
 
 	Con_DrawConsoleScrollbar( );
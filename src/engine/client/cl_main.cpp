@@ -679,6 +679,8 @@ void CL_ShutdownAll()
 	CL_ShutdownCGame();
 
 	// Clear Faces
+	SCR_ClearTextRuns();
+
 	if ( cls.consoleFont )
 	{
 		re.UnregisterFont( cls.consoleFont );
@@ -1450,6 +1452,7 @@ void CL_Vid_Restart_f()
 	// shutdown the CGame
 	CL_ShutdownCGame();
 	// clear the font cache
+	SCR_ClearTextRuns();
 	re.UnregisterFont( nullptr );
 	cls.consoleFont = nullptr;
 	// shutdown the renderer and clear the renderer interface
@@ -2526,6 +2529,7 @@ void CL_Shutdown()
 
 	if ( re.UnregisterFont )
 	{
+		SCR_ClearTextRuns();
 		re.UnregisterFont( nullptr );
 		cls.consoleFont = nullptr;
 	}
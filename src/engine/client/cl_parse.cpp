@@ -46,7 +46,8 @@ static const char *const svc_strings[ 256 ] =
 	"svc_serverCommand",
 	"svc_download",
 	"svc_snapshot",
-	"svc_EOF"
+	"svc_EOF",
+	"svc_serverCommandBlock"
 };
 
 static void SHOWNET( msg_t *msg, const char *s )
@@ -317,6 +318,7 @@ void CL_ParseSnapshot( msg_t *msg )
 
 	// save the frame off in the backup array for later delta comparisons
 	cl.snapshots[ cl.snap.messageNum & PACKET_MASK ] = cl.snap;
+	cgvm.PublishSnapshot( cl.snap );
 
 	if ( cl_shownet->integer == 3 )
 	{
@@ -465,20 +467,15 @@ void CL_ParseGamestate( msg_t *msg )
 
 /*
 =====================
-CL_ParseCommandString
+CL_StoreCommandString
 
 Command strings are just saved off until cgame asks for them
 when it transitions a snapshot
 =====================
 */
-void CL_ParseCommandString( msg_t *msg )
+static void CL_StoreCommandString( int seq, const char *s )
 {
-	char *s;
-	int  seq;
-	int  index;
-
-	seq = MSG_ReadLong( msg );
-	s = MSG_ReadString( msg );
+	int index;
 
 	// see if we have already executed stored it off
 	if ( clc.serverCommandSequence >= seq )
@@ -492,6 +489,39 @@ void CL_ParseCommandString( msg_t *msg )
 	Q_strncpyz( clc.serverCommands[ index ], s, sizeof( clc.serverCommands[ index ] ) );
 }
 
+/*
+=====================
+CL_ParseCommandString
+=====================
+*/
+void CL_ParseCommandString( msg_t *msg )
+{
+	int seq;
+
+	seq = MSG_ReadLong( msg );
+	CL_StoreCommandString( seq, MSG_ReadString( msg ) );
+}
+
+/*
+=====================
+CL_ParseCommandBlock
+
+Consecutive command strings, starting at the given sequence number
+=====================
+*/
+void CL_ParseCommandBlock( msg_t *msg )
+{
+	int seq, count, i;
+
+	seq = MSG_ReadLong( msg );
+	count = MSG_ReadByte( msg );
+
+	for ( i = 0; i < count; i++ )
+	{
+		CL_StoreCommandString( seq + i, MSG_ReadString( msg ) );
+	}
+}
+
 /*
 =====================
 CL_ParseServerMessage
@@ -567,6 +597,10 @@ void CL_ParseServerMessage( msg_t *msg )
 				CL_ParseCommandString( msg );
 				break;
 
+			case svc_serverCommandBlock:
+				CL_ParseCommandBlock( msg );
+				break;
+
 			case svc_gamestate:
 				CL_ParseGamestate( msg );
 				break;
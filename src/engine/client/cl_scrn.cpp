@@ -39,6 +39,28 @@ Maryland 20850 USA.
 
 bool scr_initialized; // ready to draw
 
+// the console font text is laid out once, as long as it is drawn
+// again every frame
+static const size_t MAX_TEXT_RUNS = 2048;
+
+struct textRunGlyph_t
+{
+	float       x; // from the start of the run
+	int         colorIndex; // in the colors of the run, -1 for the color it is drawn with
+	glyphInfo_t glyph;
+};
+
+struct textRun_t
+{
+	std::vector<textRunGlyph_t> glyphs;
+	std::vector<Color::Color>   colors;
+	int                         frameUsed;
+};
+
+static std::unordered_map<std::string, textRun_t> textRuns;
+static float textRunsKerning;
+static fontInfo_t *textRunsFont;
+
 /*
 ================
 SCR_AdjustFrom640
@@ -169,6 +191,104 @@ void SCR_DrawSmallUnichar( int x, int y, int ch )
 	}
 }
 
+/*
+==================
+SCR_ClearTextRuns
+
+The glyphs of the runs belong to the console font, they must be
+cleared whenever it is unregistered
+==================
+*/
+void SCR_ClearTextRuns()
+{
+	textRuns.clear();
+}
+
+/*
+==================
+SCR_ConsoleFontTextRun
+
+Lays out a string the first time it is drawn with a style. The color
+is part of the style for the colors of the ^* escapes, but not its alpha
+==================
+*/
+static const textRun_t &SCR_ConsoleFontTextRun( const char *string, const Color::Color &setColor, bool forceColor, bool noColorEscape )
+{
+	if ( textRunsKerning != cl_consoleFontKerning->value || textRunsFont != cls.consoleFont )
+	{
+		textRuns.clear();
+		textRunsKerning = cl_consoleFontKerning->value;
+		textRunsFont = cls.consoleFont;
+	}
+
+	float       rgb[ 3 ] = { setColor.Red(), setColor.Green(), setColor.Blue() };
+	std::string key = string;
+
+	key += '\0';
+	key += static_cast<char>( forceColor | noColorEscape << 1 );
+	key.append( reinterpret_cast<const char *>( rgb ), sizeof( rgb ) );
+
+	auto it = textRuns.find( key );
+
+	if ( it != textRuns.end() )
+	{
+		it->second.frameUsed = cls.framecount;
+		return it->second;
+	}
+
+	// only the runs drawn this frame are kept
+	if ( textRuns.size() >= MAX_TEXT_RUNS )
+	{
+		for ( it = textRuns.begin(); it != textRuns.end(); )
+		{
+			if ( it->second.frameUsed != cls.framecount )
+			{
+				it = textRuns.erase( it );
+			}
+			else
+			{
+				++it;
+			}
+		}
+	}
+
+	textRun_t run;
+	float     x = 0;
+	int       colorIndex = -1;
+
+	run.frameUsed = cls.framecount;
+
+	for ( const auto& token : Color::Parser( string, setColor ) )
+	{
+		if ( !forceColor && token.Type() == Color::Token::TokenType::COLOR )
+		{
+			run.colors.push_back( token.Color() );
+			colorIndex = run.colors.size() - 1;
+		}
+
+		Str::StringView text = noColorEscape ? token.RawToken() : token.PlainText();
+		for ( const char *p = text.begin(); p < text.end(); p += Q_UTF8_Width( p ) )
+		{
+			int   ch = Q_UTF8_CodePoint( p );
+			float width = SCR_ConsoleFontUnicharWidth( ch );
+
+			if ( ch != ' ' )
+			{
+				textRunGlyph_t glyph;
+
+				re.GlyphChar( cls.consoleFont, ch, &glyph.glyph );
+				glyph.x = x + ( width - glyph.glyph.xSkip ) / 2.0;
+				glyph.colorIndex = colorIndex;
+				run.glyphs.push_back( glyph );
+			}
+
+			x += width;
+		}
+	}
+
+	return textRuns.emplace( std::move( key ), std::move( run ) ).first->second;
+}
+
 /*
 ==================
 SCR_DrawSmallString[Color]
@@ -179,7 +299,7 @@ to a fixed color.
 Coordinates are at 640 by 480 virtual resolution
 ==================
 */
-void SCR_DrawSmallStringExt( int x, int y, const char *string,
+void SCR_DrawSmallStringExt( float x, int y, const char *string,
 							 const Color::Color &setColor, bool forceColor, bool noColorEscape )
 {
 	float      xx;
@@ -188,6 +308,31 @@ void SCR_DrawSmallStringExt( int x, int y, const char *string,
 	xx = x;
 	re.SetColor( setColor );
 
+	if ( !cls.useLegacyConsoleFont )
+	{
+		const textRun_t &run = SCR_ConsoleFontTextRun( string, setColor, forceColor, noColorEscape );
+		int colorIndex = -1;
+
+		for ( const textRunGlyph_t &glyph : run.glyphs )
+		{
+			if ( glyph.colorIndex != colorIndex )
+			{
+				Color::Color color = run.colors[ glyph.colorIndex ];
+				color.SetAlpha( setColor.Alpha() );
+				re.SetColor( color );
+				colorIndex = glyph.colorIndex;
+			}
+
+			re.DrawStretchPic( xx + glyph.x, y - glyph.glyph.top, glyph.glyph.imageWidth, glyph.glyph.imageHeight,
+			                   glyph.glyph.s, glyph.glyph.t,
+			                   glyph.glyph.s2, glyph.glyph.t2,
+			                   glyph.glyph.glyph );
+		}
+
+		re.SetColor( Color::White );
+		return;
+	}
+
 	for ( const auto& token : Color::Parser( string, setColor ) )
 	{
 		if ( !forceColor && token.Type() == Color::Token::TokenType::COLOR )
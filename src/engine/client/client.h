@@ -353,12 +353,20 @@ public:
 	void CGameRocketFrame();
 	void CGameConsoleLine(const std::string& str);
 
+	// Copies a freshly parsed snapshot to the shared snapshot ring, if the cgame mapped one
+	void PublishSnapshot(const clSnapshot_t& snap);
+
 private:
 	virtual void Syscall(uint32_t id, Util::Reader reader, IPC::Channel& channel) override final;
 	void QVMSyscall(int syscallNum, Util::Reader& reader, IPC::Channel& channel);
 
+	void SnapshotLocate(IPC::SharedMemory mem);
+
 	std::unique_ptr<VM::CommonVMServices> services;
 
+	IPC::SharedMemory snapshotShm;
+	sharedSnapshotRing_t* snapshotRing;
+
     class CmdBuffer: public IPC::CommandBufferHost {
         public:
             CmdBuffer(std::string name);
@@ -658,7 +666,8 @@ void  SCR_UpdateScreen();
 void  SCR_AdjustFrom640( float *x, float *y, float *w, float *h );
 void  SCR_FillRect( float x, float y, float width, float height, const Color::Color& color );
 
-void  SCR_DrawSmallStringExt( int x, int y, const char *string, const Color::Color& setColor, bool forceColor, bool noColorEscape );
+void  SCR_DrawSmallStringExt( float x, int y, const char *string, const Color::Color& setColor, bool forceColor, bool noColorEscape );
+void  SCR_ClearTextRuns();
 void  SCR_DrawSmallUnichar( int x, int y, int ch );
 void  SCR_DrawConsoleFontUnichar( float x, float y, int ch );
 float SCR_ConsoleFontCharWidth( const char *s );
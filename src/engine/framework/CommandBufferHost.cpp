@@ -32,7 +32,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 namespace IPC {
 
-    CommandBufferHost::CommandBufferHost(std::string name): name(name), logs(name + ".commandBufferHost") {
+    CommandBufferHost::CommandBufferHost(std::string name): name(name), logs(name + ".commandBufferHost"), profiler(name + ".commandBuffer") {
     }
 
     void CommandBufferHost::Syscall(int index, Util::Reader& reader, IPC::Channel& channel) {
@@ -74,7 +74,15 @@ namespace IPC {
                 uint32_t id = reader.Read<uint32_t>();
                 int major = id >> 16;
                 int minor = id & 0xffff;
-                this->HandleCommandBufferSyscall(major, minor, reader);
+
+                if (MessageProfiler::IsEnabled()) {
+                    size_t size = reader.GetData().size();
+                    auto start = Sys::SteadyClock::now();
+                    this->HandleCommandBufferSyscall(major, minor, reader);
+                    profiler.Record(MessageProfiler::Direction::COMMAND_BUFFER, false, id, size, Sys::SteadyClock::now() - start);
+                } else {
+                    this->HandleCommandBufferSyscall(major, minor, reader);
+                }
             }
             //TODO add more logic to stop consuming (e.g. when the socket is ready)
         }
@@ -33,6 +33,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "common/IPC/CommandBuffer.h"
 #include "common/Serialize.h"
+#include "MessageProfiler.h"
 
 namespace IPC {
 
@@ -49,6 +50,7 @@ namespace IPC {
             Log::Logger logs;
             IPC::CommandBuffer buffer;
             IPC::SharedMemory shm;
+            MessageProfiler profiler;
 
             virtual void HandleCommandBufferSyscall(int major, int minor, Util::Reader& reader) = 0;
 
@@ -0,0 +1,220 @@
+/*
+===========================================================================
+Daemon BSD Source Code
+Copyright (c) 2013-2016, Daemon Developers
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Daemon developers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL DAEMON DEVELOPERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+===========================================================================
+*/
+
+#include "MessageProfiler.h"
+
+namespace IPC {
+
+    static Cvar::Cvar<bool> profileMessages("vm.profileMessages", "record count, traffic and latency of the VM messages, see /vmProfile", Cvar::NONE, false);
+
+    static std::vector<MessageProfiler*>& Profilers() {
+        static std::vector<MessageProfiler*> profilers;
+        return profilers;
+    }
+
+    static const char* DirectionName(MessageProfiler::Direction direction) {
+        switch (direction) {
+            case MessageProfiler::Direction::ENGINE_TO_VM:
+                return "E->V";
+            case MessageProfiler::Direction::VM_TO_ENGINE:
+                return "V->E";
+            case MessageProfiler::Direction::COMMAND_BUFFER:
+                return "cmdbuf";
+        }
+        return "?";
+    }
+
+    MessageProfiler::MessageProfiler(std::string name): name(std::move(name)) {
+        Profilers().push_back(this);
+    }
+
+    MessageProfiler::~MessageProfiler() {
+        auto& profilers = Profilers();
+        profilers.erase(std::remove(profilers.begin(), profilers.end(), this), profilers.end());
+    }
+
+    bool MessageProfiler::IsEnabled() {
+        return profileMessages.Get();
+    }
+
+    int MessageProfiler::Bucket(uint64_t ns) {
+        if (ns < (1 << SUB_BUCKET_BITS)) {
+            return ns;
+        }
+
+        int msb = 0;
+        while (ns >> (msb + 1)) {
+            msb++;
+        }
+
+        int sub = (ns >> (msb - SUB_BUCKET_BITS)) & ((1 << SUB_BUCKET_BITS) - 1);
+        return (msb << SUB_BUCKET_BITS) + sub;
+    }
+
+    uint64_t MessageProfiler::BucketUpperBound(int bucket) {
+        int msb = bucket >> SUB_BUCKET_BITS;
+        uint64_t sub = bucket & ((1 << SUB_BUCKET_BITS) - 1);
+
+        if (msb < SUB_BUCKET_BITS) {
+            return bucket;
+        }
+
+        return (((1 << SUB_BUCKET_BITS) + sub + 1) << (msb - SUB_BUCKET_BITS)) - 1;
+    }
+
+    uint64_t MessageProfiler::Stats::Percentile(float fraction) const {
+        uint64_t target = std::max<uint64_t>(1, std::ceil(count * fraction));
+        uint64_t seen = 0;
+
+        for (int i = 0; i < NUM_BUCKETS; i++) {
+            seen += histogram[i];
+            if (seen >= target) {
+                return std::min(BucketUpperBound(i), maxNs);
+            }
+        }
+
+        return maxNs;
+    }
+
+    void MessageProfiler::Record(Direction direction, bool sync, uint32_t id, size_t bytes, Sys::SteadyClock::duration duration) {
+        uint64_t key = (uint64_t(id) << 32) | (Util::ordinal(direction) << 1) | sync;
+        auto it = stats.find(key);
+
+        if (it == stats.end()) {
+            Stats fresh{};
+            fresh.direction = direction;
+            fresh.sync = sync;
+            fresh.id = id;
+            it = stats.emplace(key, fresh).first;
+        }
+
+        uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+        Stats& s = it->second;
+        s.count++;
+        s.bytes += bytes;
+        s.totalNs += ns;
+        s.maxNs = std::max(s.maxNs, ns);
+        s.histogram[Bucket(ns)]++;
+    }
+
+    void MessageProfiler::Reset() {
+        stats.clear();
+    }
+
+    std::vector<const MessageProfiler::Stats*> MessageProfiler::SortedStats() const {
+        std::vector<const Stats*> sorted;
+        for (const auto& it : stats) {
+            sorted.push_back(&it.second);
+        }
+
+        std::sort(sorted.begin(), sorted.end(), [](const Stats* a, const Stats* b) {
+            return a->totalNs > b->totalNs;
+        });
+        return sorted;
+    }
+
+    std::vector<std::string> MessageProfiler::Dump() const {
+        std::vector<std::string> lines;
+
+        for (const Stats* s : SortedStats()) {
+            lines.push_back(Str::Format("%-6s %-5s %3d:%-3d %8d msgs %10d bytes %9.3f ms total  p50 %8.1f us  p99 %8.1f us  max %8.1f us",
+                DirectionName(s->direction), s->sync ? "sync" : "async", s->id >> 16, s->id & 0xffff,
+                s->count, s->bytes, s->totalNs / 1.0e6,
+                s->Percentile(0.5f) / 1.0e3, s->Percentile(0.99f) / 1.0e3, s->maxNs / 1.0e3));
+        }
+
+        return lines;
+    }
+
+    void MessageProfiler::WriteCSV(FS::File& file) const {
+        for (const Stats* s : SortedStats()) {
+            file.Printf("%s,%s,%s,%d,%d,%d,%d,%d,%d,%d,%d\n",
+                name, DirectionName(s->direction), s->sync ? "sync" : "async", s->id >> 16, s->id & 0xffff,
+                s->count, s->bytes, s->totalNs, s->Percentile(0.5f), s->Percentile(0.99f), s->maxNs);
+        }
+    }
+
+    class VMProfileCmd: public Cmd::StaticCmd {
+        public:
+            VMProfileCmd(): StaticCmd("vmProfile", Cmd::BASE, "shows the VM message profile, see vm.profileMessages") {
+            }
+
+            void Run(const Cmd::Args& args) const override {
+                if (args.Argc() == 2 && args.Argv(1) == "reset") {
+                    for (MessageProfiler* profiler : Profilers()) {
+                        profiler->Reset();
+                    }
+                    return;
+                }
+
+                if (args.Argc() == 3 && args.Argv(1) == "csv") {
+                    std::error_code err;
+                    FS::File file = FS::HomePath::OpenWrite(args.Argv(2), err);
+                    if (err) {
+                        Print("Couldn't open %s: %s", args.Argv(2), err.message());
+                        return;
+                    }
+
+                    try {
+                        file.Printf("vm,direction,type,major,minor,count,bytes,total_ns,p50_ns,p99_ns,max_ns\n");
+                        for (const MessageProfiler* profiler : Profilers()) {
+                            profiler->WriteCSV(file);
+                        }
+                    } catch (std::system_error& writeErr) {
+                        Print("Error while writing %s: %s", args.Argv(2), writeErr.what());
+                    }
+                    return;
+                }
+
+                if (args.Argc() != 1) {
+                    PrintUsage(args, "[reset | csv <file>]");
+                    return;
+                }
+
+                if (!MessageProfiler::IsEnabled()) {
+                    Print("VM message profiling is disabled, set vm.profileMessages to 1 to enable it");
+                }
+
+                for (const MessageProfiler* profiler : Profilers()) {
+                    std::vector<std::string> lines = profiler->Dump();
+                    if (lines.empty()) {
+                        continue;
+                    }
+
+                    Print("^3%s:", profiler->GetName());
+                    for (const std::string& line : lines) {
+                        Print(line);
+                    }
+                }
+            }
+    };
+    static VMProfileCmd vmProfileCmdRegistration;
+
+} // namespace IPC
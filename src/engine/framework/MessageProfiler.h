@@ -0,0 +1,108 @@
+/*
+===========================================================================
+Daemon BSD Source Code
+Copyright (c) 2013-2016, Daemon Developers
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Daemon developers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL DAEMON DEVELOPERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+===========================================================================
+*/
+
+#ifndef FRAMEWORK_MESSAGE_PROFILER_H_
+#define FRAMEWORK_MESSAGE_PROFILER_H_
+
+#include "common/Common.h"
+#include "common/FileSystem.h"
+#include "common/IPC/Channel.h"
+
+namespace IPC {
+
+    template<typename Msg> struct IsSyncMessage: std::false_type {};
+    template<typename Msg, typename Reply> struct IsSyncMessage<SyncMessage<Msg, Reply>>: std::true_type {};
+
+    /*
+     * Keeps counts, traffic and a latency histogram for every message ID that
+     * crosses a VM boundary, either through the root socket or through a
+     * command buffer. Profiling is enabled with vm.profileMessages and the
+     * results of all the profilers are shown with /vmProfile.
+     *
+     * Latencies and traffic are inclusive: a synchronous message sent by the
+     * engine accounts for the time and bytes of the syscalls the VM made while
+     * handling it.
+     */
+    class MessageProfiler {
+        public:
+            enum class Direction {
+                ENGINE_TO_VM,
+                VM_TO_ENGINE,
+                COMMAND_BUFFER,
+            };
+
+            MessageProfiler(std::string name);
+            ~MessageProfiler();
+
+            MessageProfiler(const MessageProfiler&) = delete;
+            MessageProfiler& operator=(const MessageProfiler&) = delete;
+
+            static bool IsEnabled();
+
+            void Record(Direction direction, bool sync, uint32_t id, size_t bytes, Sys::SteadyClock::duration duration);
+            void Reset();
+
+            const std::string& GetName() const {
+                return name;
+            }
+
+            // One line per message ID, sorted by total time
+            std::vector<std::string> Dump() const;
+            void WriteCSV(FS::File& file) const;
+
+        private:
+            // 4 sub-buckets per power of two of nanoseconds
+            static const int SUB_BUCKET_BITS = 2;
+            static const int NUM_BUCKETS = 64 << SUB_BUCKET_BITS;
+
+            struct Stats {
+                Direction direction;
+                bool sync;
+                uint32_t id;
+                uint64_t count;
+                uint64_t bytes;
+                uint64_t totalNs;
+                uint64_t maxNs;
+                std::array<uint32_t, NUM_BUCKETS> histogram;
+
+                uint64_t Percentile(float fraction) const;
+            };
+
+            static int Bucket(uint64_t ns);
+            static uint64_t BucketUpperBound(int bucket);
+
+            std::vector<const Stats*> SortedStats() const;
+
+            std::string name;
+            std::unordered_map<uint64_t, Stats> stats;
+    };
+}
+
+#endif // FRAMEWORK_MESSAGE_PROFILER_H_
@@ -343,7 +343,7 @@ static std::pair<Sys::OSHandle, IPC::Socket> CreateNativeVM(std::pair<IPC::Socke
 	return InternalLoadModule(std::move(pair), args.data(), true);
 }
 
-static IPC::Socket CreateInProcessNativeVM(std::pair<IPC::Socket, IPC::Socket> pair, Str::StringRef name, VM::VMBase::InProcessInfo& inProcess) {
+static IPC::Channel CreateInProcessNativeVM(std::pair<IPC::Socket, IPC::Socket> pair, Str::StringRef name, VM::VMBase::InProcessInfo& inProcess, bool usePipe) {
 	std::string filename = FS::Path::Build(FS::GetLibPath(), name + "-native-dll" + DLL_EXT);
 
 	Log::Notice("Loading VM module %s...", filename.c_str());
@@ -353,6 +353,33 @@ static IPC::Socket CreateInProcessNativeVM(std::pair<IPC::Socket, IPC::Socket> p
 	if (!inProcess.sharedLib)
 		Sys::Drop("VM: Failed to load shared library VM %s: %s", filename, errorString);
 
+	// Modules built before the in-process pipe existed only have vmMain
+	if (usePipe) {
+		auto vmMainInProcessPipe = inProcess.sharedLib.LoadSym<void(IPC::InProcessPipe*)>("vmMainInProcessPipe", errorString);
+		if (vmMainInProcessPipe) {
+			// The thread keeps its own reference in case it has to be detached
+			std::shared_ptr<IPC::InProcessPipe> pipe = std::make_shared<IPC::InProcessPipe>();
+			inProcess.pipe = pipe;
+			inProcess.running = true;
+			try {
+				inProcess.thread = std::thread([vmMainInProcessPipe, pipe, &inProcess]() {
+					vmMainInProcessPipe(pipe.get());
+
+					std::lock_guard<std::mutex> lock(inProcess.mutex);
+					inProcess.running = false;
+					inProcess.condition.notify_one();
+				});
+			} catch (std::system_error& err) {
+				inProcess.pipe = nullptr;
+				inProcess.running = false;
+				Sys::Drop("VM: Could not create thread for VM: %s", err.what());
+			}
+
+			return IPC::Channel(pipe.get(), IPC::InProcessPipe::ENGINE_SIDE);
+		}
+		Log::Notice("%s doesn't support the in-process pipe, using a socket pair", filename);
+	}
+
 	auto vmMain = inProcess.sharedLib.LoadSym<void(Sys::OSHandle)>("vmMain", errorString);
 	if (!vmMain)
 		Sys::Drop("VM: Could not find vmMain function in %s: %s", filename, errorString);
@@ -374,7 +401,7 @@ static IPC::Socket CreateInProcessNativeVM(std::pair<IPC::Socket, IPC::Socket> p
 		Sys::Drop("VM: Could not create thread for VM: %s", err.what());
 	}
 
-	return std::move(pair.first);
+	return IPC::Channel(std::move(pair.first));
 }
 
 uint32_t VMBase::Create()
@@ -404,12 +431,13 @@ uint32_t VMBase::Create()
 	IPC::Socket rootSocket;
 	if (type == TYPE_NACL || type == TYPE_NACL_LIBPATH) {
 		std::tie(processHandle, rootSocket) = CreateNaClVM(std::move(pair), name, params.debug.Get(), type == TYPE_NACL, params.debugLoader.Get());
+		rootChannel = IPC::Channel(std::move(rootSocket));
 	} else if (type == TYPE_NATIVE_EXE) {
 		std::tie(processHandle, rootSocket) = CreateNativeVM(std::move(pair), name, params.debug.Get());
+		rootChannel = IPC::Channel(std::move(rootSocket));
 	} else {
-		rootSocket = CreateInProcessNativeVM(std::move(pair), name, inProcess);
+		rootChannel = CreateInProcessNativeVM(std::move(pair), name, inProcess, params.inProcessPipe.Get());
 	}
-	rootChannel = IPC::Channel(std::move(rootSocket));
 
 	if (type != TYPE_NATIVE_DLL && params.debug.Get())
 		Log::Notice("Waiting for GDB connection on localhost:4014");
@@ -427,6 +455,11 @@ uint32_t VMBase::Create()
 }
 
 void VMBase::FreeInProcessVM() {
+	// Wakes up the VM if it was waiting on the pipe, like closing the socket would
+	if (inProcess.pipe) {
+		inProcess.pipe->Close();
+	}
+
 	if (inProcess.thread.joinable()) {
 		bool wait = true;
 		if (inProcess.running) {
@@ -447,6 +480,7 @@ void VMBase::FreeInProcessVM() {
 	}
 
 	inProcess.sharedLib.Close();
+	inProcess.pipe = nullptr;
 	inProcess.running = false;
 }
 
@@ -467,6 +501,36 @@ void VMBase::LogMessage(bool vmToEngine, bool start, int id)
 	}
 }
 
+VMBase::MessageSample VMBase::BeginMessageSample() const
+{
+	MessageSample sample;
+	sample.enabled = IPC::MessageProfiler::IsEnabled();
+	if (sample.enabled) {
+		sample.start = Sys::SteadyClock::now();
+		sample.bytes = rootChannel.bytesSent + rootChannel.bytesReceived;
+		sample.replies = rootChannel.repliesSent;
+	}
+	return sample;
+}
+
+void VMBase::EndMessageSample(const MessageSample& sample, bool sync, uint32_t id)
+{
+	if (sample.enabled) {
+		uint64_t bytes = rootChannel.bytesSent + rootChannel.bytesReceived - sample.bytes;
+		profiler.Record(IPC::MessageProfiler::Direction::ENGINE_TO_VM, sync, id, bytes, Sys::SteadyClock::now() - sample.start);
+	}
+}
+
+void VMBase::EndSyscallSample(const MessageSample& sample, uint32_t id, size_t size)
+{
+	if (sample.enabled) {
+		// Only synchronous syscalls get a reply, and it is the last thing the handler sends
+		bool sync = rootChannel.repliesSent != sample.replies;
+		uint64_t bytes = size + rootChannel.bytesSent + rootChannel.bytesReceived - sample.bytes;
+		profiler.Record(IPC::MessageProfiler::Direction::VM_TO_ENGINE, sync, id, bytes, Sys::SteadyClock::now() - sample.start);
+	}
+}
+
 void VMBase::Free()
 {
 	if (syscallLogFile) {
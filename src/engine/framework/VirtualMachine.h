@@ -31,6 +31,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <common/FileSystem.h>
 #include "common/Common.h"
 #include "common/IPC/Channel.h"
+#include "framework/MessageProfiler.h"
 
 #ifndef VIRTUALMACHINE_H_
 #define VIRTUALMACHINE_H_
@@ -98,20 +99,22 @@ struct VMParams {
 		  vmType("vm." + name + ".type", "how the vm should be loaded for " + name, vmTypeFlags,
 		         Util::ordinal(vmType_t::TYPE_NACL), 0, Util::ordinal(vmType_t::TYPE_END) - 1),
 		  debug("vm." + name + ".debug", "run a gdbserver on localhost:4014 to debug the VM", Cvar::NONE, false),
-		  debugLoader("vm." + name + ".debugLoader", "make nacl_loader dump information to " + name + "-nacl_loader.log", Cvar::NONE, 1, 0, 5) {
+		  debugLoader("vm." + name + ".debugLoader", "make nacl_loader dump information to " + name + "-nacl_loader.log", Cvar::NONE, 1, 0, 5),
+		  inProcessPipe("vm." + name + ".inProcessPipe", "talk to a native DLL " + name + " through memory instead of a socket pair", Cvar::NONE, true) {
 	}
 
 	Cvar::Cvar<bool> logSyscalls;
 	Cvar::Range<Cvar::Cvar<int>> vmType;
 	Cvar::Cvar<bool> debug;
 	Cvar::Range<Cvar::Cvar<int>> debugLoader;
+	Cvar::Cvar<bool> inProcessPipe;
 };
 
 // Base class for a virtual machine instance
 class VMBase {
 public:
 	VMBase(std::string name, int vmTypeCvarFlags)
-		: processHandle(Sys::INVALID_HANDLE), name(name), type(TYPE_NACL), params(name, vmTypeCvarFlags) {}
+		: processHandle(Sys::INVALID_HANDLE), name(name), type(TYPE_NACL), params(name, vmTypeCvarFlags), profiler(name) {}
 
 	// Create the VM for the named module. Returns the ABI version reported
 	// by the module. This will automatically free any existing VM.
@@ -136,13 +139,18 @@ public:
 	template<typename Msg, typename... Args> void SendMsg(Args&&... args)
 	{
 		// Marking lambda as mutable to work around a bug in gcc 4.6
+		MessageSample sample = BeginMessageSample();
 		LogMessage(false, true, Msg::id);
 		IPC::SendMsg<Msg>(rootChannel, [this](uint32_t id, Util::Reader reader) mutable {
 			LogMessage(true, true, id);
+			MessageSample syscallSample = BeginMessageSample();
+			size_t size = reader.GetData().size();
 			Syscall(id, std::move(reader), rootChannel);
+			EndSyscallSample(syscallSample, id, size);
 			LogMessage(true, false, id);
 		}, std::forward<Args>(args)...);
 		LogMessage(false, false, Msg::id);
+		EndMessageSample(sample, IPC::IsSyncMessage<Msg>::value, Msg::id);
 	}
 
 	struct InProcessInfo {
@@ -150,6 +158,7 @@ public:
 		std::mutex mutex;
 		std::condition_variable condition;
 		Sys::DynamicLib sharedLib;
+		std::shared_ptr<IPC::InProcessPipe> pipe;
 		bool running;
 
 		InProcessInfo()
@@ -182,6 +191,20 @@ private:
 	FS::File syscallLogFile;
 
 	void LogMessage(bool vmToEngine, bool start, int id);
+
+	// Profiling the messages
+	IPC::MessageProfiler profiler;
+
+	struct MessageSample {
+		bool enabled;
+		Sys::SteadyClock::time_point start;
+		uint64_t bytes;
+		uint64_t replies;
+	};
+
+	MessageSample BeginMessageSample() const;
+	void EndMessageSample(const MessageSample& sample, bool sync, uint32_t id);
+	void EndSyscallSample(const MessageSample& sample, uint32_t id, size_t size);
 };
 
 } // namespace VM
@@ -228,7 +228,7 @@ The server you are attempting to join is running an incompatible version of the
 The server you attempted to join is running an incompatible version of the game.\n\
 You or the server may be running older versions of the game."
 
-#define PROTOCOL_VERSION       86
+#define PROTOCOL_VERSION       87
 
 #define URI_SCHEME             GAMENAME_STRING "://"
 #define URI_SCHEME_LENGTH      ( ARRAY_LEN( URI_SCHEME ) - 1 )
@@ -253,6 +253,9 @@ enum svc_ops_e
   svc_download, // [short] size [size bytes]
   svc_snapshot,
   svc_EOF,
+
+  // added after svc_EOF so that older demos still parse
+  svc_serverCommandBlock, // [long] first sequence [byte] count [string]*count
 };
 
 //
@@ -0,0 +1,233 @@
+/*
+===========================================================================
+Daemon BSD Source Code
+Copyright (c) 2026, Daemon Developers
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Daemon developers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL DAEMON DEVELOPERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+===========================================================================
+*/
+
+#ifndef FRUSTUMCULL_H
+#define FRUSTUMCULL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "common/Platform.h"
+
+/*
+ * Culls many boxes against a frustum at once. The boxes are stored one
+ * array per coordinate so that with SSE2 four boxes are tested against a
+ * plane in one go, other platforms use the same loop one box at a time.
+ * The results are the same as BoxOnPlaneSide on each plane.
+ */
+namespace FrustumCull {
+
+    static const int MAX_PLANES = 6;
+
+    struct Frustum
+    {
+        float normal[ MAX_PLANES ][ 3 ];
+        float dist[ MAX_PLANES ];
+        int numPlanes = 0;
+
+        void SetPlane( int i, const float planeNormal[ 3 ], float planeDist )
+        {
+            normal[ i ][ 0 ] = planeNormal[ 0 ];
+            normal[ i ][ 1 ] = planeNormal[ 1 ];
+            normal[ i ][ 2 ] = planeNormal[ 2 ];
+            dist[ i ] = planeDist;
+        }
+    };
+
+    /*
+     * Bounds of the boxes to cull, one array per axis
+     */
+    class Boxes
+    {
+    public:
+        void Clear()
+        {
+            for ( std::vector<float>& v : mins ) v.clear();
+            for ( std::vector<float>& v : maxs ) v.clear();
+        }
+
+        void Add( const float boxMins[ 3 ], const float boxMaxs[ 3 ] )
+        {
+            for ( int j = 0; j < 3; j++ )
+            {
+                mins[ j ].push_back( boxMins[ j ] );
+                maxs[ j ].push_back( boxMaxs[ j ] );
+            }
+        }
+
+        size_t Size() const
+        {
+            return mins[ 0 ].size();
+        }
+
+        std::vector<float> mins[ 3 ];
+        std::vector<float> maxs[ 3 ];
+    };
+
+    /*
+     * One bit per box: outside is set when the box is entirely behind one
+     * of the planes, clipped when it is not entirely in front of all of
+     * them. A box with neither bit set is entirely inside.
+     */
+    struct Result
+    {
+        std::vector<uint32_t> outside;
+        std::vector<uint32_t> clipped;
+
+        bool Outside( size_t i ) const
+        {
+            return outside[ i / 32 ] & ( 1u << ( i % 32 ) );
+        }
+
+        bool Clipped( size_t i ) const
+        {
+            return clipped[ i / 32 ] & ( 1u << ( i % 32 ) );
+        }
+    };
+
+    namespace detail {
+
+        // Returns the planes the box is behind in bit 0 and the planes it
+        // crosses in bit 1, for boxes[ i ] only
+        inline int CullOne( const Frustum& frustum, int planeBits, const Boxes& boxes, size_t i )
+        {
+            int result = 0;
+
+            for ( int p = 0; p < frustum.numPlanes; p++ )
+            {
+                if ( !( planeBits & ( 1 << p ) ) )
+                {
+                    continue;
+                }
+
+                // the corners furthest along and against the normal
+                float front = 0.0f, back = 0.0f;
+
+                for ( int j = 0; j < 3; j++ )
+                {
+                    float n = frustum.normal[ p ][ j ];
+                    float lo = n * boxes.mins[ j ][ i ];
+                    float hi = n * boxes.maxs[ j ][ i ];
+
+                    front += n < 0 ? lo : hi;
+                    back += n < 0 ? hi : lo;
+                }
+
+                if ( front < frustum.dist[ p ] )
+                {
+                    result |= 1;
+                }
+
+                if ( back < frustum.dist[ p ] )
+                {
+                    result |= 2;
+                }
+            }
+
+            return result;
+        }
+    }
+
+    /*
+     * Tests the boxes against the planes of the frustum that are set in
+     * planeBits, the other planes are treated as if every box was in front.
+     */
+    inline void Cull( const Frustum& frustum, int planeBits, const Boxes& boxes, Result& result )
+    {
+        size_t count = boxes.Size();
+        size_t numWords = ( count + 31 ) / 32;
+        size_t i = 0;
+
+        result.outside.assign( numWords, 0 );
+        result.clipped.assign( numWords, 0 );
+
+#if idx86_sse >= 2
+        // four boxes at a time, the sign of the normal picks which of
+        // mins and maxs gives the corners along and against it
+        for ( ; i + 4 <= count; i += 4 )
+        {
+            __m128i outside = _mm_setzero_si128();
+            __m128i clipped = _mm_setzero_si128();
+
+            for ( int p = 0; p < frustum.numPlanes; p++ )
+            {
+                if ( !( planeBits & ( 1 << p ) ) )
+                {
+                    continue;
+                }
+
+                __m128 front = _mm_setzero_ps();
+                __m128 back = _mm_setzero_ps();
+
+                for ( int j = 0; j < 3; j++ )
+                {
+                    float n = frustum.normal[ p ][ j ];
+                    __m128 normal = _mm_set1_ps( n );
+                    __m128 lo = _mm_mul_ps( normal, _mm_loadu_ps( &boxes.mins[ j ][ i ] ) );
+                    __m128 hi = _mm_mul_ps( normal, _mm_loadu_ps( &boxes.maxs[ j ][ i ] ) );
+
+                    front = _mm_add_ps( front, n < 0 ? lo : hi );
+                    back = _mm_add_ps( back, n < 0 ? hi : lo );
+                }
+
+                __m128 dist = _mm_set1_ps( frustum.dist[ p ] );
+
+                outside = _mm_or_si128( outside, _mm_castps_si128( _mm_cmplt_ps( front, dist ) ) );
+                clipped = _mm_or_si128( clipped, _mm_castps_si128( _mm_cmplt_ps( back, dist ) ) );
+            }
+
+            uint32_t outsideBits = _mm_movemask_ps( _mm_castsi128_ps( outside ) );
+            uint32_t clippedBits = _mm_movemask_ps( _mm_castsi128_ps( clipped ) );
+
+            // i is a multiple of 4 so the four bits are in the same word
+            result.outside[ i / 32 ] |= outsideBits << ( i % 32 );
+            result.clipped[ i / 32 ] |= clippedBits << ( i % 32 );
+        }
+#endif
+
+        for ( ; i < count; i++ )
+        {
+            int r = detail::CullOne( frustum, planeBits, boxes, i );
+
+            if ( r & 1 )
+            {
+                result.outside[ i / 32 ] |= 1u << ( i % 32 );
+            }
+
+            if ( r & 2 )
+            {
+                result.clipped[ i / 32 ] |= 1u << ( i % 32 );
+            }
+        }
+    }
+}
+
+#endif // FRUSTUMCULL_H
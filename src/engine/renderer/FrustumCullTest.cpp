@@ -0,0 +1,201 @@
+/*
+===========================================================================
+Daemon BSD Source Code
+Copyright (c) 2026, Daemon Developers
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Daemon developers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL DAEMON DEVELOPERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+===========================================================================
+*/
+
+#include <array>
+#include <random>
+#include <gtest/gtest.h>
+#include "engine/qcommon/q_shared.h"
+#include "FrustumCull.h"
+
+namespace FrustumCull {
+namespace {
+
+enum class Visibility { In, Clip, Out };
+
+// Same as R_CullBox, which needs the renderer
+Visibility CullBox( const cplane_t* planes, int numPlanes, vec3_t bounds[ 2 ] )
+{
+    bool anyClip = false;
+
+    for ( int i = 0; i < numPlanes; i++ )
+    {
+        int r = BoxOnPlaneSide( bounds[ 0 ], bounds[ 1 ], &planes[ i ] );
+
+        if ( r == 2 )
+        {
+            return Visibility::Out;
+        }
+
+        if ( r == 3 )
+        {
+            anyClip = true;
+        }
+    }
+
+    return anyClip ? Visibility::Clip : Visibility::In;
+}
+
+Visibility FromResult( const Result& result, size_t i )
+{
+    if ( result.Outside( i ) )
+    {
+        return Visibility::Out;
+    }
+
+    return result.Clipped( i ) ? Visibility::Clip : Visibility::In;
+}
+
+class FrustumCullTest : public testing::Test
+{
+protected:
+    void MakePlanes( int numPlanes, bool axial )
+    {
+        std::uniform_real_distribution<float> coord( -1.0f, 1.0f );
+
+        frustum.numPlanes = numPlanes;
+
+        for ( int i = 0; i < numPlanes; i++ )
+        {
+            cplane_t& plane = planes[ i ];
+
+            if ( axial )
+            {
+                VectorClear( plane.normal );
+                plane.normal[ i % 3 ] = 1.0f;
+            }
+            else
+            {
+                do
+                {
+                    VectorSet( plane.normal, coord( rng ), coord( rng ), coord( rng ) );
+                }
+                while ( VectorNormalize( plane.normal ) < 0.1f );
+            }
+
+            plane.dist = 500.0f * coord( rng );
+            plane.type = PlaneTypeForNormal( plane.normal );
+            SetPlaneSignbits( &plane );
+
+            frustum.SetPlane( i, plane.normal, plane.dist );
+        }
+    }
+
+    void MakeBoxes( size_t count )
+    {
+        std::uniform_real_distribution<float> origin( -1000.0f, 1000.0f );
+        std::uniform_real_distribution<float> size( 0.5f, 300.0f );
+
+        boxes.Clear();
+        bounds.resize( count );
+
+        for ( size_t i = 0; i < count; i++ )
+        {
+            for ( int j = 0; j < 3; j++ )
+            {
+                bounds[ i ][ 0 ][ j ] = origin( rng );
+                bounds[ i ][ 1 ][ j ] = bounds[ i ][ 0 ][ j ] + size( rng );
+            }
+
+            boxes.Add( bounds[ i ][ 0 ], bounds[ i ][ 1 ] );
+        }
+    }
+
+    void Compare( int planeBits )
+    {
+        cplane_t enabled[ MAX_PLANES ];
+        int numEnabled = 0;
+
+        for ( int i = 0; i < frustum.numPlanes; i++ )
+        {
+            if ( planeBits & ( 1 << i ) )
+            {
+                enabled[ numEnabled++ ] = planes[ i ];
+            }
+        }
+
+        Cull( frustum, planeBits, boxes, result );
+
+        for ( size_t i = 0; i < bounds.size(); i++ )
+        {
+            ASSERT_EQ( CullBox( enabled, numEnabled, bounds[ i ].data() ), FromResult( result, i ) ) << "box " << i;
+        }
+    }
+
+    std::mt19937 rng{ 42 };
+    cplane_t planes[ MAX_PLANES ];
+    Frustum frustum;
+    Boxes boxes;
+    std::vector<std::array<vec3_t, 2>> bounds;
+    Result result;
+};
+
+TEST_F( FrustumCullTest, MatchesCullBox )
+{
+    for ( int i = 0; i < 20; i++ )
+    {
+        MakePlanes( 5, false );
+        MakeBoxes( 1000 );
+        Compare( 31 );
+    }
+}
+
+TEST_F( FrustumCullTest, MatchesCullBoxAxial )
+{
+    MakePlanes( 3, true );
+    MakeBoxes( 1000 );
+    Compare( 7 );
+}
+
+TEST_F( FrustumCullTest, OddCounts )
+{
+    for ( size_t count : { 0, 1, 3, 4, 5, 31, 32, 33, 67 } )
+    {
+        MakePlanes( 5, false );
+        MakeBoxes( count );
+        Compare( 31 );
+        ASSERT_EQ( ( count + 31 ) / 32, result.outside.size() );
+    }
+}
+
+TEST_F( FrustumCullTest, PlaneBits )
+{
+    MakePlanes( 5, false );
+    MakeBoxes( 500 );
+    Compare( 1 | 4 | 16 );
+    Compare( 0 );
+
+    for ( size_t i = 0; i < bounds.size(); i++ )
+    {
+        ASSERT_EQ( Visibility::In, FromResult( result, i ) );
+    }
+}
+
+} // namespace
+} // namespace FrustumCull
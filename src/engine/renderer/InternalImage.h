@@ -39,5 +39,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 int R_GetImageCustomScalingStep( const image_t *image, const imageParams_t &imageParams );
 void R_DownscaleImageDimensions( int scalingStep, int *scaledWidth, int *scaledHeight, const byte ***dataArray, int numLayers, int *numMips );
+int R_FindImageFileName( const char *name, std::string &fileName );
+void R_LoadImageFile( int loader, const std::string &fileName, byte **pic, int *width, int *height, int *numLayers, int *numMips, int *bits, const std::string *fileData = nullptr );
 
 #endif // INTERNAL_IMAGE_H
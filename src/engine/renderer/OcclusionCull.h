@@ -0,0 +1,420 @@
+/*
+===========================================================================
+Daemon BSD Source Code
+Copyright (c) 2026, Daemon Developers
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Daemon developers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL DAEMON DEVELOPERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+===========================================================================
+*/
+
+#ifndef OCCLUSIONCULL_H
+#define OCCLUSIONCULL_H
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "common/Platform.h"
+
+/*
+ * Culls boxes hidden behind large occluders, with a low resolution depth
+ * buffer drawn on the CPU. The buffer stores the inverse of the clip space
+ * w, which is linear in screen space and larger when closer, so it doesn't
+ * depend on the near and far planes of the projection.
+ *
+ * Both sides are conservative: an occluder only writes the pixels it
+ * covers entirely with the farthest depth it has in them, and a box is
+ * only hidden when every pixel its screen rectangle touches has an
+ * occluder in front of its nearest corner. With SSE2 four pixels are
+ * drawn and tested at a time, other platforms use the same loops one
+ * pixel at a time.
+ */
+namespace OcclusionCull {
+
+    // The most points an occluder can have
+    static const int MAX_POINTS = 16;
+
+    class DepthBuffer
+    {
+    public:
+        // The width is rounded up to a multiple of 4
+        void Resize( int newWidth, int newHeight )
+        {
+            width = ( std::max( newWidth, 4 ) + 3 ) & ~3;
+            height = std::max( newHeight, 1 );
+            depth.assign( width * height, 0.0f );
+        }
+
+        int Width() const
+        {
+            return width;
+        }
+
+        int Height() const
+        {
+            return height;
+        }
+
+        void Clear()
+        {
+            std::fill( depth.begin(), depth.end(), 0.0f );
+        }
+
+        /*
+         * Sets the column major model view projection matrix used by
+         * DrawTriangle and Occluded, along with the distance to the near
+         * plane, which occluders are clipped against.
+         */
+        void SetView( const float modelViewProjection[ 16 ], float zNear )
+        {
+            std::copy( modelViewProjection, modelViewProjection + 16, matrix );
+            nearW = zNear;
+        }
+
+        // The inverse of w at a pixel, 0 if nothing was drawn there
+        float Depth( int x, int y ) const
+        {
+            return depth[ y * width + x ];
+        }
+
+        /*
+         * Draws both sides of a convex occluder polygon given in world
+         * space, with at most MAX_POINTS points
+         */
+        void DrawPolygon( const float ( *points )[ 3 ], int numPoints )
+        {
+            // clip against the near plane, which adds at most one point
+            ClipVertex in[ MAX_POINTS ], out[ MAX_POINTS + 1 ];
+            int numOut = 0;
+
+            for ( int i = 0; i < numPoints; i++ )
+            {
+                Transform( points[ i ], in[ i ] );
+            }
+
+            for ( int i = 0; i < numPoints; i++ )
+            {
+                const ClipVertex& p = in[ i ];
+                const ClipVertex& q = in[ ( i + 1 ) % numPoints ];
+
+                if ( p.w >= nearW )
+                {
+                    out[ numOut++ ] = p;
+                }
+
+                if ( ( p.w >= nearW ) != ( q.w >= nearW ) )
+                {
+                    float t = ( nearW - p.w ) / ( q.w - p.w );
+
+                    out[ numOut ].x = p.x + t * ( q.x - p.x );
+                    out[ numOut ].y = p.y + t * ( q.y - p.y );
+                    out[ numOut ].w = nearW;
+                    numOut++;
+                }
+            }
+
+            if ( numOut < 3 )
+            {
+                return;
+            }
+
+            ScreenVertex screen[ MAX_POINTS + 1 ];
+
+            for ( int i = 0; i < numOut; i++ )
+            {
+                Project( out[ i ], screen[ i ] );
+            }
+
+            Rasterize( screen, numOut );
+        }
+
+        /*
+         * Returns true if the box given in world space is entirely hidden
+         * by the occluders drawn since the last Clear
+         */
+        bool Occluded( const float mins[ 3 ], const float maxs[ 3 ] ) const
+        {
+            float minX = std::numeric_limits<float>::max(), minY = minX;
+            float maxX = -minX, maxY = -minX;
+            float nearest = 0.0f;
+
+            for ( int i = 0; i < 8; i++ )
+            {
+                float corner[ 3 ] = {
+                    ( i & 1 ) ? maxs[ 0 ] : mins[ 0 ],
+                    ( i & 2 ) ? maxs[ 1 ] : mins[ 1 ],
+                    ( i & 4 ) ? maxs[ 2 ] : mins[ 2 ],
+                };
+                ClipVertex clip;
+                ScreenVertex screen;
+
+                Transform( corner, clip );
+
+                // crosses the near plane
+                if ( clip.w < nearW )
+                {
+                    return false;
+                }
+
+                Project( clip, screen );
+
+                minX = std::min( minX, screen.x );
+                minY = std::min( minY, screen.y );
+                maxX = std::max( maxX, screen.x );
+                maxY = std::max( maxY, screen.y );
+                nearest = std::max( nearest, screen.invW );
+            }
+
+            // the pixels the rectangle touches, nothing is known about
+            // boxes that are off screen so they are left to frustum culling
+            if ( !( minX < width && minY < height && maxX >= 0.0f && maxY >= 0.0f ) )
+            {
+                return false;
+            }
+
+            int x0 = static_cast<int>( std::max( minX, 0.0f ) );
+            int y0 = static_cast<int>( std::max( minY, 0.0f ) );
+            int x1 = static_cast<int>( std::min( maxX, width - 1.0f ) );
+            int y1 = static_cast<int>( std::min( maxY, height - 1.0f ) );
+
+            for ( int y = y0; y <= y1; y++ )
+            {
+                const float* row = depth.data() + y * width;
+                int x = x0;
+
+#if idx86_sse >= 2
+                __m128 boxDepth = _mm_set1_ps( nearest );
+
+                for ( ; x + 4 <= x1 + 1; x += 4 )
+                {
+                    if ( _mm_movemask_ps( _mm_cmple_ps( _mm_loadu_ps( row + x ), boxDepth ) ) )
+                    {
+                        return false;
+                    }
+                }
+#endif
+
+                for ( ; x <= x1; x++ )
+                {
+                    if ( row[ x ] <= nearest )
+                    {
+                        return false;
+                    }
+                }
+            }
+
+            return true;
+        }
+
+    private:
+        struct ClipVertex
+        {
+            float x, y, w;
+        };
+
+        struct ScreenVertex
+        {
+            float x, y, invW;
+        };
+
+        void Transform( const float p[ 3 ], ClipVertex& out ) const
+        {
+            out.x = matrix[ 0 ] * p[ 0 ] + matrix[ 4 ] * p[ 1 ] + matrix[ 8 ] * p[ 2 ] + matrix[ 12 ];
+            out.y = matrix[ 1 ] * p[ 0 ] + matrix[ 5 ] * p[ 1 ] + matrix[ 9 ] * p[ 2 ] + matrix[ 13 ];
+            out.w = matrix[ 3 ] * p[ 0 ] + matrix[ 7 ] * p[ 1 ] + matrix[ 11 ] * p[ 2 ] + matrix[ 15 ];
+        }
+
+        void Project( const ClipVertex& clip, ScreenVertex& out ) const
+        {
+            out.invW = 1.0f / clip.w;
+            out.x = ( clip.x * out.invW * 0.5f + 0.5f ) * width;
+            out.y = ( clip.y * out.invW * 0.5f + 0.5f ) * height;
+        }
+
+        // A function of the pixel coordinates, ax + by + c
+        struct Plane
+        {
+            float a, b, c;
+
+            // the smallest value over the pixel whose center is given
+            // by c, so that a test at the center covers all of it
+            void Conservative()
+            {
+                c -= 0.5f * ( std::fabs( a ) + std::fabs( b ) );
+            }
+        };
+
+        void Rasterize( const ScreenVertex* v, int numPoints )
+        {
+            // the depth is interpolated from the largest triangle of the
+            // fan, the sum of the fan is twice the area of the polygon
+            float area = 0.0f, largest = 0.0f;
+            int apex = 1;
+
+            for ( int i = 1; i + 1 < numPoints; i++ )
+            {
+                float fan = ( v[ i ].x - v[ 0 ].x ) * ( v[ i + 1 ].y - v[ 0 ].y ) - ( v[ i ].y - v[ 0 ].y ) * ( v[ i + 1 ].x - v[ 0 ].x );
+
+                area += fan;
+
+                if ( std::fabs( fan ) > std::fabs( largest ) )
+                {
+                    largest = fan;
+                    apex = i;
+                }
+            }
+
+            if ( !( std::fabs( largest ) > 1e-6f ) )
+            {
+                return;
+            }
+
+            float minX = v[ 0 ].x, minY = v[ 0 ].y, maxX = v[ 0 ].x, maxY = v[ 0 ].y;
+
+            for ( int i = 1; i < numPoints; i++ )
+            {
+                minX = std::min( minX, v[ i ].x );
+                minY = std::min( minY, v[ i ].y );
+                maxX = std::max( maxX, v[ i ].x );
+                maxY = std::max( maxY, v[ i ].y );
+            }
+
+            if ( !( minX < width && minY < height && maxX >= 0.0f && maxY >= 0.0f ) )
+            {
+                return;
+            }
+
+            // positive inside whatever the winding is, so that both sides
+            // are drawn
+            float sign = area < 0.0f ? -1.0f : 1.0f;
+            Plane edge[ MAX_POINTS + 1 ];
+
+            for ( int i = 0; i < numPoints; i++ )
+            {
+                const ScreenVertex& p = v[ i ];
+                const ScreenVertex& q = v[ ( i + 1 ) % numPoints ];
+
+                edge[ i ].a = sign * ( p.y - q.y );
+                edge[ i ].b = sign * ( q.x - p.x );
+                edge[ i ].c = -( edge[ i ].a * p.x + edge[ i ].b * p.y );
+            }
+
+            // the weight of each vertex of the triangle is the edge
+            // opposite to it, divided by the area
+            const ScreenVertex* t[ 3 ] = { &v[ 0 ], &v[ apex ], &v[ apex + 1 ] };
+            Plane plane = { 0.0f, 0.0f, 0.0f };
+
+            for ( int i = 0; i < 3; i++ )
+            {
+                const ScreenVertex& p = *t[ ( i + 1 ) % 3 ];
+                const ScreenVertex& q = *t[ ( i + 2 ) % 3 ];
+                float weight = t[ i ]->invW / largest;
+                float a = p.y - q.y;
+                float b = q.x - p.x;
+
+                plane.a += a * weight;
+                plane.b += b * weight;
+                plane.c -= ( a * p.x + b * p.y ) * weight;
+            }
+
+            // only the pixels entirely inside, with the farthest depth
+            // of the polygon in them
+            for ( int i = 0; i < numPoints; i++ )
+            {
+                edge[ i ].Conservative();
+            }
+
+            plane.Conservative();
+
+            int x0 = static_cast<int>( std::max( minX, 0.0f ) );
+            int y0 = static_cast<int>( std::max( minY, 0.0f ) );
+            int x1 = static_cast<int>( std::min( maxX, width - 1.0f ) );
+            int y1 = static_cast<int>( std::min( maxY, height - 1.0f ) );
+
+            for ( int y = y0; y <= y1; y++ )
+            {
+                float* row = depth.data() + y * width;
+                float centerY = y + 0.5f;
+                int x = x0;
+
+#if idx86_sse >= 2
+                // the rows are a multiple of 4 wide so the group containing
+                // x1 is always within the row
+                __m128 zero = _mm_setzero_ps();
+                __m128 step = _mm_set_ps( 3.0f, 2.0f, 1.0f, 0.0f );
+
+                for ( x = x0 & ~3; x <= x1; x += 4 )
+                {
+                    __m128 centerX = _mm_add_ps( _mm_set1_ps( x + 0.5f ), step );
+                    __m128 inside = _mm_cmpeq_ps( zero, zero );
+
+                    for ( int i = 0; i < numPoints; i++ )
+                    {
+                        __m128 e = _mm_add_ps( _mm_set1_ps( edge[ i ].b * centerY + edge[ i ].c ), _mm_mul_ps( _mm_set1_ps( edge[ i ].a ), centerX ) );
+
+                        inside = _mm_and_ps( inside, _mm_cmpge_ps( e, zero ) );
+                    }
+
+                    if ( !_mm_movemask_ps( inside ) )
+                    {
+                        continue;
+                    }
+
+                    __m128 pixelDepth = _mm_add_ps( _mm_set1_ps( plane.b * centerY + plane.c ), _mm_mul_ps( _mm_set1_ps( plane.a ), centerX ) );
+                    __m128 stored = _mm_loadu_ps( row + x );
+                    __m128 closer = _mm_max_ps( stored, pixelDepth );
+
+                    _mm_storeu_ps( row + x, _mm_or_ps( _mm_and_ps( inside, closer ), _mm_andnot_ps( inside, stored ) ) );
+                }
+#endif
+
+                for ( ; x <= x1; x++ )
+                {
+                    float centerX = x + 0.5f;
+                    bool inside = true;
+
+                    for ( int i = 0; i < numPoints && inside; i++ )
+                    {
+                        inside = edge[ i ].a * centerX + edge[ i ].b * centerY + edge[ i ].c >= 0.0f;
+                    }
+
+                    if ( inside )
+                    {
+                        row[ x ] = std::max( row[ x ], plane.a * centerX + plane.b * centerY + plane.c );
+                    }
+                }
+            }
+        }
+
+        int width = 0;
+        int height = 0;
+        std::vector<float> depth;
+
+        float matrix[ 16 ] = {};
+        float nearW = 1.0f;
+    };
+}
+
+#endif // OCCLUSIONCULL_H
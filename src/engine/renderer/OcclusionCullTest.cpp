@@ -0,0 +1,242 @@
+/*
+===========================================================================
+Daemon BSD Source Code
+Copyright (c) 2026, Daemon Developers
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Daemon developers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL DAEMON DEVELOPERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+===========================================================================
+*/
+
+#include <array>
+#include <random>
+#include <gtest/gtest.h>
+#include "OcclusionCull.h"
+
+namespace OcclusionCull {
+namespace {
+
+using Vec3 = std::array<float, 3>;
+
+// Looks down -z from the origin with a 90 degree fov, so that the clip
+// space w is -z
+const float projection[ 16 ] = {
+    1.0f, 0.0f, 0.0f, 0.0f,
+    0.0f, 1.0f, 0.0f, 0.0f,
+    0.0f, 0.0f, -1.0f, -1.0f,
+    0.0f, 0.0f, -2.0f, 0.0f,
+};
+
+const float zNear = 1.0f;
+
+// Whether the segment from the eye to p goes through the triangle
+bool Hidden( const Vec3& p, const Vec3& a, const Vec3& b, const Vec3& c )
+{
+    Vec3 e1 = { b[ 0 ] - a[ 0 ], b[ 1 ] - a[ 1 ], b[ 2 ] - a[ 2 ] };
+    Vec3 e2 = { c[ 0 ] - a[ 0 ], c[ 1 ] - a[ 1 ], c[ 2 ] - a[ 2 ] };
+    Vec3 h = { p[ 1 ] * e2[ 2 ] - p[ 2 ] * e2[ 1 ], p[ 2 ] * e2[ 0 ] - p[ 0 ] * e2[ 2 ], p[ 0 ] * e2[ 1 ] - p[ 1 ] * e2[ 0 ] };
+    double det = e1[ 0 ] * h[ 0 ] + e1[ 1 ] * h[ 1 ] + e1[ 2 ] * h[ 2 ];
+
+    if ( std::fabs( det ) < 1e-9 )
+    {
+        return false;
+    }
+
+    Vec3 s = { -a[ 0 ], -a[ 1 ], -a[ 2 ] };
+    double u = ( s[ 0 ] * h[ 0 ] + s[ 1 ] * h[ 1 ] + s[ 2 ] * h[ 2 ] ) / det;
+    Vec3 q = { s[ 1 ] * e1[ 2 ] - s[ 2 ] * e1[ 1 ], s[ 2 ] * e1[ 0 ] - s[ 0 ] * e1[ 2 ], s[ 0 ] * e1[ 1 ] - s[ 1 ] * e1[ 0 ] };
+    double v = ( p[ 0 ] * q[ 0 ] + p[ 1 ] * q[ 1 ] + p[ 2 ] * q[ 2 ] ) / det;
+    double t = ( e2[ 0 ] * q[ 0 ] + e2[ 1 ] * q[ 1 ] + e2[ 2 ] * q[ 2 ] ) / det;
+
+    return u >= 0 && v >= 0 && u + v <= 1 && t > 0 && t < 1;
+}
+
+class OcclusionCullTest : public testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        buffer.Resize( 62, 30 );
+        buffer.SetView( projection, zNear );
+    }
+
+    void DrawQuad( const Vec3& a, const Vec3& b, const Vec3& c, const Vec3& d )
+    {
+        float points[ 4 ][ 3 ];
+
+        for ( int j = 0; j < 3; j++ )
+        {
+            points[ 0 ][ j ] = a[ j ];
+            points[ 1 ][ j ] = b[ j ];
+            points[ 2 ][ j ] = c[ j ];
+            points[ 3 ][ j ] = d[ j ];
+        }
+
+        buffer.DrawPolygon( points, 4 );
+    }
+
+    bool Occluded( const Vec3& mins, const Vec3& maxs )
+    {
+        return buffer.Occluded( mins.data(), maxs.data() );
+    }
+
+    DepthBuffer buffer;
+};
+
+TEST_F( OcclusionCullTest, Resize )
+{
+    EXPECT_EQ( 64, buffer.Width() );
+    EXPECT_EQ( 30, buffer.Height() );
+}
+
+TEST_F( OcclusionCullTest, Empty )
+{
+    EXPECT_FALSE( Occluded( { -10, -10, -300 }, { 10, 10, -200 } ) );
+    EXPECT_FALSE( Occluded( { -1000, -1000, -5000 }, { 1000, 1000, -4000 } ) );
+}
+
+TEST_F( OcclusionCullTest, Wall )
+{
+    DrawQuad( { -1000, -1000, -100 }, { 1000, -1000, -100 }, { 1000, 1000, -100 }, { -1000, 1000, -100 } );
+
+    EXPECT_FLOAT_EQ( 1.0f / 100.0f, buffer.Depth( 32, 15 ) );
+
+    // behind, in front and through the wall
+    EXPECT_TRUE( Occluded( { -10, -10, -300 }, { 10, 10, -200 } ) );
+    EXPECT_TRUE( Occluded( { -500, -500, -3000 }, { 500, 500, -2000 } ) );
+    EXPECT_FALSE( Occluded( { -10, -10, -50 }, { 10, 10, -40 } ) );
+    EXPECT_FALSE( Occluded( { -10, -10, -150 }, { 10, 10, -50 } ) );
+
+    // off screen and across the near plane are left visible
+    EXPECT_FALSE( Occluded( { 2000, -10, -300 }, { 2100, 10, -200 } ) );
+    EXPECT_FALSE( Occluded( { -10, -10, -300 }, { 10, 10, 5 } ) );
+
+    buffer.Clear();
+    EXPECT_FALSE( Occluded( { -10, -10, -300 }, { 10, 10, -200 } ) );
+}
+
+TEST_F( OcclusionCullTest, BackSide )
+{
+    DrawQuad( { -1000, 1000, -100 }, { 1000, 1000, -100 }, { 1000, -1000, -100 }, { -1000, -1000, -100 } );
+
+    EXPECT_TRUE( Occluded( { -10, -10, -300 }, { 10, 10, -200 } ) );
+}
+
+TEST_F( OcclusionCullTest, PartialWall )
+{
+    // covers the right half of the screen
+    DrawQuad( { 0, -1000, -100 }, { 1000, -1000, -100 }, { 1000, 1000, -100 }, { 0, 1000, -100 } );
+
+    EXPECT_TRUE( Occluded( { 20, -10, -300 }, { 50, 10, -200 } ) );
+    EXPECT_FALSE( Occluded( { -50, -10, -300 }, { 50, 10, -200 } ) );
+    EXPECT_FALSE( Occluded( { -50, -10, -300 }, { -20, 10, -200 } ) );
+}
+
+TEST_F( OcclusionCullTest, NearClipped )
+{
+    // a slanted wall that goes behind the eye on the right
+    DrawQuad( { -1000, -1000, -600 }, { 1000, -1000, 400 }, { 1000, 1000, 400 }, { -1000, 1000, -600 } );
+
+    EXPECT_TRUE( Occluded( { -10, -10, -400 }, { 10, 10, -300 } ) );
+    EXPECT_FALSE( Occluded( { -10, -10, -60 }, { 10, 10, -50 } ) );
+}
+
+TEST_F( OcclusionCullTest, Conservative )
+{
+    std::mt19937 rng{ 42 };
+    std::uniform_real_distribution<float> coord( -300.0f, 300.0f );
+    std::uniform_real_distribution<float> distance( -600.0f, -20.0f );
+    std::uniform_real_distribution<float> size( 1.0f, 60.0f );
+    int numOccluded = 0;
+
+    for ( int pass = 0; pass < 20; pass++ )
+    {
+        std::vector<std::array<Vec3, 3>> triangles;
+
+        buffer.Clear();
+
+        for ( int i = 0; i < 8; i++ )
+        {
+            std::array<Vec3, 3> triangle;
+            float points[ 3 ][ 3 ];
+
+            for ( int k = 0; k < 3; k++ )
+            {
+                triangle[ k ] = { coord( rng ), coord( rng ), distance( rng ) * 0.5f };
+                std::copy( triangle[ k ].begin(), triangle[ k ].end(), points[ k ] );
+            }
+
+            triangles.push_back( triangle );
+            buffer.DrawPolygon( points, 3 );
+        }
+
+        for ( int i = 0; i < 500; i++ )
+        {
+            Vec3 mins = { coord( rng ), coord( rng ), distance( rng ) };
+            Vec3 maxs = { mins[ 0 ] + size( rng ), mins[ 1 ] + size( rng ), mins[ 2 ] + size( rng ) };
+
+            if ( !Occluded( mins, maxs ) )
+            {
+                continue;
+            }
+
+            numOccluded++;
+
+            // every point of the box that is on screen must be behind one
+            // of the triangles
+            for ( int x = 0; x <= 4; x++ )
+            {
+                for ( int y = 0; y <= 4; y++ )
+                {
+                    for ( int z = 0; z <= 4; z++ )
+                    {
+                        Vec3 p = {
+                            mins[ 0 ] + ( maxs[ 0 ] - mins[ 0 ] ) * x / 4,
+                            mins[ 1 ] + ( maxs[ 1 ] - mins[ 1 ] ) * y / 4,
+                            mins[ 2 ] + ( maxs[ 2 ] - mins[ 2 ] ) * z / 4,
+                        };
+
+                        if ( std::fabs( p[ 0 ] ) > -p[ 2 ] || std::fabs( p[ 1 ] ) > -p[ 2 ] )
+                        {
+                            continue;
+                        }
+
+                        bool hidden = false;
+
+                        for ( const std::array<Vec3, 3>& t : triangles )
+                        {
+                            hidden = hidden || Hidden( p, t[ 0 ], t[ 1 ], t[ 2 ] );
+                        }
+
+                        ASSERT_TRUE( hidden ) << "pass " << pass << " box " << i;
+                    }
+                }
+            }
+        }
+    }
+
+    EXPECT_GT( numOccluded, 0 );
+}
+
+} // namespace
+} // namespace OcclusionCull
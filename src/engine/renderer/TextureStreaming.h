@@ -0,0 +1,188 @@
+/*
+===========================================================================
+Daemon BSD Source Code
+Copyright (c) 2026, Daemon Developers
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Daemon developers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL DAEMON DEVELOPERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+===========================================================================
+*/
+
+
+#ifndef TEXTURESTREAMING_H
+#define TEXTURESTREAMING_H
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+/*
+ * Keeps the video memory of the streamed images within a budget. Each image
+ * is counted from the level it is uploaded from, and its low level is always
+ * resident. When a finer level doesn't fit, the images unused for the
+ * longest time are put back to their low level, or nothing is evicted at all
+ * if that isn't enough, so that a level is never uploaded over the budget.
+ */
+namespace TextureStreaming {
+
+    // Video memory used by an image uploaded from level, with the levels
+    // below it. A block size of 0 is for the uncompressed images, whose
+    // levels are added by glGenerateMipmap
+    inline size_t LevelSize( int width, int height, int numMips, int blockSize, int level )
+    {
+        size_t levelWidth = std::max( width >> level, 1 );
+        size_t levelHeight = std::max( height >> level, 1 );
+
+        if ( !blockSize )
+        {
+            return levelWidth * levelHeight * 4 * 4 / 3;
+        }
+
+        size_t size = 0;
+
+        for ( int i = level; i < numMips; i++ )
+        {
+            size += ( ( levelWidth + 3 ) >> 2 ) * ( ( levelHeight + 3 ) >> 2 ) * blockSize;
+
+            levelWidth = std::max<size_t>( levelWidth >> 1, 1 );
+            levelHeight = std::max<size_t>( levelHeight >> 1, 1 );
+        }
+
+        return size;
+    }
+
+    class Budget
+    {
+    public:
+        // Adds an image resident at its low level, returns its index
+        int Add( size_t lowSize )
+        {
+            entries.push_back( { lowSize, lowSize, -1 } );
+            used += lowSize;
+            return entries.size() - 1;
+        }
+
+        void SetSize( int index, size_t size )
+        {
+            used -= entries[ index ].size;
+            entries[ index ].size = size;
+            used += size;
+        }
+
+        size_t Size( int index ) const
+        {
+            return entries[ index ].size;
+        }
+
+        void Use( int index, int frame )
+        {
+            entries[ index ].lastUsed = frame;
+        }
+
+        int LastUsed( int index ) const
+        {
+            return entries[ index ].lastUsed;
+        }
+
+        size_t Used() const
+        {
+            return used;
+        }
+
+        void Clear()
+        {
+            entries.clear();
+            used = 0;
+        }
+
+        // Puts the images unused for the longest time back to their low
+        // level until size more bytes fit in limit, and returns them in
+        // evicted. The images used in frame and keep are never evicted, so
+        // that a budget too small doesn't make them evict each other in
+        // turn. Returns false, with nothing evicted, when size can't fit
+        bool Evict( size_t size, size_t limit, int keep, int frame, std::vector<int> &evicted )
+        {
+            evicted.clear();
+
+            if ( used + size <= limit )
+            {
+                return true;
+            }
+
+            std::vector<int> candidates;
+
+            for ( size_t i = 0; i < entries.size(); i++ )
+            {
+                const Entry &entry = entries[ i ];
+
+                if ( static_cast<int>( i ) != keep && entry.lastUsed != frame && entry.size > entry.lowSize )
+                {
+                    candidates.push_back( i );
+                }
+            }
+
+            std::stable_sort( candidates.begin(), candidates.end(), [ this ]( int a, int b ) {
+                return entries[ a ].lastUsed < entries[ b ].lastUsed;
+            } );
+
+            size_t freed = 0;
+
+            for ( int index : candidates )
+            {
+                if ( used - freed + size <= limit )
+                {
+                    break;
+                }
+
+                freed += entries[ index ].size - entries[ index ].lowSize;
+                evicted.push_back( index );
+            }
+
+            if ( used - freed + size > limit )
+            {
+                evicted.clear();
+                return false;
+            }
+
+            for ( int index : evicted )
+            {
+                SetSize( index, entries[ index ].lowSize );
+            }
+
+            return true;
+        }
+
+    private:
+        struct Entry
+        {
+            size_t size;
+            size_t lowSize;
+            int lastUsed;
+        };
+
+        std::vector<Entry> entries;
+        size_t used = 0;
+    };
+}
+
+#endif // TEXTURESTREAMING_H
@@ -0,0 +1,173 @@
+/*
+===========================================================================
+Daemon BSD Source Code
+Copyright (c) 2026, Daemon Developers
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Daemon developers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL DAEMON DEVELOPERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+===========================================================================
+*/
+
+#include <random>
+#include <gtest/gtest.h>
+#include "TextureStreaming.h"
+
+namespace TextureStreaming {
+namespace {
+
+const size_t MiB = 1 << 20;
+
+TEST( TextureStreamingTest, LevelSize )
+{
+    EXPECT_EQ( 256u * 256 * 4 * 4 / 3, LevelSize( 256, 256, 1, 0, 0 ) );
+    EXPECT_EQ( 64u * 32 * 4 * 4 / 3, LevelSize( 256, 128, 1, 0, 2 ) );
+
+    // 8x8 BC1 with its 4 levels: 4 blocks, then 1 block each
+    EXPECT_EQ( 8u * ( 4 + 1 + 1 + 1 ), LevelSize( 8, 8, 4, 8, 0 ) );
+    EXPECT_EQ( 16u * 3, LevelSize( 8, 8, 4, 16, 1 ) );
+}
+
+TEST( TextureStreamingTest, EvictsLeastRecentlyUsed )
+{
+    Budget budget;
+    std::vector<int> evicted;
+
+    for ( int i = 0; i < 3; i++ )
+    {
+        int index = budget.Add( MiB );
+        budget.SetSize( index, 4 * MiB );
+    }
+
+    budget.Use( 0, 5 );
+    budget.Use( 1, 3 );
+    budget.Use( 2, 4 );
+
+    ASSERT_TRUE( budget.Evict( 4 * MiB, 14 * MiB, -1, 6, evicted ) );
+    ASSERT_EQ( 1u, evicted.size() );
+    EXPECT_EQ( 1, evicted[ 0 ] );
+    EXPECT_EQ( MiB, budget.Size( 1 ) );
+    EXPECT_EQ( 9 * MiB, budget.Used() );
+}
+
+TEST( TextureStreamingTest, KeepsTheImagesOfTheFrame )
+{
+    Budget budget;
+    std::vector<int> evicted;
+
+    for ( int i = 0; i < 3; i++ )
+    {
+        int index = budget.Add( MiB );
+        budget.SetSize( index, 4 * MiB );
+        budget.Use( index, 7 );
+    }
+
+    budget.Use( 0, 6 );
+
+    // only the first image can go, which isn't enough
+    EXPECT_FALSE( budget.Evict( 8 * MiB, 14 * MiB, -1, 7, evicted ) );
+    EXPECT_TRUE( evicted.empty() );
+    EXPECT_EQ( 12 * MiB, budget.Used() );
+
+    // nor when it is the one asking
+    EXPECT_FALSE( budget.Evict( 4 * MiB, 14 * MiB, 0, 7, evicted ) );
+    EXPECT_EQ( 12 * MiB, budget.Used() );
+
+    ASSERT_TRUE( budget.Evict( 4 * MiB, 14 * MiB, 1, 7, evicted ) );
+    ASSERT_EQ( 1u, evicted.size() );
+    EXPECT_EQ( 0, evicted[ 0 ] );
+}
+
+// Streams random levels of random images over many frames, the way
+// R_UpdateTextureStreaming does, and checks that the budget is never
+// exceeded and that the images of the frame stay resident
+TEST( TextureStreamingTest, StaysWithinBudget )
+{
+    const size_t limit = 64 * MiB;
+    const int numImages = 200;
+
+    std::mt19937 random( 42 );
+    Budget budget;
+    std::vector<int> evicted;
+    std::vector<int> sizes;
+    size_t lowSizes = 0;
+
+    for ( int i = 0; i < numImages; i++ )
+    {
+        int size = 64 << std::uniform_int_distribution<int>( 0, 5 )( random );
+
+        sizes.push_back( size );
+        lowSizes += LevelSize( size, size, 1, 0, 4 );
+        budget.Add( LevelSize( size, size, 1, 0, 4 ) );
+    }
+
+    ASSERT_LE( lowSizes, limit );
+
+    int uploaded = 0, refused = 0;
+
+    for ( int frame = 0; frame < 500; frame++ )
+    {
+        std::vector<int> visible;
+
+        for ( int i = 0; i < 20; i++ )
+        {
+            int index = std::uniform_int_distribution<int>( 0, numImages - 1 )( random );
+
+            budget.Use( index, frame );
+            visible.push_back( index );
+        }
+
+        for ( int index : visible )
+        {
+            int level = std::uniform_int_distribution<int>( 0, 3 )( random );
+            size_t size = LevelSize( sizes[ index ], sizes[ index ], 1, 0, level );
+
+            if ( size <= budget.Size( index ) )
+            {
+                continue;
+            }
+
+            if ( !budget.Evict( size - budget.Size( index ), limit, index, frame, evicted ) )
+            {
+                refused++;
+                continue;
+            }
+
+            for ( int other : evicted )
+            {
+                EXPECT_NE( frame, budget.LastUsed( other ) );
+            }
+
+            budget.SetSize( index, size );
+            uploaded++;
+
+            ASSERT_LE( budget.Used(), limit );
+        }
+    }
+
+    // both paths were taken
+    EXPECT_GT( uploaded, 0 );
+    EXPECT_GT( refused, 0 );
+}
+
+} // namespace
+} // namespace TextureStreaming
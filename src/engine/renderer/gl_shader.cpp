@@ -219,6 +219,9 @@ GLShaderManager::~GLShaderManager()
 
 void GLShaderManager::freeAll()
 {
+	SavePrewarmList();
+
+	_pendingPermutations.clear();
 	_shaders.clear();
 
 	for ( GLint sh : _deformShaders )
@@ -665,6 +668,7 @@ int GLShaderManager::getDeformShaderIndex( deformStage_t *deforms, int numDeform
 							{ &GLVersionDeclaration,
 							  &GLVertexHeader },
 							GL_VERTEX_SHADER ) );
+		CheckShaderCompiled( "deformVertexes", _deformShaders.back() );
 		index = _deformShaders.size();
 		_deformShaderLookup[ steps ] = index--;
 	}
@@ -790,7 +794,6 @@ static bool IsUnusedPermutation( const char *compileMacros )
 
 void GLShaderManager::buildPermutation( GLShader *shader, int macroIndex, int deformIndex )
 {
-	std::string compileMacros;
 	int  startTime = ri.Milliseconds();
 	int  endTime;
 	size_t i = macroIndex + ( deformIndex << shader->_compileMacros.size() );
@@ -799,56 +802,189 @@ void GLShaderManager::buildPermutation( GLShader *shader, int macroIndex, int de
 	if ( i < shader->_shaderPrograms.size() &&
 	     shader->_shaderPrograms[ i ].program )
 	{
+		// it was started with others and is needed now
+		if ( shader->_shaderPrograms[ i ].pending )
+		{
+			auto it = std::find( _pendingPermutations.begin(), _pendingPermutations.end(), std::make_pair( shader, i ) );
+			_pendingPermutations.erase( it );
+			FinishPermutation( shader, i );
+		}
+
 		return;
 	}
 
-	if( shader->GetCompileMacrosString( macroIndex, compileMacros ) )
+	if ( StartPermutation( shader, macroIndex, deformIndex ) )
+	{
+		_pendingPermutations.pop_back();
+		FinishPermutation( shader, i );
+
+		endTime = ri.Milliseconds();
+		_totalBuildTime += ( endTime - startTime );
+	}
+}
+
+/*
+Compiles and links a permutation without waiting for the driver, the program
+is added to _pendingPermutations and can't be used before FinishPermutation
+is called on it. With GL_KHR_parallel_shader_compile the driver builds the
+pending programs on its own threads meanwhile.
+*/
+bool GLShaderManager::StartPermutation( GLShader *shader, int macroIndex, int deformIndex )
+{
+	std::string compileMacros;
+	size_t i = macroIndex + ( deformIndex << shader->_compileMacros.size() );
+
+	// program already exists
+	if ( i < shader->_shaderPrograms.size() &&
+	     shader->_shaderPrograms[ i ].program )
+	{
+		return false;
+	}
+
+	if( !shader->GetCompileMacrosString( macroIndex, compileMacros ) )
+	{
+		return false;
+	}
+
+	shader->BuildShaderCompileMacros( compileMacros );
+
+	if ( IsUnusedPermutation( compileMacros.c_str() ) )
+		return false;
+
+	if( i >= shader->_shaderPrograms.size() )
+		shader->_shaderPrograms.resize( (deformIndex + 1) << shader->_compileMacros.size() );
+
+	shaderProgram_t *shaderProgram = &shader->_shaderPrograms[ i ];
+	shaderProgram->attribs = shader->_vertexAttribsRequired; // | _vertexAttribsOptional;
+
+	if( deformIndex > 0 )
+	{
+		shaderProgram_t *baseShader = &shader->_shaderPrograms[ macroIndex ];
+		if( !baseShader->VS || !baseShader->FS )
+			CompileGPUShaders( shader, baseShader, compileMacros );
+
+		shaderProgram->program = glCreateProgram();
+		glAttachShader( shaderProgram->program, baseShader->VS );
+		glAttachShader( shaderProgram->program, _deformShaders[ deformIndex ] );
+		glAttachShader( shaderProgram->program, baseShader->FS );
+
+		BindAttribLocations( shaderProgram->program );
+		LinkProgram( shaderProgram->program );
+	}
+	else if ( LoadShaderBinary( shader, i ) )
+	{
+		shaderProgram->fromBinary = true;
+	}
+	else
+	{
+		CompileAndLinkGPUShaderProgram(	shader, shaderProgram, compileMacros, deformIndex );
+	}
+
+	shaderProgram->pending = true;
+	_pendingPermutations.emplace_back( shader, i );
+
+	return true;
+}
+
+void GLShaderManager::FinishPermutation( GLShader *shader, size_t index )
+{
+	shaderProgram_t *shaderProgram = &shader->_shaderPrograms[ index ];
+	size_t macroIndex = index & ( ( size_t( 1 ) << shader->_compileMacros.size() ) - 1 );
+	int deformIndex = index >> shader->_compileMacros.size();
+	GLint linked;
+
+	shaderProgram->pending = false;
+
+	glGetProgramiv( shaderProgram->program, GL_LINK_STATUS, &linked );
+
+	// the driver refused the binary, build the program from source instead
+	if ( !linked && shaderProgram->fromBinary )
 	{
+		std::string compileMacros;
+
+		glDeleteProgram( shaderProgram->program );
+		shaderProgram->fromBinary = false;
+
+		shader->GetCompileMacrosString( macroIndex, compileMacros );
 		shader->BuildShaderCompileMacros( compileMacros );
+		CompileAndLinkGPUShaderProgram( shader, shaderProgram, compileMacros, deformIndex );
 
-		if ( IsUnusedPermutation( compileMacros.c_str() ) )
-			return;
+		glGetProgramiv( shaderProgram->program, GL_LINK_STATUS, &linked );
+	}
 
-		if( i >= shader->_shaderPrograms.size() )
-			shader->_shaderPrograms.resize( (deformIndex + 1) << shader->_compileMacros.size() );
+	if ( !linked )
+	{
+		// report the shader which failed to compile, if any
+		const shaderProgram_t *sources = deformIndex > 0 ? &shader->_shaderPrograms[ macroIndex ] : shaderProgram;
 
-		shaderProgram_t *shaderProgram = &shader->_shaderPrograms[ i ];
-		shaderProgram->attribs = shader->_vertexAttribsRequired; // | _vertexAttribsOptional;
+		CheckShaderCompiled( shader->GetName(), sources->VS );
+		CheckShaderCompiled( shader->GetName(), sources->FS );
 
-		if( deformIndex > 0 )
-		{
-			shaderProgram_t *baseShader = &shader->_shaderPrograms[ macroIndex ];
-			if( !baseShader->VS || !baseShader->FS )
-				CompileGPUShaders( shader, baseShader, compileMacros );
+		PrintInfoLog( shaderProgram->program );
+		ThrowShaderError( "Shaders failed to link!" );
+	}
+
+	if ( !shaderProgram->fromBinary && deformIndex == 0 )
+	{
+		SaveShaderBinary( shader, index );
+	}
 
-			shaderProgram->program = glCreateProgram();
-			glAttachShader( shaderProgram->program, baseShader->VS );
-			glAttachShader( shaderProgram->program, _deformShaders[ deformIndex ] );
-			glAttachShader( shaderProgram->program, baseShader->FS );
+	UpdateShaderProgramUniformLocations( shader, shaderProgram );
+	GL_BindProgram( shaderProgram );
+	shader->SetShaderProgramUniforms( shaderProgram );
+	GL_BindProgram( nullptr );
 
-			BindAttribLocations( shaderProgram->program );
-			LinkProgram( shaderProgram->program );
-		}
-		else if ( !LoadShaderBinary( shader, i ) )
+	GL_CheckErrors();
+}
+
+/*
+Finishes all the pending permutations. Those the driver is done building are
+finished first, so that it keeps building the others meanwhile.
+*/
+void GLShaderManager::FinishPermutations()
+{
+	while ( !_pendingPermutations.empty() )
+	{
+		bool finished = false;
+
+		for ( auto it = _pendingPermutations.begin(); it != _pendingPermutations.end(); )
 		{
-			CompileAndLinkGPUShaderProgram(	shader, shaderProgram, compileMacros, deformIndex );
-			SaveShaderBinary( shader, i );
-		}
+			GLint completed = GL_TRUE;
 
-		UpdateShaderProgramUniformLocations( shader, shaderProgram );
-		GL_BindProgram( shaderProgram );
-		shader->SetShaderProgramUniforms( shaderProgram );
-		GL_BindProgram( nullptr );
+#ifdef GL_KHR_parallel_shader_compile
+			if ( glConfig2.parallelShaderCompileAvailable )
+			{
+				glGetProgramiv( it->first->_shaderPrograms[ it->second ].program, GL_COMPLETION_STATUS_KHR, &completed );
+			}
+#endif
 
-		GL_CheckErrors();
+			if ( completed )
+			{
+				std::pair< GLShader*, size_t > permutation = *it;
+				it = _pendingPermutations.erase( it );
+				FinishPermutation( permutation.first, permutation.second );
+				finished = true;
+			}
+			else
+			{
+				++it;
+			}
+		}
 
-		endTime = ri.Milliseconds();
-		_totalBuildTime += ( endTime - startTime );
+		// nothing is done yet, wait for the oldest one
+		if ( !finished )
+		{
+			std::pair< GLShader*, size_t > permutation = _pendingPermutations.front();
+			_pendingPermutations.erase( _pendingPermutations.begin() );
+			FinishPermutation( permutation.first, permutation.second );
+		}
 	}
 }
 
 void GLShaderManager::buildAll()
 {
+	int startTime = ri.Milliseconds();
+
 	while ( !_shaderBuildQueue.empty() )
 	{
 		GLShader& shader = *_shaderBuildQueue.front();
@@ -860,15 +996,166 @@ void GLShaderManager::buildAll()
 
 		for( i = 0; i < numPermutations; i++ )
 		{
-			buildPermutation( &shader, i, 0 );
+			// let the driver build all of them at once if it can
+			if ( StartPermutation( &shader, i, 0 ) && !glConfig2.parallelShaderCompileAvailable )
+			{
+				FinishPermutations();
+			}
 		}
 
 		_shaderBuildQueue.pop();
 	}
 
+	FinishPermutations();
+
+	_totalBuildTime += ri.Milliseconds() - startTime;
+
 	Log::Notice( "glsl shaders took %d msec to build", _totalBuildTime );
 }
 
+// the prewarm list is in cache/glsl, see R_WriteCacheFile
+static const char     GLSL_PREWARM_DIR[] = "glsl";
+static const char     GLSL_PREWARM_KEY[] = "prewarm";
+static const uint32_t GLSL_PREWARM_VERSION = 1;
+
+// sessions a permutation stays in the prewarm list without being bound
+static const int      GLSL_PREWARM_MAX_AGE = 8;
+
+struct prewarmEntry_t
+{
+	std::string  name;
+	unsigned int checkSum; // of the shader source, see GLShaderManager::InitShader
+	size_t       index;
+	int          age; // sessions since it was last bound
+};
+
+static std::vector<prewarmEntry_t> ReadPrewarmList()
+{
+	std::vector<prewarmEntry_t> entries;
+	std::string list;
+
+	if ( !R_ReadCacheFile( GLSL_PREWARM_DIR, GLSL_PREWARM_KEY, GLSL_PREWARM_VERSION, list ) )
+	{
+		return entries;
+	}
+
+	std::istringstream stream( list );
+	prewarmEntry_t entry;
+
+	while ( stream >> entry.name >> entry.checkSum >> entry.index >> entry.age )
+	{
+		entries.push_back( entry );
+	}
+
+	return entries;
+}
+
+/*
+With r_lazyShaders 2, the permutations which were bound are recorded in the
+homepath when the shaders are freed. They are all built when a map is done
+loading, instead of stalling the frames which first need them. Those of a
+shader whose source changed since are left out.
+*/
+void GLShaderManager::prewarmPermutations()
+{
+	std::vector<prewarmEntry_t> entries = ReadPrewarmList();
+
+	if ( entries.empty() )
+	{
+		return;
+	}
+
+	int startTime = ri.Milliseconds();
+	int count = 0;
+
+	for ( const prewarmEntry_t &entry : entries )
+	{
+		for ( const auto &shader : _shaders )
+		{
+			if ( entry.name == shader->GetName() && entry.checkSum == shader->_checkSum
+			     && entry.index < ( size_t( 1 ) << shader->_compileMacros.size() ) )
+			{
+				if ( StartPermutation( shader.get(), entry.index, 0 ) )
+				{
+					if ( !glConfig2.parallelShaderCompileAvailable )
+					{
+						FinishPermutations();
+					}
+
+					count++;
+				}
+
+				break;
+			}
+		}
+	}
+
+	FinishPermutations();
+
+	int time = ri.Milliseconds() - startTime;
+	_totalBuildTime += time;
+
+	Log::Debug( "prewarmed %d glsl shader permutations in %d msec", count, time );
+}
+
+/*
+Merges the permutations which were bound with the list of the previous
+sessions. The entries of shaders that are gone or whose source changed are
+dropped, and so are those not bound for GLSL_PREWARM_MAX_AGE sessions
+*/
+void GLShaderManager::SavePrewarmList() const
+{
+	if ( r_lazyShaders->integer != 2 || _shaders.empty() )
+	{
+		return;
+	}
+
+	std::map<std::pair<std::string, size_t>, prewarmEntry_t> permutations;
+
+	for ( prewarmEntry_t &entry : ReadPrewarmList() )
+	{
+		entry.age++;
+
+		if ( entry.age >= GLSL_PREWARM_MAX_AGE )
+		{
+			continue;
+		}
+
+		for ( const auto &shader : _shaders )
+		{
+			if ( entry.name == shader->GetName() && entry.checkSum == shader->_checkSum )
+			{
+				permutations[ { entry.name, entry.index } ] = entry;
+				break;
+			}
+		}
+	}
+
+	for ( const auto &shader : _shaders )
+	{
+		size_t numMacroPermutations = std::min( shader->_shaderPrograms.size(), size_t( 1 ) << shader->_compileMacros.size() );
+
+		for ( size_t i = 0; i < numMacroPermutations; i++ )
+		{
+			if ( shader->_shaderPrograms[ i ].used )
+			{
+				permutations[ { shader->GetName(), i } ] = { shader->GetName(), shader->_checkSum, i, 0 };
+			}
+		}
+	}
+
+	std::string list;
+
+	for ( const auto &permutation : permutations )
+	{
+		const prewarmEntry_t &entry = permutation.second;
+
+		list += Str::Format( "%s %u %u %d\n", entry.name, entry.checkSum, unsigned( entry.index ), entry.age );
+	}
+
+	R_WriteCacheFile( GLSL_PREWARM_DIR, GLSL_PREWARM_KEY, GLSL_PREWARM_VERSION, list );
+}
+
 void GLShaderManager::InitShader( GLShader *shader )
 {
 	shader->_shaderPrograms = std::vector<shaderProgram_t>( static_cast<size_t>(1) << shader->_compileMacros.size() );
@@ -904,7 +1191,6 @@ void GLShaderManager::InitShader( GLShader *shader )
 bool GLShaderManager::LoadShaderBinary( GLShader *shader, size_t programNum )
 {
 #ifdef GL_ARB_get_program_binary
-	GLint          success;
 	const byte    *binaryptr;
 	GLBinaryHeader shaderHeader;
 
@@ -974,11 +1260,8 @@ bool GLShaderManager::LoadShaderBinary( GLShader *shader, size_t programNum )
 	shaderProgram_t *shaderProgram = &shader->_shaderPrograms[ programNum ];
 	shaderProgram->program = glCreateProgram();
 	glProgramBinary( shaderProgram->program, shaderHeader.binaryFormat, binaryptr, shaderHeader.binaryLength );
-	glGetProgramiv( shaderProgram->program, GL_LINK_STATUS, &success );
-
-	if ( !success )
-		return false;
 
+	// the link status is checked by FinishPermutation, so that it doesn't wait for the driver
 	return true;
 #else
 	return false;
@@ -1135,18 +1418,24 @@ GLuint GLShaderManager::CompileShader( Str::StringRef programName,
 
 	GL_CheckErrors();
 
-	// check if shader compiled
+	// the compile status is checked by CheckShaderCompiled, so that it doesn't wait for the driver
+	return shader;
+}
+
+void GLShaderManager::CheckShaderCompiled( Str::StringRef programName, GLuint shader ) const
+{
 	GLint compiled;
 	glGetShaderiv( shader, GL_COMPILE_STATUS, &compiled );
 
 	if ( !compiled )
 	{
+		GLint shaderType;
+		glGetShaderiv( shader, GL_SHADER_TYPE, &shaderType );
+
 		PrintShaderSource( programName, shader );
 		PrintInfoLog( shader );
 		ThrowShaderError(Str::Format("Couldn't compile %s shader: %s", ( shaderType == GL_VERTEX_SHADER) ? "vertex" : "fragment", programName));
 	}
-
-	return shader;
 }
 
 void GLShaderManager::PrintShaderSource( Str::StringRef programName, GLuint object ) const
@@ -1237,8 +1526,6 @@ void GLShaderManager::PrintInfoLog( GLuint object) const
 
 void GLShaderManager::LinkProgram( GLuint program ) const
 {
-	GLint linked;
-
 #ifdef GL_ARB_get_program_binary
 	// Apparently, this is necessary to get the binary program via glGetProgramBinary
 	if( glConfig2.getProgramBinaryAvailable )
@@ -1248,13 +1535,7 @@ void GLShaderManager::LinkProgram( GLuint program ) const
 #endif
 	glLinkProgram( program );
 
-	glGetProgramiv( program, GL_LINK_STATUS, &linked );
-
-	if ( !linked )
-	{
-		PrintInfoLog( program );
-		ThrowShaderError( "Shaders failed to link!" );
-	}
+	// the link status is checked by FinishPermutation, so that it doesn't wait for the driver
 }
 
 void GLShaderManager::BindAttribLocations( GLuint program ) const
@@ -1335,6 +1616,38 @@ bool GLCompileMacro_USE_VERTEX_SPRITE::HasConflictingMacros( size_t permutation,
 	return false;
 }
 
+// instancing is only implemented for animated .md3 meshes
+bool GLCompileMacro_USE_VERTEX_INSTANCING::HasConflictingMacros( size_t permutation, const std::vector< GLCompileMacro * > &macros ) const
+{
+	for (const GLCompileMacro* macro : macros)
+	{
+		if ( ( permutation & macro->GetBit() ) != 0 && (macro->GetType() == USE_BSP_SURFACE || macro->GetType() == USE_VERTEX_SKINNING || macro->GetType() == USE_VERTEX_SPRITE || macro->GetType() == USE_TCGEN_ENVIRONMENT || macro->GetType() == USE_DEPTH_FADE) )
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool GLCompileMacro_USE_VERTEX_INSTANCING::MissesRequiredMacros( size_t permutation, const std::vector< GLCompileMacro * > &macros ) const
+{
+	if ( !glConfig2.instancedArraysAvailable )
+	{
+		return true;
+	}
+
+	for (const GLCompileMacro* macro : macros)
+	{
+		if ( ( permutation & macro->GetBit() ) != 0 && macro->GetType() == USE_VERTEX_ANIMATION )
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
 bool GLCompileMacro_USE_TCGEN_ENVIRONMENT::HasConflictingMacros( size_t permutation, const std::vector<GLCompileMacro*> &macros) const
 {
 	for (const GLCompileMacro* macro : macros)
@@ -1478,7 +1791,7 @@ void GLShader::BindProgram( int deformIndex )
 
 	// program may not be loaded yet because the shader manager hasn't yet gotten to it
 	// so try to load it now
-	if ( index >= _shaderPrograms.size() || !_shaderPrograms[ index ].program )
+	if ( index >= _shaderPrograms.size() || !_shaderPrograms[ index ].program || _shaderPrograms[ index ].pending )
 	{
 		_shaderManager->buildPermutation( this, macroIndex, deformIndex );
 	}
@@ -1506,6 +1819,7 @@ void GLShader::BindProgram( int deformIndex )
 	}
 
 	_currentProgram = &_shaderPrograms[ index ];
+	_currentProgram->used = true;
 
 	if ( r_logFile->integer )
 	{
@@ -1589,6 +1903,7 @@ GLShader_generic::GLShader_generic( GLShaderManager *manager ) :
 	GLCompileMacro_USE_VERTEX_SKINNING( this ),
 	GLCompileMacro_USE_VERTEX_ANIMATION( this ),
 	GLCompileMacro_USE_VERTEX_SPRITE( this ),
+	GLCompileMacro_USE_VERTEX_INSTANCING( this ),
 	GLCompileMacro_USE_TCGEN_ENVIRONMENT( this ),
 	GLCompileMacro_USE_TCGEN_LIGHTMAP( this ),
 	GLCompileMacro_USE_DEPTH_FADE( this ),
@@ -1632,6 +1947,7 @@ GLShader_lightMapping::GLShader_lightMapping( GLShaderManager *manager ) :
 	GLCompileMacro_USE_BSP_SURFACE( this ),
 	GLCompileMacro_USE_VERTEX_SKINNING( this ),
 	GLCompileMacro_USE_VERTEX_ANIMATION( this ),
+	GLCompileMacro_USE_VERTEX_INSTANCING( this ),
 	GLCompileMacro_USE_DELUXE_MAPPING( this ),
 	GLCompileMacro_USE_GRID_LIGHTING( this ),
 	GLCompileMacro_USE_GRID_DELUXE_MAPPING( this ),
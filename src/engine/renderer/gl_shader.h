@@ -278,6 +278,9 @@ class GLShaderManager
 	unsigned int _driverVersionHash; // For cache invalidation if hardware changes
 	bool _shaderBinaryCacheInvalidated;
 
+	// Permutations started by StartPermutation, the driver may still be building them
+	std::vector< std::pair< GLShader*, size_t > > _pendingPermutations;
+
 public:
 	GLHeader GLVersionDeclaration;
 	GLHeader GLCompatHeader;
@@ -312,7 +315,13 @@ public:
 
 	void buildPermutation( GLShader *shader, int macroIndex, int deformIndex );
 	void buildAll();
+	void prewarmPermutations();
 private:
+	bool StartPermutation( GLShader *shader, int macroIndex, int deformIndex );
+	void FinishPermutation( GLShader *shader, size_t index );
+	void FinishPermutations();
+	void SavePrewarmList() const;
+	void CheckShaderCompiled( Str::StringRef programName, GLuint shader ) const;
 	bool LoadShaderBinary( GLShader *shader, size_t permutation );
 	void SaveShaderBinary( GLShader *shader, size_t permutation );
 	GLuint CompileShader( Str::StringRef programName, Str::StringRef shaderText,
@@ -761,6 +770,17 @@ public:
 			glBindBufferBase( GL_UNIFORM_BUFFER, blockIndex, buffer );
 		}
 	}
+
+	void SetBufferRange( GLuint buffer, GLintptr offset, GLsizeiptr size ) {
+		shaderProgram_t *p = _shader->GetProgram();
+		GLuint blockIndex = p->uniformBlockIndexes[ _locationIndex ];
+
+		ASSERT_EQ(p, glState.currentProgram);
+
+		if( blockIndex != GL_INVALID_INDEX ) {
+			glBindBufferRange( GL_UNIFORM_BUFFER, blockIndex, buffer, offset, size );
+		}
+	}
 };
 
 class GLCompileMacro
@@ -798,7 +818,8 @@ protected:
 	  LIGHT_DIRECTIONAL,
 	  USE_DEPTH_FADE,
 	  USE_PHYSICAL_MAPPING,
-	  USE_ALPHA_TESTING
+	  USE_ALPHA_TESTING,
+	  USE_VERTEX_INSTANCING
 	};
 
 public:
@@ -963,6 +984,38 @@ public:
 	}
 };
 
+class GLCompileMacro_USE_VERTEX_INSTANCING :
+	GLCompileMacro
+{
+public:
+	GLCompileMacro_USE_VERTEX_INSTANCING( GLShader *shader ) :
+		GLCompileMacro( shader )
+	{
+	}
+
+	const char *GetName() const override
+	{
+		return "USE_VERTEX_INSTANCING";
+	}
+
+	EGLCompileMacro GetType() const override
+	{
+		return EGLCompileMacro::USE_VERTEX_INSTANCING;
+	}
+
+	bool     HasConflictingMacros( size_t permutation, const std::vector< GLCompileMacro * > &macros ) const override;
+	bool     MissesRequiredMacros( size_t permutation, const std::vector< GLCompileMacro * > &macros ) const override;
+	uint32_t GetRequiredVertexAttributes() const override
+	{
+		return ATTR_INSTANCE_BITS;
+	}
+
+	void SetVertexInstancing( bool enable )
+	{
+		SetMacro( enable );
+	}
+};
+
 class GLCompileMacro_USE_TCGEN_ENVIRONMENT :
 	GLCompileMacro
 {
@@ -2206,9 +2259,9 @@ class u_Lights :
 	{
 	}
 
-	void SetUniformBlock_Lights( GLuint buffer )
+	void SetUniformBlock_Lights( GLuint buffer, GLintptr offset )
 	{
-		this->SetBuffer( buffer );
+		this->SetBufferRange( buffer, offset, MAX_REF_LIGHTS * sizeof( shaderLight_t ) );
 	}
 };
 
@@ -2254,6 +2307,7 @@ class GLShader_generic :
 	public GLCompileMacro_USE_VERTEX_SKINNING,
 	public GLCompileMacro_USE_VERTEX_ANIMATION,
 	public GLCompileMacro_USE_VERTEX_SPRITE,
+	public GLCompileMacro_USE_VERTEX_INSTANCING,
 	public GLCompileMacro_USE_TCGEN_ENVIRONMENT,
 	public GLCompileMacro_USE_TCGEN_LIGHTMAP,
 	public GLCompileMacro_USE_DEPTH_FADE,
@@ -2289,6 +2343,7 @@ class GLShader_lightMapping :
 	public GLCompileMacro_USE_BSP_SURFACE,
 	public GLCompileMacro_USE_VERTEX_SKINNING,
 	public GLCompileMacro_USE_VERTEX_ANIMATION,
+	public GLCompileMacro_USE_VERTEX_INSTANCING,
 	public GLCompileMacro_USE_DELUXE_MAPPING,
 	public GLCompileMacro_USE_GRID_LIGHTING,
 	public GLCompileMacro_USE_GRID_DELUXE_MAPPING,
@@ -64,6 +64,10 @@ void VertexFetch(out vec4 position,
 	LB.tangent = normalize(mix(fromLB.tangent, toLB.tangent, u_VertexInterpolation));
 	LB.binormal = normalize(mix(fromLB.binormal, toLB.binormal, u_VertexInterpolation));
 
+#if defined(USE_VERTEX_INSTANCING)
+	InstanceTransform( position, LB );
+#endif
+
 	color    = attr_Color;
 	texCoord = attr_TexCoord0;
 	lmCoord  = attr_TexCoord0;
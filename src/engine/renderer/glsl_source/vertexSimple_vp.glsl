@@ -38,6 +38,22 @@ void QTangentToLocalBasis( in vec4 qtangent, out localBasis LB ) {
 	LB.binormal = QuatTransVec( qtangent, vec3( 0.0, 1.0, 0.0 ) );
 }
 
+#if defined(USE_VERTEX_INSTANCING)
+// one transform per instance, the model matrix is the identity
+// so the vertex is moved to world space here
+IN vec4 attr_InstanceRotation;
+IN vec4 attr_InstanceTranslation; // scale in w
+
+void InstanceTransform( inout vec4 position, inout localBasis LB )
+{
+	position.xyz = QuatTransVec( attr_InstanceRotation, position.xyz ) * attr_InstanceTranslation.w + attr_InstanceTranslation.xyz;
+
+	LB.normal = QuatTransVec( attr_InstanceRotation, LB.normal );
+	LB.tangent = QuatTransVec( attr_InstanceRotation, LB.tangent );
+	LB.binormal = QuatTransVec( attr_InstanceRotation, LB.binormal );
+}
+#endif
+
 #if !defined(USE_VERTEX_ANIMATION) && !defined(USE_VERTEX_SKINNING) && !defined(USE_VERTEX_SPRITE)
 
 IN vec3 attr_Position;
@@ -23,6 +23,9 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 // tr_animation.c
 #include "tr_local.h"
 
+static Cvar::Cvar<bool> r_animationCache(
+	"r_animationCache", "keep parsed .md5anim files in the homepath so that they load faster", Cvar::NONE, true );
+
 /*
 ===========================================================================
 All bones should be an identity orientation to display the mesh exactly
@@ -413,6 +416,159 @@ static bool R_LoadMD5Anim( skelAnimation_t *skelAnim, const char *buffer, const
 	return true;
 }
 
+static const char     ANIMATION_CACHE_DIR[] = "animations";
+static const uint32_t ANIMATION_CACHE_VERSION = 1;
+
+struct animationCacheHeader_t
+{
+	uint32_t numFrames;
+	uint32_t numChannels;
+	int32_t  frameRate;
+	uint32_t numAnimatedComponents;
+};
+
+static std::string R_AnimationCacheKey( const char *name )
+{
+	if ( !r_animationCache.Get() )
+	{
+		return "";
+	}
+
+	std::string revision = R_PakFileRevision( name );
+
+	if ( revision.empty() )
+	{
+		return "";
+	}
+
+	return Str::Format( "%s %s", name, revision );
+}
+
+/*
+===============
+R_LoadCachedMD5Anim
+
+Loads an animation saved by R_SaveCachedMD5Anim, the channels and the frames
+are stored as they are in memory so there is nothing to parse
+===============
+*/
+static bool R_LoadCachedMD5Anim( skelAnimation_t *skelAnim, const std::string &key )
+{
+	std::string data;
+
+	if ( !R_ReadCacheFile( ANIMATION_CACHE_DIR, key, ANIMATION_CACHE_VERSION, data ) )
+	{
+		return false;
+	}
+
+	cacheReader_t          reader( data );
+	animationCacheHeader_t header;
+
+	if ( !reader.Read( header ) || header.numChannels > 0xFF || header.numFrames > 0xFFFF )
+	{
+		return false;
+	}
+
+	size_t channelsSize = sizeof( md5Channel_t ) * header.numChannels;
+	size_t boundsSize = sizeof( vec3_t[ 2 ] ) * header.numFrames;
+	size_t componentsSize = sizeof( float ) * header.numAnimatedComponents * header.numFrames;
+
+	if ( reader.Left() != channelsSize + boundsSize + componentsSize )
+	{
+		return false;
+	}
+
+	std::vector<md5Channel_t> channels( header.numChannels );
+
+	reader.Read( channels.data(), channelsSize );
+
+	// what the text loader checks, and that the components of each
+	// channel are in the frames, before anything is allocated
+	for ( const md5Channel_t &channel : channels )
+	{
+		unsigned numComponents = 0;
+
+		for ( int bit = 0; bit < 6; bit++ )
+		{
+			numComponents += ( channel.componentsBits >> bit ) & 1u;
+		}
+
+		if ( !memchr( channel.name, '\0', sizeof( channel.name ) ) || channel.parentIndex >= (int) header.numChannels
+		     || channel.parentIndex < -1 || ( channel.componentsBits & ~( ( 1 << 6 ) - 1 ) )
+		     || channel.componentsOffset + numComponents > header.numAnimatedComponents )
+		{
+			Log::Warn( "animation cache for '%s' has bad channels", key );
+			return false;
+		}
+	}
+
+	const char *p = data.data() + reader.offset;
+
+	md5Animation_t *anim = (md5Animation_t*) ri.Hunk_Alloc( sizeof( *anim ), ha_pref::h_low );
+	anim->numFrames = header.numFrames;
+	anim->numChannels = header.numChannels;
+	anim->frameRate = header.frameRate;
+	anim->numAnimatedComponents = header.numAnimatedComponents;
+
+	anim->channels = (md5Channel_t*) ri.Hunk_Alloc( channelsSize, ha_pref::h_low );
+	memcpy( anim->channels, channels.data(), channelsSize );
+
+	anim->frames = (md5Frame_t*) ri.Hunk_Alloc( sizeof( md5Frame_t ) * anim->numFrames, ha_pref::h_low );
+
+	// all the components are allocated together
+	float *components = (float*) ri.Hunk_Alloc( componentsSize, ha_pref::h_low );
+	memcpy( components, p + boundsSize, componentsSize );
+
+	for ( unsigned i = 0; i < anim->numFrames; i++ )
+	{
+		memcpy( anim->frames[ i ].bounds, p, sizeof( vec3_t[ 2 ] ) );
+		p += sizeof( vec3_t[ 2 ] );
+
+		anim->frames[ i ].components = components + i * anim->numAnimatedComponents;
+	}
+
+	skelAnim->type = animType_t::AT_MD5;
+	skelAnim->md5 = anim;
+
+	return true;
+}
+
+/*
+===============
+R_SaveCachedMD5Anim
+===============
+*/
+static void R_SaveCachedMD5Anim( const skelAnimation_t *skelAnim, const std::string &key )
+{
+	if ( key.empty() )
+	{
+		return;
+	}
+
+	const md5Animation_t *anim = skelAnim->md5;
+	animationCacheHeader_t header{};
+
+	header.numFrames = anim->numFrames;
+	header.numChannels = anim->numChannels;
+	header.frameRate = anim->frameRate;
+	header.numAnimatedComponents = anim->numAnimatedComponents;
+
+	std::string data( reinterpret_cast<const char *>( &header ), sizeof( header ) );
+	data.append( reinterpret_cast<const char *>( anim->channels ), sizeof( md5Channel_t ) * anim->numChannels );
+
+	for ( unsigned i = 0; i < anim->numFrames; i++ )
+	{
+		data.append( reinterpret_cast<const char *>( anim->frames[ i ].bounds ), sizeof( vec3_t[ 2 ] ) );
+	}
+
+	for ( unsigned i = 0; i < anim->numFrames; i++ )
+	{
+		data.append( reinterpret_cast<const char *>( anim->frames[ i ].components ), sizeof( float ) * anim->numAnimatedComponents );
+	}
+
+	R_WriteCacheFile( ANIMATION_CACHE_DIR, key, ANIMATION_CACHE_VERSION, data );
+}
+
 /*
 ===============
 RE_RegisterAnimationIQM
@@ -530,6 +686,13 @@ qhandle_t RE_RegisterAnimation( const char *name )
 		return 0;
 	}
 
+	std::string cacheKey = R_AnimationCacheKey( name );
+
+	if ( R_LoadCachedMD5Anim( anim, cacheKey ) )
+	{
+		return anim->index;
+	}
+
 	// load and parse the .md5anim file
 	std::error_code err;
 	std::string buffer = FS::PakPath::ReadFile( name, err );
@@ -542,6 +705,11 @@ qhandle_t RE_RegisterAnimation( const char *name )
 	if ( Str::IsPrefix( "MD5Version", buffer ) )
 	{
 		loaded = R_LoadMD5Anim( anim, buffer.c_str(), name );
+
+		if ( loaded )
+		{
+			R_SaveCachedMD5Anim( anim, cacheKey );
+		}
 	}
 	else
 	{
@@ -671,6 +839,7 @@ void R_AddMD5Surfaces( trRefEntity_t *ent )
 	// cull the entire model if merged bounding box of both frames
 	// is outside the view frustum
 	R_CullMD5( ent );
+	R_OcclusionCullEntity( ent );
 
 	if ( ent->cull == cullResult_t::CULL_OUT )
 	{
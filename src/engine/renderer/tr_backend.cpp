@@ -700,6 +700,12 @@ void GL_VertexAttribPointers( uint32_t attribBits )
 			base = tess.vertexBase * sizeof( shaderVertex_t );
 		}
 
+		// the instance attributes don't come from the current VBO
+		if ( bit & ATTR_INSTANCE_BITS )
+		{
+			continue;
+		}
+
 		if ( ( attribBits & bit ) != 0 &&
 		     ( !( glState.vertexAttribPointersSet & bit ) ||
 		       glState.vertexAttribsInterpolation >= 0 ||
@@ -728,6 +734,25 @@ void GL_VertexAttribPointers( uint32_t attribBits )
 			glState.vertexAttribPointersSet |= bit;
 		}
 	}
+
+	if ( attribBits & ATTR_INSTANCE_BITS )
+	{
+		// one transform_t per instance: the rotation quaternion, then
+		// the translation with the scale in w
+		uintptr_t base = tess.instanceBase * sizeof( transform_t );
+
+		GLimp_LogComment( "glVertexAttribPointer( instance attributes )\n" );
+
+		glBindBuffer( GL_ARRAY_BUFFER, tess.instanceVBO );
+
+		glVertexAttribPointer( ATTR_INDEX_INSTANCE_ROTATION, 4, GL_FLOAT, GL_FALSE, sizeof( transform_t ), BUFFER_OFFSET( base ) );
+		glVertexAttribDivisor( ATTR_INDEX_INSTANCE_ROTATION, 1 );
+
+		glVertexAttribPointer( ATTR_INDEX_INSTANCE_TRANSLATION, 4, GL_FLOAT, GL_FALSE, sizeof( transform_t ), BUFFER_OFFSET( base + sizeof( quat_t ) ) );
+		glVertexAttribDivisor( ATTR_INDEX_INSTANCE_TRANSLATION, 1 );
+
+		glBindBuffer( GL_ARRAY_BUFFER, glState.currentVBO->vertexesVBO );
+	}
 }
 
 /*
@@ -832,9 +857,182 @@ enum renderDrawSurfaces_e
   DRAWSURFACES_ALL           = DRAWSURFACES_WORLD | DRAWSURFACES_ALL_ENTITIES
 };
 
+/*
+=================
+RB_InstancableShader
+
+Opaque shaders whose stages don't depend on the entity
+can draw all the instances of a surface at once
+=================
+*/
+static bool RB_InstancableShader( const shader_t *shader )
+{
+	if ( shader->remappedShader )
+	{
+		shader = shader->remappedShader;
+	}
+
+	if ( shader->sort > Util::ordinal( shaderSort_t::SS_OPAQUE ) || shader->isSky || shader->isPortal
+	     || shader->entityMergable || shader->autoSpriteMode || shader->numDeforms )
+	{
+		return false;
+	}
+
+	for ( int stage = 0; stage < shader->numStages; stage++ )
+	{
+		const shaderStage_t *pStage = shader->stages[ stage ];
+
+		switch ( pStage->type )
+		{
+			case stageType_t::ST_COLORMAP:
+			case stageType_t::ST_STYLELIGHTMAP:
+			case stageType_t::ST_STYLECOLORMAP:
+			case stageType_t::ST_LIGHTMAP:
+			case stageType_t::ST_DIFFUSEMAP:
+			case stageType_t::ST_COLLAPSE_lighting_PHONG:
+			case stageType_t::ST_COLLAPSE_lighting_PBR:
+				break;
+
+			default:
+				return false;
+		}
+
+		if ( pStage->deformIndex || pStage->tcGen_Environment || pStage->hasDepthFade )
+		{
+			return false;
+		}
+
+		if ( pStage->rgbGen == colorGen_t::CGEN_ENTITY || pStage->rgbGen == colorGen_t::CGEN_ONE_MINUS_ENTITY
+		     || pStage->alphaGen == alphaGen_t::AGEN_ENTITY || pStage->alphaGen == alphaGen_t::AGEN_ONE_MINUS_ENTITY )
+		{
+			return false;
+		}
+
+		// the cube maps are picked from the entity origin
+		if ( pStage->enableNormalMapping && tr.cubeHashTable != nullptr )
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+=================
+RB_InstanceTransform
+
+Returns false if the entity transform isn't a rotation,
+a uniform scale and a translation
+=================
+*/
+static bool RB_InstanceTransform( const trRefEntity_t *entity, transform_t *transform )
+{
+	const refEntity_t *e = &entity->e;
+	vec3_t            axis[ 3 ];
+	vec3_t            cross;
+	matrix_t          rotation;
+	float             scale = 1.0f;
+	int               i;
+
+	if ( entity == &tr.worldEntity || e->reType != refEntityType_t::RT_MODEL || ( e->renderfx & RF_DEPTHHACK ) )
+	{
+		return false;
+	}
+
+	if ( e->nonNormalizedAxes )
+	{
+		scale = VectorLength( e->axis[ 0 ] );
+
+		if ( scale <= 0.0f )
+		{
+			return false;
+		}
+
+		for ( i = 0; i < 3; i++ )
+		{
+			VectorScale( e->axis[ i ], 1.0f / scale, axis[ i ] );
+
+			if ( fabsf( VectorLength( axis[ i ] ) - 1.0f ) > 0.001f )
+			{
+				return false;
+			}
+		}
+	}
+	else
+	{
+		for ( i = 0; i < 3; i++ )
+		{
+			VectorCopy( e->axis[ i ], axis[ i ] );
+		}
+	}
+
+	// mirrored axes aren't a rotation
+	CrossProduct( axis[ 0 ], axis[ 1 ], cross );
+
+	if ( DotProduct( cross, axis[ 2 ] ) <= 0.0f )
+	{
+		return false;
+	}
+
+	MatrixFromVectorsFLU( rotation, axis[ 0 ], axis[ 1 ], axis[ 2 ] );
+	QuatFromMatrix( transform->rot, rotation );
+	VectorCopy( e->origin, transform->trans );
+	transform->scale = scale;
+
+	return true;
+}
+
+/*
+=================
+RB_CollectInstances
+
+Gathers the consecutive draw surfaces from firstSurf on that
+show the same .md3 surface in the same frame, returns how many
+=================
+*/
+static int RB_CollectInstances( int firstSurf, int lastSurf, transform_t *instances )
+{
+	const drawSurf_t *first = &backEnd.viewParms.drawSurfs[ firstSurf ];
+	const refEntity_t *e = &first->entity->e;
+	int numInstances = 0;
+
+	for ( int i = firstSurf; i < lastSurf && numInstances < MAX_INSTANCES; i++ )
+	{
+		const drawSurf_t *drawSurf = &backEnd.viewParms.drawSurfs[ i ];
+		const refEntity_t *other = &drawSurf->entity->e;
+
+		if ( drawSurf->surface != first->surface || drawSurf->shader != first->shader
+		     || drawSurf->lightmapNum() != first->lightmapNum() || drawSurf->fogNum() != first->fogNum() )
+		{
+			break;
+		}
+
+		// the vertex animation and the shader time are shared
+		if ( other->frame != e->frame || other->oldframe != e->oldframe
+		     || ( other->frame != other->oldframe && other->backlerp != e->backlerp )
+		     || other->shaderTime != e->shaderTime
+		     || ( other->renderfx & RF_SWAPCULL ) != ( e->renderfx & RF_SWAPCULL ) )
+		{
+			break;
+		}
+
+		if ( !RB_InstanceTransform( drawSurf->entity, &instances[ numInstances ] ) )
+		{
+			break;
+		}
+
+		numInstances++;
+	}
+
+	return numInstances;
+}
+
 static void RB_RenderDrawSurfaces( shaderSort_t fromSort, shaderSort_t toSort,
 				   renderDrawSurfaces_e drawSurfFilter )
 {
+	static transform_t instances[ MAX_INSTANCES ];
+
 	trRefEntity_t *entity, *oldEntity;
 	shader_t      *shader, *oldShader;
 	int           lightmapNum, oldLightmapNum;
@@ -885,6 +1083,56 @@ static void RB_RenderDrawSurfaces( shaderSort_t fromSort, shaderSort_t toSort,
 				continue;
 		}
 
+		// draw the instances of a .md3 surface with a single call,
+		// their vertexes are moved to world space by the instance transforms
+		if ( glConfig2.instancedArraysAvailable && *drawSurf->surface == surfaceType_t::SF_VBO_MDVMESH
+		     && fogNum == 0 && RB_InstancableShader( shader ) )
+		{
+			int numInstances = RB_CollectInstances( i, lastSurf, instances );
+
+			if ( numInstances > 1 )
+			{
+				if ( oldShader != nullptr )
+				{
+					if ( oldShader->autoSpriteMode && !(tess.attribsSet & ATTR_ORIENTATION) ) {
+						Tess_AutospriteDeform( oldShader->autoSpriteMode,
+								       0, tess.numVertexes,
+								       0, tess.numIndexes );
+					}
+					Tess_End();
+				}
+
+				Tess_Begin( Tess_StageIteratorGeneric, nullptr, shader, nullptr, false, false, lightmapNum, fogNum, bspSurface );
+
+				oldShader = shader;
+				oldLightmapNum = lightmapNum;
+				oldFogNum = fogNum;
+
+				// the entity still provides the frames and the shader time
+				backEnd.currentEntity = entity;
+				backEnd.orientation = backEnd.viewParms.world;
+
+				GL_LoadModelViewMatrix( backEnd.orientation.modelViewMatrix );
+
+				depthRange = false;
+
+				if ( oldDepthRange )
+				{
+					glDepthRange( 0, 1 );
+					oldDepthRange = false;
+				}
+
+				// make the next surface set up its entity again
+				oldEntity = nullptr;
+
+				Tess_UploadInstances( instances, numInstances );
+				rb_surfaceTable[Util::ordinal(*drawSurf->surface)](drawSurf->surface );
+
+				i += numInstances - 1;
+				continue;
+			}
+		}
+
 		if ( entity == oldEntity && shader == oldShader && lightmapNum == oldLightmapNum && fogNum == oldFogNum )
 		{
 			// fast path, same as previous sort
@@ -2888,7 +3136,7 @@ void RB_RenderPostDepthLightTile()
 	gl_lighttileShader->SetUniform_zFar( projToViewParams );
 
 	if( glConfig2.uniformBufferObjectAvailable ) {
-		gl_lighttileShader->SetUniformBlock_Lights( tr.dlightUBO );
+		gl_lighttileShader->SetUniformBlock_Lights( tr.dlightUBO, tr.dlightOffset );
 	} else {
 		GL_BindToTMU( 1, tr.dlightImage );
 	}
@@ -4840,12 +5088,23 @@ static void RB_RenderPostProcess()
 		// need to convert Y axis
 		// Bugfix: drivers absolutely hate running in high res and using glReadPixels near the top or bottom edge.
 		// Sooo... let's do it in the middle.
-		glReadPixels(glConfig.vidWidth / 2, glConfig.vidHeight / 2, tr.refdef.pixelTargetWidth, tr.refdef.pixelTargetHeight, GL_RGBA,
-			GL_UNSIGNED_BYTE, tr.refdef.pixelTarget);
-
-		for (i = 0; i < tr.refdef.pixelTargetWidth * tr.refdef.pixelTargetHeight; i++)
+		if (tr.refdef.pixelTargetPBO)
+		{
+			// the reader maps the PBO later, so nothing waits for the GPU here
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, tr.refdef.pixelTargetPBO);
+			glReadPixels(glConfig.vidWidth / 2, glConfig.vidHeight / 2, tr.refdef.pixelTargetWidth, tr.refdef.pixelTargetHeight, GL_RGBA,
+				GL_UNSIGNED_BYTE, nullptr);
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		}
+		else
 		{
-			tr.refdef.pixelTarget[(i * 4) + 3] = 255;  //set the alpha pure white
+			glReadPixels(glConfig.vidWidth / 2, glConfig.vidHeight / 2, tr.refdef.pixelTargetWidth, tr.refdef.pixelTargetHeight, GL_RGBA,
+				GL_UNSIGNED_BYTE, tr.refdef.pixelTarget);
+
+			for (i = 0; i < tr.refdef.pixelTargetWidth * tr.refdef.pixelTargetHeight; i++)
+			{
+				tr.refdef.pixelTarget[(i * 4) + 3] = 255;  //set the alpha pure white
+			}
 		}
 	}
 
@@ -5402,10 +5661,7 @@ const RenderCommand *SetupLightsCommand::ExecuteSelf( ) const
 	if( (numLights = refdef.numLights) > 0 ) {
 		shaderLight_t *buffer;
 
-		glBindBuffer( bufferTarget, tr.dlightUBO );
-		buffer = (shaderLight_t *)glMapBufferRange( bufferTarget,
-							    0, numLights * sizeof( shaderLight_t ),
-							    GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT );
+		buffer = R_MapDynamicLights( numLights );
 
 		for( int i = 0, j = 0; i < numLights; i++, j++ ) {
 			trRefLight_t *light = &refdef.lights[j];
@@ -5433,10 +5689,10 @@ const RenderCommand *SetupLightsCommand::ExecuteSelf( ) const
 			}
 		}
 
-		glUnmapBuffer( bufferTarget );
+		R_UnmapDynamicLights();
 		if( !glConfig2.uniformBufferObjectAvailable ) {
 			GL_BindToTMU( 0, tr.dlightImage );
-			glTexSubImage2D( GL_TEXTURE_2D, 0, 0, 0, tr.dlightImage->width, tr.dlightImage->height, GL_RGBA, GL_FLOAT, nullptr );
+			glTexSubImage2D( GL_TEXTURE_2D, 0, 0, 0, tr.dlightImage->width, tr.dlightImage->height, GL_RGBA, GL_FLOAT, BUFFER_OFFSET( tr.dlightOffset ) );
 		}
 		glBindBuffer( bufferTarget, 0 );
 	}
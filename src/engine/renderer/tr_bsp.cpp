@@ -23,7 +23,9 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 */
 // tr_bsp.c
 #include "tr_local.h"
+#include "InternalImage.h"
 #include "framework/CommandSystem.h"
+#include <zlib.h>
 
 /*
 ========================================================
@@ -35,8 +37,16 @@ RE_LoadWorldMap(const char *name);
 */
 
 static world_t    s_worldData;
-static int        s_lightCount;
-static growList_t s_interactions;
+
+// checksum of the BSP file, used as a key for the homepath caches
+static unsigned   s_worldChecksum;
+
+// the leafs of each cluster, see R_CreateClusterLeafLists
+static std::vector<int> s_clusterLeafOffsets;
+static std::vector<int> s_clusterLeaves;
+
+// the large faces drawn into the occlusion buffer, see R_CreateOccluders
+static std::vector<occluder_t> s_occluders;
 static byte       *fileBase;
 
 static int        c_redundantInteractions;
@@ -44,6 +54,36 @@ static int        c_vboWorldSurfaces;
 static int        c_vboLightSurfaces;
 static int        c_vboShadowSurfaces;
 
+static Cvar::Cvar<bool> r_interactionCache(
+	"r_interactionCache", "keep the interactions precached for the static lights in the homepath so that maps load faster", Cvar::NONE, true );
+static Cvar::Cvar<bool> r_cubeProbeCache(
+	"r_cubeProbeCache", "keep the cubemap probes baked by buildcubemaps in the homepath and load them with the map", Cvar::NONE, true );
+
+// a static VBO surface of a light, see R_BuildLightMeshes
+struct lightMeshBatch_t
+{
+	int                    firstSurface; // the batch is drawn with the shader of this surface
+	bool                   shadow;
+	byte                   cubeSideBits;
+	int                    numVerts;
+	vec3_t                 bounds[ 2 ];
+	std::vector<glIndex_t> indexes;
+
+	// the surface number and the triangle in it of each triangle, the
+	// cache keeps them as the order of the world VBO can change
+	std::vector<uint32_t>  triangles;
+};
+
+// what R_PrecacheInteractions computes for a light, before it is moved to the hunk
+struct lightInteractions_t
+{
+	std::vector<int>              surfaces;
+	std::vector<byte>             cubeSideBits; // for each surface
+	std::vector<byte>             mergedIntoVBO; // for each surface
+	std::vector<int>              leafs;
+	std::vector<lightMeshBatch_t> batches;
+};
+
 //===============================================================================
 
 /*
@@ -125,6 +165,65 @@ static void R_ColorShiftLightingBytesCompressed( byte in[ 8 ], byte out[ 8 ] )
 	out[3] = rgb565 >> 8;
 }
 
+/*
+===============
+R_ColorShiftLightmapPixels
+
+Color shifts count pixels and sets their alpha to 255. With SSE2, groups
+of four 32 bit pixels none of which overflows are shifted at once.
+===============
+*/
+static void R_ColorShiftLightmapPixels( const byte *in, int in_padding, byte *out, int count )
+{
+	int j = 0;
+
+#if idx86_sse >= 2
+	int shift = tr.mapOverBrightBits;
+
+	if ( in_padding == 4 && shift >= 0 && shift <= 7 )
+	{
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i limit = _mm_set1_epi16( 255 );
+		const __m128i colorMask16 = _mm_set_epi16( 0, -1, -1, -1, 0, -1, -1, -1 );
+		const __m128i colorMask8 = _mm_set1_epi32( 0x00FFFFFF );
+		const __m128i alpha = _mm_set1_epi32( 0xFF000000 );
+		const __m128i shiftCount = _mm_cvtsi32_si128( shift );
+
+		for ( ; j + 4 <= count; j += 4 )
+		{
+			__m128i pixels = _mm_loadu_si128( reinterpret_cast<const __m128i *>( &in[ j * 4 ] ) );
+			__m128i lo = _mm_and_si128( _mm_sll_epi16( _mm_unpacklo_epi8( pixels, zero ), shiftCount ), colorMask16 );
+			__m128i hi = _mm_and_si128( _mm_sll_epi16( _mm_unpackhi_epi8( pixels, zero ), shiftCount ), colorMask16 );
+			__m128i over = _mm_or_si128( _mm_cmpgt_epi16( lo, limit ), _mm_cmpgt_epi16( hi, limit ) );
+
+			// colors normalized by their maximum are left to the scalar code
+			if ( _mm_movemask_epi8( over ) )
+			{
+				for ( int k = j; k < j + 4; k++ )
+				{
+					byte pixel[ 4 ] = { in[ k * 4 ], in[ k * 4 + 1 ], in[ k * 4 + 2 ], 255 };
+					R_ColorShiftLightingBytes( pixel, &out[ k * 4 ] );
+				}
+
+				continue;
+			}
+
+			pixels = _mm_or_si128( _mm_and_si128( _mm_packus_epi16( lo, hi ), colorMask8 ), alpha );
+			_mm_storeu_si128( reinterpret_cast<__m128i *>( &out[ j * 4 ] ), pixels );
+		}
+	}
+#endif
+
+	for ( ; j < count; j++ )
+	{
+		R_ColorShiftLightingBytes( const_cast<byte *>( &in[ j * in_padding ] ), &out[ j * 4 ] );
+		out[ j * 4 + 3 ] = 255;
+	}
+}
+
+// pixels or blocks per job when processing lightmaps and light grids
+static const int LIGHTING_JOB_SIZE = 16384;
+
 /*
 ===============
 R_ProcessLightmap
@@ -134,26 +233,38 @@ R_ProcessLightmap
 */
 float R_ProcessLightmap( byte *pic, int in_padding, int width, int height, int bits, byte *pic_out )
 {
-	int   j;
 	float maxIntensity = 0;
+	int   blockSize = 0;
+	int   count = width * height;
 
 	if( bits & IF_BC1 ) {
-		for ( j = 0; j < ((width + 3) >> 2) * ((height + 3) >> 2); j++ )
-		{
-			R_ColorShiftLightingBytesCompressed( &pic[ j * 8 ], &pic_out[ j * 8 ] );
-		}
+		blockSize = 8;
 	} else if( bits & (IF_BC2 | IF_BC3) ) {
-		for ( j = 0; j < ((width + 3) >> 2) * ((height + 3) >> 2); j++ )
+		blockSize = 16;
+	}
+
+	if ( blockSize )
+	{
+		count = ((width + 3) >> 2) * ((height + 3) >> 2);
+	}
+
+	// large lightmaps are split between the job threads
+	R_RunJobs( ( count + LIGHTING_JOB_SIZE - 1 ) / LIGHTING_JOB_SIZE, [ & ]( int job ) {
+		int first = job * LIGHTING_JOB_SIZE;
+		int last = std::min( first + LIGHTING_JOB_SIZE, count );
+
+		if ( blockSize )
 		{
-			R_ColorShiftLightingBytesCompressed( &pic[ j * 16 ], &pic_out[ j * 16 ] );
+			for ( int j = first; j < last; j++ )
+			{
+				R_ColorShiftLightingBytesCompressed( &pic[ j * blockSize ], &pic_out[ j * blockSize ] );
+			}
 		}
-	} else {
-		for ( j = 0; j < width * height; j++ )
+		else
 		{
-			R_ColorShiftLightingBytes( &pic[ j * in_padding ], &pic_out[ j * 4 ] );
-			pic_out[ j * 4 + 3 ] = 255;
+			R_ColorShiftLightmapPixels( &pic[ first * in_padding ], in_padding, &pic_out[ first * 4 ], last - first );
 		}
-	}
+	} );
 
 	return maxIntensity;
 }
@@ -377,13 +488,8 @@ void LoadRGBEToFloats( const char *name, float **pic, int *width, int *height )
 
 static void LoadRGBEToBytes( const char *name, byte **ldrImage, int *width, int *height )
 {
-	int    i, j;
 	int    w, h;
 	float  *hdrImage;
-	float  *floatbuf;
-	byte   *pixbuf;
-	vec3_t sample;
-	float  max;
 
 	w = h = 0;
 	LoadRGBEToFloats( name, &hdrImage, &w, &h );
@@ -392,40 +498,46 @@ static void LoadRGBEToBytes( const char *name, byte **ldrImage, int *width, int
 	*height = h;
 
 	*ldrImage = (byte*) ri.Z_Malloc( w * h * 4 );
-	pixbuf = *ldrImage;
 
-	floatbuf = hdrImage;
+	R_RunJobs( ( w * h + LIGHTING_JOB_SIZE - 1 ) / LIGHTING_JOB_SIZE, [ & ]( int job ) {
+		int    first = job * LIGHTING_JOB_SIZE;
+		int    last = std::min( first + LIGHTING_JOB_SIZE, w * h );
+		byte   *pixbuf = *ldrImage + first * 4;
+		float  *floatbuf = hdrImage + first * 3;
+		vec3_t sample;
+		float  max;
 
-	for ( i = 0; i < ( w * h ); i++ )
-	{
-		for ( j = 0; j < 3; j++ )
+		for ( int i = first; i < last; i++ )
 		{
-			sample[ j ] = *floatbuf++ * 255.0f;
-		}
+			for ( int j = 0; j < 3; j++ )
+			{
+				sample[ j ] = *floatbuf++ * 255.0f;
+			}
 
-		// clamp with color normalization
-		max = sample[ 0 ];
+			// clamp with color normalization
+			max = sample[ 0 ];
 
-		if ( sample[ 1 ] > max )
-		{
-			max = sample[ 1 ];
-		}
+			if ( sample[ 1 ] > max )
+			{
+				max = sample[ 1 ];
+			}
 
-		if ( sample[ 2 ] > max )
-		{
-			max = sample[ 2 ];
-		}
+			if ( sample[ 2 ] > max )
+			{
+				max = sample[ 2 ];
+			}
 
-		if ( max > 255.0f )
-		{
-			VectorScale( sample, ( 255.0f / max ), sample );
-		}
+			if ( max > 255.0f )
+			{
+				VectorScale( sample, ( 255.0f / max ), sample );
+			}
 
-		*pixbuf++ = ( byte ) sample[ 0 ];
-		*pixbuf++ = ( byte ) sample[ 1 ];
-		*pixbuf++ = ( byte ) sample[ 2 ];
-		*pixbuf++ = ( byte ) 255;
-	}
+			*pixbuf++ = ( byte ) sample[ 0 ];
+			*pixbuf++ = ( byte ) sample[ 1 ];
+			*pixbuf++ = ( byte ) sample[ 2 ];
+			*pixbuf++ = ( byte ) 255;
+		}
+	} );
 
 	free( hdrImage );
 }
@@ -621,29 +733,29 @@ static void R_LoadLightmaps( lump_t *l, const char *bspName )
 			numLightmaps = MAX_LIGHTMAPS;
 		}
 
-		for ( int i = 0; i < numLightmaps; i++ )
-		{
-			byte *lightMapBuffer = (byte*) ri.Hunk_AllocateTempMemory( sizeof( byte ) * internalLightMapSize * internalLightMapSize * 4 );
+		const int pageSize = internalLightMapSize * internalLightMapSize * 4;
+		byte *lightMapBuffers = (byte*) ri.Hunk_AllocateTempMemory( sizeof( byte ) * pageSize * numLightmaps );
 
-			memset( lightMapBuffer, 128, internalLightMapSize * internalLightMapSize * 4 );
-
-			// expand the 24 bit on-disk to 32 bit
+		// expand the 24 bit on-disk to 32 bit, one page per job
+		R_RunJobs( numLightmaps, [ & ]( int i ) {
+			byte *lightMapBuffer = lightMapBuffers + i * pageSize;
 			byte *buf_p = buf + i * internalLightMapSize * internalLightMapSize * 3;
 
-			for ( int y = 0; y < internalLightMapSize; y++ )
+			for ( int index = 0; index < internalLightMapSize * internalLightMapSize; index++ )
 			{
-				for ( int x = 0; x < internalLightMapSize; x++ )
-				{
-					int index = x + ( y * internalLightMapSize );
-					lightMapBuffer[( index * 4 ) + 0 ] = buf_p[( ( x + ( y * internalLightMapSize ) ) * 3 ) + 0 ];
-					lightMapBuffer[( index * 4 ) + 1 ] = buf_p[( ( x + ( y * internalLightMapSize ) ) * 3 ) + 1 ];
-					lightMapBuffer[( index * 4 ) + 2 ] = buf_p[( ( x + ( y * internalLightMapSize ) ) * 3 ) + 2 ];
-					lightMapBuffer[( index * 4 ) + 3 ] = 255;
-
-					R_ColorShiftLightingBytes( &lightMapBuffer[( index * 4 ) + 0 ], &lightMapBuffer[( index * 4 ) + 0 ] );
-				}
+				lightMapBuffer[( index * 4 ) + 0 ] = buf_p[( index * 3 ) + 0 ];
+				lightMapBuffer[( index * 4 ) + 1 ] = buf_p[( index * 3 ) + 1 ];
+				lightMapBuffer[( index * 4 ) + 2 ] = buf_p[( index * 3 ) + 2 ];
+				lightMapBuffer[( index * 4 ) + 3 ] = 255;
 			}
 
+			R_ColorShiftLightmapPixels( lightMapBuffer, 4, lightMapBuffer, internalLightMapSize * internalLightMapSize );
+		} );
+
+		for ( int i = 0; i < numLightmaps; i++ )
+		{
+			byte *lightMapBuffer = lightMapBuffers + i * pageSize;
+
 			imageParams_t imageParams = {};
 			imageParams.bits = IF_NOPICMIP | IF_LIGHTMAP;
 			imageParams.filterType = filterType_t::FT_DEFAULT;
@@ -651,9 +763,9 @@ static void R_LoadLightmaps( lump_t *l, const char *bspName )
 
 			image_t *internalLightMap = R_CreateImage( va( "_internalLightMap%d", i ), (const byte **)&lightMapBuffer, internalLightMapSize, internalLightMapSize, 1, imageParams );
 			Com_AddToGrowList( &tr.lightmaps, internalLightMap );
-
-			ri.Hunk_FreeTempMemory( lightMapBuffer );
 		}
+
+		ri.Hunk_FreeTempMemory( lightMapBuffers );
 	}
 }
 
@@ -2730,6 +2842,248 @@ static void CopyVert( const srfVert_t *in, srfVert_t *out )
 	}
 }
 
+/*
+=================
+R_CreateClusterLeafLists
+
+Lists the leafs of each cluster, in flat node order, so that R_MarkLeaves
+only goes through the leafs of the clusters set in the pvs. Each leaf is
+stored once, the leafs without a cluster last as they are always in the pvs
+=================
+*/
+static void R_CreateClusterLeafLists()
+{
+	s_clusterLeafOffsets.clear();
+	s_clusterLeaves.clear();
+
+	s_worldData.clusterLeafOffsets = nullptr;
+	s_worldData.clusterLeaves = nullptr;
+
+	if ( !s_worldData.vis )
+	{
+		return;
+	}
+
+	// the leafs that can be visible at all, those outside the map
+	// or not reachable from the root are never marked
+	std::vector<bspNode_t *> leafs;
+
+	for ( int i = s_worldData.numDecisionNodes; i < s_worldData.numnodes; i++ )
+	{
+		bspNode_t *leaf = &s_worldData.nodes[ i ];
+
+		if ( leaf->area != -1 && leaf->flatIndex >= 0 )
+		{
+			leafs.push_back( leaf );
+		}
+	}
+
+	auto clusterIndex = []( const bspNode_t *leaf ) {
+		return leaf->cluster >= 0 && leaf->cluster < s_worldData.numClusters ? leaf->cluster : s_worldData.numClusters;
+	};
+
+	std::sort( leafs.begin(), leafs.end(), [ & ]( const bspNode_t *a, const bspNode_t *b ) {
+		int clusterA = clusterIndex( a );
+		int clusterB = clusterIndex( b );
+
+		return clusterA != clusterB ? clusterA < clusterB : a->flatIndex < b->flatIndex;
+	} );
+
+	s_clusterLeaves.reserve( leafs.size() );
+	s_clusterLeafOffsets.assign( s_worldData.numClusters + 2, 0 );
+
+	for ( const bspNode_t *leaf : leafs )
+	{
+		s_clusterLeafOffsets[ clusterIndex( leaf ) + 1 ]++;
+		s_clusterLeaves.push_back( leaf->flatIndex );
+	}
+
+	for ( int i = 0; i <= s_worldData.numClusters; i++ )
+	{
+		s_clusterLeafOffsets[ i + 1 ] += s_clusterLeafOffsets[ i ];
+	}
+
+	s_worldData.clusterLeafOffsets = s_clusterLeafOffsets.data();
+	s_worldData.clusterLeaves = s_clusterLeaves.data();
+
+	Log::Debug( "%i leafs in the cluster leaf lists", static_cast<int>( s_clusterLeaves.size() ) );
+}
+
+// about the size of a wall as high as a player
+static const float MIN_OCCLUDER_AREA = 128.0f * 128.0f;
+
+/*
+=================
+R_FaceOccluder
+
+Makes an occluder of the outline of a face, if the face is a large convex
+polygon. The triangles must cover the convex hull of the vertexes, so that
+the occluder doesn't hide anything seen through the face
+=================
+*/
+static bool R_FaceOccluder( const srfSurfaceFace_t *face, occluder_t *occluder )
+{
+	if ( face->numVerts < 3 || face->numTriangles < 1 )
+	{
+		return false;
+	}
+
+	// work in the plane of the axes the face is the least slanted against
+	int axis = 0;
+
+	for ( int j = 1; j < 3; j++ )
+	{
+		if ( fabsf( face->plane.normal[ j ] ) > fabsf( face->plane.normal[ axis ] ) )
+		{
+			axis = j;
+		}
+	}
+
+	int u = ( axis + 1 ) % 3;
+	int v = ( axis + 2 ) % 3;
+
+	auto cross = [ & ]( int o, int a, int b ) {
+		const float *po = face->verts[ o ].xyz;
+		const float *pa = face->verts[ a ].xyz;
+		const float *pb = face->verts[ b ].xyz;
+
+		return ( pa[ u ] - po[ u ] ) * ( pb[ v ] - po[ v ] ) - ( pa[ v ] - po[ v ] ) * ( pb[ u ] - po[ u ] );
+	};
+
+	// convex hull of the vertexes with the monotone chain, collinear
+	// vertexes are left out
+	std::vector<int> sorted( face->numVerts );
+
+	for ( int i = 0; i < face->numVerts; i++ )
+	{
+		sorted[ i ] = i;
+	}
+
+	std::sort( sorted.begin(), sorted.end(), [ & ]( int a, int b ) {
+		const float *pa = face->verts[ a ].xyz;
+		const float *pb = face->verts[ b ].xyz;
+
+		return pa[ u ] < pb[ u ] || ( pa[ u ] == pb[ u ] && pa[ v ] < pb[ v ] );
+	} );
+
+	std::vector<int> hull( 2 * face->numVerts );
+	int numHull = 0;
+
+	for ( int i = 0; i < face->numVerts; i++ )
+	{
+		while ( numHull >= 2 && cross( hull[ numHull - 2 ], hull[ numHull - 1 ], sorted[ i ] ) <= 0 )
+		{
+			numHull--;
+		}
+
+		hull[ numHull++ ] = sorted[ i ];
+	}
+
+	for ( int i = face->numVerts - 2, lower = numHull + 1; i >= 0; i-- )
+	{
+		while ( numHull >= lower && cross( hull[ numHull - 2 ], hull[ numHull - 1 ], sorted[ i ] ) <= 0 )
+		{
+			numHull--;
+		}
+
+		hull[ numHull++ ] = sorted[ i ];
+	}
+
+	// the first point is repeated at the end
+	numHull--;
+
+	if ( numHull < 3 || numHull > MAX_OCCLUDER_POINTS )
+	{
+		return false;
+	}
+
+	float hullArea = 0.0f;
+
+	for ( int i = 1; i + 1 < numHull; i++ )
+	{
+		hullArea += cross( hull[ 0 ], hull[ i ], hull[ i + 1 ] );
+	}
+
+	float triangleArea = 0.0f;
+
+	for ( int i = 0; i < face->numTriangles; i++ )
+	{
+		const int *indexes = face->triangles[ i ].indexes;
+
+		triangleArea += fabsf( cross( indexes[ 0 ], indexes[ 1 ], indexes[ 2 ] ) );
+	}
+
+	// not convex, or with holes
+	if ( fabsf( hullArea - triangleArea ) > 0.01f * hullArea )
+	{
+		return false;
+	}
+
+	// from the area in the plane of the axes to the area of the face
+	if ( 0.5f * hullArea < MIN_OCCLUDER_AREA * fabsf( face->plane.normal[ axis ] ) )
+	{
+		return false;
+	}
+
+	VectorCopy( face->bounds[ 0 ], occluder->bounds[ 0 ] );
+	VectorCopy( face->bounds[ 1 ], occluder->bounds[ 1 ] );
+	occluder->plane = face->plane;
+	occluder->numPoints = numHull;
+
+	for ( int i = 0; i < numHull; i++ )
+	{
+		VectorCopy( face->verts[ hull[ i ] ].xyz, occluder->points[ i ] );
+	}
+
+	return true;
+}
+
+/*
+=================
+R_CreateOccluders
+
+Picks the large opaque faces of the world model, that are drawn into the
+occlusion buffer to cull what is behind them. Moving brush models can't
+be occluders
+=================
+*/
+static void R_CreateOccluders()
+{
+	bspModel_t *model = &s_worldData.models[ 0 ];
+
+	s_occluders.clear();
+
+	for ( uint32_t i = 0; i < model->numSurfaces; i++ )
+	{
+		bspSurface_t *surface = model->firstSurface + i;
+		shader_t     *shader = surface->shader;
+		occluder_t   occluder;
+
+		if ( *surface->data != surfaceType_t::SF_FACE )
+		{
+			continue;
+		}
+
+		// anything that can be seen through, or that isn't drawn where
+		// the face is
+		if ( shader->sort > Util::ordinal( shaderSort_t::SS_OPAQUE ) || shader->isSky || shader->isPortal
+		     || shader->alphaTest || shader->autoSpriteMode || shader->numDeforms )
+		{
+			continue;
+		}
+
+		if ( R_FaceOccluder( ( srfSurfaceFace_t * ) surface->data, &occluder ) )
+		{
+			s_occluders.push_back( occluder );
+		}
+	}
+
+	s_worldData.numOccluders = s_occluders.size();
+	s_worldData.occluders = s_occluders.data();
+
+	Log::Debug( "%i occluders", s_worldData.numOccluders );
+}
+
 /*
 =================
 R_CreateClusters
@@ -2751,6 +3105,8 @@ static void R_CreateClusters()
 	{
 		node->visCounts[ 0 ] = -1;
 	}
+
+	// R_FlattenNodes already reset the flat vis counts
 }
 
 /*
@@ -3513,6 +3869,82 @@ static void R_SetParent( bspNode_t *node, bspNode_t *parent )
 	R_SetParent( node->children[ 1 ], node );
 }
 
+/*
+=================
+R_FlattenNode
+
+Copies a subtree to the flat node arrays in depth first order, and returns
+the flat index of its root
+=================
+*/
+static int R_FlattenNode( bspNode_t *node, int parent, int *numFlatNodes )
+{
+	int             index = ( *numFlatNodes )++;
+	bspNodeBounds_t *bounds = &s_worldData.flatBounds[ index ];
+
+	node->flatIndex = index;
+	s_worldData.flatNodes[ index ] = node;
+	s_worldData.flatParents[ index ] = parent;
+
+	for ( int i = 0; i < 3; i++ )
+	{
+		bounds->center[ i ] = 0.5f * ( node->mins[ i ] + node->maxs[ i ] );
+		bounds->extents[ i ] = 0.5f * ( node->maxs[ i ] - node->mins[ i ] );
+	}
+
+	if ( node->contents != CONTENTS_NODE )
+	{
+		s_worldData.flatChildren[ index ][ 0 ] = 0;
+		s_worldData.flatChildren[ index ][ 1 ] = 0;
+		Vector4Set( s_worldData.flatPlanes[ index ], 0, 0, 0, 0 );
+		return index;
+	}
+
+	VectorCopy( node->plane->normal, s_worldData.flatPlanes[ index ] );
+	s_worldData.flatPlanes[ index ][ 3 ] = node->plane->dist;
+
+	s_worldData.flatChildren[ index ][ 0 ] = R_FlattenNode( node->children[ 0 ], index, numFlatNodes );
+	s_worldData.flatChildren[ index ][ 1 ] = R_FlattenNode( node->children[ 1 ], index, numFlatNodes );
+
+	return index;
+}
+
+/*
+=================
+R_FlattenNodes
+=================
+*/
+static void R_FlattenNodes()
+{
+	int numnodes = s_worldData.numnodes;
+	int numFlatNodes = 0;
+
+	s_worldData.flatNodes = ( bspNode_t ** ) ri.Hunk_Alloc( numnodes * sizeof( *s_worldData.flatNodes ), ha_pref::h_low );
+	s_worldData.flatBounds = ( bspNodeBounds_t * ) ri.Hunk_Alloc( numnodes * sizeof( *s_worldData.flatBounds ), ha_pref::h_low );
+	s_worldData.flatChildren = ( int ( * )[ 2 ] ) ri.Hunk_Alloc( numnodes * sizeof( *s_worldData.flatChildren ), ha_pref::h_low );
+	s_worldData.flatPlanes = ( vec4_t * ) ri.Hunk_Alloc( numnodes * sizeof( *s_worldData.flatPlanes ), ha_pref::h_low );
+	s_worldData.flatParents = ( int * ) ri.Hunk_Alloc( numnodes * sizeof( *s_worldData.flatParents ), ha_pref::h_low );
+	s_worldData.flatVisCounts = ( int * ) ri.Hunk_Alloc( MAX_VISCOUNTS * numnodes * sizeof( *s_worldData.flatVisCounts ), ha_pref::h_low );
+
+	for ( int i = 0; i < MAX_VISCOUNTS * numnodes; i++ )
+	{
+		s_worldData.flatVisCounts[ i ] = -1;
+	}
+
+	// leafs not referenced by any node are left out of the walk
+	for ( int i = 0; i < numnodes; i++ )
+	{
+		s_worldData.nodes[ i ].flatIndex = -1;
+	}
+
+	R_FlattenNode( s_worldData.nodes, -1, &numFlatNodes );
+
+	if ( numFlatNodes != numnodes )
+	{
+		Log::Debug( "%i nodes and leafs aren't reachable from the root", numnodes - numFlatNodes );
+	}
+}
+
 /*
 =================
 R_LoadNodesAndLeafs
@@ -3605,6 +4037,7 @@ static void R_LoadNodesAndLeafs( lump_t *nodeLump, lump_t *leafLump )
 
 	// chain descendants and compute surface bounds
 	R_SetParent( s_worldData.nodes, nullptr );
+	R_FlattenNodes();
 
 	backEndData[ 0 ]->traversalList = ( bspNode_t ** ) ri.Hunk_Alloc( sizeof( bspNode_t * ) * s_worldData.numnodes, ha_pref::h_low );
 	backEndData[ 0 ]->traversalLength = 0;
@@ -3960,7 +4393,6 @@ void R_LoadLightGrid( lump_t *l )
 	dgridPoint_t   *in;
 	bspGridPoint1_t *gridPoint1;
 	bspGridPoint2_t *gridPoint2;
-	float          lat, lng;
 	int            from[ 3 ], to[ 3 ];
 	float          weights[ 3 ] = { 0.25f, 0.5f, 0.25f };
 	float          *factors[ 3 ] = { weights, weights, weights };
@@ -4028,68 +4460,79 @@ void R_LoadLightGrid( lump_t *l )
 	w->lightGridData1 = gridPoint1;
 	w->lightGridData2 = gridPoint2;
 
-	for ( i = 0; i < w->numLightGridPoints;
-	      i++, in++, gridPoint1++, gridPoint2++ )
-	{
-		byte tmpAmbient[ 4 ];
-		byte tmpDirected[ 4 ];
+	// the points are decoded one slab of the grid per job
+	int slabSize = w->lightGridBounds[ 0 ] * w->lightGridBounds[ 1 ];
+
+	R_RunJobs( w->lightGridBounds[ 2 ], [ & ]( int slab ) {
+		const dgridPoint_t *in_p = in + slab * slabSize;
+		bspGridPoint1_t *point1 = gridPoint1 + slab * slabSize;
+		bspGridPoint2_t *point2 = gridPoint2 + slab * slabSize;
+		vec3_t          ambientColor, directedColor, direction;
+		float           lat, lng;
 
-		tmpAmbient[ 0 ] = in->ambient[ 0 ];
-		tmpAmbient[ 1 ] = in->ambient[ 1 ];
-		tmpAmbient[ 2 ] = in->ambient[ 2 ];
-		tmpAmbient[ 3 ] = 255;
+		for ( int p = 0; p < slabSize; p++, in_p++, point1++, point2++ )
+		{
+			byte tmpAmbient[ 4 ];
+			byte tmpDirected[ 4 ];
 
-		tmpDirected[ 0 ] = in->directed[ 0 ];
-		tmpDirected[ 1 ] = in->directed[ 1 ];
-		tmpDirected[ 2 ] = in->directed[ 2 ];
-		tmpDirected[ 3 ] = 255;
+			tmpAmbient[ 0 ] = in_p->ambient[ 0 ];
+			tmpAmbient[ 1 ] = in_p->ambient[ 1 ];
+			tmpAmbient[ 2 ] = in_p->ambient[ 2 ];
+			tmpAmbient[ 3 ] = 255;
 
-		R_ColorShiftLightingBytes( tmpAmbient, tmpAmbient );
-		R_ColorShiftLightingBytes( tmpDirected, tmpDirected );
+			tmpDirected[ 0 ] = in_p->directed[ 0 ];
+			tmpDirected[ 1 ] = in_p->directed[ 1 ];
+			tmpDirected[ 2 ] = in_p->directed[ 2 ];
+			tmpDirected[ 3 ] = 255;
 
-		for ( j = 0; j < 3; j++ )
-		{
-			ambientColor[ j ] = tmpAmbient[ j ] * ( 1.0f / 255.0f );
-			directedColor[ j ] = tmpDirected[ j ] * ( 1.0f / 255.0f );
-		}
+			R_ColorShiftLightingBytes( tmpAmbient, tmpAmbient );
+			R_ColorShiftLightingBytes( tmpDirected, tmpDirected );
 
-		// standard spherical coordinates to cartesian coordinates conversion
+			for ( int j = 0; j < 3; j++ )
+			{
+				ambientColor[ j ] = tmpAmbient[ j ] * ( 1.0f / 255.0f );
+				directedColor[ j ] = tmpDirected[ j ] * ( 1.0f / 255.0f );
+			}
 
-		// decode X as cos( lat ) * sin( long )
-		// decode Y as sin( lat ) * sin( long )
-		// decode Z as cos( long )
+			// standard spherical coordinates to cartesian coordinates conversion
 
-		// RB: having a look in NormalToLatLong used by q3map2 shows the order of latLong
+			// decode X as cos( lat ) * sin( long )
+			// decode Y as sin( lat ) * sin( long )
+			// decode Z as cos( long )
 
-		// Lat = 0 at (1,0,0) to 360 (-1,0,0), encoded in 8-bit sine table format
-		// Lng = 0 at (0,0,1) to 180 (0,0,-1), encoded in 8-bit sine table format
+			// RB: having a look in NormalToLatLong used by q3map2 shows the order of latLong
 
-		lat = DEG2RAD( in->latLong[ 1 ] * ( 360.0f / 255.0f ) );
-		lng = DEG2RAD( in->latLong[ 0 ] * ( 360.0f / 255.0f ) );
+			// Lat = 0 at (1,0,0) to 360 (-1,0,0), encoded in 8-bit sine table format
+			// Lng = 0 at (0,0,1) to 180 (0,0,-1), encoded in 8-bit sine table format
 
-		direction[ 0 ] = cosf( lat ) * sinf( lng );
-		direction[ 1 ] = sinf( lat ) * sinf( lng );
-		direction[ 2 ] = cosf( lng );
+			lat = DEG2RAD( in_p->latLong[ 1 ] * ( 360.0f / 255.0f ) );
+			lng = DEG2RAD( in_p->latLong[ 0 ] * ( 360.0f / 255.0f ) );
 
-		// Pack data into an bspGridPoint
-		gridPoint1->color[ 0 ] = floatToUnorm8( 0.5f * (ambientColor[ 0 ] + directedColor[ 0 ]) );
-		gridPoint1->color[ 1 ] = floatToUnorm8( 0.5f * (ambientColor[ 1 ] + directedColor[ 1 ]) );
-		gridPoint1->color[ 2 ] = floatToUnorm8( 0.5f * (ambientColor[ 2 ] + directedColor[ 2 ]) );
+			direction[ 0 ] = cosf( lat ) * sinf( lng );
+			direction[ 1 ] = sinf( lat ) * sinf( lng );
+			direction[ 2 ] = cosf( lng );
 
-		// Avoid division-by-zero.
-		float ambientLength = VectorLength(ambientColor);
-		float directedLength = VectorLength(directedColor);
-		float length = ambientLength + directedLength;
-		gridPoint1->ambientPart = length ? floatToUnorm8( ambientLength / length ) : 0;
+			// Pack data into an bspGridPoint
+			point1->color[ 0 ] = floatToUnorm8( 0.5f * (ambientColor[ 0 ] + directedColor[ 0 ]) );
+			point1->color[ 1 ] = floatToUnorm8( 0.5f * (ambientColor[ 1 ] + directedColor[ 1 ]) );
+			point1->color[ 2 ] = floatToUnorm8( 0.5f * (ambientColor[ 2 ] + directedColor[ 2 ]) );
 
-		gridPoint2->direction[0] = 128 + floatToSnorm8( direction[ 0 ] );
-		gridPoint2->direction[1] = 128 + floatToSnorm8( direction[ 1 ] );
-		gridPoint2->direction[2] = 128 + floatToSnorm8( direction[ 2 ] );
-		gridPoint2->unused = 0;
-	}
+			// Avoid division-by-zero.
+			float ambientLength = VectorLength(ambientColor);
+			float directedLength = VectorLength(directedColor);
+			float length = ambientLength + directedLength;
+			point1->ambientPart = length ? floatToUnorm8( ambientLength / length ) : 0;
+
+			point2->direction[0] = 128 + floatToSnorm8( direction[ 0 ] );
+			point2->direction[1] = 128 + floatToSnorm8( direction[ 1 ] );
+			point2->direction[2] = 128 + floatToSnorm8( direction[ 2 ] );
+			point2->unused = 0;
+		}
+	} );
 
 	// fill in gridpoints with zero light (samples in walls) to avoid
-	// darkening of objects near walls
+	// darkening of objects near walls, this stays serial because a point
+	// which is filled in is used to fill in the next ones
 	gridPoint1 = w->lightGridData1;
 	gridPoint2 = w->lightGridData2;
 
@@ -4675,41 +5118,10 @@ bool R_GetEntityToken( char *buffer, int size )
 
 /*
 =================
-R_PrecacheInteraction
+R_PrecacheGenericSurfInteraction
 =================
 */
-static void R_PrecacheInteraction( trRefLight_t *light, bspSurface_t *surface )
-{
-	interactionCache_t *iaCache;
-
-	iaCache = (interactionCache_t*) ri.Hunk_Alloc( sizeof( *iaCache ), ha_pref::h_low );
-	Com_AddToGrowList( &s_interactions, iaCache );
-
-	// connect to interaction grid
-	if ( !light->firstInteractionCache )
-	{
-		light->firstInteractionCache = iaCache;
-	}
-
-	if ( light->lastInteractionCache )
-	{
-		light->lastInteractionCache->next = iaCache;
-	}
-
-	light->lastInteractionCache = iaCache;
-
-	iaCache->next = nullptr;
-	iaCache->surface = surface;
-
-	iaCache->redundant = false;
-}
-
-/*
-================
-R_PrecacheGenericSurfInteraction
-================
-*/
-static bool R_PrecacheGenericSurfInteraction( srfGeneric_t *face, trRefLight_t *light )
+static bool R_PrecacheGenericSurfInteraction( srfGeneric_t *face, trRefLight_t *light )
 {
 	return BoundsIntersect( face->bounds[ 0 ], face->bounds[ 1 ], light->worldBounds[ 0 ], light->worldBounds[ 1 ] );
 }
@@ -4719,16 +5131,17 @@ static bool R_PrecacheGenericSurfInteraction( srfGeneric_t *face, trRefLight_t *
 R_PrecacheInteractionSurface
 ======================
 */
-static void R_PrecacheInteractionSurface( bspSurface_t *surf, trRefLight_t *light )
+static void R_PrecacheInteractionSurface( bspSurface_t *surf, trRefLight_t *light, lightInteractions_t &ia, std::vector<bool> &checked )
 {
 	bool intersects;
+	int  surfaceNum = surf - s_worldData.surfaces;
 
-	if ( surf->lightCount == s_lightCount )
+	if ( checked[ surfaceNum ] )
 	{
 		return; // already checked this surface
 	}
 
-	surf->lightCount = s_lightCount;
+	checked[ surfaceNum ] = true;
 
 	// skip all surfaces that don't matter for lighting only pass
 	if ( surf->shader->isSky || ( !surf->shader->interactLight && surf->shader->noShadows ) )
@@ -4750,16 +5163,19 @@ static void R_PrecacheInteractionSurface( bspSurface_t *surf, trRefLight_t *ligh
 
 	if ( intersects )
 	{
-		R_PrecacheInteraction( light, surf );
+		ia.surfaces.push_back( surfaceNum );
 	}
 }
 
 /*
 ================
 R_RecursivePrecacheInteractionNode
+
+Runs on the job threads, the surfaces and the leafs touched by the light are
+only collected in ia and connected to the light by R_LinkLightInteractions
 ================
 */
-static void R_RecursivePrecacheInteractionNode( bspNode_t *node, trRefLight_t *light )
+static void R_RecursivePrecacheInteractionNode( bspNode_t *node, trRefLight_t *light, lightInteractions_t &ia, std::vector<bool> &checked )
 {
 	int r;
 
@@ -4788,7 +5204,7 @@ static void R_RecursivePrecacheInteractionNode( bspNode_t *node, trRefLight_t *l
 			case 3:
 			default:
 				// recurse down the children, front side first
-				R_RecursivePrecacheInteractionNode( node->children[ 0 ], light );
+				R_RecursivePrecacheInteractionNode( node->children[ 0 ], light, ia, checked );
 
 				// tail recurse
 				node = node->children[ 1 ];
@@ -4800,7 +5216,7 @@ static void R_RecursivePrecacheInteractionNode( bspNode_t *node, trRefLight_t *l
 	{
 		// leaf node, so add mark surfaces
 		int          c;
-		bspSurface_t *surf, **mark;
+		bspSurface_t **mark;
 		vec3_t       worldBounds[ 2 ];
 
 		// add the individual surfaces
@@ -4811,8 +5227,7 @@ static void R_RecursivePrecacheInteractionNode( bspNode_t *node, trRefLight_t *l
 		{
 			// the surface may have already been added if it
 			// spans multiple leafs
-			surf = *mark;
-			R_PrecacheInteractionSurface( surf, light );
+			R_PrecacheInteractionSurface( *mark, light, ia, checked );
 			mark++;
 		}
 
@@ -4821,14 +5236,7 @@ static void R_RecursivePrecacheInteractionNode( bspNode_t *node, trRefLight_t *l
 
 		if ( node->numMarkSurfaces > 0 && R_CullLightWorldBounds( light, worldBounds ) != cullResult_t::CULL_OUT )
 		{
-			link_t *l;
-
-			l = ( link_t *)ri.Hunk_Alloc( sizeof( *l ), ha_pref::h_low );
-			InitLink( l, node );
-
-			InsertLink( l, &light->leafs );
-
-			light->leafs.numElements++;
+			ia.leafs.push_back( node - s_worldData.nodes );
 		}
 	}
 }
@@ -4863,60 +5271,79 @@ static interactionVBO_t *R_CreateInteractionVBO( trRefLight_t *light )
 
 /*
 =================
-InteractionCacheCompare
-compare function for qsort()
+R_GetSurfaceTriangles
 =================
 */
-static int InteractionCacheCompare( const void *a, const void *b )
+static bool R_GetSurfaceTriangles( const bspSurface_t *surface, int *firstTriangle, int *numTriangles, int *numVerts )
 {
-	interactionCache_t *aa, *bb;
-
-	aa = * ( interactionCache_t ** ) a;
-	bb = * ( interactionCache_t ** ) b;
-
-	// shader first
-	if ( aa->surface->shader < bb->surface->shader )
+	switch ( *surface->data )
 	{
-		return -1;
-	}
+		case surfaceType_t::SF_FACE:
+			{
+				const srfSurfaceFace_t *srf = ( const srfSurfaceFace_t * ) surface->data;
+				*firstTriangle = srf->firstTriangle;
+				*numTriangles = srf->numTriangles;
+				*numVerts = srf->numVerts;
+				return true;
+			}
 
-	else if ( aa->surface->shader > bb->surface->shader )
-	{
-		return 1;
-	}
+		case surfaceType_t::SF_GRID:
+			{
+				const srfGridMesh_t *srf = ( const srfGridMesh_t * ) surface->data;
+				*firstTriangle = srf->firstTriangle;
+				*numTriangles = srf->numTriangles;
+				*numVerts = srf->numVerts;
+				return true;
+			}
 
-	// then alphaTest
-	if ( aa->surface->shader->alphaTest < bb->surface->shader->alphaTest )
-	{
-		return -1;
-	}
+		case surfaceType_t::SF_TRIANGLES:
+			{
+				const srfTriangles_t *srf = ( const srfTriangles_t * ) surface->data;
+				*firstTriangle = srf->firstTriangle;
+				*numTriangles = srf->numTriangles;
+				*numVerts = srf->numVerts;
+				return true;
+			}
 
-	else if ( aa->surface->shader->alphaTest > bb->surface->shader->alphaTest )
-	{
-		return 1;
+		default:
+			return false;
 	}
-
-	return 0;
 }
 
-static int UpdateLightTriangles( const srfVert_t *verts, int numTriangles, srfTriangle_t *triangles, shader_t *surfaceShader,
-                                 trRefLight_t *light )
+/*
+=================
+R_AddLitTriangles
+
+Appends the triangles of the surface facing the light to the batch and
+returns how many were added, the facing state is not stored in the
+triangles so that several lights can be processed at the same time
+=================
+*/
+static int R_AddLitTriangles( const bspSurface_t *surface, trRefLight_t *light, lightMeshBatch_t &batch )
 {
 	int           i;
+	int           firstTriangle, numTriangles, numVerts;
 	srfTriangle_t *tri;
+	shader_t      *surfaceShader = surface->shader;
 	int           numFacing;
 
+	if ( !R_GetSurfaceTriangles( surface, &firstTriangle, &numTriangles, &numVerts ) )
+	{
+		return 0;
+	}
+
 	numFacing = 0;
 
-	for ( i = 0, tri = triangles; i < numTriangles; i++, tri++ )
+	for ( i = 0, tri = s_worldData.triangles + firstTriangle; i < numTriangles; i++, tri++ )
 	{
 		vec3_t pos[ 3 ];
 		vec4_t triPlane;
 		float  d;
+		bool   facingLight;
 
-		VectorCopy( verts[ tri->indexes[ 0 ] ].xyz, pos[ 0 ] );
-		VectorCopy( verts[ tri->indexes[ 1 ] ].xyz, pos[ 1 ] );
-		VectorCopy( verts[ tri->indexes[ 2 ] ].xyz, pos[ 2 ] );
+		VectorCopy( s_worldData.verts[ tri->indexes[ 0 ] ].xyz, pos[ 0 ] );
+		VectorCopy( s_worldData.verts[ tri->indexes[ 1 ] ].xyz, pos[ 1 ] );
+		VectorCopy( s_worldData.verts[ tri->indexes[ 2 ] ].xyz, pos[ 2 ] );
 
 		if ( PlaneFromPoints( triPlane, pos[ 0 ], pos[ 1 ], pos[ 2 ] ) )
 		{
@@ -4930,28 +5357,31 @@ static int UpdateLightTriangles( const srfVert_t *verts, int numTriangles, srfTr
 
 				d = DotProduct( triPlane, lightDirection );
 
-				tri->facingLight = surfaceShader->cullType == CT_TWO_SIDED || ( d > 0 && surfaceShader->cullType != CT_BACK_SIDED );
+				facingLight = surfaceShader->cullType == CT_TWO_SIDED || ( d > 0 && surfaceShader->cullType != CT_BACK_SIDED );
 			}
 			else
 			{
 				// check if light origin is behind triangle
 				d = DotProduct( triPlane, light->origin ) - triPlane[ 3 ];
 
-				tri->facingLight = surfaceShader->cullType == CT_TWO_SIDED || ( d > 0 && surfaceShader->cullType != CT_BACK_SIDED );
+				facingLight = surfaceShader->cullType == CT_TWO_SIDED || ( d > 0 && surfaceShader->cullType != CT_BACK_SIDED );
 			}
 		}
 		else
 		{
-			tri->facingLight = true; // FIXME ?
+			facingLight = true; // FIXME ?
 		}
 
 		if ( R_CullLightTriangle( light, pos ) == cullResult_t::CULL_OUT )
 		{
-			tri->facingLight = false;
+			facingLight = false;
 		}
 
-		if ( tri->facingLight )
+		if ( facingLight )
 		{
+			batch.indexes.insert( batch.indexes.end(), tri->indexes, tri->indexes + 3 );
+			batch.triangles.push_back( surface - s_worldData.surfaces );
+			batch.triangles.push_back( i );
 			numFacing++;
 		}
 	}
@@ -4960,1437 +5390,1410 @@ static int UpdateLightTriangles( const srfVert_t *verts, int numTriangles, srfTr
 }
 
 /*
-===============
-R_CreateVBOLightMeshes
-===============
+=================
+R_SortLightInteractions
+
+Returns the interactions of the light that pass the filter, sorted by shader
+=================
 */
-static void R_CreateVBOLightMeshes( trRefLight_t *light )
+template<typename Filter>
+static std::vector<int> R_SortLightInteractions( const lightInteractions_t &ia, Filter filter )
 {
-	int                i, j, k, l;
-
-	int                numVerts;
+	std::vector<int> sorted;
 
-	int                numTriangles, numLitTriangles;
-	srfTriangle_t      *tri;
-	glIndex_t          *indexes;
+	for ( size_t i = 0; i < ia.surfaces.size(); i++ )
+	{
+		if ( filter( s_worldData.surfaces[ ia.surfaces[ i ] ].shader ) )
+		{
+			sorted.push_back( i );
+		}
+	}
 
-	interactionVBO_t   *iaVBO;
+	std::sort( sorted.begin(), sorted.end(), [ & ]( int a, int b ) {
+		const shader_t *aa = s_worldData.surfaces[ ia.surfaces[ a ] ].shader;
+		const shader_t *bb = s_worldData.surfaces[ ia.surfaces[ b ] ].shader;
 
-	interactionCache_t *iaCache, *iaCache2;
-	interactionCache_t **iaCachesSorted;
-	int                numCaches;
+		// shader first, then alphaTest
+		if ( aa != bb )
+		{
+			return aa < bb;
+		}
 
-	shader_t           *shader, *oldShader;
+		return aa->alphaTest < bb->alphaTest;
+	} );
 
-	bspSurface_t       *surface;
+	return sorted;
+}
 
-	srfVBOMesh_t       *vboSurf;
-	vec3_t             bounds[ 2 ];
+/*
+=================
+R_AddLightMeshBatches
 
-	if ( !r_vboLighting->integer )
-	{
-		return;
-	}
+Builds the index lists of the static VBO surfaces of a light from its sorted
+interactions: one per shader for light meshes, and for shadow meshes one per
+alpha tested shader plus one for each run of opaque shaders. If cubeSide is
+not negative only the interactions touching that side of the cube are used.
+=================
+*/
+static void R_AddLightMeshBatches( trRefLight_t *light, lightInteractions_t &ia, const std::vector<int> &sorted, bool shadow, int cubeSide )
+{
+	size_t first, last;
 
-	if ( !light->firstInteractionCache )
+	for ( first = 0; first < sorted.size(); first = last )
 	{
-		// this light has no interactions precached
-		return;
-	}
+		const shader_t *shader = s_worldData.surfaces[ ia.surfaces[ sorted[ first ] ] ].shader;
 
-	// count number of interaction caches
-	numCaches = 0;
-
-	for ( iaCache = light->firstInteractionCache; iaCache; iaCache = iaCache->next )
-	{
-		if ( iaCache->redundant )
+		for ( last = first + 1; last < sorted.size(); last++ )
 		{
-			continue;
+			const shader_t *next = s_worldData.surfaces[ ia.surfaces[ sorted[ last ] ] ].shader;
+
+			if ( ( shadow && !shader->alphaTest ) ? next->alphaTest : next != shader )
+			{
+				break;
+			}
 		}
 
-		surface = iaCache->surface;
+		lightMeshBatch_t batch;
+		batch.firstSurface = ia.surfaces[ sorted[ first ] ];
+		batch.shadow = shadow;
+		batch.cubeSideBits = cubeSide < 0 ? 0 : 1 << cubeSide;
+		batch.numVerts = 0;
 
-		if ( !surface->shader->interactLight )
-		{
-			continue;
-		}
+		ClearBounds( batch.bounds[ 0 ], batch.bounds[ 1 ] );
 
-		if ( surface->shader->isPortal )
+		for ( size_t l = first; l < last; l++ )
 		{
-			continue;
-		}
+			int                firstTriangle, numTriangles, numVerts;
+			const bspSurface_t *surface = &s_worldData.surfaces[ ia.surfaces[ sorted[ l ] ] ];
 
-		numCaches++;
-	}
+			if ( cubeSide >= 0 && !( ia.cubeSideBits[ sorted[ l ] ] & ( 1 << cubeSide ) ) )
+			{
+				continue;
+			}
 
-	// build interaction caches list
-	iaCachesSorted = (interactionCache_t**) ri.Hunk_AllocateTempMemory( numCaches * sizeof( iaCachesSorted[ 0 ] ) );
+			if ( !R_GetSurfaceTriangles( surface, &firstTriangle, &numTriangles, &numVerts ) )
+			{
+				continue;
+			}
 
-	numCaches = 0;
+			if ( R_AddLitTriangles( surface, light, batch ) && cubeSide < 0 )
+			{
+				const srfGeneric_t *srf = ( const srfGeneric_t * ) surface->data;
+				BoundsAdd( batch.bounds[ 0 ], batch.bounds[ 1 ], srf->bounds[ 0 ], srf->bounds[ 1 ] );
+			}
 
-	for ( iaCache = light->firstInteractionCache; iaCache; iaCache = iaCache->next )
-	{
-		if ( iaCache->redundant )
-		{
-			continue;
+			batch.numVerts += numVerts;
 		}
 
-		surface = iaCache->surface;
-
-		if ( !surface->shader->interactLight )
+		if ( !batch.numVerts || batch.indexes.empty() )
 		{
 			continue;
 		}
 
-		if ( surface->shader->isPortal )
+		if ( cubeSide >= 0 )
 		{
-			continue;
+			ZeroBounds( batch.bounds[ 0 ], batch.bounds[ 1 ] );
 		}
 
-		iaCachesSorted[ numCaches ] = iaCache;
-		numCaches++;
+		ia.batches.push_back( std::move( batch ) );
 	}
+}
 
-	// sort interaction caches by shader
-	qsort( iaCachesSorted, numCaches, sizeof( *iaCachesSorted ), InteractionCacheCompare );
+/*
+===============
+R_BuildLightMeshes
 
-	// create a VBO for each shader
-	shader = oldShader = nullptr;
+Computes what R_CreateLightMeshes needs to create the static VBO surface for
+each light geometry batch and each shadow geometry batch of the light,
+runs on the job threads
+===============
+*/
+static void R_BuildLightMeshes( trRefLight_t *light, lightInteractions_t &ia )
+{
+	ia.mergedIntoVBO.assign( ia.surfaces.size(), false );
 
-	for ( k = 0; k < numCaches; k++ )
+	if ( ia.surfaces.empty() )
 	{
-		iaCache = iaCachesSorted[ k ];
-
-		iaCache->mergedIntoVBO = true;
+		// this light has no interactions precached
+		return;
+	}
 
-		shader = iaCache->surface->shader;
+	if ( r_vboLighting->integer )
+	{
+		std::vector<int> sorted = R_SortLightInteractions( ia, []( const shader_t *shader ) {
+			return shader->interactLight && !shader->isPortal;
+		} );
 
-		if ( shader != oldShader )
+		for ( int i : sorted )
 		{
-			oldShader = shader;
-
-			// count vertices and indices
-			numVerts = 0;
-			numTriangles = 0;
-
-			ClearBounds( bounds[ 0 ], bounds[ 1 ] );
-
-			for ( l = k; l < numCaches; l++ )
-			{
-				iaCache2 = iaCachesSorted[ l ];
-
-				surface = iaCache2->surface;
-
-				if ( surface->shader != shader )
-				{
-					continue;
-				}
-
-				if ( *surface->data == surfaceType_t::SF_FACE )
-				{
-					srfSurfaceFace_t *srf = ( srfSurfaceFace_t * ) surface->data;
+			ia.mergedIntoVBO[ i ] = true;
+		}
 
-					if ( srf->numTriangles )
-					{
-						numLitTriangles = UpdateLightTriangles( s_worldData.verts, srf->numTriangles, s_worldData.triangles + srf->firstTriangle, surface->shader, light );
+		R_AddLightMeshBatches( light, ia, sorted, false, -1 );
+	}
 
-						if ( numLitTriangles )
-						{
-							BoundsAdd( bounds[ 0 ], bounds[ 1 ], srf->bounds[ 0 ], srf->bounds[ 1 ] );
-						}
+	if ( !r_vboShadows->integer || r_shadows->integer < Util::ordinal(shadowingMode_t::SHADOWING_ESM16) || light->l.noShadows )
+	{
+		return;
+	}
 
-						numTriangles += numLitTriangles;
-					}
+	if ( light->l.rlType != refLightType_t::RL_OMNI && light->l.rlType != refLightType_t::RL_DIRECTIONAL && light->l.rlType != refLightType_t::RL_PROJ )
+	{
+		return;
+	}
 
-					if ( srf->numVerts )
-					{
-						numVerts += srf->numVerts;
-					}
-				}
-				else if ( *surface->data == surfaceType_t::SF_GRID )
-				{
-					srfGridMesh_t *srf = ( srfGridMesh_t * ) surface->data;
+	std::vector<int> sorted = R_SortLightInteractions( ia, []( const shader_t *shader ) {
+		return shader->interactLight && !shader->isSky && !shader->noShadows
+		       && shader->sort <= Util::ordinal(shaderSort_t::SS_OPAQUE) && !shader->isPortal;
+	} );
 
-					if ( srf->numTriangles )
-					{
-						numLitTriangles = UpdateLightTriangles( s_worldData.verts, srf->numTriangles, s_worldData.triangles + srf->firstTriangle, surface->shader, light );
+	for ( int i : sorted )
+	{
+		ia.mergedIntoVBO[ i ] = true;
+	}
 
-						if ( numLitTriangles )
-						{
-							BoundsAdd( bounds[ 0 ], bounds[ 1 ], srf->bounds[ 0 ], srf->bounds[ 1 ] );
-						}
+	if ( light->l.rlType != refLightType_t::RL_OMNI )
+	{
+		R_AddLightMeshBatches( light, ia, sorted, true, -1 );
+		return;
+	}
 
-						numTriangles += numLitTriangles;
-					}
+	// one batch list per side of the cubemap pyramid
+	for ( int cubeSide = 0; cubeSide < 6; cubeSide++ )
+	{
+		R_AddLightMeshBatches( light, ia, sorted, true, cubeSide );
+	}
+}
 
-					if ( srf->numVerts )
-					{
-						numVerts += srf->numVerts;
-					}
-				}
-				else if ( *surface->data == surfaceType_t::SF_TRIANGLES )
-				{
-					srfTriangles_t *srf = ( srfTriangles_t * ) surface->data;
+/*
+===============
+R_CreateLightMeshes
 
-					if ( srf->numTriangles )
-					{
-						numLitTriangles = UpdateLightTriangles( s_worldData.verts, srf->numTriangles, s_worldData.triangles + srf->firstTriangle, surface->shader, light );
+Creates the interaction caches, the leaf list and the static VBO surfaces of
+the light from what was collected by the jobs or loaded from the cache
+===============
+*/
+static void R_CreateLightMeshes( trRefLight_t *light, const lightInteractions_t &ia, growList_t *interactions )
+{
+	light->firstInteractionCache = nullptr;
+	light->lastInteractionCache = nullptr;
 
-						if ( numLitTriangles )
-						{
-							BoundsAdd( bounds[ 0 ], bounds[ 1 ], srf->bounds[ 0 ], srf->bounds[ 1 ] );
-						}
+	light->firstInteractionVBO = nullptr;
+	light->lastInteractionVBO = nullptr;
 
-						numTriangles += numLitTriangles;
-					}
+	for ( size_t i = 0; i < ia.surfaces.size(); i++ )
+	{
+		interactionCache_t *iaCache;
 
-					if ( srf->numVerts )
-					{
-						numVerts += srf->numVerts;
-					}
-				}
-			}
+		iaCache = (interactionCache_t*) ri.Hunk_Alloc( sizeof( *iaCache ), ha_pref::h_low );
+		Com_AddToGrowList( interactions, iaCache );
 
-			if ( !numVerts || !numTriangles )
-			{
-				continue;
-			}
+		// connect to interaction grid
+		if ( !light->firstInteractionCache )
+		{
+			light->firstInteractionCache = iaCache;
+		}
 
-			// create surface
-			vboSurf = (srfVBOMesh_t*) ri.Hunk_Alloc( sizeof( *vboSurf ), ha_pref::h_low );
-			vboSurf->surfaceType = surfaceType_t::SF_VBO_MESH;
-			vboSurf->numIndexes = numTriangles * 3;
-			vboSurf->numVerts = numVerts;
-			vboSurf->lightmapNum = -1;
+		if ( light->lastInteractionCache )
+		{
+			light->lastInteractionCache->next = iaCache;
+		}
 
-			VectorCopy( bounds[ 0 ], vboSurf->bounds[ 0 ] );
-			VectorCopy( bounds[ 1 ], vboSurf->bounds[ 1 ] );
+		light->lastInteractionCache = iaCache;
 
-			// create arrays
-			indexes = (glIndex_t*) ri.Hunk_AllocateTempMemory( 3 * numTriangles * sizeof( glIndex_t ) );
-			numTriangles = 0;
+		iaCache->next = nullptr;
+		iaCache->surface = &s_worldData.surfaces[ ia.surfaces[ i ] ];
+		iaCache->cubeSideBits = ia.cubeSideBits[ i ];
+		iaCache->mergedIntoVBO = ia.mergedIntoVBO[ i ];
 
-			// build triangle indices
-			for ( l = k; l < numCaches; l++ )
-			{
-				iaCache2 = iaCachesSorted[ l ];
+		iaCache->redundant = false;
+	}
 
-				surface = iaCache2->surface;
+	QueueInit( &light->leafs );
 
-				if ( surface->shader != shader )
-				{
-					continue;
-				}
+	for ( int leaf : ia.leafs )
+	{
+		link_t *l;
 
-				if ( *surface->data == surfaceType_t::SF_FACE )
-				{
-					srfSurfaceFace_t *srf = ( srfSurfaceFace_t * ) surface->data;
+		l = ( link_t *)ri.Hunk_Alloc( sizeof( *l ), ha_pref::h_low );
+		InitLink( l, &s_worldData.nodes[ leaf ] );
 
-					for ( i = 0, tri = s_worldData.triangles + srf->firstTriangle; i < srf->numTriangles; i++, tri++ )
-					{
-						if ( tri->facingLight )
-						{
-							for ( j = 0; j < 3; j++ )
-							{
-								indexes[ 3 * numTriangles + j ] = tri->indexes[ j ];
-							}
+		InsertLink( l, &light->leafs );
 
-							numTriangles++;
-						}
-					}
-				}
-				else if ( *surface->data == surfaceType_t::SF_GRID )
-				{
-					srfGridMesh_t *srf = ( srfGridMesh_t * ) surface->data;
+		light->leafs.numElements++;
+	}
 
-					for ( i = 0, tri = s_worldData.triangles + srf->firstTriangle; i < srf->numTriangles; i++, tri++ )
-					{
-						if ( tri->facingLight )
-						{
-							for ( j = 0; j < 3; j++ )
-							{
-								indexes[ 3 * numTriangles + j ] = tri->indexes[ j ];
-							}
+	for ( const lightMeshBatch_t &batch : ia.batches )
+	{
+		interactionVBO_t *iaVBO;
+		srfVBOMesh_t     *vboSurf;
 
-							numTriangles++;
-						}
-					}
-				}
-				else if ( *surface->data == surfaceType_t::SF_TRIANGLES )
-				{
-					srfTriangles_t *srf = ( srfTriangles_t * ) surface->data;
+		// create surface
+		vboSurf = (srfVBOMesh_t*) ri.Hunk_Alloc( sizeof( *vboSurf ), ha_pref::h_low );
+		vboSurf->surfaceType = surfaceType_t::SF_VBO_MESH;
+		vboSurf->numIndexes = batch.indexes.size();
+		vboSurf->numVerts = batch.numVerts;
+		vboSurf->lightmapNum = -1;
 
-					for ( i = 0, tri = s_worldData.triangles + srf->firstTriangle; i < srf->numTriangles; i++, tri++ )
-					{
-						if ( tri->facingLight )
-						{
-							for ( j = 0; j < 3; j++ )
-							{
-								indexes[ 3 * numTriangles + j ] = tri->indexes[ j ];
-							}
+		VectorCopy( batch.bounds[ 0 ], vboSurf->bounds[ 0 ] );
+		VectorCopy( batch.bounds[ 1 ], vboSurf->bounds[ 1 ] );
 
-							numTriangles++;
-						}
-					}
-				}
-			}
+		vboSurf->vbo = s_worldData.vbo;
 
-			vboSurf->vbo = s_worldData.vbo;
-			vboSurf->ibo = R_CreateStaticIBO( va( "staticLightMesh_IBO %i", c_vboLightSurfaces ), indexes, 3 * numTriangles );
+		// add everything needed to the light
+		iaVBO = R_CreateInteractionVBO( light );
+		iaVBO->cubeSideBits = batch.cubeSideBits;
+		iaVBO->shader = s_worldData.surfaces[ batch.firstSurface ].shader;
 
-			ri.Hunk_FreeTempMemory( indexes );
+		glIndex_t *indexes = const_cast<glIndex_t *>( batch.indexes.data() );
 
-			// add everything needed to the light
-			iaVBO = R_CreateInteractionVBO( light );
-			iaVBO->shader = shader;
+		if ( !batch.shadow )
+		{
+			vboSurf->ibo = R_CreateStaticIBO( va( "staticLightMesh_IBO %i", c_vboLightSurfaces ), indexes, batch.indexes.size() );
 			iaVBO->vboLightMesh = vboSurf;
 
 			c_vboLightSurfaces++;
 		}
-	}
+		else
+		{
+			vboSurf->ibo = R_CreateStaticIBO( va( batch.cubeSideBits ? "staticShadowPyramidMesh_IBO %i" : "staticShadowMesh_IBO %i", c_vboShadowSurfaces ), indexes, batch.indexes.size() );
+			iaVBO->vboShadowMesh = vboSurf;
 
-	ri.Hunk_FreeTempMemory( iaCachesSorted );
+			c_vboShadowSurfaces++;
+		}
+	}
 }
 
-/*
-===============
-R_CreateVBOShadowMeshes
-===============
-*/
-static void R_CreateVBOShadowMeshes( trRefLight_t *light )
+static void R_CalcInteractionCubeSideBits( trRefLight_t *light, lightInteractions_t &ia )
 {
-	int                i, j, k, l;
-
-	int                numVerts;
-
-	int                numTriangles, numLitTriangles;
-	glIndex_t          *indexes;
-	srfTriangle_t      *tri;
-
-	interactionVBO_t   *iaVBO;
-
-	interactionCache_t *iaCache, *iaCache2;
-	interactionCache_t **iaCachesSorted;
-	int                numCaches;
-
-	shader_t           *shader, *oldShader;
-	bool           alphaTest, oldAlphaTest;
-
-	bspSurface_t       *surface;
+	vec3_t localBounds[ 2 ];
 
-	srfVBOMesh_t       *vboSurf;
-	vec3_t             bounds[ 2 ];
+	ia.cubeSideBits.assign( ia.surfaces.size(), 0 );
 
-	if ( !r_vboShadows->integer )
+	if ( r_shadows->integer <= Util::ordinal(shadowingMode_t::SHADOWING_BLOB))
 	{
 		return;
 	}
 
-	if ( r_shadows->integer < Util::ordinal(shadowingMode_t::SHADOWING_ESM16))
+	if ( ia.surfaces.empty() )
 	{
+		// this light has no interactions precached
 		return;
 	}
 
-	if ( !light->firstInteractionCache )
+	if ( light->l.noShadows )
 	{
-		// this light has no interactions precached
+		// actually noShadows lights are quite bad concerning this optimization
 		return;
 	}
 
-	if ( light->l.noShadows )
+	if ( light->l.rlType != refLightType_t::RL_OMNI )
 	{
 		return;
 	}
 
-	switch ( light->l.rlType )
+	for ( size_t i = 0; i < ia.surfaces.size(); i++ )
 	{
-		case refLightType_t::RL_OMNI:
-			return;
+		// only generic surfaces have interactions
+		const srfGeneric_t *gen = ( const srfGeneric_t * ) s_worldData.surfaces[ ia.surfaces[ i ] ].data;
 
-		case refLightType_t::RL_DIRECTIONAL:
-		case refLightType_t::RL_PROJ:
-			break;
+		VectorCopy( gen->bounds[ 0 ], localBounds[ 0 ] );
+		VectorCopy( gen->bounds[ 1 ], localBounds[ 1 ] );
 
-		default:
-			return;
+		light->shadowLOD = 0; // important for R_CalcLightCubeSideBits
+		ia.cubeSideBits[ i ] = R_CalcLightCubeSideBits( light, localBounds );
 	}
+}
 
-	// count number of interaction caches
-	numCaches = 0;
+static const char     INTERACTION_CACHE_DIR[] = "interactions";
+static const uint32_t INTERACTION_CACHE_VERSION = 2;
 
-	for ( iaCache = light->firstInteractionCache; iaCache; iaCache = iaCache->next )
-	{
-		if ( iaCache->redundant )
-		{
-			continue;
-		}
+struct interactionCacheHeader_t
+{
+	uint32_t numLights;
+	uint32_t numSurfaces;
+	uint32_t numNodes;
+};
 
-		surface = iaCache->surface;
+struct interactionCacheLight_t
+{
+	uint32_t numInteractions;
+	uint32_t numLeafs;
+	uint32_t numBatches;
+};
 
-		if ( !surface->shader->interactLight )
-		{
-			continue;
-		}
+struct interactionCacheBatch_t
+{
+	uint32_t firstSurface;
+	uint32_t shadow;
+	uint32_t cubeSideBits;
+	uint32_t numVerts;
+	vec3_t   bounds[ 2 ];
+	uint32_t numTriangles;
+};
 
-		if ( surface->shader->isSky )
-		{
-			continue;
-		}
+/*
+===============
+R_InteractionCacheKey
 
-		if ( surface->shader->noShadows )
-		{
-			continue;
-		}
+Everything the precached interactions depend on besides the light entities
+and the geometry, which are covered by the checksum of the BSP
+===============
+*/
+static std::string R_InteractionCacheKey()
+{
+	if ( !r_interactionCache.Get() )
+	{
+		return "";
+	}
 
-		if (surface->shader->sort > Util::ordinal(shaderSort_t::SS_OPAQUE))
-		{
-			continue;
-		}
+	std::string shaders;
 
-		if ( surface->shader->isPortal )
-		{
-			continue;
-		}
+	for ( int i = 0; i < s_worldData.numSurfaces; i++ )
+	{
+		const shader_t *shader = s_worldData.surfaces[ i ].shader;
 
-		numCaches++;
+		shaders += Str::Format( "%i%i%i%i %g %i%i ", shader->isSky, shader->interactLight, shader->noShadows,
+		                        shader->isPortal, shader->sort, shader->alphaTest, (int) shader->cullType );
 	}
 
-	// build interaction caches list
-	iaCachesSorted = (interactionCache_t**) ri.Hunk_AllocateTempMemory( numCaches * sizeof( iaCachesSorted[ 0 ] ) );
+	return Str::Format( "%s %08x %08x %i %i %i %i %i %i %f %f %f", s_worldData.name, s_worldChecksum,
+	                    Com_BlockChecksum( shaders.data(), shaders.size() ), r_vboLighting->integer, r_vboShadows->integer,
+	                    r_shadows->integer, r_noShadowPyramids->integer, r_nocull->integer, tr.worldLightMapping,
+	                    tr.sunDirection[ 0 ], tr.sunDirection[ 1 ], tr.sunDirection[ 2 ] );
+}
 
-	numCaches = 0;
+/*
+===============
+R_LoadInteractionCache
+===============
+*/
+static bool R_LoadInteractionCache( const std::string &key, std::vector<lightInteractions_t> &interactions )
+{
+	std::string data;
 
-	for ( iaCache = light->firstInteractionCache; iaCache; iaCache = iaCache->next )
+	if ( !R_ReadCacheFile( INTERACTION_CACHE_DIR, key, INTERACTION_CACHE_VERSION, data ) )
 	{
-		if ( iaCache->redundant )
-		{
-			continue;
-		}
+		return false;
+	}
 
-		surface = iaCache->surface;
+	cacheReader_t            reader( data );
+	interactionCacheHeader_t header;
 
-		if ( !surface->shader->interactLight )
-		{
-			continue;
-		}
+	if ( !reader.Read( header ) || header.numLights != interactions.size()
+	     || header.numSurfaces != (uint32_t) s_worldData.numSurfaces || header.numNodes != (uint32_t) s_worldData.numnodes )
+	{
+		return false;
+	}
 
-		if ( surface->shader->isSky )
-		{
-			continue;
-		}
+	for ( lightInteractions_t &ia : interactions )
+	{
+		interactionCacheLight_t light;
 
-		if ( surface->shader->noShadows )
+		if ( !reader.Read( light ) || reader.Left() < light.numInteractions * ( sizeof( int ) + 2 ) + light.numLeafs * sizeof( int ) )
 		{
-			continue;
+			return false;
 		}
 
-		if ( surface->shader->sort > Util::ordinal(shaderSort_t::SS_OPAQUE) )
-		{
-			continue;
-		}
+		ia.surfaces.resize( light.numInteractions );
+		ia.cubeSideBits.resize( light.numInteractions );
+		ia.mergedIntoVBO.resize( light.numInteractions );
+		ia.leafs.resize( light.numLeafs );
+
+		reader.Read( ia.surfaces.data(), light.numInteractions * sizeof( int ) );
+		reader.Read( ia.cubeSideBits.data(), light.numInteractions );
+		reader.Read( ia.mergedIntoVBO.data(), light.numInteractions );
+		reader.Read( ia.leafs.data(), light.numLeafs * sizeof( int ) );
 
-		if ( surface->shader->isPortal )
+		for ( int surface : ia.surfaces )
 		{
-			continue;
+			if ( surface < 0 || surface >= s_worldData.numSurfaces )
+			{
+				return false;
+			}
 		}
 
-		iaCachesSorted[ numCaches ] = iaCache;
-		numCaches++;
-	}
-
-	// sort interaction caches by shader
-	qsort( iaCachesSorted, numCaches, sizeof( *iaCachesSorted ), InteractionCacheCompare );
-
-	// create a VBO for each shader
-	shader = oldShader = nullptr;
-	oldAlphaTest = alphaTest = true;
-
-	for ( k = 0; k < numCaches; k++ )
-	{
-		iaCache = iaCachesSorted[ k ];
-
-		shader = iaCache->surface->shader;
-		alphaTest = shader->alphaTest;
-
-		iaCache->mergedIntoVBO = true;
-
-		if ( alphaTest ? shader != oldShader : alphaTest != oldAlphaTest )
+		for ( int leaf : ia.leafs )
 		{
-			oldShader = shader;
-			oldAlphaTest = alphaTest;
-
-			// count vertices and indices
-			numVerts = 0;
-			numTriangles = 0;
-
-			ClearBounds( bounds[ 0 ], bounds[ 1 ] );
-
-			for ( l = k; l < numCaches; l++ )
+			if ( leaf < 0 || leaf >= s_worldData.numnodes )
 			{
-				iaCache2 = iaCachesSorted[ l ];
-
-				surface = iaCache2->surface;
-
-				if ( alphaTest )
-				{
-					if ( surface->shader != shader )
-					{
-						break;
-					}
-				}
-				else
-				{
-					if ( surface->shader->alphaTest != alphaTest )
-					{
-						break;
-					}
-				}
-
-				if ( *surface->data == surfaceType_t::SF_FACE )
-				{
-					srfSurfaceFace_t *srf = ( srfSurfaceFace_t * ) surface->data;
-
-					if ( srf->numTriangles )
-					{
-						numLitTriangles = UpdateLightTriangles( s_worldData.verts, srf->numTriangles, s_worldData.triangles + srf->firstTriangle, surface->shader, light );
-
-						if ( numLitTriangles )
-						{
-							BoundsAdd( bounds[ 0 ], bounds[ 1 ], srf->bounds[ 0 ], srf->bounds[ 1 ] );
-						}
-
-						numTriangles += numLitTriangles;
-					}
-
-					if ( srf->numVerts )
-					{
-						numVerts += srf->numVerts;
-					}
-				}
-				else if ( *surface->data == surfaceType_t::SF_GRID )
-				{
-					srfGridMesh_t *srf = ( srfGridMesh_t * ) surface->data;
-
-					if ( srf->numTriangles )
-					{
-						numLitTriangles = UpdateLightTriangles( s_worldData.verts, srf->numTriangles, s_worldData.triangles + srf->firstTriangle, surface->shader, light );
-
-						if ( numLitTriangles )
-						{
-							BoundsAdd( bounds[ 0 ], bounds[ 1 ], srf->bounds[ 0 ], srf->bounds[ 1 ] );
-						}
-
-						numTriangles += numLitTriangles;
-					}
-
-					if ( srf->numVerts )
-					{
-						numVerts += srf->numVerts;
-					}
-				}
-				else if ( *surface->data == surfaceType_t::SF_TRIANGLES )
-				{
-					srfTriangles_t *srf = ( srfTriangles_t * ) surface->data;
-
-					if ( srf->numTriangles )
-					{
-						numLitTriangles = UpdateLightTriangles( s_worldData.verts, srf->numTriangles, s_worldData.triangles + srf->firstTriangle, surface->shader, light );
-
-						if ( numLitTriangles )
-						{
-							BoundsAdd( bounds[ 0 ], bounds[ 1 ], srf->bounds[ 0 ], srf->bounds[ 1 ] );
-						}
+				return false;
+			}
+		}
 
-						numTriangles += numLitTriangles;
-					}
+		ia.batches.resize( light.numBatches );
 
-					if ( srf->numVerts )
-					{
-						numVerts += srf->numVerts;
-					}
-				}
-			}
+		for ( lightMeshBatch_t &batch : ia.batches )
+		{
+			interactionCacheBatch_t cached;
 
-			if ( !numVerts || !numTriangles )
+			if ( !reader.Read( cached ) || cached.firstSurface >= (uint32_t) s_worldData.numSurfaces
+			     || !cached.numTriangles || reader.Left() / ( 2 * sizeof( uint32_t ) ) < cached.numTriangles )
 			{
-				continue;
+				return false;
 			}
 
-			// create surface
-			vboSurf = (srfVBOMesh_t*) ri.Hunk_Alloc( sizeof( *vboSurf ), ha_pref::h_low );
-			vboSurf->surfaceType = surfaceType_t::SF_VBO_MESH;
-			vboSurf->numIndexes = numTriangles * 3;
-			vboSurf->numVerts = numVerts;
-			vboSurf->lightmapNum = -1;
+			batch.firstSurface = cached.firstSurface;
+			batch.shadow = cached.shadow;
+			batch.cubeSideBits = cached.cubeSideBits;
+			batch.numVerts = cached.numVerts;
+			VectorCopy( cached.bounds[ 0 ], batch.bounds[ 0 ] );
+			VectorCopy( cached.bounds[ 1 ], batch.bounds[ 1 ] );
 
-			VectorCopy( bounds[ 0 ], vboSurf->bounds[ 0 ] );
-			VectorCopy( bounds[ 1 ], vboSurf->bounds[ 1 ] );
+			batch.triangles.resize( 2 * cached.numTriangles );
+			reader.Read( batch.triangles.data(), batch.triangles.size() * sizeof( uint32_t ) );
 
-			// create arrays
-			indexes = (glIndex_t*) ri.Hunk_AllocateTempMemory( 3 * numTriangles * sizeof( glIndex_t ) );
-			numTriangles = 0;
+			// the indexes are those of the triangles in the world VBO of this run
+			batch.indexes.reserve( 3 * cached.numTriangles );
 
-			// build triangle indices
-			for ( l = k; l < numCaches; l++ )
+			for ( size_t j = 0; j < batch.triangles.size(); j += 2 )
 			{
-				iaCache2 = iaCachesSorted[ l ];
-
-				surface = iaCache2->surface;
+				int firstTriangle, numTriangles, numVerts;
 
-				if ( alphaTest )
-				{
-					if ( surface->shader != shader )
-					{
-						break;
-					}
-				}
-				else
+				if ( batch.triangles[ j ] >= (uint32_t) s_worldData.numSurfaces
+				     || !R_GetSurfaceTriangles( &s_worldData.surfaces[ batch.triangles[ j ] ], &firstTriangle, &numTriangles, &numVerts )
+				     || batch.triangles[ j + 1 ] >= (uint32_t) numTriangles
+				     || firstTriangle + batch.triangles[ j + 1 ] >= (uint32_t) s_worldData.numTriangles )
 				{
-					if ( surface->shader->alphaTest != alphaTest )
-					{
-						break;
-					}
+					return false;
 				}
 
-				if ( *surface->data == surfaceType_t::SF_FACE )
-				{
-					srfSurfaceFace_t *srf = ( srfSurfaceFace_t * ) surface->data;
-
-					for ( i = 0, tri = s_worldData.triangles + srf->firstTriangle; i < srf->numTriangles; i++, tri++ )
-					{
-						if ( tri->facingLight )
-						{
-							for ( j = 0; j < 3; j++ )
-							{
-								indexes[ 3 * numTriangles + j ] = tri->indexes[ j ];
-							}
+				const srfTriangle_t *tri = s_worldData.triangles + firstTriangle + batch.triangles[ j + 1 ];
 
-							numTriangles++;
-						}
-					}
-				}
-				else if ( *surface->data == surfaceType_t::SF_GRID )
+				for ( int k = 0; k < 3; k++ )
 				{
-					srfGridMesh_t *srf = ( srfGridMesh_t * ) surface->data;
-
-					for ( i = 0, tri = s_worldData.triangles + srf->firstTriangle; i < srf->numTriangles; i++, tri++ )
+					if ( tri->indexes[ k ] >= (glIndex_t) s_worldData.numVerts )
 					{
-						if ( tri->facingLight )
-						{
-							for ( j = 0; j < 3; j++ )
-							{
-								indexes[ 3 * numTriangles + j ] = tri->indexes[ j ];
-							}
-
-							numTriangles++;
-						}
+						return false;
 					}
-				}
-				else if ( *surface->data == surfaceType_t::SF_TRIANGLES )
-				{
-					srfTriangles_t *srf = ( srfTriangles_t * ) surface->data;
-
-					for ( i = 0, tri = s_worldData.triangles + srf->firstTriangle; i < srf->numTriangles; i++, tri++ )
-					{
-						if ( tri->facingLight )
-						{
-							for ( j = 0; j < 3; j++ )
-							{
-								indexes[ 3 * numTriangles + j ] = tri->indexes[ j ];
-							}
 
-							numTriangles++;
-						}
-					}
+					batch.indexes.push_back( tri->indexes[ k ] );
 				}
 			}
-
-			vboSurf->vbo = s_worldData.vbo;
-			vboSurf->ibo = R_CreateStaticIBO( va( "staticShadowMesh_IBO %i", c_vboLightSurfaces ), indexes, 3 * numTriangles );
-
-			ri.Hunk_FreeTempMemory( indexes );
-
-			// add everything needed to the light
-			iaVBO = R_CreateInteractionVBO( light );
-			iaVBO->shader = shader;
-			iaVBO->vboShadowMesh = vboSurf;
-
-			c_vboShadowSurfaces++;
 		}
 	}
 
-	ri.Hunk_FreeTempMemory( iaCachesSorted );
+	return reader.Done();
 }
 
 /*
 ===============
-R_CreateVBOShadowCubeMeshes
+R_SaveInteractionCache
 ===============
 */
-static void R_CreateVBOShadowCubeMeshes( trRefLight_t *light )
+static void R_SaveInteractionCache( const std::string &key, const std::vector<lightInteractions_t> &interactions )
 {
-	int                i, j, k, l;
+	if ( key.empty() )
+	{
+		return;
+	}
 
-	int                numVerts;
+	interactionCacheHeader_t header{};
 
-	int                numTriangles;
-	glIndex_t          *indexes;
-	srfTriangle_t      *tri;
+	header.numLights = interactions.size();
+	header.numSurfaces = s_worldData.numSurfaces;
+	header.numNodes = s_worldData.numnodes;
 
-	interactionVBO_t   *iaVBO;
+	std::string data( reinterpret_cast<const char *>( &header ), sizeof( header ) );
 
-	interactionCache_t *iaCache, *iaCache2;
-	interactionCache_t **iaCachesSorted;
-	int                numCaches;
+	for ( const lightInteractions_t &ia : interactions )
+	{
+		interactionCacheLight_t light;
 
-	shader_t           *shader, *oldShader;
-	bool           alphaTest, oldAlphaTest;
-	int                cubeSide;
+		light.numInteractions = ia.surfaces.size();
+		light.numLeafs = ia.leafs.size();
+		light.numBatches = ia.batches.size();
 
-	bspSurface_t       *surface;
+		data.append( reinterpret_cast<const char *>( &light ), sizeof( light ) );
+		data.append( reinterpret_cast<const char *>( ia.surfaces.data() ), ia.surfaces.size() * sizeof( int ) );
+		data.append( reinterpret_cast<const char *>( ia.cubeSideBits.data() ), ia.cubeSideBits.size() );
+		data.append( reinterpret_cast<const char *>( ia.mergedIntoVBO.data() ), ia.mergedIntoVBO.size() );
+		data.append( reinterpret_cast<const char *>( ia.leafs.data() ), ia.leafs.size() * sizeof( int ) );
 
-	srfVBOMesh_t       *vboSurf;
+		for ( const lightMeshBatch_t &batch : ia.batches )
+		{
+			interactionCacheBatch_t cached{};
 
-	if ( !r_vboShadows->integer )
-	{
-		return;
-	}
+			cached.firstSurface = batch.firstSurface;
+			cached.shadow = batch.shadow;
+			cached.cubeSideBits = batch.cubeSideBits;
+			cached.numVerts = batch.numVerts;
+			VectorCopy( batch.bounds[ 0 ], cached.bounds[ 0 ] );
+			VectorCopy( batch.bounds[ 1 ], cached.bounds[ 1 ] );
+			cached.numTriangles = batch.triangles.size() / 2;
 
-	if ( r_shadows->integer < Util::ordinal(shadowingMode_t::SHADOWING_ESM16))
-	{
-		return;
+			data.append( reinterpret_cast<const char *>( &cached ), sizeof( cached ) );
+			data.append( reinterpret_cast<const char *>( batch.triangles.data() ), batch.triangles.size() * sizeof( uint32_t ) );
+		}
 	}
 
-	if ( !light->firstInteractionCache )
-	{
-		// this light has no interactions precached
-		return;
-	}
+	R_WriteCacheFile( INTERACTION_CACHE_DIR, key, INTERACTION_CACHE_VERSION, data );
+}
 
-	if ( light->l.noShadows )
-	{
-		return;
-	}
+/*
+=============
+R_PrecacheInteractions
 
-	if ( light->l.rlType != refLightType_t::RL_OMNI )
-	{
-		return;
-	}
+The lights are independent so the BSP walk and the building of the light and
+shadow meshes run on the job threads, only the hunk allocations and the IBO
+creation are left to the main thread. The result is kept in the homepath.
+=============
+*/
+void R_PrecacheInteractions()
+{
+	int          i;
+	bspSurface_t *surface;
+	int          startTime, endTime;
+	growList_t   interactions;
 
-	// count number of interaction caches
-	numCaches = 0;
+	startTime = ri.Milliseconds();
 
-	for ( iaCache = light->firstInteractionCache; iaCache; iaCache = iaCache->next )
+	// reset surfaces' viewCount
+	for ( i = 0, surface = s_worldData.surfaces; i < s_worldData.numSurfaces; i++, surface++ )
 	{
-		if ( iaCache->redundant )
-		{
-			continue;
-		}
+		surface->lightCount = -1;
+	}
 
-		surface = iaCache->surface;
+	Com_InitGrowList( &interactions, 100 );
 
-		if ( !surface->shader->interactLight )
-		{
-			continue;
-		}
+	c_redundantInteractions = 0;
+	c_vboWorldSurfaces = 0;
+	c_vboLightSurfaces = 0;
+	c_vboShadowSurfaces = 0;
 
-		if ( surface->shader->isSky )
-		{
-			continue;
-		}
+	Log::Debug("...precaching %i lights", s_worldData.numLights );
 
-		if ( surface->shader->noShadows )
-		{
-			continue;
-		}
+	std::vector<trRefLight_t *> lights;
 
-		if ( surface->shader->sort > Util::ordinal(shaderSort_t::SS_OPAQUE))
-		{
-			continue;
-		}
+	for ( i = 0; i < s_worldData.numLights; i++ )
+	{
+		trRefLight_t *light = &s_worldData.lights[ i ];
 
-		if ( surface->shader->isPortal )
+		if ( tr.worldLightMapping && !light->noRadiosity )
 		{
 			continue;
 		}
 
-		numCaches++;
+		lights.push_back( light );
 	}
 
-	// build interaction caches list
-	iaCachesSorted = (interactionCache_t**) ri.Hunk_AllocateTempMemory( numCaches * sizeof( iaCachesSorted[ 0 ] ) );
+	std::vector<lightInteractions_t> lightInteractions( lights.size() );
 
-	numCaches = 0;
-
-	for ( iaCache = light->firstInteractionCache; iaCache; iaCache = iaCache->next )
-	{
-		if ( iaCache->redundant )
-		{
-			continue;
-		}
+	R_RunJobs( lights.size(), [ & ]( int job ) {
+		trRefLight_t *light = lights[ job ];
 
-		surface = iaCache->surface;
+		// set up light transform matrix
+		MatrixSetupTransformFromQuat( light->transformMatrix, light->l.rotation, light->l.origin );
 
-		if ( !surface->shader->interactLight )
-		{
-			continue;
-		}
+		// set up light origin for lighting and shadowing
+		R_SetupLightOrigin( light );
 
-		if ( surface->shader->isSky )
-		{
-			continue;
-		}
+		// set up model to light view matrix
+		R_SetupLightView( light );
 
-		if ( surface->shader->noShadows )
-		{
-			continue;
-		}
+		// set up projection
+		R_SetupLightProjection( light );
 
-		if ( surface->shader->sort > Util::ordinal(shaderSort_t::SS_OPAQUE) )
-		{
-			continue;
-		}
+		// calc local bounds for culling
+		R_SetupLightLocalBounds( light );
 
-		if ( surface->shader->isPortal )
-		{
-			continue;
-		}
+		// setup world bounds for intersection tests
+		R_SetupLightWorldBounds( light );
 
-		iaCachesSorted[ numCaches ] = iaCache;
-		numCaches++;
-	}
+		// setup frustum planes for intersection tests
+		R_SetupLightFrustum( light );
+	} );
 
-	// sort interaction caches by shader
-	qsort( iaCachesSorted, numCaches, sizeof( *iaCachesSorted ), InteractionCacheCompare );
+	std::string key = R_InteractionCacheKey();
 
-	// create a VBO for each shader
-	for ( cubeSide = 0; cubeSide < 6; cubeSide++ )
+	if ( R_LoadInteractionCache( key, lightInteractions ) )
+	{
+		Log::Debug("...loaded precached interactions from the cache" );
+	}
+	else
 	{
-		shader = oldShader = nullptr;
-		oldAlphaTest = alphaTest = true;
+		// perform culling and add all the potentially visible surfaces
+		R_RunJobs( lights.size(), [ & ]( int job ) {
+			std::vector<bool> checked( s_worldData.numSurfaces, false );
 
-		for ( k = 0; k < numCaches; k++ )
-		{
-			iaCache = iaCachesSorted[ k ];
-			shader = iaCache->surface->shader;
-			alphaTest = shader->alphaTest;
+			lightInteractions[ job ] = {};
+			R_RecursivePrecacheInteractionNode( s_worldData.nodes, lights[ job ], lightInteractions[ job ], checked );
+		} );
 
-			iaCache->mergedIntoVBO = true;
+		// calculate pyramid bits for each interaction in omni-directional lights,
+		// this updates the performance counters so it stays on the main thread
+		for ( size_t j = 0; j < lights.size(); j++ )
+		{
+			R_CalcInteractionCubeSideBits( lights[ j ], lightInteractions[ j ] );
+		}
 
-			if ( alphaTest ? shader != oldShader : alphaTest != oldAlphaTest )
-			{
-				oldShader = shader;
-				oldAlphaTest = alphaTest;
+		// batch the light and shadow geometry of each light by shader, and
+		// inside a cubemap pyramid for omni-directional lights
+		R_RunJobs( lights.size(), [ & ]( int job ) {
+			R_BuildLightMeshes( lights[ job ], lightInteractions[ job ] );
+		} );
 
-				// count vertices and indices
-				numVerts = 0;
-				numTriangles = 0;
+		R_SaveInteractionCache( key, lightInteractions );
+	}
 
-				for ( l = k; l < numCaches; l++ )
-				{
-					iaCache2 = iaCachesSorted[ l ];
-
-					surface = iaCache2->surface;
-
-					if ( alphaTest )
-					{
-						if ( surface->shader != shader )
-						{
-							break;
-						}
-					}
-					else
-					{
-						if ( surface->shader->alphaTest != alphaTest )
-						{
-							break;
-						}
-					}
+	// create a static VBO surface for each geometry batch
+	for ( size_t j = 0; j < lights.size(); j++ )
+	{
+		R_CreateLightMeshes( lights[ j ], lightInteractions[ j ], &interactions );
+	}
 
-					if ( !( iaCache2->cubeSideBits & ( 1 << cubeSide ) ) )
-					{
-						continue;
-					}
+	// move interactions grow list to hunk
+	s_worldData.numInteractions = interactions.currentElements;
+	s_worldData.interactions = (interactionCache_t**) ri.Hunk_Alloc( s_worldData.numInteractions * sizeof( *s_worldData.interactions ), ha_pref::h_low );
 
-					if ( *surface->data == surfaceType_t::SF_FACE )
-					{
-						srfSurfaceFace_t *srf = ( srfSurfaceFace_t * ) surface->data;
+	for ( i = 0; i < s_worldData.numInteractions; i++ )
+	{
+		s_worldData.interactions[ i ] = ( interactionCache_t * ) Com_GrowListElement( &interactions, i );
+	}
 
-						if ( srf->numTriangles )
-						{
-							numTriangles +=
-							  UpdateLightTriangles( s_worldData.verts, srf->numTriangles,
-							                        s_worldData.triangles + srf->firstTriangle, surface->shader, light );
-						}
+	Com_DestroyGrowList( &interactions );
 
-						if ( srf->numVerts )
-						{
-							numVerts += srf->numVerts;
-						}
-					}
-					else if ( *surface->data == surfaceType_t::SF_GRID )
-					{
-						srfGridMesh_t *srf = ( srfGridMesh_t * ) surface->data;
+	Log::Debug("%i interactions precached", s_worldData.numInteractions );
+	Log::Debug("%i interactions were hidden in shadows", c_redundantInteractions );
 
-						if ( srf->numTriangles )
-						{
-							numTriangles +=
-							  UpdateLightTriangles( s_worldData.verts, srf->numTriangles,
-							                        s_worldData.triangles + srf->firstTriangle, surface->shader, light );
-						}
+	if ( r_shadows->integer >= Util::ordinal(shadowingMode_t::SHADOWING_ESM16))
+	{
+		// only interesting for omni-directional shadow mapping
+		Log::Debug("%i omni pyramid tests", tr.pc.c_pyramidTests );
+		Log::Debug("%i omni pyramid surfaces visible", tr.pc.c_pyramid_cull_ent_in );
+		Log::Debug("%i omni pyramid surfaces clipped", tr.pc.c_pyramid_cull_ent_clip );
+		Log::Debug("%i omni pyramid surfaces culled", tr.pc.c_pyramid_cull_ent_out );
+	}
 
-						if ( srf->numVerts )
-						{
-							numVerts += srf->numVerts;
-						}
-					}
-					else if ( *surface->data == surfaceType_t::SF_TRIANGLES )
-					{
-						srfTriangles_t *srf = ( srfTriangles_t * ) surface->data;
+	endTime = ri.Milliseconds();
 
-						if ( srf->numTriangles )
-						{
-							numTriangles +=
-							  UpdateLightTriangles( s_worldData.verts, srf->numTriangles,
-							                        s_worldData.triangles + srf->firstTriangle, surface->shader, light );
-						}
+	Log::Debug("lights precaching time = %5.2f seconds", ( endTime - startTime ) / 1000.0 );
+}
 
-						if ( srf->numVerts )
-						{
-							numVerts += srf->numVerts;
-						}
-					}
-				}
+static const int HASHTABLE_SIZE = 7919; // 32749 // 2039    /* prime, use % */
+#define HASH_USE_EPSILON
 
-				if ( !numVerts || !numTriangles )
-				{
-					continue;
-				}
+#ifdef HASH_USE_EPSILON
+#define HASH_XYZ_EPSILON                 0.01f
+#define HASH_XYZ_EPSILONSPACE_MULTIPLIER 1.f / HASH_XYZ_EPSILON
+#endif
 
-				// create surface
-				vboSurf = (srfVBOMesh_t*) ri.Hunk_Alloc( sizeof( *vboSurf ), ha_pref::h_low );
-				vboSurf->surfaceType = surfaceType_t::SF_VBO_MESH;
-				vboSurf->numIndexes = numTriangles * 3;
-				vboSurf->numVerts = numVerts;
-				vboSurf->lightmapNum = -1;
-				ZeroBounds( vboSurf->bounds[ 0 ], vboSurf->bounds[ 1 ] );
+unsigned int VertexCoordGenerateHash( const vec3_t xyz )
+{
+	unsigned int hash = 0;
 
-				// create arrays
-				indexes = (glIndex_t*) ri.Hunk_AllocateTempMemory( 3 * numTriangles * sizeof( glIndex_t ) );
-				numTriangles = 0;
+#ifndef HASH_USE_EPSILON
+	hash += ~( * ( ( unsigned int * ) &xyz[ 0 ] ) << 15 );
+	hash ^= ( * ( ( unsigned int * ) &xyz[ 0 ] ) >> 10 );
+	hash += ( * ( ( unsigned int * ) &xyz[ 1 ] ) << 3 );
+	hash ^= ( * ( ( unsigned int * ) &xyz[ 1 ] ) >> 6 );
+	hash += ~( * ( ( unsigned int * ) &xyz[ 2 ] ) << 11 );
+	hash ^= ( * ( ( unsigned int * ) &xyz[ 2 ] ) >> 16 );
+#else
+	vec3_t xyz_epsilonspace;
 
-				// build triangle indices
-				for ( l = k; l < numCaches; l++ )
-				{
-					iaCache2 = iaCachesSorted[ l ];
+	VectorScale( xyz, HASH_XYZ_EPSILONSPACE_MULTIPLIER, xyz_epsilonspace );
+	xyz_epsilonspace[ 0 ] = floor( xyz_epsilonspace[ 0 ] );
+	xyz_epsilonspace[ 1 ] = floor( xyz_epsilonspace[ 1 ] );
+	xyz_epsilonspace[ 2 ] = floor( xyz_epsilonspace[ 2 ] );
 
-					surface = iaCache2->surface;
+	hash += ~( * ( ( unsigned int * ) &xyz_epsilonspace[ 0 ] ) << 15 );
+	hash ^= ( * ( ( unsigned int * ) &xyz_epsilonspace[ 0 ] ) >> 10 );
+	hash += ( * ( ( unsigned int * ) &xyz_epsilonspace[ 1 ] ) << 3 );
+	hash ^= ( * ( ( unsigned int * ) &xyz_epsilonspace[ 1 ] ) >> 6 );
+	hash += ~( * ( ( unsigned int * ) &xyz_epsilonspace[ 2 ] ) << 11 );
+	hash ^= ( * ( ( unsigned int * ) &xyz_epsilonspace[ 2 ] ) >> 16 );
 
-					if ( alphaTest )
-					{
-						if ( surface->shader != shader )
-						{
-							break;
-						}
-					}
-					else
-					{
-						if ( surface->shader->alphaTest != alphaTest )
-						{
-							break;
-						}
-					}
+#endif
 
-					if ( !( iaCache2->cubeSideBits & ( 1 << cubeSide ) ) )
-					{
-						continue;
-					}
+	hash = hash % ( HASHTABLE_SIZE );
+	return hash;
+}
 
-					if ( *surface->data == surfaceType_t::SF_FACE )
-					{
-						srfSurfaceFace_t *srf = ( srfSurfaceFace_t * ) surface->data;
+vertexHash_t **NewVertexHashTable()
+{
+	vertexHash_t **hashTable = (vertexHash_t**) malloc( HASHTABLE_SIZE * sizeof( vertexHash_t * ) );
 
-						for ( i = 0, tri = s_worldData.triangles + srf->firstTriangle; i < srf->numTriangles; i++, tri++ )
-						{
-							if ( tri->facingLight )
-							{
-								for ( j = 0; j < 3; j++ )
-								{
-									indexes[ 3 * numTriangles + j ] = tri->indexes[ j ];
-								}
-
-								numTriangles++;
-							}
-						}
-					}
-					else if ( *surface->data == surfaceType_t::SF_GRID )
-					{
-						srfGridMesh_t *srf = ( srfGridMesh_t * ) surface->data;
+	memset( hashTable, 0, HASHTABLE_SIZE * sizeof( vertexHash_t * ) );
 
-						for ( i = 0, tri = s_worldData.triangles + srf->firstTriangle; i < srf->numTriangles; i++, tri++ )
-						{
-							if ( tri->facingLight )
-							{
-								for ( j = 0; j < 3; j++ )
-								{
-									indexes[ 3 * numTriangles + j ] = tri->indexes[ j ];
-								}
-
-								numTriangles++;
-							}
-						}
-					}
-					else if ( *surface->data == surfaceType_t::SF_TRIANGLES )
-					{
-						srfTriangles_t *srf = ( srfTriangles_t * ) surface->data;
+	return hashTable;
+}
 
-						for ( i = 0, tri = s_worldData.triangles + srf->firstTriangle; i < srf->numTriangles; i++, tri++ )
-						{
-							if ( tri->facingLight )
-							{
-								for ( j = 0; j < 3; j++ )
-								{
-									indexes[ 3 * numTriangles + j ] = tri->indexes[ j ];
-								}
-
-								numTriangles++;
-							}
-						}
-					}
-				}
+void FreeVertexHashTable( vertexHash_t **hashTable )
+{
+	int          i;
+	vertexHash_t *vertexHash;
+	vertexHash_t *nextVertexHash;
 
-				vboSurf->vbo = s_worldData.vbo;
-				vboSurf->ibo = R_CreateStaticIBO( va( "staticShadowPyramidMesh_IBO %i", c_vboShadowSurfaces ), indexes, numTriangles );
+	if ( hashTable == nullptr )
+	{
+		return;
+	}
 
-				ri.Hunk_FreeTempMemory( indexes );
+	for ( i = 0; i < HASHTABLE_SIZE; i++ )
+	{
+		if ( hashTable[ i ] )
+		{
+			nextVertexHash = nullptr;
 
-				// add everything needed to the light
-				iaVBO = R_CreateInteractionVBO( light );
-				iaVBO->cubeSideBits = ( 1 << cubeSide );
-				iaVBO->shader = shader;
-				iaVBO->vboShadowMesh = vboSurf;
+			for ( vertexHash = hashTable[ i ]; vertexHash; vertexHash = nextVertexHash )
+			{
+				nextVertexHash = vertexHash->next;
 
-				c_vboShadowSurfaces++;
+				free( vertexHash );
 			}
 		}
 	}
 
-	ri.Hunk_FreeTempMemory( iaCachesSorted );
+	free( hashTable );
 }
 
-static void R_CalcInteractionCubeSideBits( trRefLight_t *light )
+vertexHash_t *FindVertexInHashTable( vertexHash_t **hashTable, const vec3_t xyz, float distance )
 {
-	interactionCache_t *iaCache;
-	bspSurface_t       *surface;
-	vec3_t             localBounds[ 2 ];
+	unsigned int hash;
+	vertexHash_t *vertexHash;
 
-	if ( r_shadows->integer <= Util::ordinal(shadowingMode_t::SHADOWING_BLOB))
+	if ( hashTable == nullptr || xyz == nullptr )
 	{
-		return;
+		return nullptr;
 	}
 
-	if ( !light->firstInteractionCache )
+	hash = VertexCoordGenerateHash( xyz );
+
+	for ( vertexHash = hashTable[ hash ]; vertexHash; vertexHash = vertexHash->next )
 	{
-		// this light has no interactions precached
-		return;
+#ifndef HASH_USE_EPSILON
+
+		if ( ( vertexHash->vcd.xyz[ 0 ] != xyz[ 0 ] || vertexHash->vcd.xyz[ 1 ] != xyz[ 1 ] ||
+		       vertexHash->vcd.xyz[ 2 ] != xyz[ 2 ] ) )
+		{
+			continue;
+		}
+
+#elif 1
+
+		if ( Distance( xyz, vertexHash->xyz ) > distance )
+		{
+			continue;
+		}
+
+#else
+
+		if ( ( fabsf( xyz[ 0 ] - vertexHash->vcd.xyz[ 0 ] ) ) > HASH_XYZ_EPSILON ||
+		     ( fabsf( xyz[ 1 ] - vertexHash->vcd.xyz[ 1 ] ) ) > HASH_XYZ_EPSILON ||
+		     ( fabsf( xyz[ 2 ] - vertexHash->vcd.xyz[ 2 ] ) ) > HASH_XYZ_EPSILON )
+		{
+			continue;
+		}
+
+#endif
+		return vertexHash;
 	}
 
-	if ( light->l.noShadows )
+	return nullptr;
+}
+
+vertexHash_t *AddVertexToHashTable( vertexHash_t **hashTable, vec3_t xyz, void *data )
+{
+	unsigned int hash;
+	vertexHash_t *vertexHash;
+
+	if ( hashTable == nullptr || xyz == nullptr )
 	{
-		// actually noShadows lights are quite bad concerning this optimization
-		return;
+		return nullptr;
 	}
 
-	if ( light->l.rlType != refLightType_t::RL_OMNI )
+	vertexHash = (vertexHash_t*) malloc( sizeof( vertexHash_t ) );
+
+	if ( !vertexHash )
 	{
-		return;
+		return nullptr;
 	}
 
-	{
-		for ( iaCache = light->firstInteractionCache; iaCache; iaCache = iaCache->next )
-		{
-			surface = iaCache->surface;
+	hash = VertexCoordGenerateHash( xyz );
 
-			if ( *surface->data == surfaceType_t::SF_FACE || *surface->data == surfaceType_t::SF_GRID || *surface->data == surfaceType_t::SF_TRIANGLES )
-			{
-				srfGeneric_t *gen;
+	VectorCopy( xyz, vertexHash->xyz );
+	vertexHash->data = data;
 
-				gen = ( srfGeneric_t * ) surface->data;
+	// link into table
+	vertexHash->next = hashTable[ hash ];
+	hashTable[ hash ] = vertexHash;
 
-				VectorCopy( gen->bounds[ 0 ], localBounds[ 0 ] );
-				VectorCopy( gen->bounds[ 1 ], localBounds[ 1 ] );
-			}
-			else
-			{
-				iaCache->cubeSideBits = CUBESIDE_CLIPALL;
-				continue;
-			}
+	return vertexHash;
+}
 
-			light->shadowLOD = 0; // important for R_CalcLightCubeSideBits
-			iaCache->cubeSideBits = R_CalcLightCubeSideBits( light, localBounds );
-		}
+// the cubemap probes sorted as a balanced k-d tree, see R_BuildCubeProbeTree
+static std::vector<cubemapProbe_t *> s_cubeProbeTree;
+
+static void R_SortCubeProbeTree( int first, int last, int axis )
+{
+	if ( last - first < 2 )
+	{
+		return;
 	}
+
+	int mid = ( first + last ) / 2;
+
+	std::nth_element( s_cubeProbeTree.begin() + first, s_cubeProbeTree.begin() + mid, s_cubeProbeTree.begin() + last,
+	                  [ axis ]( const cubemapProbe_t *a, const cubemapProbe_t *b ) {
+		return a->origin[ axis ] < b->origin[ axis ];
+	} );
+
+	R_SortCubeProbeTree( first, mid, ( axis + 1 ) % 3 );
+	R_SortCubeProbeTree( mid + 1, last, ( axis + 1 ) % 3 );
 }
 
 /*
-=============
-R_PrecacheInteractions
-=============
+=================
+R_BuildCubeProbeTree
+
+The vertex hash only finds the probes at the exact same position, the k-d
+tree finds the nearest ones wherever they are
+=================
 */
-void R_PrecacheInteractions()
+static void R_BuildCubeProbeTree()
 {
-	int          i;
-	trRefLight_t *light;
-	bspSurface_t *surface;
-	int          startTime, endTime;
+	s_cubeProbeTree.clear();
 
-	startTime = ri.Milliseconds();
+	for ( int i = 0; i < tr.cubeProbes.currentElements; i++ )
+	{
+		s_cubeProbeTree.push_back( ( cubemapProbe_t * ) Com_GrowListElement( &tr.cubeProbes, i ) );
+	}
 
-	// reset surfaces' viewCount
-	s_lightCount = 0;
+	R_SortCubeProbeTree( 0, s_cubeProbeTree.size(), 0 );
+}
 
-	for ( i = 0, surface = s_worldData.surfaces; i < s_worldData.numSurfaces; i++, surface++ )
+static void R_SearchCubeProbeTree( const vec3_t position, int first, int last, int axis, cubemapProbe_t *nearest[ 2 ], float distance[ 2 ] )
+{
+	if ( first >= last )
 	{
-		surface->lightCount = -1;
+		return;
 	}
 
-	Com_InitGrowList( &s_interactions, 100 );
+	int            mid = ( first + last ) / 2;
+	cubemapProbe_t *cubeProbe = s_cubeProbeTree[ mid ];
+	float          d = DistanceSquared( cubeProbe->origin, position );
 
-	c_redundantInteractions = 0;
-	c_vboWorldSurfaces = 0;
-	c_vboLightSurfaces = 0;
-	c_vboShadowSurfaces = 0;
+	if ( d < distance[ 0 ] )
+	{
+		nearest[ 1 ] = nearest[ 0 ];
+		distance[ 1 ] = distance[ 0 ];
 
-	Log::Debug("...precaching %i lights", s_worldData.numLights );
+		nearest[ 0 ] = cubeProbe;
+		distance[ 0 ] = d;
+	}
+	else if ( d < distance[ 1 ] )
+	{
+		nearest[ 1 ] = cubeProbe;
+		distance[ 1 ] = d;
+	}
 
-	for ( i = 0; i < s_worldData.numLights; i++ )
+	// search the side of the position first, the other side
+	// only if it can be closer than what was already found
+	float delta = position[ axis ] - cubeProbe->origin[ axis ];
+	int   next = ( axis + 1 ) % 3;
+
+	if ( delta < 0 )
 	{
-		light = &s_worldData.lights[ i ];
+		R_SearchCubeProbeTree( position, first, mid, next, nearest, distance );
 
-		if ( tr.worldLightMapping && !light->noRadiosity )
+		if ( delta * delta < distance[ 1 ] )
 		{
-			continue;
+			R_SearchCubeProbeTree( position, mid + 1, last, next, nearest, distance );
 		}
+	}
+	else
+	{
+		R_SearchCubeProbeTree( position, mid + 1, last, next, nearest, distance );
 
-		// set up light transform matrix
-		MatrixSetupTransformFromQuat( light->transformMatrix, light->l.rotation, light->l.origin );
+		if ( delta * delta < distance[ 1 ] )
+		{
+			R_SearchCubeProbeTree( position, first, mid, next, nearest, distance );
+		}
+	}
+}
 
-		// set up light origin for lighting and shadowing
-		R_SetupLightOrigin( light );
+void GL_BindNearestCubeMap( const vec3_t xyz )
+{
+	cubemapProbe_t *nearest[ 2 ] = { nullptr, nullptr };
+	float          distance[ 2 ] = { FLT_MAX, FLT_MAX };
 
-		// set up model to light view matrix
-		R_SetupLightView( light );
+	tr.autoCubeImage = tr.whiteCubeImage;
 
-		// set up projection
-		R_SetupLightProjection( light );
+	if ( !r_reflectionMapping->integer )
+	{
+		return;
+	}
 
-		// calc local bounds for culling
-		R_SetupLightLocalBounds( light );
+	if ( tr.cubeHashTable == nullptr || xyz == nullptr )
+	{
+		return;
+	}
 
-		// setup world bounds for intersection tests
-		R_SetupLightWorldBounds( light );
+	R_SearchCubeProbeTree( xyz, 0, s_cubeProbeTree.size(), 0, nearest, distance );
 
-		// setup frustum planes for intersection tests
-		R_SetupLightFrustum( light );
+	if ( nearest[ 0 ] )
+	{
+		tr.autoCubeImage = nearest[ 0 ]->cubemap;
+	}
+
+	GL_Bind( tr.autoCubeImage );
+}
+
+void R_FindTwoNearestCubeMaps( const vec3_t position, cubemapProbe_t **cubeProbeNearest, cubemapProbe_t **cubeProbeSecondNearest )
+{
+	cubemapProbe_t *nearest[ 2 ] = { nullptr, nullptr };
+	float          distance[ 2 ] = { FLT_MAX, FLT_MAX };
 
-		// setup interactions
-		light->firstInteractionCache = nullptr;
-		light->lastInteractionCache = nullptr;
+	GLimp_LogComment( "--- R_FindTwoNearestCubeMaps ---\n" );
 
-		light->firstInteractionVBO = nullptr;
-		light->lastInteractionVBO = nullptr;
+	*cubeProbeNearest = nullptr;
+	*cubeProbeSecondNearest = nullptr;
 
-		// perform culling and add all the potentially visible surfaces
-		s_lightCount++;
-		QueueInit( &light->leafs );
-		R_RecursivePrecacheInteractionNode( s_worldData.nodes, light );
+	if ( tr.cubeHashTable == nullptr || position == nullptr )
+	{
+		return;
+	}
+
+	R_SearchCubeProbeTree( position, 0, s_cubeProbeTree.size(), 0, nearest, distance );
+
+	*cubeProbeNearest = nearest[ 0 ];
+	*cubeProbeSecondNearest = nearest[ 1 ];
+}
+
+static const int CUBEMAP_FACE_SIZE = REF_CUBEMAP_SIZE * REF_CUBEMAP_SIZE * 4;
+static const int CUBEMAP_PROBE_SIZE = 6 * CUBEMAP_FACE_SIZE;
 
-		// create a static VBO surface for each light geometry batch
-		R_CreateVBOLightMeshes( light );
+// number of probes processed together on the job threads
+static const int CUBEMAP_PROBE_BATCH = 64;
 
-		// create a static VBO surface for each shadow geometry batch
-		R_CreateVBOShadowMeshes( light );
+// number of probes in flight between the rendering and the readback
+static const int CUBEMAP_READBACK_DEPTH = 2;
 
-		// calculate pyramid bits for each interaction in omni-directional lights
-		R_CalcInteractionCubeSideBits( light );
+static const char     CUBEMAP_CACHE_DIR[] = "cubemaps";
+static const uint32_t CUBEMAP_CACHE_VERSION = 1;
 
-		// create a static VBO surface for each light geometry batch inside a cubemap pyramid
-		R_CreateVBOShadowCubeMeshes( light );
+struct cubemapCacheHeader_t
+{
+	uint32_t numProbes;
+	uint32_t size;
+};
+
+struct cubemapCacheProbe_t
+{
+	vec3_t   origin;
+	uint32_t compressedSize;
+};
+
+static void R_AddImageRevision( const image_t *image, std::set<std::string> &revisions )
+{
+	std::string fileName;
+
+	if ( image && R_FindImageFileName( image->name, fileName ) >= 0 )
+	{
+		revisions.insert( R_PakFileRevision( fileName ) );
 	}
+}
 
-	// move interactions grow list to hunk
-	s_worldData.numInteractions = s_interactions.currentElements;
-	s_worldData.interactions = (interactionCache_t**) ri.Hunk_Alloc( s_worldData.numInteractions * sizeof( *s_worldData.interactions ), ha_pref::h_low );
+/*
+=================
+R_CubeProbeCacheKey
 
-	for ( i = 0; i < s_worldData.numInteractions; i++ )
+The probes see the world with its shaders, so the key has the revisions
+of the shader files and of the images of the world shaders and lightmaps
+=================
+*/
+static std::string R_CubeProbeCacheKey()
+{
+	if ( !r_cubeProbeCache.Get() )
 	{
-		s_worldData.interactions[ i ] = ( interactionCache_t * ) Com_GrowListElement( &s_interactions, i );
+		return "";
 	}
 
-	Com_DestroyGrowList( &s_interactions );
+	std::set<std::string> revisions;
 
-	Log::Debug("%i interactions precached", s_worldData.numInteractions );
-	Log::Debug("%i interactions were hidden in shadows", c_redundantInteractions );
+	for ( const std::string &name : FS::PakPath::ListFiles( "scripts" ) )
+	{
+		if ( Str::IsISuffix( ".shader", name ) )
+		{
+			revisions.insert( R_PakFileRevision( "scripts/" + name ) );
+		}
+	}
 
-	if ( r_shadows->integer >= Util::ordinal(shadowingMode_t::SHADOWING_ESM16))
+	std::set<const shader_t *> shaders;
+
+	for ( int i = 0; i < s_worldData.numSurfaces; i++ )
 	{
-		// only interesting for omni-directional shadow mapping
-		Log::Debug("%i omni pyramid tests", tr.pc.c_pyramidTests );
-		Log::Debug("%i omni pyramid surfaces visible", tr.pc.c_pyramid_cull_ent_in );
-		Log::Debug("%i omni pyramid surfaces clipped", tr.pc.c_pyramid_cull_ent_clip );
-		Log::Debug("%i omni pyramid surfaces culled", tr.pc.c_pyramid_cull_ent_out );
+		shaders.insert( s_worldData.surfaces[ i ].shader );
 	}
 
-	endTime = ri.Milliseconds();
+	for ( const shader_t *shader : shaders )
+	{
+		for ( int i = 0; i < shader->numStages; i++ )
+		{
+			for ( const textureBundle_t &bundle : shader->stages[ i ]->bundle )
+			{
+				for ( int j = 0; j < bundle.numImages; j++ )
+				{
+					R_AddImageRevision( bundle.image[ j ], revisions );
+				}
+			}
+		}
+	}
 
-	Log::Debug("lights precaching time = %5.2f seconds", ( endTime - startTime ) / 1000.0 );
-}
+	for ( int i = 0; i < tr.lightmaps.currentElements; i++ )
+	{
+		R_AddImageRevision( ( image_t * ) Com_GrowListElement( &tr.lightmaps, i ), revisions );
+	}
 
-static const int HASHTABLE_SIZE = 7919; // 32749 // 2039    /* prime, use % */
-#define HASH_USE_EPSILON
+	std::string paks;
 
-#ifdef HASH_USE_EPSILON
-#define HASH_XYZ_EPSILON                 0.01f
-#define HASH_XYZ_EPSILONSPACE_MULTIPLIER 1.f / HASH_XYZ_EPSILON
-#endif
+	for ( const std::string &revision : revisions )
+	{
+		paks += revision;
+		paks += '\n';
+	}
 
-unsigned int VertexCoordGenerateHash( const vec3_t xyz )
-{
-	unsigned int hash = 0;
+	return Str::Format( "%s %08x %i %i %08x", s_worldData.name, s_worldChecksum, REF_CUBEMAP_SIZE,
+	                    Util::ordinal( tr.lightMode ), Com_BlockChecksum( paks.data(), paks.size() ) );
+}
 
-#ifndef HASH_USE_EPSILON
-	hash += ~( * ( ( unsigned int * ) &xyz[ 0 ] ) << 15 );
-	hash ^= ( * ( ( unsigned int * ) &xyz[ 0 ] ) >> 10 );
-	hash += ( * ( ( unsigned int * ) &xyz[ 1 ] ) << 3 );
-	hash ^= ( * ( ( unsigned int * ) &xyz[ 1 ] ) >> 6 );
-	hash += ~( * ( ( unsigned int * ) &xyz[ 2 ] ) << 11 );
-	hash ^= ( * ( ( unsigned int * ) &xyz[ 2 ] ) >> 16 );
-#else
-	vec3_t xyz_epsilonspace;
+/*
+=================
+R_EncodeCubeProbeIntensity
 
-	VectorScale( xyz, HASH_XYZ_EPSILONSPACE_MULTIPLIER, xyz_epsilonspace );
-	xyz_epsilonspace[ 0 ] = floor( xyz_epsilonspace[ 0 ] );
-	xyz_epsilonspace[ 1 ] = floor( xyz_epsilonspace[ 1 ] );
-	xyz_epsilonspace[ 2 ] = floor( xyz_epsilonspace[ 2 ] );
+Encode the pixel intensity into the alpha channel, saves work in the shader
+=================
+*/
+static void R_EncodeCubeProbeIntensity( byte *faces )
+{
+	byte r, g, b, best;
 
-	hash += ~( * ( ( unsigned int * ) &xyz_epsilonspace[ 0 ] ) << 15 );
-	hash ^= ( * ( ( unsigned int * ) &xyz_epsilonspace[ 0 ] ) >> 10 );
-	hash += ( * ( ( unsigned int * ) &xyz_epsilonspace[ 1 ] ) << 3 );
-	hash ^= ( * ( ( unsigned int * ) &xyz_epsilonspace[ 1 ] ) >> 6 );
-	hash += ~( * ( ( unsigned int * ) &xyz_epsilonspace[ 2 ] ) << 11 );
-	hash ^= ( * ( ( unsigned int * ) &xyz_epsilonspace[ 2 ] ) >> 16 );
+	for ( int i = 0; i < CUBEMAP_PROBE_SIZE; i += 4 )
+	{
+		r = faces[ i + 0 ];
+		g = faces[ i + 1 ];
+		b = faces[ i + 2 ];
 
-#endif
+		if ( ( r > g ) && ( r > b ) )
+		{
+			best = r;
+		}
+		else if ( ( g > r ) && ( g > b ) )
+		{
+			best = g;
+		}
+		else
+		{
+			best = b;
+		}
 
-	hash = hash % ( HASHTABLE_SIZE );
-	return hash;
+		faces[ i + 3 ] = best;
+	}
 }
 
-vertexHash_t **NewVertexHashTable()
+/*
+=================
+R_ClearCubeProbes
+
+Forgets the probes of a previous bake, and gives back their cubemaps to
+be uploaded again instead of allocating new images
+=================
+*/
+static std::vector<image_t *> R_ClearCubeProbes()
 {
-	vertexHash_t **hashTable = (vertexHash_t**) malloc( HASHTABLE_SIZE * sizeof( vertexHash_t * ) );
+	std::vector<image_t *> images;
 
-	memset( hashTable, 0, HASHTABLE_SIZE * sizeof( vertexHash_t * ) );
+	for ( int i = 0; i < tr.cubeProbes.currentElements; i++ )
+	{
+		const cubemapProbe_t *cubeProbe = (cubemapProbe_t*) Com_GrowListElement( &tr.cubeProbes, i );
 
-	return hashTable;
+		if ( cubeProbe->cubemap )
+		{
+			images.push_back( cubeProbe->cubemap );
+		}
+	}
+
+	Com_DestroyGrowList( &tr.cubeProbes );
+	FreeVertexHashTable( tr.cubeHashTable );
+	tr.cubeHashTable = nullptr;
+	s_cubeProbeTree.clear();
+
+	return images;
 }
 
-void FreeVertexHashTable( vertexHash_t **hashTable )
+static bool R_CreateCubeProbeImage( cubemapProbe_t *cubeProbe, int num, const byte *faces, const std::vector<image_t *> &images )
 {
-	int          i;
-	vertexHash_t *vertexHash;
-	vertexHash_t *nextVertexHash;
+	const byte *pics[ 6 ];
 
-	if ( hashTable == nullptr )
+	if ( num < static_cast<int>( images.size() ) )
 	{
-		return;
+		cubeProbe->cubemap = images[ num ];
+	}
+	else
+	{
+		cubeProbe->cubemap = R_AllocImage( va( "_autoCube%d", num ), false );
 	}
 
-	for ( i = 0; i < HASHTABLE_SIZE; i++ )
+	if ( !cubeProbe->cubemap )
+	{
+		return false;
+	}
+
+	cubeProbe->cubemap->type = GL_TEXTURE_CUBE_MAP;
+
+	cubeProbe->cubemap->width = REF_CUBEMAP_SIZE;
+	cubeProbe->cubemap->height = REF_CUBEMAP_SIZE;
+
+	cubeProbe->cubemap->bits = IF_NOPICMIP;
+	cubeProbe->cubemap->filterType = filterType_t::FT_LINEAR;
+	cubeProbe->cubemap->wrapType = wrapTypeEnum_t::WT_EDGE_CLAMP;
+
+	for ( int i = 0; i < 6; i++ )
 	{
-		if ( hashTable[ i ] )
-		{
-			nextVertexHash = nullptr;
+		pics[ i ] = faces + i * CUBEMAP_FACE_SIZE;
+	}
 
-			for ( vertexHash = hashTable[ i ]; vertexHash; vertexHash = nextVertexHash )
-			{
-				nextVertexHash = vertexHash->next;
+	imageParams_t imageParams = {};
 
-				free( vertexHash );
-			}
-		}
-	}
+	R_UploadImage( pics, 6, 1, cubeProbe->cubemap, imageParams );
 
-	free( hashTable );
+	return true;
 }
 
-vertexHash_t *FindVertexInHashTable( vertexHash_t **hashTable, const vec3_t xyz, float distance )
+/*
+=================
+R_LoadCubeProbes
+
+Loads the probes baked by a previous R_BuildCubeMaps on the same map, they
+are decompressed on the job threads
+=================
+*/
+static bool R_LoadCubeProbes( const std::string &key )
 {
-	unsigned int hash;
-	vertexHash_t *vertexHash;
+	std::string data;
 
-	if ( hashTable == nullptr || xyz == nullptr )
+	if ( !R_ReadCacheFile( CUBEMAP_CACHE_DIR, key, CUBEMAP_CACHE_VERSION, data ) )
 	{
-		return nullptr;
+		return false;
 	}
 
-	hash = VertexCoordGenerateHash( xyz );
+	cacheReader_t        reader( data );
+	cubemapCacheHeader_t header;
 
-	for ( vertexHash = hashTable[ hash ]; vertexHash; vertexHash = vertexHash->next )
+	if ( !reader.Read( header ) || header.size != REF_CUBEMAP_SIZE || !header.numProbes )
 	{
-#ifndef HASH_USE_EPSILON
+		return false;
+	}
 
-		if ( ( vertexHash->vcd.xyz[ 0 ] != xyz[ 0 ] || vertexHash->vcd.xyz[ 1 ] != xyz[ 1 ] ||
-		       vertexHash->vcd.xyz[ 2 ] != xyz[ 2 ] ) )
+	std::vector<cubemapCacheProbe_t> probes( header.numProbes );
+	std::vector<size_t> offsets( header.numProbes );
+
+	for ( uint32_t i = 0; i < header.numProbes; i++ )
+	{
+		if ( !reader.Read( probes[ i ] ) || reader.Left() < probes[ i ].compressedSize )
 		{
-			continue;
+			return false;
 		}
 
-#elif 1
+		offsets[ i ] = reader.offset;
+		reader.offset += probes[ i ].compressedSize;
+	}
 
-		if ( Distance( xyz, vertexHash->xyz ) > distance )
-		{
-			continue;
-		}
+	if ( !reader.Done() )
+	{
+		return false;
+	}
 
-#else
+	std::vector<byte> faces( CUBEMAP_PROBE_BATCH * CUBEMAP_PROBE_SIZE );
 
-		if ( ( fabsf( xyz[ 0 ] - vertexHash->vcd.xyz[ 0 ] ) ) > HASH_XYZ_EPSILON ||
-		     ( fabsf( xyz[ 1 ] - vertexHash->vcd.xyz[ 1 ] ) ) > HASH_XYZ_EPSILON ||
-		     ( fabsf( xyz[ 2 ] - vertexHash->vcd.xyz[ 2 ] ) ) > HASH_XYZ_EPSILON )
-		{
-			continue;
-		}
+	auto decompressBatch = [ & ]( uint32_t first, int count ) {
+		std::atomic<bool> corrupted( false );
 
-#endif
-		return vertexHash;
-	}
+		R_RunJobs( count, [ & ]( int job ) {
+			uLongf outSize = CUBEMAP_PROBE_SIZE;
+			const Bytef *compressed = reinterpret_cast<const Bytef *>( data.data() + offsets[ first + job ] );
 
-	return nullptr;
-}
+			if ( uncompress( &faces[ job * CUBEMAP_PROBE_SIZE ], &outSize, compressed, probes[ first + job ].compressedSize ) != Z_OK
+			     || outSize != CUBEMAP_PROBE_SIZE )
+			{
+				corrupted = true;
+			}
+		} );
 
-vertexHash_t *AddVertexToHashTable( vertexHash_t **hashTable, vec3_t xyz, void *data )
-{
-	unsigned int hash;
-	vertexHash_t *vertexHash;
+		return !corrupted;
+	};
 
-	if ( hashTable == nullptr || xyz == nullptr )
+	// all the probes are checked before anything is created, so that a
+	// corrupted cache is baked again from a clean state, they are only
+	// kept in memory a batch at a time
+	for ( uint32_t first = 0; first < header.numProbes; first += CUBEMAP_PROBE_BATCH )
 	{
-		return nullptr;
+		if ( !decompressBatch( first, std::min<uint32_t>( CUBEMAP_PROBE_BATCH, header.numProbes - first ) ) )
+		{
+			Log::Warn( "cubemap probes cache of %s is corrupted", s_worldData.name );
+			return false;
+		}
 	}
 
-	vertexHash = (vertexHash_t*) malloc( sizeof( vertexHash_t ) );
+	std::vector<image_t *> images = R_ClearCubeProbes();
 
-	if ( !vertexHash )
+	Com_InitGrowList( &tr.cubeProbes, header.numProbes );
+	tr.cubeHashTable = NewVertexHashTable();
+
+	for ( uint32_t first = 0; first < header.numProbes; first += CUBEMAP_PROBE_BATCH )
 	{
-		return nullptr;
-	}
+		int count = std::min<uint32_t>( CUBEMAP_PROBE_BATCH, header.numProbes - first );
 
-	hash = VertexCoordGenerateHash( xyz );
+		decompressBatch( first, count );
 
-	VectorCopy( xyz, vertexHash->xyz );
-	vertexHash->data = data;
+		for ( int i = 0; i < count; i++ )
+		{
+			cubemapProbe_t *cubeProbe = (cubemapProbe_t*) ri.Hunk_Alloc( sizeof( *cubeProbe ), ha_pref::h_high );
+			Com_AddToGrowList( &tr.cubeProbes, cubeProbe );
 
-	// link into table
-	vertexHash->next = hashTable[ hash ];
-	hashTable[ hash ] = vertexHash;
+			VectorCopy( probes[ first + i ].origin, cubeProbe->origin );
+			AddVertexToHashTable( tr.cubeHashTable, cubeProbe->origin, cubeProbe );
 
-	return vertexHash;
+			if ( !R_CreateCubeProbeImage( cubeProbe, first + i, &faces[ i * CUBEMAP_PROBE_SIZE ], images ) )
+			{
+				R_BuildCubeProbeTree();
+				return true;
+			}
+		}
+	}
+
+	R_BuildCubeProbeTree();
+
+	return true;
 }
 
-void GL_BindNearestCubeMap( const vec3_t xyz )
+/*
+=================
+R_FinishCubeProbes
+
+Encodes, uploads and compresses for the cache the probes of a batch, the
+CPU work runs on the job threads
+=================
+*/
+static bool R_FinishCubeProbes( int first, int count, byte *faces, std::vector<std::string> &compressed, const std::vector<image_t *> &images )
 {
-	float          distance, maxDistance;
-	cubemapProbe_t *cubeProbe;
-	unsigned int   hash;
-	vertexHash_t   *vertexHash;
+	bool cache = !compressed.empty();
 
-	tr.autoCubeImage = tr.whiteCubeImage;
+	R_RunJobs( count, [ & ]( int job ) {
+		byte *probeFaces = faces + job * CUBEMAP_PROBE_SIZE;
 
-	if ( !r_reflectionMapping->integer )
-	{
-		return;
-	}
+		R_EncodeCubeProbeIntensity( probeFaces );
 
-	if ( tr.cubeHashTable == nullptr || xyz == nullptr )
-	{
-		return;
-	}
+		if ( !cache )
+		{
+			return;
+		}
 
-	maxDistance = 9999999.0f;
+		// decompressing has to be much faster than rendering the probe
+		uLongf compressedSize = compressBound( CUBEMAP_PROBE_SIZE );
+		std::string &out = compressed[ first + job ];
 
-	hash = VertexCoordGenerateHash( xyz );
+		out.resize( compressedSize );
 
-	for ( vertexHash = tr.cubeHashTable[ hash ]; vertexHash; vertexHash = vertexHash->next )
-	{
-		cubeProbe = (cubemapProbe_t*) vertexHash->data;
+		if ( compress2( reinterpret_cast<Bytef *>( &out[ 0 ] ), &compressedSize, probeFaces, CUBEMAP_PROBE_SIZE, Z_BEST_SPEED ) != Z_OK )
+		{
+			compressedSize = 0;
+		}
 
-		distance = Distance( cubeProbe->origin, xyz );
+		out.resize( compressedSize );
+	} );
+
+	for ( int i = 0; i < count; i++ )
+	{
+		cubemapProbe_t *cubeProbe = (cubemapProbe_t*) Com_GrowListElement( &tr.cubeProbes, first + i );
 
-		if ( distance < maxDistance )
+		if ( !R_CreateCubeProbeImage( cubeProbe, first + i, faces + i * CUBEMAP_PROBE_SIZE, images ) )
 		{
-			tr.autoCubeImage = cubeProbe->cubemap;
-			maxDistance = distance;
+			return false;
 		}
 	}
 
-	GL_Bind( tr.autoCubeImage );
+	return true;
 }
 
-void R_FindTwoNearestCubeMaps( const vec3_t position, cubemapProbe_t **cubeProbeNearest, cubemapProbe_t **cubeProbeSecondNearest )
+static void R_SaveCubeProbes( const std::string &key, const std::vector<std::string> &compressed )
 {
-	int            j;
-	float          distance, maxDistance, maxDistance2;
-	cubemapProbe_t *cubeProbe;
-	unsigned int   hash;
-	vertexHash_t   *vertexHash;
+	if ( key.empty() )
+	{
+		return;
+	}
 
-	GLimp_LogComment( "--- R_FindTwoNearestCubeMaps ---\n" );
+	cubemapCacheHeader_t header{};
 
-	*cubeProbeNearest = nullptr;
-	*cubeProbeSecondNearest = nullptr;
+	header.numProbes = tr.cubeProbes.currentElements;
+	header.size = REF_CUBEMAP_SIZE;
 
-	if ( tr.cubeHashTable == nullptr || position == nullptr )
+	std::string data( reinterpret_cast<const char *>( &header ), sizeof( header ) );
+
+	for ( int i = 0; i < tr.cubeProbes.currentElements; i++ )
 	{
-		return;
+		const cubemapProbe_t *cubeProbe = (cubemapProbe_t*) Com_GrowListElement( &tr.cubeProbes, i );
+		cubemapCacheProbe_t probe;
+
+		if ( compressed[ i ].empty() )
+		{
+			return;
+		}
+
+		VectorCopy( cubeProbe->origin, probe.origin );
+		probe.compressedSize = compressed[ i ].size();
+
+		data.append( reinterpret_cast<const char *>( &probe ), sizeof( probe ) );
+		data += compressed[ i ];
 	}
 
-	hash = VertexCoordGenerateHash( position );
-	maxDistance = maxDistance2 = 9999999.0f;
+	// the probes are compressed on their own to be decompressed on the job threads
+	R_WriteCacheFile( CUBEMAP_CACHE_DIR, key, CUBEMAP_CACHE_VERSION, data, false );
+}
+
+/*
+=================
+R_ReadCubeProbeFaces
 
-	for ( j = 0, vertexHash = tr.cubeHashTable[ hash ]; vertexHash; vertexHash = vertexHash->next, j++ )
+Copies the faces of a probe rendered earlier from the readback PBOs
+=================
+*/
+static void R_ReadCubeProbeFaces( const GLuint *pbos, byte *faces )
+{
+	for ( int i = 0; i < 6; i++ )
 	{
-		cubeProbe = (cubemapProbe_t*) vertexHash->data;
-		distance = Distance( cubeProbe->origin, position );
+		glBindBuffer( GL_PIXEL_PACK_BUFFER, pbos[ i ] );
 
-		if ( distance < maxDistance )
-		{
-			*cubeProbeSecondNearest = *cubeProbeNearest;
-			maxDistance2 = maxDistance;
+		void *pixels = glMapBufferRange( GL_PIXEL_PACK_BUFFER, 0, CUBEMAP_FACE_SIZE, GL_MAP_READ_BIT );
 
-			*cubeProbeNearest = cubeProbe;
-			maxDistance = distance;
-		}
-		else if ( distance < maxDistance2 && distance > maxDistance )
+		if ( pixels )
 		{
-			*cubeProbeSecondNearest = cubeProbe;
-			maxDistance2 = distance;
+			memcpy( faces + i * CUBEMAP_FACE_SIZE, pixels, CUBEMAP_FACE_SIZE );
+			glUnmapBuffer( GL_PIXEL_PACK_BUFFER );
 		}
 	}
+
+	glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
 }
 
+/*
+=================
+R_BuildCubeMaps
+
+The faces are read back through PBOs CUBEMAP_READBACK_DEPTH probes behind
+the rendering, so that the GPU does not have to be waited for. The baked
+probes are kept in the homepath and loaded with the map, this always bakes
+them again.
+=================
+*/
 void R_BuildCubeMaps()
 {
 	int            i, j;
 	int            ii, jj;
 	refdef_t       rf;
-	bool       flipx;
-	bool       flipy;
-	int            x, y, xy, xy2;
 
 	cubemapProbe_t *cubeProbe;
-	byte           temp[ REF_CUBEMAP_SIZE * REF_CUBEMAP_SIZE * 4 ];
-	byte           *dest;
 
 	int    startTime, endTime;
 	size_t tics = 0;
@@ -6406,12 +6809,11 @@ void R_BuildCubeMaps()
 
 	startTime = ri.Milliseconds();
 
-	memset( &rf, 0, sizeof( refdef_t ) );
+	// the probes loaded with the map are replaced, and the cache overwritten
+	std::string key = R_CubeProbeCacheKey();
+	std::vector<image_t *> images = R_ClearCubeProbes();
 
-	for ( i = 0; i < 6; i++ )
-	{
-		tr.cubeTemp[ i ] = (byte*) ri.Z_Malloc( REF_CUBEMAP_SIZE * REF_CUBEMAP_SIZE * 4 );
-	}
+	memset( &rf, 0, sizeof( refdef_t ) );
 
 	// calculate origins for our probes
 	Com_InitGrowList( &tr.cubeProbes, 4000 );
@@ -6461,269 +6863,228 @@ void R_BuildCubeMaps()
 		VectorClear( cubeProbe->origin );
 	}
 
-	Log::Notice("...pre-rendering %d cubemaps", tr.cubeProbes.currentElements );
-	Log::Notice("0%%  10   20   30   40   50   60   70   80   90   100%%" );
-	Log::Notice("|----|----|----|----|----|----|----|----|----|----|" );
-
-	for ( j = 0; j < tr.cubeProbes.currentElements; j++ )
-	{
-		cubeProbe = (cubemapProbe_t*) Com_GrowListElement( &tr.cubeProbes, j );
-
-		//Log::Notice("rendering cubemap at (%i %i %i)", (int)cubeProbe->origin[0], (int)cubeProbe->origin[1],
-		//      (int)cubeProbe->origin[2]);
+	R_BuildCubeProbeTree();
 
-		if ( ( j + 1 ) >= nextTicCount )
-		{
-			size_t ticsNeeded = ( size_t )( ( ( double )( j + 1 ) / tr.cubeProbes.currentElements ) * 50.0 );
+	int numProbes = tr.cubeProbes.currentElements;
 
-			do
-			{
-				Log::Notice("*");
-				Cmd::ExecuteCommand("updatescreen");
-			}
-			while ( ++tics < ticsNeeded );
+	std::vector<byte> faces( CUBEMAP_PROBE_BATCH * CUBEMAP_PROBE_SIZE, 255 );
+	std::vector<std::string> compressed( key.empty() ? 0 : numProbes );
 
-			nextTicCount = ( size_t )( ( tics / 50.0 ) * tr.cubeProbes.currentElements );
+	// without PBOs the faces are read back right after being rendered
+	GLuint pbos[ CUBEMAP_READBACK_DEPTH ][ 6 ] = {};
+	bool   usePBOs = glConfig2.mapBufferRangeAvailable;
 
-			if ( ( j + 1 ) == tr.cubeProbes.currentElements )
-			{
-				if ( tics < 51 )
-				{
-					Log::Notice("*");
-				}
+	if ( usePBOs )
+	{
+		glGenBuffers( CUBEMAP_READBACK_DEPTH * 6, &pbos[ 0 ][ 0 ] );
 
-				Log::Notice("");
-			}
+		for ( i = 0; i < CUBEMAP_READBACK_DEPTH * 6; i++ )
+		{
+			glBindBuffer( GL_PIXEL_PACK_BUFFER, pbos[ 0 ][ i ] );
+			glBufferData( GL_PIXEL_PACK_BUFFER, CUBEMAP_FACE_SIZE, nullptr, GL_STREAM_READ );
 		}
 
-		VectorCopy( cubeProbe->origin, rf.vieworg );
+		glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+	}
 
-		AxisClear( rf.viewaxis );
+	int latency = usePBOs ? CUBEMAP_READBACK_DEPTH - 1 : 0;
+	bool ok = true;
 
-		rf.fov_x = 90;
-		rf.fov_y = 90;
-		rf.x = 0;
-		rf.y = 0;
-		rf.width = REF_CUBEMAP_SIZE;
-		rf.height = REF_CUBEMAP_SIZE;
-		rf.time = 0;
+	Log::Notice("...pre-rendering %d cubemaps", numProbes );
+	Log::Notice("0%%  10   20   30   40   50   60   70   80   90   100%%" );
+	Log::Notice("|----|----|----|----|----|----|----|----|----|----|" );
 
-		rf.rdflags = RDF_NOCUBEMAP | RDF_NOBLOOM;
+	// probe j is rendered while probe j - latency is read back
+	for ( j = 0; j < numProbes + latency && ok; j++ )
+	{
+		int readback = j - latency;
 
-		for ( i = 0; i < 6; i++ )
+		if ( j < numProbes )
 		{
-			flipx = false;
-			flipy = false;
+			cubeProbe = (cubemapProbe_t*) Com_GrowListElement( &tr.cubeProbes, j );
 
-			switch ( i )
+			if ( ( j + 1 ) >= nextTicCount )
 			{
-				case 0:
-					{
-						//X+
-						rf.viewaxis[ 0 ][ 0 ] = 1;
-						rf.viewaxis[ 0 ][ 1 ] = 0;
-						rf.viewaxis[ 0 ][ 2 ] = 0;
+				size_t ticsNeeded = ( size_t )( ( ( double )( j + 1 ) / numProbes ) * 50.0 );
 
-						rf.viewaxis[ 1 ][ 0 ] = 0;
-						rf.viewaxis[ 1 ][ 1 ] = 0;
-						rf.viewaxis[ 1 ][ 2 ] = 1;
+				do
+				{
+					Log::Notice("*");
+					Cmd::ExecuteCommand("updatescreen");
+				}
+				while ( ++tics < ticsNeeded );
 
-						CrossProduct( rf.viewaxis[ 0 ], rf.viewaxis[ 1 ], rf.viewaxis[ 2 ] );
-						//flipx=true;
-						break;
-					}
+				nextTicCount = ( size_t )( ( tics / 50.0 ) * numProbes );
 
-				case 1:
+				if ( ( j + 1 ) == numProbes )
+				{
+					if ( tics < 51 )
 					{
-						//X-
-						rf.viewaxis[ 0 ][ 0 ] = -1;
-						rf.viewaxis[ 0 ][ 1 ] = 0;
-						rf.viewaxis[ 0 ][ 2 ] = 0;
-
-						rf.viewaxis[ 1 ][ 0 ] = 0;
-						rf.viewaxis[ 1 ][ 1 ] = 0;
-						rf.viewaxis[ 1 ][ 2 ] = -1;
-
-						CrossProduct( rf.viewaxis[ 0 ], rf.viewaxis[ 1 ], rf.viewaxis[ 2 ] );
-						//flipx=true;
-						break;
+						Log::Notice("*");
 					}
 
-				case 2:
-					{
-						//Y+
-						rf.viewaxis[ 0 ][ 0 ] = 0;
-						rf.viewaxis[ 0 ][ 1 ] = 1;
-						rf.viewaxis[ 0 ][ 2 ] = 0;
-
-						rf.viewaxis[ 1 ][ 0 ] = -1;
-						rf.viewaxis[ 1 ][ 1 ] = 0;
-						rf.viewaxis[ 1 ][ 2 ] = 0;
+					Log::Notice("");
+				}
+			}
 
-						CrossProduct( rf.viewaxis[ 0 ], rf.viewaxis[ 1 ], rf.viewaxis[ 2 ] );
-						//flipx=true;
-						break;
-					}
+			VectorCopy( cubeProbe->origin, rf.vieworg );
 
-				case 3:
-					{
-						//Y-
-						rf.viewaxis[ 0 ][ 0 ] = 0;
-						rf.viewaxis[ 0 ][ 1 ] = -1;
-						rf.viewaxis[ 0 ][ 2 ] = 0;
+			AxisClear( rf.viewaxis );
 
-						rf.viewaxis[ 1 ][ 0 ] = -1; //-1
-						rf.viewaxis[ 1 ][ 1 ] = 0;
-						rf.viewaxis[ 1 ][ 2 ] = 0;
+			rf.fov_x = 90;
+			rf.fov_y = 90;
+			rf.x = 0;
+			rf.y = 0;
+			rf.width = REF_CUBEMAP_SIZE;
+			rf.height = REF_CUBEMAP_SIZE;
+			rf.time = 0;
 
-						CrossProduct( rf.viewaxis[ 0 ], rf.viewaxis[ 1 ], rf.viewaxis[ 2 ] );
-						//flipx=true;
-						break;
-					}
+			rf.rdflags = RDF_NOCUBEMAP | RDF_NOBLOOM;
 
-				case 4:
-					{
-						//Z+
-						rf.viewaxis[ 0 ][ 0 ] = 0;
-						rf.viewaxis[ 0 ][ 1 ] = 0;
-						rf.viewaxis[ 0 ][ 2 ] = 1;
+			for ( i = 0; i < 6; i++ )
+			{
+				switch ( i )
+				{
+					case 0:
+						{
+							//X+
+							rf.viewaxis[ 0 ][ 0 ] = 1;
+							rf.viewaxis[ 0 ][ 1 ] = 0;
+							rf.viewaxis[ 0 ][ 2 ] = 0;
 
-						rf.viewaxis[ 1 ][ 0 ] = -1;
-						rf.viewaxis[ 1 ][ 1 ] = 0;
-						rf.viewaxis[ 1 ][ 2 ] = 0;
+							rf.viewaxis[ 1 ][ 0 ] = 0;
+							rf.viewaxis[ 1 ][ 1 ] = 0;
+							rf.viewaxis[ 1 ][ 2 ] = 1;
 
-						CrossProduct( rf.viewaxis[ 0 ], rf.viewaxis[ 1 ], rf.viewaxis[ 2 ] );
-						//  flipx=true;
-						break;
-					}
+							CrossProduct( rf.viewaxis[ 0 ], rf.viewaxis[ 1 ], rf.viewaxis[ 2 ] );
+							break;
+						}
 
-				case 5:
-					{
-						//Z-
-						rf.viewaxis[ 0 ][ 0 ] = 0;
-						rf.viewaxis[ 0 ][ 1 ] = 0;
-						rf.viewaxis[ 0 ][ 2 ] = -1;
+					case 1:
+						{
+							//X-
+							rf.viewaxis[ 0 ][ 0 ] = -1;
+							rf.viewaxis[ 0 ][ 1 ] = 0;
+							rf.viewaxis[ 0 ][ 2 ] = 0;
 
-						rf.viewaxis[ 1 ][ 0 ] = 1;
-						rf.viewaxis[ 1 ][ 1 ] = 0;
-						rf.viewaxis[ 1 ][ 2 ] = 0;
+							rf.viewaxis[ 1 ][ 0 ] = 0;
+							rf.viewaxis[ 1 ][ 1 ] = 0;
+							rf.viewaxis[ 1 ][ 2 ] = -1;
 
-						CrossProduct( rf.viewaxis[ 0 ], rf.viewaxis[ 1 ], rf.viewaxis[ 2 ] );
-						//flipx=true;
-						break;
-					}
-			}
+							CrossProduct( rf.viewaxis[ 0 ], rf.viewaxis[ 1 ], rf.viewaxis[ 2 ] );
+							break;
+						}
 
-			tr.refdef.pixelTarget = tr.cubeTemp[ i ];
-			memset( tr.cubeTemp[ i ], 255, REF_CUBEMAP_SIZE * REF_CUBEMAP_SIZE * 4 );
-			tr.refdef.pixelTargetWidth = REF_CUBEMAP_SIZE;
-			tr.refdef.pixelTargetHeight = REF_CUBEMAP_SIZE;
+					case 2:
+						{
+							//Y+
+							rf.viewaxis[ 0 ][ 0 ] = 0;
+							rf.viewaxis[ 0 ][ 1 ] = 1;
+							rf.viewaxis[ 0 ][ 2 ] = 0;
 
-			RE_BeginFrame();
-			RE_RenderScene( &rf );
-			RE_EndFrame( &ii, &jj );
+							rf.viewaxis[ 1 ][ 0 ] = -1;
+							rf.viewaxis[ 1 ][ 1 ] = 0;
+							rf.viewaxis[ 1 ][ 2 ] = 0;
 
-			if ( flipx )
-			{
-				dest = tr.cubeTemp[ i ];
-				memcpy( temp, dest, REF_CUBEMAP_SIZE * REF_CUBEMAP_SIZE * 4 );
+							CrossProduct( rf.viewaxis[ 0 ], rf.viewaxis[ 1 ], rf.viewaxis[ 2 ] );
+							break;
+						}
 
-				for ( y = 0; y < REF_CUBEMAP_SIZE; y++ )
-				{
-					for ( x = 0; x < REF_CUBEMAP_SIZE; x++ )
-					{
-						xy = ( ( y * REF_CUBEMAP_SIZE ) + x ) * 4;
-						xy2 = ( ( y * REF_CUBEMAP_SIZE ) + ( ( REF_CUBEMAP_SIZE - 1 ) - x ) ) * 4;
-						dest[ xy2 + 0 ] = temp[ xy + 0 ];
-						dest[ xy2 + 1 ] = temp[ xy + 1 ];
-						dest[ xy2 + 2 ] = temp[ xy + 2 ];
-						dest[ xy2 + 3 ] = temp[ xy + 3 ];
-					}
-				}
-			}
+					case 3:
+						{
+							//Y-
+							rf.viewaxis[ 0 ][ 0 ] = 0;
+							rf.viewaxis[ 0 ][ 1 ] = -1;
+							rf.viewaxis[ 0 ][ 2 ] = 0;
 
-			if ( flipy )
-			{
-				dest = tr.cubeTemp[ i ];
-				memcpy( temp, dest, REF_CUBEMAP_SIZE * REF_CUBEMAP_SIZE * 4 );
+							rf.viewaxis[ 1 ][ 0 ] = -1; //-1
+							rf.viewaxis[ 1 ][ 1 ] = 0;
+							rf.viewaxis[ 1 ][ 2 ] = 0;
 
-				for ( y = 0; y < REF_CUBEMAP_SIZE; y++ )
-				{
-					for ( x = 0; x < REF_CUBEMAP_SIZE; x++ )
-					{
-						xy = ( ( y * REF_CUBEMAP_SIZE ) + x ) * 4;
-						xy2 = ( ( ( ( REF_CUBEMAP_SIZE - 1 ) - y ) * REF_CUBEMAP_SIZE ) + x ) * 4;
-						dest[ xy2 + 0 ] = temp[ xy + 0 ];
-						dest[ xy2 + 1 ] = temp[ xy + 1 ];
-						dest[ xy2 + 2 ] = temp[ xy + 2 ];
-						dest[ xy2 + 3 ] = temp[ xy + 3 ];
-					}
-				}
-			}
+							CrossProduct( rf.viewaxis[ 0 ], rf.viewaxis[ 1 ], rf.viewaxis[ 2 ] );
+							break;
+						}
 
-			// encode the pixel intensity into the alpha channel, saves work in the shader
-			byte r, g, b, best;
+					case 4:
+						{
+							//Z+
+							rf.viewaxis[ 0 ][ 0 ] = 0;
+							rf.viewaxis[ 0 ][ 1 ] = 0;
+							rf.viewaxis[ 0 ][ 2 ] = 1;
 
-			dest = tr.cubeTemp[ i ];
+							rf.viewaxis[ 1 ][ 0 ] = -1;
+							rf.viewaxis[ 1 ][ 1 ] = 0;
+							rf.viewaxis[ 1 ][ 2 ] = 0;
 
-			for ( y = 0; y < REF_CUBEMAP_SIZE; y++ )
-			{
-				for ( x = 0; x < REF_CUBEMAP_SIZE; x++ )
-				{
-					xy = ( ( y * REF_CUBEMAP_SIZE ) + x ) * 4;
+							CrossProduct( rf.viewaxis[ 0 ], rf.viewaxis[ 1 ], rf.viewaxis[ 2 ] );
+							break;
+						}
 
-					r = dest[ xy + 0 ];
-					g = dest[ xy + 1 ];
-					b = dest[ xy + 2 ];
+					case 5:
+						{
+							//Z-
+							rf.viewaxis[ 0 ][ 0 ] = 0;
+							rf.viewaxis[ 0 ][ 1 ] = 0;
+							rf.viewaxis[ 0 ][ 2 ] = -1;
 
-					if ( ( r > g ) && ( r > b ) )
-					{
-						best = r;
-					}
-					else if ( ( g > r ) && ( g > b ) )
-					{
-						best = g;
-					}
-					else
-					{
-						best = b;
-					}
+							rf.viewaxis[ 1 ][ 0 ] = 1;
+							rf.viewaxis[ 1 ][ 1 ] = 0;
+							rf.viewaxis[ 1 ][ 2 ] = 0;
 
-					dest[ xy + 3 ] = best;
+							CrossProduct( rf.viewaxis[ 0 ], rf.viewaxis[ 1 ], rf.viewaxis[ 2 ] );
+							break;
+						}
 				}
+
+				tr.refdef.pixelTarget = &faces[ ( j % CUBEMAP_PROBE_BATCH ) * CUBEMAP_PROBE_SIZE + i * CUBEMAP_FACE_SIZE ];
+				tr.refdef.pixelTargetPBO = pbos[ j % CUBEMAP_READBACK_DEPTH ][ i ];
+				tr.refdef.pixelTargetWidth = REF_CUBEMAP_SIZE;
+				tr.refdef.pixelTargetHeight = REF_CUBEMAP_SIZE;
+
+				RE_BeginFrame();
+				RE_RenderScene( &rf );
+				RE_EndFrame( &ii, &jj );
 			}
 		}
 
-		// build the cubemap
-		cubeProbe->cubemap = R_AllocImage( va( "_autoCube%d", j ), false );
-
-		if ( !cubeProbe->cubemap )
+		if ( readback < 0 )
 		{
-			return;
+			continue;
 		}
 
-		cubeProbe->cubemap->type = GL_TEXTURE_CUBE_MAP;
-
-		cubeProbe->cubemap->width = REF_CUBEMAP_SIZE;
-		cubeProbe->cubemap->height = REF_CUBEMAP_SIZE;
+		if ( usePBOs )
+		{
+			R_ReadCubeProbeFaces( pbos[ readback % CUBEMAP_READBACK_DEPTH ], &faces[ ( readback % CUBEMAP_PROBE_BATCH ) * CUBEMAP_PROBE_SIZE ] );
+		}
 
-		cubeProbe->cubemap->bits = IF_NOPICMIP;
-		cubeProbe->cubemap->filterType = filterType_t::FT_LINEAR;
-		cubeProbe->cubemap->wrapType = wrapTypeEnum_t::WT_EDGE_CLAMP;
+		// the probes are finished a batch at a time
+		if ( ( readback + 1 ) % CUBEMAP_PROBE_BATCH == 0 || readback + 1 == numProbes )
+		{
+			int first = readback - readback % CUBEMAP_PROBE_BATCH;
 
-		imageParams_t imageParams = {};
+			ok = R_FinishCubeProbes( first, readback + 1 - first, faces.data(), compressed, images );
+		}
+	}
 
-		R_UploadImage( ( const byte ** ) tr.cubeTemp, 6, 1, cubeProbe->cubemap, imageParams );
+	if ( usePBOs )
+	{
+		glDeleteBuffers( CUBEMAP_READBACK_DEPTH * 6, &pbos[ 0 ][ 0 ] );
 	}
 
 	Log::Notice("");
 
 	// turn pixel targets off
 	tr.refdef.pixelTarget = nullptr;
+	tr.refdef.pixelTargetPBO = 0;
+
+	if ( ok )
+	{
+		R_SaveCubeProbes( key, compressed );
+	}
 
 	// assign the surfs a cubemap
 	endTime = ri.Milliseconds();
-	Log::Notice("cubemap probes pre-rendering time of %i cubes = %5.2f seconds", tr.cubeProbes.currentElements,
+	Log::Notice("cubemap probes pre-rendering time of %i cubes = %5.2f seconds", numProbes,
 	           ( endTime - startTime ) / 1000.0 );
 }
 
@@ -6771,6 +7132,8 @@ void RE_LoadWorldMap( const char *name )
 		Sys::Drop( "RE_LoadWorldMap: %s not found", name );
 	}
 
+	s_worldChecksum = Com_BlockChecksum( buffer.data(), buffer.size() );
+
 	// clear tr.world so if the level fails to load, the next
 	// try will not look at the partially loaded version
 	tr.world = nullptr;
@@ -6828,6 +7191,10 @@ void RE_LoadWorldMap( const char *name )
 
 	R_LoadVisibility( &header->lumps[ LUMP_VISIBILITY ] );
 
+	R_CreateClusterLeafLists();
+
+	R_CreateOccluders();
+
 	R_LoadLightGrid( &header->lumps[ LUMP_LIGHTGRID ] );
 
 	// create a static vbo for the world
@@ -6846,6 +7213,12 @@ void RE_LoadWorldMap( const char *name )
 	// build cubemaps after the necessary vbo stuff is done
 	//R_BuildCubeMaps();
 
+	// but load them if they were built before for this map
+	if ( r_reflectionMapping->integer )
+	{
+		R_LoadCubeProbes( R_CubeProbeCacheKey() );
+	}
+
 	tr.worldLight = tr.lightMode;
 	tr.modelDeluxe = deluxeMode_t::NONE;
 
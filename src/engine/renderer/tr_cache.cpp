@@ -0,0 +1,335 @@
+/*
+===========================================================================
+Daemon BSD Source Code
+Copyright (c) 2026, Daemon Developers
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Daemon developers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL DAEMON DEVELOPERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+===========================================================================
+*/
+// tr_cache.cpp -- files the renderer keeps in the homepath to load faster
+
+#include <zlib.h>
+
+#include "tr_local.h"
+
+static Cvar::Range<Cvar::Cvar<int>> r_cacheSize(
+	"r_cacheSize", "MiB the renderer caches can take in the homepath, the least recently used files are removed above it",
+	Cvar::NONE, 512, 16, 65536 );
+
+// all the caches are in subdirectories of this one
+static const char CACHE_DIR[] = "cache";
+
+// a file read again is written back when it is older than this, so that
+// the file times tell which files were used last
+static const std::chrono::hours CACHE_REFRESH_AGE( 24 );
+
+static const uint32_t CACHE_MAGIC = 0x48434344; // "DCCH"
+
+// the version of each cache is stored after the magic, for the files
+// written by an older engine to be left alone
+struct cacheHeader_t
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t keyLength;
+	uint32_t dataSize;
+	uint32_t compressedSize; // 0 if the payload is stored as it is
+};
+
+/*
+=================
+R_PakFileRevision
+
+Identifies the content of a file with the pak that has it, for the caches
+to be left alone when the pak changes. Returns an empty string if the file
+isn't in a pak
+=================
+*/
+std::string R_PakFileRevision( const std::string &fileName )
+{
+	const FS::LoadedPakInfo *pak = FS::PakPath::LocateFile( fileName );
+
+	if ( !pak )
+	{
+		return "";
+	}
+
+	// the files of a directory pak can change without the pak changing
+	std::string revision;
+
+	if ( pak->realChecksum )
+	{
+		revision = Str::Format( "%08x", *pak->realChecksum );
+	}
+	else
+	{
+		std::error_code err;
+		auto timestamp = FS::PakPath::FileTimestamp( fileName, err );
+
+		if ( err )
+		{
+			return "";
+		}
+
+		revision = std::to_string( timestamp.time_since_epoch().count() );
+	}
+
+	return Str::Format( "%s_%s %s", pak->name, pak->version, revision );
+}
+
+static std::string R_CacheFilePath( const char *dir, const std::string &key )
+{
+	return Str::Format( "%s/%s/%08x.bin", CACHE_DIR, dir, Com_BlockChecksum( key.data(), key.size() ) );
+}
+
+/*
+=================
+R_ReadCacheFile
+
+Gives the payload saved by R_WriteCacheFile for the same key and
+version, returns false if there is none. The key is stored in the file
+as the files are named after its hash
+=================
+*/
+bool R_ReadCacheFile( const char *dir, const std::string &key, uint32_t version, std::string &payload )
+{
+	if ( key.empty() )
+	{
+		return false;
+	}
+
+	std::string     path = R_CacheFilePath( dir, key );
+	std::error_code err;
+	FS::File file = FS::HomePath::OpenRead( path, err );
+
+	if ( err )
+	{
+		return false;
+	}
+
+	std::string data = file.ReadAll( err );
+
+	if ( err || data.size() < sizeof( cacheHeader_t ) )
+	{
+		return false;
+	}
+
+	cacheHeader_t header;
+	memcpy( &header, data.data(), sizeof( header ) );
+
+	if ( header.magic != CACHE_MAGIC || header.version != version )
+	{
+		return false;
+	}
+
+	uint32_t storedSize = header.compressedSize ? header.compressedSize : header.dataSize;
+
+	if ( data.size() - sizeof( header ) < header.keyLength
+	     || data.size() - sizeof( header ) - header.keyLength != storedSize )
+	{
+		Log::Warn( "%s cache for '%s' has the wrong size", dir, key );
+		return false;
+	}
+
+	// another file with the same hash
+	if ( key.compare( 0, std::string::npos, data.data() + sizeof( header ), header.keyLength ) )
+	{
+		return false;
+	}
+
+	auto timestamp = FS::HomePath::FileTimestamp( path, err );
+
+	if ( !err && std::chrono::system_clock::now() - timestamp > CACHE_REFRESH_AGE )
+	{
+		ri.FS_WriteFile( path.c_str(), data.data(), data.size() );
+	}
+
+	if ( !header.compressedSize )
+	{
+		payload = data.substr( sizeof( header ) + header.keyLength );
+		return true;
+	}
+
+	payload.resize( header.dataSize );
+
+	uLongf      size = header.dataSize;
+	const Bytef *compressed = reinterpret_cast<const Bytef *>( data.data() + sizeof( header ) + header.keyLength );
+
+	if ( uncompress( reinterpret_cast<Bytef *>( &payload[ 0 ] ), &size, compressed, header.compressedSize ) != Z_OK
+	     || size != header.dataSize )
+	{
+		Log::Warn( "%s cache for '%s' is corrupt", dir, key );
+		payload.clear();
+		return false;
+	}
+
+	return true;
+}
+
+/*
+=================
+R_WriteCacheFile
+
+Compresses the payload fast, reading it back has to be much faster than
+what it saves. A payload that is already compressed is stored as it is
+=================
+*/
+void R_WriteCacheFile( const char *dir, const std::string &key, uint32_t version, const std::string &payload, bool compress )
+{
+	if ( key.empty() )
+	{
+		return;
+	}
+
+	cacheHeader_t header{};
+	uLongf compressedSize = compress ? compressBound( payload.size() ) : payload.size();
+	std::string data( sizeof( header ) + key.size() + compressedSize, '\0' );
+	Bytef *compressed = reinterpret_cast<Bytef *>( &data[ sizeof( header ) + key.size() ] );
+
+	if ( !compress )
+	{
+		memcpy( compressed, payload.data(), payload.size() );
+	}
+	else if ( compress2( compressed, &compressedSize, reinterpret_cast<const Bytef *>( payload.data() ), payload.size(), Z_BEST_SPEED ) != Z_OK )
+	{
+		return;
+	}
+
+	header.magic = CACHE_MAGIC;
+	header.version = version;
+	header.keyLength = key.size();
+	header.dataSize = payload.size();
+	header.compressedSize = compress ? compressedSize : 0;
+
+	memcpy( &data[ 0 ], &header, sizeof( header ) );
+	memcpy( &data[ sizeof( header ) ], key.data(), key.size() );
+
+	ri.FS_WriteFile( R_CacheFilePath( dir, key ).c_str(), data.data(), sizeof( header ) + key.size() + compressedSize );
+}
+
+/*
+=================
+R_PruneCacheFiles
+
+Removes the least recently used files until the caches fit in r_cacheSize,
+the files of paks that were updated are never read again so they go first
+=================
+*/
+void R_PruneCacheFiles()
+{
+	struct cacheFile_t
+	{
+		std::string                           path;
+		size_t                                size;
+		std::chrono::system_clock::time_point timestamp;
+	};
+
+	std::vector<cacheFile_t> files;
+	size_t                   total = 0;
+	std::error_code          err;
+
+	for ( const std::string &name : FS::HomePath::ListFilesRecursive( CACHE_DIR, err ) )
+	{
+		if ( name.back() == '/' )
+		{
+			continue;
+		}
+
+		cacheFile_t file;
+		std::error_code fileErr;
+
+		file.path = FS::Path::Build( CACHE_DIR, name );
+		file.timestamp = FS::HomePath::FileTimestamp( file.path, fileErr );
+
+		if ( fileErr )
+		{
+			continue;
+		}
+
+		FS::File handle = FS::HomePath::OpenRead( file.path, fileErr );
+
+		if ( fileErr )
+		{
+			continue;
+		}
+
+		file.size = handle.Length( fileErr );
+
+		if ( fileErr )
+		{
+			continue;
+		}
+
+		total += file.size;
+		files.push_back( std::move( file ) );
+	}
+
+	size_t budget = size_t( r_cacheSize.Get() ) << 20;
+
+	if ( err || total <= budget )
+	{
+		return;
+	}
+
+	std::sort( files.begin(), files.end(), []( const cacheFile_t &a, const cacheFile_t &b ) {
+		return a.timestamp < b.timestamp;
+	} );
+
+	int numRemoved = 0;
+
+	for ( const cacheFile_t &file : files )
+	{
+		if ( total <= budget )
+		{
+			break;
+		}
+
+		FS::HomePath::DeleteFile( file.path, err );
+
+		if ( !err )
+		{
+			total -= file.size;
+			numRemoved++;
+		}
+	}
+
+	Log::Debug( "removed %i renderer cache files, %i MiB left", numRemoved, int( total >> 20 ) );
+}
+
+/*
+=================
+cacheReader_t::Read
+=================
+*/
+bool cacheReader_t::Read( void *out, size_t size )
+{
+	if ( data.size() - offset < size )
+	{
+		return false;
+	}
+
+	memcpy( out, data.data() + offset, size );
+	offset += size;
+	return true;
+}
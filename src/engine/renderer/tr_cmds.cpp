@@ -61,6 +61,18 @@ void R_PerformanceCounters()
 		           backEnd.pc.c_multiDrawElements,
 		           backEnd.pc.c_multiDrawPrimitives,
 		           backEnd.pc.c_multiVboIndexes / 3 );
+
+		Log::Notice("%i indirect multidraws",
+		           backEnd.pc.c_multiDrawIndirect );
+
+		Log::Notice("%i instanced draws %i instances",
+		           backEnd.pc.c_instancedDraws,
+		           backEnd.pc.c_instances );
+
+		Log::Notice("%i KB uploaded %i stalls %i orphans",
+		           backEnd.pc.c_dynamicBufferBytes / 1024,
+		           backEnd.pc.c_dynamicBufferStalls,
+		           backEnd.pc.c_dynamicBufferOrphans );
 	}
 	else if ( r_speeds->integer == Util::ordinal(renderSpeeds_t::RSPEEDS_CULLING ))
 	{
@@ -74,6 +86,10 @@ void R_PerformanceCounters()
 
 		Log::Notice("(md5) %i bin %i bclip %i bout",
 		           tr.pc.c_box_cull_md5_in, tr.pc.c_box_cull_md5_clip, tr.pc.c_box_cull_md5_out );
+
+		Log::Notice("(occ) %i occluders %i nin %i nout %i eout",
+		           tr.pc.c_occluders, tr.pc.c_occlusion_cull_node_in,
+		           tr.pc.c_occlusion_cull_node_out, tr.pc.c_occlusion_cull_ent_out );
 	}
 	else if ( r_speeds->integer == Util::ordinal(renderSpeeds_t::RSPEEDS_VIEWCLUSTER ))
 	{
@@ -886,6 +902,9 @@ void RE_EndFrame( int *frontEndMsec, int *backEndMsec )
 		return;
 	}
 
+	// before the backend draws with the images of this frame
+	R_UpdateTextureStreaming();
+
 	R_IssueRenderCommands( true );
 
 	// use the other buffers next frame, because another CPU
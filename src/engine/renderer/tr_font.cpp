@@ -95,7 +95,8 @@ Maryland 20850 USA.
 
 FT_Library ftLibrary = nullptr;
 
-static const int FONT_SIZE = 512;
+static Cvar::Cvar<bool> r_fontCache(
+	"r_fontCache", "keep the glyphs rasterised for the fonts in the homepath", Cvar::NONE, true );
 
 static const int MAX_FONTS = 16;
 static const int MAX_FILES = ( MAX_FONTS );
@@ -109,8 +110,6 @@ static struct {
 	char  name[ MAX_QPATH ];
 } fontData[ MAX_FILES ];
 
-void RE_RenderChunk( fontInfo_t *font, const int chunk );
-
 
 void R_GetGlyphInfo( FT_GlyphSlot glyph, int *left, int *right, int *width, int *top, int *bottom, int *height, int *pitch )
 {
@@ -167,359 +166,513 @@ FT_Bitmap      *R_RenderGlyph( FT_GlyphSlot glyph, glyphInfo_t *glyphOut )
 	return nullptr;
 }
 
-static glyphInfo_t *RE_ConstructGlyphInfo( unsigned char *imageOut, int *xOut, int *yOut,
-    int *maxHeight, FT_Face face, const int c, bool calcHeight )
+// the glyphs of all the fonts are packed in pages of this size
+static const int GLYPH_ATLAS_SIZE = 1024;
+
+static const char     FONT_CACHE_DIR[] = "fonts";
+static const uint32_t FONT_CACHE_VERSION = 1;
+
+// a glyph as FreeType rasterised it, kept to be saved in the font cache
+struct rasterGlyph_t
+{
+	int32_t           height;
+	int32_t           top;
+	int32_t           bottom;
+	int32_t           pitch;
+	int32_t           xSkip;
+	std::vector<byte> bitmap; // pitch * height coverage values
+};
+
+// what the renderer keeps for a registered font beside its fontInfo_t
+struct fontCache_t
+{
+	std::string                            key; // empty if the glyphs aren't saved
+	std::unordered_map<int, rasterGlyph_t> glyphs;
+	std::vector<bool>                      tried; // the code points already looked for
+	bool                                   dirty = false;
+};
+
+static fontCache_t fontCaches[ MAX_FONTS ];
+
+struct skylineNode_t
+{
+	int x, y, width;
+};
+
+struct glyphAtlasPage_t
 {
-	int                i;
-	static glyphInfo_t glyph;
-	unsigned char      *src, *dst;
-	float              scaledWidth, scaledHeight;
-	FT_Bitmap          *bitmap = nullptr;
+	image_t                    *image;
+	qhandle_t                  shader;
+	std::string                name;
+	std::vector<skylineNode_t> skyline; // top of the glyphs packed so far, left to right
+};
 
-	memset( &glyph, 0, sizeof( glyphInfo_t ) );
+static std::vector<glyphAtlasPage_t> glyphAtlas;
+
+/*
+================
+R_SkylineFit
 
-	// make sure everything is here
-	if ( face != nullptr )
+Lowest y at which a w * h rect fits with its left on a skyline
+node, -1 if it doesn't fit there
+================
+*/
+static int R_SkylineFit( const std::vector<skylineNode_t> &skyline, size_t index, int w, int h )
+{
+	if ( skyline[ index ].x + w > GLYPH_ATLAS_SIZE )
 	{
-		FT_UInt index = FT_Get_Char_Index( face, c );
+		return -1;
+	}
 
-		if ( index == 0 )
-		{
-			return nullptr; // nothing to render
-		}
+	int y = 0;
+	int widthLeft = w;
 
-		FT_Load_Glyph( face, index, FT_LOAD_DEFAULT );
-		bitmap = R_RenderGlyph( face->glyph, &glyph );
+	for ( size_t i = index; widthLeft > 0 && i < skyline.size(); i++ )
+	{
+		y = std::max( y, skyline[ i ].y );
 
-		if ( bitmap )
+		if ( y + h > GLYPH_ATLAS_SIZE )
 		{
-			glyph.xSkip = ( face->glyph->metrics.horiAdvance >> 6 ) + 1;
-		}
-		else
-		{
-			return nullptr;
+			return -1;
 		}
 
-		if ( glyph.height > *maxHeight )
+		widthLeft -= skyline[ i ].width;
+	}
+
+	return y;
+}
+
+/*
+================
+R_SkylineInsert
+
+Finds a place for a w * h rect in an atlas page, the lowest then the
+tightest one. Returns false if the page is full
+================
+*/
+static bool R_SkylineInsert( std::vector<skylineNode_t> &skyline, int w, int h, int *x, int *y )
+{
+	size_t bestIndex = skyline.size();
+	int    bestTop = 0;
+	int    bestWidth = 0;
+
+	for ( size_t i = 0; i < skyline.size(); i++ )
+	{
+		int fitY = R_SkylineFit( skyline, i, w, h );
+
+		if ( fitY < 0 )
 		{
-			*maxHeight = glyph.height;
+			continue;
 		}
 
-		if ( calcHeight )
+		if ( bestIndex == skyline.size() || fitY + h < bestTop || ( fitY + h == bestTop && skyline[ i ].width < bestWidth ) )
 		{
-			ri.Free( bitmap->buffer );
-			ri.Free( bitmap );
-			return &glyph;
+			bestIndex = i;
+			bestTop = fitY + h;
+			bestWidth = skyline[ i ].width;
+			*x = skyline[ i ].x;
+			*y = fitY;
 		}
+	}
 
-		scaledWidth = glyph.pitch;
-		scaledHeight = glyph.height;
+	if ( bestIndex == skyline.size() )
+	{
+		return false;
+	}
 
-		// we need to make sure we fit
-		if ( *xOut + scaledWidth + 1 >= ( FONT_SIZE - 1 ) )
+	skyline.insert( skyline.begin() + bestIndex, skylineNode_t{ *x, bestTop, w } );
+
+	// the nodes now under the rect are shortened or removed
+	for ( size_t i = bestIndex + 1; i < skyline.size(); )
+	{
+		int overlap = skyline[ i - 1 ].x + skyline[ i - 1 ].width - skyline[ i ].x;
+
+		if ( overlap <= 0 )
 		{
-			*xOut = 0;
-			*yOut += *maxHeight + 1;
+			break;
 		}
 
-		if ( *yOut + *maxHeight + 1 >= ( FONT_SIZE - 1 ) )
+		skyline[ i ].x += overlap;
+		skyline[ i ].width -= overlap;
+
+		if ( skyline[ i ].width > 0 )
 		{
-			*xOut = -1;
-			ri.Free( bitmap->buffer );
-			ri.Free( bitmap );
-			return nullptr;
+			break;
 		}
 
-		src = bitmap->buffer;
-		dst = imageOut + ( *yOut * FONT_SIZE ) + *xOut;
+		skyline.erase( skyline.begin() + i );
+	}
 
-		if ( bitmap->pixel_mode == ft_pixel_mode_mono )
+	for ( size_t i = 0; i + 1 < skyline.size(); )
+	{
+		if ( skyline[ i ].y == skyline[ i + 1 ].y )
 		{
-			for ( i = 0; i < glyph.height; i++ )
-			{
-				int           j;
-				unsigned char *_src = src;
-				unsigned char *_dst = dst;
-				unsigned char mask = 0x80;
-				unsigned char val = *_src;
-
-				for ( j = 0; j < glyph.pitch; j++ )
-				{
-					if ( mask == 0x80 )
-					{
-						val = *_src++;
-					}
-
-					if ( val & mask )
-					{
-						*_dst = 0xff;
-					}
-
-					mask >>= 1;
-
-					if ( mask == 0 )
-					{
-						mask = 0x80;
-					}
-
-					_dst++;
-				}
-
-				src += glyph.pitch;
-				dst += FONT_SIZE;
-			}
+			skyline[ i ].width += skyline[ i + 1 ].width;
+			skyline.erase( skyline.begin() + i + 1 );
 		}
 		else
 		{
-			for ( i = 0; i < glyph.height; i++ )
-			{
-				memcpy( dst, src, glyph.pitch );
-				src += glyph.pitch;
-				dst += FONT_SIZE;
-			}
+			i++;
 		}
+	}
 
-		// we now have an 8 bit per pixel grey scale bitmap
-		// that is width wide and pf->ftSize->metrics.y_ppem tall
-
-		glyph.imageHeight = scaledHeight;
-		glyph.imageWidth = scaledWidth;
-		glyph.s = ( float ) * xOut / FONT_SIZE;
-		glyph.t = ( float ) * yOut / FONT_SIZE;
-		glyph.s2 = glyph.s + ( float ) scaledWidth / FONT_SIZE;
-		glyph.t2 = glyph.t + ( float ) scaledHeight / FONT_SIZE;
-		glyph.shaderName[0] = 1; // flag that we have a glyph here
-
-		*xOut += scaledWidth + 1;
+	return true;
+}
 
-		ri.Free( bitmap->buffer );
-		ri.Free( bitmap );
+static glyphAtlasPage_t *R_AddGlyphAtlasPage()
+{
+	// white everywhere, for the edges of the glyphs to be filtered
+	// against transparent white
+	std::vector<byte> pic( GLYPH_ATLAS_SIZE * GLYPH_ATLAS_SIZE * 4 );
 
-		return &glyph;
+	for ( size_t i = 0; i < pic.size(); i += 4 )
+	{
+		pic[ i + 0 ] = 255;
+		pic[ i + 1 ] = 255;
+		pic[ i + 2 ] = 255;
 	}
 
-	return nullptr;
-}
+	glyphAtlasPage_t page;
 
+	page.name = Str::Format( "*glyphAtlas%d", static_cast<int>( glyphAtlas.size() ) );
+	page.image = R_CreateGlyph( page.name.c_str(), pic.data(), GLYPH_ATLAS_SIZE, GLYPH_ATLAS_SIZE );
 
-static int  fdOffset;
-static byte *fdFile;
+	if ( !page.image )
+	{
+		return nullptr;
+	}
 
-int readInt()
-{
-	int i =
-	  fdFile[ fdOffset ] + ( fdFile[ fdOffset + 1 ] << 8 ) + ( fdFile[ fdOffset + 2 ] << 16 ) + ( fdFile[ fdOffset + 3 ] << 24 );
-	fdOffset += 4;
-	return i;
+	page.shader = RE_RegisterShaderFromImage( page.name.c_str(), page.image );
+	page.skyline.push_back( skylineNode_t{ 0, 0, GLYPH_ATLAS_SIZE } );
+
+	glyphAtlas.push_back( std::move( page ) );
+	return &glyphAtlas.back();
 }
 
-union poor
-{
-	byte  fred[ 4 ];
-	float ffred;
-};
+/*
+================
+R_PlaceGlyph
 
-float readFloat()
+Uploads a glyph into the atlas, the glyphs already there never move
+================
+*/
+static bool R_PlaceGlyph( const rasterGlyph_t &raster, glyphInfo_t *glyph )
 {
-	poor me;
+	glyphAtlasPage_t *page = nullptr;
+	int              x = 0, y = 0;
 
-#ifdef Q3_BIG_ENDIAN
-	me.fred[ 0 ] = fdFile[ fdOffset + 3 ];
-	me.fred[ 1 ] = fdFile[ fdOffset + 2 ];
-	me.fred[ 2 ] = fdFile[ fdOffset + 1 ];
-	me.fred[ 3 ] = fdFile[ fdOffset + 0 ];
-#else
-	me.fred[ 0 ] = fdFile[ fdOffset + 0 ];
-	me.fred[ 1 ] = fdFile[ fdOffset + 1 ];
-	me.fred[ 2 ] = fdFile[ fdOffset + 2 ];
-	me.fred[ 3 ] = fdFile[ fdOffset + 3 ];
-#endif
-	fdOffset += 4;
-	return me.ffred;
-}
+	// a texel between the glyphs so that they aren't filtered together
+	int w = raster.pitch + 1;
+	int h = raster.height + 1;
 
-void RE_GlyphChar( fontInfo_t *font, int ch, glyphInfo_t *glyph )
-{
-	// default if out of range
-	if ( ch < 0 || ( ch >= 0xD800 && ch < 0xE000 ) || ch >= 0x110000 || ch == 0xFFFD )
+	for ( glyphAtlasPage_t &p : glyphAtlas )
 	{
-		ch = 0;
+		if ( R_SkylineInsert( p.skyline, w, h, &x, &y ) )
+		{
+			page = &p;
+			break;
+		}
 	}
 
-	// render if needed
-	if ( !font->glyphBlock[ ch / 256 ] )
+	if ( !page )
 	{
-		RE_RenderChunk( font, ch / 256 );
+		page = R_AddGlyphAtlasPage();
+
+		if ( !page || !R_SkylineInsert( page->skyline, w, h, &x, &y ) )
+		{
+			Log::Warn( "R_PlaceGlyph: %dx%d glyph doesn't fit in the glyph atlas", raster.pitch, raster.height );
+			return false;
+		}
 	}
 
-	// default if no glyph
-	if ( !font->glyphBlock[ ch / 256 ][ ch % 256 ].glyph )
+	std::vector<byte> pic( raster.bitmap.size() * 4 );
+
+	for ( size_t i = 0; i < raster.bitmap.size(); i++ )
 	{
-		ch = 0;
+		pic[ i * 4 + 0 ] = 255;
+		pic[ i * 4 + 1 ] = 255;
+		pic[ i * 4 + 2 ] = 255;
+		pic[ i * 4 + 3 ] = raster.bitmap[ i ];
 	}
 
-	// we have a glyph
-	memcpy( glyph, &font->glyphBlock[ ch / 256][ ch % 256 ], sizeof( *glyph ) );
+	// about to render an image
+	R_SyncRenderThread();
+
+	GL_Bind( page->image );
+	glTexSubImage2D( GL_TEXTURE_2D, 0, x, y, raster.pitch, raster.height, GL_RGBA, GL_UNSIGNED_BYTE, pic.data() );
+	GL_CheckErrors();
+
+	memset( glyph, 0, sizeof( *glyph ) );
+
+	glyph->height = raster.height;
+	glyph->top = raster.top;
+	glyph->bottom = raster.bottom;
+	glyph->pitch = raster.pitch;
+	glyph->xSkip = raster.xSkip;
+	glyph->imageWidth = raster.pitch;
+	glyph->imageHeight = raster.height;
+	glyph->s = ( float ) x / GLYPH_ATLAS_SIZE;
+	glyph->t = ( float ) y / GLYPH_ATLAS_SIZE;
+	glyph->s2 = glyph->s + ( float ) raster.pitch / GLYPH_ATLAS_SIZE;
+	glyph->t2 = glyph->t + ( float ) raster.height / GLYPH_ATLAS_SIZE;
+	glyph->glyph = page->shader;
+	Q_strncpyz( glyph->shaderName, page->name.c_str(), sizeof( glyph->shaderName ) );
+
+	return true;
 }
 
-void RE_Glyph( fontInfo_t *font, const char *str, glyphInfo_t *glyph )
+static bool R_RasterizeGlyph( FT_Face face, int ch, rasterGlyph_t &raster )
 {
-	RE_GlyphChar( font, Q_UTF8_CodePoint( str ), glyph );
+	FT_UInt index = FT_Get_Char_Index( face, ch );
+
+	if ( index == 0 )
+	{
+		return false; // nothing to render
+	}
+
+	glyphInfo_t glyph;
+	memset( &glyph, 0, sizeof( glyph ) );
+
+	FT_Load_Glyph( face, index, FT_LOAD_DEFAULT );
+	FT_Bitmap *bitmap = R_RenderGlyph( face->glyph, &glyph );
+
+	if ( !bitmap )
+	{
+		return false;
+	}
+
+	raster.height = glyph.height;
+	raster.top = glyph.top;
+	raster.bottom = glyph.bottom;
+	raster.pitch = glyph.pitch;
+	raster.xSkip = ( face->glyph->metrics.horiAdvance >> 6 ) + 1;
+	raster.bitmap.assign( bitmap->buffer, bitmap->buffer + glyph.pitch * glyph.height );
+
+	ri.Free( bitmap->buffer );
+	ri.Free( bitmap );
+
+	return true;
 }
 
-static void RE_StoreImage( fontInfo_t *font, int chunk, int page, int from, int to, const unsigned char *bitmap, int yEnd )
+/*
+================
+R_FontCacheKey
+
+Identifies the font file with the pak that has it and the size the
+glyphs are rasterised at. Empty if the glyphs can't be cached
+================
+*/
+static std::string R_FontCacheKey( const char *fileName, int pointSize )
 {
-	int           scaledSize = FONT_SIZE * FONT_SIZE;
-	int           i, j, y;
-	float         max;
+	if ( !r_fontCache.Get() )
+	{
+		return "";
+	}
 
-	glyphInfo_t   *glyphs = font->glyphBlock[chunk];
+	std::string revision = R_PakFileRevision( fileName );
 
-	unsigned char *buffer;
-	image_t       *image;
-	qhandle_t     h;
+	if ( revision.empty() )
+	{
+		return "";
+	}
 
-	char          fileName[ MAX_QPATH ];
+	return Str::Format( "%s %s %d", fileName, revision, pointSize );
+}
 
-	// about to render an image
-	R_SyncRenderThread();
+/*
+================
+R_LoadFontCache
 
-	// maybe crop image while retaining power-of-2 height
-	i = 1;
-	y = FONT_SIZE;
+The glyphs are saved one after the other, with their code point
+and metrics followed by their bitmap
+================
+*/
+static void R_LoadFontCache( fontCache_t &cache )
+{
+	std::string data;
 
-	// How much to reduce it?
-	while ( yEnd < y / 2 - 1 ) { i += i; y /= 2; }
+	if ( !R_ReadCacheFile( FONT_CACHE_DIR, cache.key, FONT_CACHE_VERSION, data ) )
+	{
+		return;
+	}
 
-	// Fix up the glyphs' Y co-ordinates
-	for ( j = from; j < to; j++ ) { glyphs[j].t *= i; glyphs[j].t2 *= i; }
+	cacheReader_t reader( data );
+	int32_t       fields[ 6 ];
 
-	scaledSize /= i;
+	while ( reader.Read( fields ) )
+	{
+		rasterGlyph_t raster;
 
-	max = 0;
+		raster.height = fields[ 1 ];
+		raster.top = fields[ 2 ];
+		raster.bottom = fields[ 3 ];
+		raster.pitch = fields[ 4 ];
+		raster.xSkip = fields[ 5 ];
 
-	for ( i = 0; i < scaledSize; i++ )
-	{
-		if ( max < bitmap[ i ] )
+		if ( raster.height <= 0 || raster.pitch <= 0 || raster.pitch > GLYPH_ATLAS_SIZE || raster.height > GLYPH_ATLAS_SIZE
+		     || reader.Left() < size_t( raster.pitch * raster.height ) )
 		{
-			max = bitmap[ i ];
+			break;
 		}
+
+		raster.bitmap.resize( raster.pitch * raster.height );
+		reader.Read( raster.bitmap.data(), raster.bitmap.size() );
+
+		cache.glyphs.emplace( fields[ 0 ], std::move( raster ) );
 	}
+}
 
-	if ( max > 0 )
+static void R_SaveFontCache( const fontCache_t &cache )
+{
+	if ( cache.key.empty() || !cache.dirty )
 	{
-		max = 255 / max;
+		return;
 	}
 
-	buffer = ( unsigned char * ) ri.Z_Malloc( scaledSize * 4 );
-	for ( i = j = 0; i < scaledSize; i++ )
+	std::string glyphs;
+
+	for ( const auto &it : cache.glyphs )
 	{
-		buffer[ j++ ] = 255;
-		buffer[ j++ ] = 255;
-		buffer[ j++ ] = 255;
-		buffer[ j++ ] = ( ( float ) bitmap[ i ] * max );
+		const rasterGlyph_t &raster = it.second;
+		int32_t fields[ 6 ] = { it.first, raster.height, raster.top, raster.bottom, raster.pitch, raster.xSkip };
+
+		glyphs.append( reinterpret_cast<const char *>( fields ), sizeof( fields ) );
+		glyphs.append( reinterpret_cast<const char *>( raster.bitmap.data() ), raster.bitmap.size() );
 	}
 
+	R_WriteCacheFile( FONT_CACHE_DIR, cache.key, FONT_CACHE_VERSION, glyphs );
+}
+
 
-	Com_sprintf( fileName, sizeof( fileName ), "%s_%i_%i_%i.png", font->name, chunk, page, font->pointSize );
+static int  fdOffset;
+static byte *fdFile;
 
-	image = R_CreateGlyph( fileName, buffer, FONT_SIZE, y );
+int readInt()
+{
+	int i =
+	  fdFile[ fdOffset ] + ( fdFile[ fdOffset + 1 ] << 8 ) + ( fdFile[ fdOffset + 2 ] << 16 ) + ( fdFile[ fdOffset + 3 ] << 24 );
+	fdOffset += 4;
+	return i;
+}
 
-	ri.Free( buffer );
+union poor
+{
+	byte  fred[ 4 ];
+	float ffred;
+};
 
-	h = RE_RegisterShaderFromImage( fileName, image );
+float readFloat()
+{
+	poor me;
 
-	for ( j = from; j < to; j++ )
-	{
-		if ( font->glyphBlock[ chunk ][ j ].shaderName[0] ) // non-0 if we have a glyph here
-		{
-			font->glyphBlock[ chunk ][ j ].glyph = h;
-			Q_strncpyz( font->glyphBlock[ chunk ][ j ].shaderName, fileName, sizeof( font->glyphBlock[ chunk ][ j ].shaderName ) );
-		}
-	}
+#ifdef Q3_BIG_ENDIAN
+	me.fred[ 0 ] = fdFile[ fdOffset + 3 ];
+	me.fred[ 1 ] = fdFile[ fdOffset + 2 ];
+	me.fred[ 2 ] = fdFile[ fdOffset + 1 ];
+	me.fred[ 3 ] = fdFile[ fdOffset + 0 ];
+#else
+	me.fred[ 0 ] = fdFile[ fdOffset + 0 ];
+	me.fred[ 1 ] = fdFile[ fdOffset + 1 ];
+	me.fred[ 2 ] = fdFile[ fdOffset + 2 ];
+	me.fred[ 3 ] = fdFile[ fdOffset + 3 ];
+#endif
+	fdOffset += 4;
+	return me.ffred;
 }
 
 static glyphBlock_t nullGlyphs;
 
-void RE_RenderChunk( fontInfo_t *font, const int chunk )
-{
-	int           xOut, yOut, maxHeight;
-	int           i, lastStart, page;
-	unsigned char *out;
-	glyphInfo_t   *glyphs;
-	bool      rendered;
+/*
+================
+R_FindGlyph
 
-	const int     startGlyph = chunk * 256;
+The glyph of a code point, rasterised or taken from the font cache and
+put in the atlas the first time it is asked for. nullptr if the font
+doesn't have it
+================
+*/
+static glyphInfo_t *R_FindGlyph( fontInfo_t *font, int ch )
+{
+	const int chunk = ch / 256;
 
-	// sanity check
-	if ( chunk < 0 || chunk >= 0x1100 || font->glyphBlock[ chunk ] )
+	if ( !font->glyphBlock[ chunk ] )
 	{
-		return;
+		if ( font->face )
+		{
+			font->glyphBlock[ chunk ] = (glyphInfo_t*) ri.Z_Malloc( sizeof( glyphBlock_t ) );
+			memset( font->glyphBlock[ chunk ], 0, sizeof( glyphBlock_t ) );
+		}
+		else
+		{
+			font->glyphBlock[ chunk ] = nullGlyphs;
+		}
 	}
 
-	out = (unsigned char*) ri.Z_Malloc( FONT_SIZE * FONT_SIZE );
+	glyphInfo_t *glyph = &font->glyphBlock[ chunk ][ ch % 256 ];
 
-	if ( out == nullptr )
+	if ( glyph->glyph )
 	{
-		Log::Warn("RE_RenderChunk: ri.Malloc failure during output image creation." );
-		return;
+		return glyph;
 	}
 
-	memset( out, 0, FONT_SIZE * FONT_SIZE );
-
-	// calculate max height
-	maxHeight = 0;
-	rendered = false;
-
-	for ( i = 0; i < 256; i++ )
+	if ( !font->face )
 	{
-		rendered |= !!RE_ConstructGlyphInfo( out, &xOut, &yOut, &maxHeight, (FT_Face) font->face, ( i + startGlyph ) ? ( i + startGlyph ) : 0xFFFD, true );
+		return nullptr;
 	}
 
-	// no glyphs? just return
-	if ( !rendered )
+	fontCache_t &cache = fontCaches[ font - registeredFont ];
+
+	if ( cache.tried[ ch ] )
 	{
-		ri.Free( out );
-		font->glyphBlock[ chunk ] = nullGlyphs;
-		return;
+		return nullptr;
 	}
 
-	glyphs = font->glyphBlock[ chunk ] = (glyphInfo_t*) ri.Z_Malloc( sizeof( glyphBlock_t ) );
-	memset( glyphs, 0, sizeof( glyphBlock_t ) );
+	cache.tried[ ch ] = true;
 
-	xOut = yOut = 0;
-	rendered = false;
-	i = lastStart = page = 0;
+	// the default glyph is the replacement character
+	const int codePoint = ch ? ch : 0xFFFD;
+	auto it = cache.glyphs.find( codePoint );
 
-	while ( i < 256 )
+	if ( it == cache.glyphs.end() )
 	{
-		glyphInfo_t *glyph = RE_ConstructGlyphInfo( out, &xOut, &yOut, &maxHeight, (FT_Face) font->face, ( i + startGlyph ) ? ( i + startGlyph ) : 0xFFFD, false );
+		rasterGlyph_t raster;
 
-		if ( glyph )
+		if ( !R_RasterizeGlyph( (FT_Face) font->face, codePoint, raster ) )
 		{
-			rendered = true;
-			memcpy( glyphs + i, glyph, sizeof( glyphInfo_t ) );
+			return nullptr;
 		}
 
-		if ( xOut == -1 )
-		{
-			RE_StoreImage( font, chunk, page++, lastStart, i, out, yOut + maxHeight + 1 );
-			memset( out, 0, FONT_SIZE * FONT_SIZE );
-			xOut = yOut = 0;
-			rendered = false;
-			lastStart = i;
-		}
-		else
-		{
-			i++;
-		}
+		it = cache.glyphs.emplace( codePoint, std::move( raster ) ).first;
+		cache.dirty = true;
 	}
 
-	if ( rendered )
+	return R_PlaceGlyph( it->second, glyph ) ? glyph : nullptr;
+}
+
+void RE_GlyphChar( fontInfo_t *font, int ch, glyphInfo_t *glyph )
+{
+	// default if out of range
+	if ( ch < 0 || ( ch >= 0xD800 && ch < 0xE000 ) || ch >= 0x110000 || ch == 0xFFFD )
+	{
+		ch = 0;
+	}
+
+	glyphInfo_t *found = R_FindGlyph( font, ch );
+
+	// default if no glyph
+	if ( !found )
 	{
-		RE_StoreImage( font, chunk, page, lastStart, 256, out, yOut + maxHeight + 1 );
+		R_FindGlyph( font, 0 );
+		found = &font->glyphBlock[ 0 ][ 0 ];
 	}
-	ri.Free( out );
+
+	// we have a glyph
+	memcpy( glyph, found, sizeof( *glyph ) );
+}
+
+void RE_Glyph( fontInfo_t *font, const char *str, glyphInfo_t *glyph )
+{
+	RE_GlyphChar( font, Q_UTF8_CodePoint( str ), glyph );
 }
 
 static int RE_LoadFontFile( const char *name, void **buffer )
@@ -751,7 +904,20 @@ fontInfo_t* RE_RegisterFont( const char *fontName, int pointSize )
 	font->glyphScale = 64.0f / pointSize;
 	font->height = ceil( ( face->height / 64.0 ) * ( face->size->metrics.y_scale / 65536.0 ) * font->glyphScale );
 
-	RE_RenderChunk( font, 0 );
+	fontCache_t &cache = fontCaches[ fontNo ];
+
+	cache = fontCache_t();
+	cache.tried.assign( 0x110000, false );
+	cache.key = R_FontCacheKey( fileName, pointSize );
+	R_LoadFontCache( cache );
+
+	// the console reads the metrics of some of them directly
+	R_FindGlyph( font, 0 );
+
+	for ( i = GLYPH_CHARSTART; i <= GLYPH_CHAREND; i++ )
+	{
+		R_FindGlyph( font, i );
+	}
 
 	++fontUsage[ fontNo ];
 	return font;
@@ -782,6 +948,9 @@ void RE_UnregisterFont_Internal( fontHandle_t handle )
 
 	if ( registeredFont[ handle ].face )
 	{
+		R_SaveFontCache( fontCaches[ handle ] );
+		fontCaches[ handle ] = fontCache_t();
+
 		FT_Done_Face( (FT_Face) registeredFont[ handle ].face );
 		RE_FreeFontFile( registeredFont[ handle ].faceData );
 	}
@@ -830,5 +999,8 @@ void R_DoneFreeType()
 		RE_UnregisterFont( nullptr );
 		FT_Done_FreeType( ftLibrary );
 		ftLibrary = nullptr;
+
+		// the images of the pages are gone with the other ones
+		glyphAtlas.clear();
 	}
 }
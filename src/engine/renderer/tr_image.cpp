@@ -831,7 +831,8 @@ void R_UploadImage( const byte **dataArray, int numLayers, int numMips, image_t
 
 	int scaledWidth = image->width;
 	int scaledHeight = image->height;
-	int customScalingStep = R_GetImageCustomScalingStep( image, imageParams );
+	// the levels of the streamed images are already picked
+	int customScalingStep = image->streamed ? 0 : R_GetImageCustomScalingStep( image, imageParams );
 	R_DownscaleImageDimensions( customScalingStep, &scaledWidth, &scaledHeight, &dataArray, numLayers, &numMips );
 
 	// clamp to the current upper OpenGL limit
@@ -1594,42 +1595,59 @@ tells the extra prefix that may be required to load the image.
 =================
 */
 static int R_FindImageLoader( const char *baseName, const char **prefix ) {
-	const FS::PakInfo* bestPak = nullptr;
-	int i;
-
+	uint32_t bestPak = 0;
 	int bestLoader = -1;
+
 	*prefix = "";
 	// try and find a suitable match using all the image formats supported
-	// prioritize with the pak priority
-	for ( i = 0; i < numImageLoaders; i++ )
+	// prioritize with the pak priority, the extensions are sorted by it
+	for ( const FS::PakPath::FileExtension &file : FS::PakPath::LocateExtensions( baseName ) )
 	{
-		std::string altName = Str::Format( "%s.%s", baseName, imageLoaders[i].ext );
-		const FS::PakInfo* pak = FS::PakPath::LocateFile( altName );
+		if ( bestLoader >= 0 && file.pakIndex != bestPak )
+		{
+			break;
+		}
 
-		// We found a file and its pak is better than the best pak we have
-		// this relies on how the filesystem works internally and should be moved
-		// to a more explicit interface once there is one. (FIXME)
-		if ( pak != nullptr && ( bestPak == nullptr || pak < bestPak ) )
+		for ( int i = 0; i < numImageLoaders; i++ )
 		{
-			bestPak = pak;
-			bestLoader = i;
+			if ( file.extension == imageLoaders[ i ].ext )
+			{
+				if ( bestLoader < 0 || i < bestLoader )
+				{
+					bestPak = file.pakIndex;
+					bestLoader = i;
+				}
+
+				break;
+			}
 		}
+	}
+
+	if ( bestLoader >= 0 )
+	{
+		return bestLoader;
+	}
 
-		// DarkPlaces or Doom3 packages can ship alternative texture path in the form of
-		//   dds/<path without ext>.dds
-		if ( bestPak == nullptr && !Q_stricmp( "dds", imageLoaders[i].ext ) )
+	// DarkPlaces or Doom3 packages can ship alternative texture path in the form of
+	//   dds/<path without ext>.dds
+	std::string prefixedName = Str::Format( "dds/%s", baseName );
+
+	for ( const FS::PakPath::FileExtension &file : FS::PakPath::LocateExtensions( prefixedName ) )
+	{
+		if ( file.extension == "dds" )
 		{
-			std::string prefixedName = Str::Format( "dds/%s.dds", baseName );
-			bestPak = FS::PakPath::LocateFile( prefixedName );
-			if ( bestPak != nullptr ) {
-				*prefix = "dds/";
-				bestPak = pak;
-				bestLoader = i;
+			for ( int i = 0; i < numImageLoaders; i++ )
+			{
+				if ( !Q_stricmp( "dds", imageLoaders[ i ].ext ) )
+				{
+					*prefix = "dds/";
+					return i;
+				}
 			}
 		}
 	}
 
-	return bestLoader;
+	return -1;
 }
 
 int R_FindImageLoader( const char *baseName ) {
@@ -1641,41 +1659,22 @@ int R_FindImageLoader( const char *baseName ) {
 
 /*
 =================
-R_LoadImage
+R_FindImageFileName
 
-Loads any of the supported image types into a canonical
-32 bit format.
+Finds the file R_LoadImage loads for the name, the hardcoded path
+first, and returns its loader or -1 if there is none
 =================
 */
-static void R_LoadImage( const char **buffer, byte **pic, int *width, int *height,
-			 int *numLayers, int *numMips,
-			 int *bits )
+int R_FindImageFileName( const char *name, std::string &fileName )
 {
-	char *token;
-
-	*pic = nullptr;
-	*width = 0;
-	*height = 0;
-
-	token = COM_ParseExt2( buffer, false );
-
-	if ( !token[ 0 ] )
-	{
-		Log::Warn("NULL parameter for R_LoadImage" );
-		return;
-	}
-
-	int        i;
-	const char *ext;
-	char       filename[ MAX_QPATH ];
-	byte       alphaByte;
+	int  i;
+	char filename[ MAX_QPATH ];
 
-	// missing alpha means fully opaque
-	alphaByte = 0xFF;
+	fileName.clear();
 
-	Q_strncpyz( filename, token, sizeof( filename ) );
+	Q_strncpyz( filename, name, sizeof( filename ) );
 
-	ext = COM_GetExtension( filename );
+	const char *ext = COM_GetExtension( filename );
 
 	// the Daemon's default strategy is to use the hardcoded path if exists
 	if ( *ext )
@@ -1688,27 +1687,17 @@ static void R_LoadImage( const char **buffer, byte **pic, int *width, int *heigh
 				// do not complain on missing file if extension is hardcoded to a wrong one
 				// since file can exist with another extension and it will tested right after
 				// that, and by the way if there is no alternative an error will be raised
-				// because of missing texture so we don't have to let the ImageLoader says
-				// it failed to read the file using this filename
+				// because of missing texture
 				if ( FS::PakPath::FileExists( filename ) )
 				{
-					// load
-					imageLoaders[ i ].ImageLoader( filename, pic, width, height, numLayers, numMips, bits, alphaByte );
+					fileName = filename;
+					return i;
 				}
+
 				// we still have to break because a loader was found, so we can strip the extension
 				break;
 			}
 		}
-
-		// a loader was found
-		if ( i < numImageLoaders )
-		{
-			if ( *pic != nullptr )
-			{
-				// something loaded
-				return;
-			}
-		}
 	}
 
 	// if the file isn't there, maybe the file path did not have any extension,
@@ -1721,16 +1710,112 @@ static void R_LoadImage( const char **buffer, byte **pic, int *width, int *heigh
 	{
 		// if there is no file with such extension
 		// or there is no codec available for this file format
-		COM_StripExtension3( token, filename, sizeof(filename) );
+		COM_StripExtension3( name, filename, sizeof(filename) );
 
 		bestLoader = R_FindImageLoader( filename, &prefix );
 	}
 
 	if ( bestLoader >= 0 )
 	{
-		char *altName = va( "%s%s.%s", prefix, filename, imageLoaders[ bestLoader ].ext );
-		imageLoaders[ bestLoader ].ImageLoader( altName, pic, width, height, numLayers, numMips, bits, alphaByte );
+		fileName = Str::Format( "%s%s.%s", prefix, filename, imageLoaders[ bestLoader ].ext );
+	}
+
+	return bestLoader;
+}
+
+// the content of the file R_LoadImageFile decodes on this thread, when
+// the caller already read it
+static thread_local const std::string *r_imageFileName;
+static thread_local const std::string *r_imageFileData;
+
+/*
+=================
+R_ReadImageFile
+
+Reads the file of an image for its loader
+=================
+*/
+std::string R_ReadImageFile( Str::StringRef name, std::error_code &err )
+{
+	if ( r_imageFileData && name == *r_imageFileName )
+	{
+		err.clear();
+		return *r_imageFileData;
 	}
+
+	return FS::PakPath::ReadFile( name, err );
+}
+
+/*
+=================
+R_LoadImageFile
+
+Loads the file found by R_FindImageFileName with its loader. If fileData is
+given, it is decoded instead of reading the file, so that it can be done
+away from the main thread
+=================
+*/
+void R_LoadImageFile( int loader, const std::string &fileName, byte **pic, int *width, int *height,
+			 int *numLayers, int *numMips, int *bits, const std::string *fileData )
+{
+	// missing alpha means fully opaque
+	byte alphaByte = 0xFF;
+
+	*pic = nullptr;
+	*width = 0;
+	*height = 0;
+
+	if ( loader < 0 )
+	{
+		return;
+	}
+
+	r_imageFileName = &fileName;
+	r_imageFileData = fileData;
+
+	try
+	{
+		imageLoaders[ loader ].ImageLoader( fileName.c_str(), pic, width, height, numLayers, numMips, bits, alphaByte );
+	}
+	catch ( ... )
+	{
+		r_imageFileData = nullptr;
+		throw;
+	}
+
+	r_imageFileData = nullptr;
+}
+
+/*
+=================
+R_LoadImage
+
+Loads any of the supported image types into a canonical
+32 bit format.
+=================
+*/
+static void R_LoadImage( const char **buffer, byte **pic, int *width, int *height,
+			 int *numLayers, int *numMips,
+			 int *bits )
+{
+	char *token;
+
+	*pic = nullptr;
+	*width = 0;
+	*height = 0;
+
+	token = COM_ParseExt2( buffer, false );
+
+	if ( !token[ 0 ] )
+	{
+		Log::Warn("NULL parameter for R_LoadImage" );
+		return;
+	}
+
+	std::string fileName;
+	int loader = R_FindImageFileName( token, fileName );
+
+	R_LoadImageFile( loader, fileName, pic, width, height, numLayers, numMips, bits );
 }
 
 /*
@@ -1784,10 +1869,23 @@ image_t *R_FindImageFile( const char *imageName, imageParams_t &imageParams )
 		}
 	}
 
-	// load the pic from disk
+	// load the pic from the image cache, or from disk
 	pic[ 0 ] = nullptr;
 	buffer_p = &buffer[ 0 ];
-	R_LoadImage( &buffer_p, pic, &width, &height, &numLayers, &numMips, &imageParams.bits );
+
+	std::string fileName;
+	int loader = R_FindImageFileName( COM_ParseExt2( &buffer_p, false ), fileName );
+	std::string cacheKey = R_ImageCacheKey( fileName, imageParams.bits );
+
+	if ( !R_LoadCachedImage( cacheKey, pic, &width, &height, &numMips, &imageParams.bits ) )
+	{
+		R_LoadImageFile( loader, fileName, pic, &width, &height, &numLayers, &numMips, &imageParams.bits );
+
+		if ( pic[ 0 ] && numLayers == 0 )
+		{
+			R_SaveCachedImage( cacheKey, pic, width, height, numMips, imageParams.bits );
+		}
+	}
 
 	if ( (mallocPtr = pic[ 0 ]) == nullptr || numLayers > 0 )
 	{
@@ -1803,7 +1901,12 @@ image_t *R_FindImageFile( const char *imageName, imageParams_t &imageParams )
 		R_ProcessLightmap( pic[ 0 ], 4, width, height, imageParams.bits, pic[ 0 ] );
 	}
 
-	image = R_CreateImage( ( char * ) buffer, (const byte **)pic, width, height, numMips, imageParams );
+	image = R_CreateStreamedImage( buffer, loader, fileName, cacheKey, pic, width, height, numMips, imageParams );
+
+	if ( !image )
+	{
+		image = R_CreateImage( ( char * ) buffer, (const byte **)pic, width, height, numMips, imageParams );
+	}
 
 	ri.Free( mallocPtr );
 	return image;
@@ -3033,6 +3136,8 @@ void R_ShutdownImages()
 
 	Log::Debug("------- R_ShutdownImages -------" );
 
+	R_ShutdownTextureStreaming();
+
 	for ( i = 0; i < tr.images.currentElements; i++ )
 	{
 		image = (image_t*) Com_GrowListElement( &tr.images, i );
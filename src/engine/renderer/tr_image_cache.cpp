@@ -0,0 +1,219 @@
+/*
+===========================================================================
+Daemon BSD Source Code
+Copyright (c) 2026, Daemon Developers
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Daemon developers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL DAEMON DEVELOPERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+===========================================================================
+*/
+// tr_image_cache.cpp -- decoded images kept in the homepath
+
+#include "tr_local.h"
+
+static Cvar::Cvar<bool> r_imageCache(
+	"r_imageCache", "keep decoded images in the homepath so that they load faster", Cvar::NONE, true );
+
+static const char     IMAGE_CACHE_DIR[] = "images";
+static const uint32_t IMAGE_CACHE_VERSION = 1;
+
+struct imageCacheHeader_t
+{
+	int32_t  width;
+	int32_t  height;
+	int32_t  numMips;
+	int32_t  bits;
+};
+
+/*
+=================
+R_ImageCacheMipSizes
+
+The size of each mip level the loaders give for a 2D image, returns false
+for the formats that aren't cached
+=================
+*/
+static bool R_ImageCacheMipSizes( int width, int height, int numMips, int bits, std::vector<uint32_t> &sizes )
+{
+	sizes.clear();
+
+	if ( bits & ( IF_RGBA16F | IF_RGBA32F | IF_TWOCOMP16F | IF_TWOCOMP32F | IF_ONECOMP16F | IF_ONECOMP32F
+	              | IF_DEPTH16 | IF_DEPTH24 | IF_DEPTH32 | IF_PACKED_DEPTH24_STENCIL8 | IF_RGBA16 | IF_RGBE | IF_RGBA32UI ) )
+	{
+		return false;
+	}
+
+	if ( width <= 0 || height <= 0 || numMips > MAX_TEXTURE_MIPS )
+	{
+		return false;
+	}
+
+	// uncompressed images only have the first level, the other ones
+	// are generated on upload
+	if ( !IsImageCompressed( bits ) )
+	{
+		sizes.push_back( width * height * 4 );
+		return true;
+	}
+
+	int blockSize = ( bits & ( IF_BC1 | IF_BC4 ) ) ? 8 : 16;
+
+	for ( int i = 0; i < std::max( numMips, 1 ); i++ )
+	{
+		sizes.push_back( ( ( width + 3 ) >> 2 ) * ( ( height + 3 ) >> 2 ) * blockSize );
+
+		width = std::max( width >> 1, 1 );
+		height = std::max( height >> 1, 1 );
+	}
+
+	return true;
+}
+
+/*
+=================
+R_ImageCacheKey
+
+Identifies the file an image is loaded from with the pak that has it.
+Returns an empty string for the files that aren't worth caching
+=================
+*/
+std::string R_ImageCacheKey( const std::string &fileName, int bits )
+{
+	if ( !r_imageCache.Get() || fileName.empty() )
+	{
+		return "";
+	}
+
+	const char *ext = COM_GetExtension( fileName.c_str() );
+
+	// dds and ktx are already in the format they are uploaded in, and
+	// png, tga and jpg decode about as fast as the cache is inflated, so
+	// only the formats that are slow to decode are cached
+	if ( Q_stricmp( ext, "crn" ) && Q_stricmp( ext, "webp" ) )
+	{
+		return "";
+	}
+
+	std::string revision = R_PakFileRevision( fileName );
+
+	if ( revision.empty() )
+	{
+		return "";
+	}
+
+	return Str::Format( "%s %s %d", fileName, revision, bits );
+}
+
+/*
+=================
+R_LoadCachedImage
+
+Loads an image saved by R_SaveCachedImage, the mip levels are allocated
+together in pic[ 0 ] like the loaders do
+=================
+*/
+bool R_LoadCachedImage( const std::string &key, byte **pic, int *width, int *height, int *numMips, int *bits )
+{
+	std::string payload;
+
+	if ( !R_ReadCacheFile( IMAGE_CACHE_DIR, key, IMAGE_CACHE_VERSION, payload ) )
+	{
+		return false;
+	}
+
+	cacheReader_t      reader( payload );
+	imageCacheHeader_t header;
+
+	if ( !reader.Read( header ) )
+	{
+		return false;
+	}
+
+	std::vector<uint32_t> sizes;
+
+	if ( !R_ImageCacheMipSizes( header.width, header.height, header.numMips, header.bits, sizes ) )
+	{
+		return false;
+	}
+
+	size_t total = 0;
+
+	for ( uint32_t size : sizes )
+	{
+		total += size;
+	}
+
+	if ( total != reader.Left() )
+	{
+		return false;
+	}
+
+	byte *out = ( byte * ) ri.Z_Malloc( total );
+
+	reader.Read( out, total );
+
+	for ( size_t i = 0; i < sizes.size(); i++ )
+	{
+		pic[ i ] = out;
+		out += sizes[ i ];
+	}
+
+	*width = header.width;
+	*height = header.height;
+	*numMips = header.numMips;
+	*bits = header.bits;
+
+	return true;
+}
+
+/*
+=================
+R_SaveCachedImage
+
+Saves what a loader gave for a 2D image, the bits are those after loading
+=================
+*/
+void R_SaveCachedImage( const std::string &key, const byte * const *pic, int width, int height, int numMips, int bits )
+{
+	if ( key.empty() )
+	{
+		return;
+	}
+
+	std::vector<uint32_t> sizes;
+
+	if ( !R_ImageCacheMipSizes( width, height, numMips, bits, sizes ) )
+	{
+		return;
+	}
+
+	imageCacheHeader_t header{ width, height, numMips, bits };
+	std::string payload( reinterpret_cast<const char *>( &header ), sizeof( header ) );
+
+	for ( size_t i = 0; i < sizes.size(); i++ )
+	{
+		payload.append( reinterpret_cast<const char *>( pic[ i ] ), sizes[ i ] );
+	}
+
+	R_WriteCacheFile( IMAGE_CACHE_DIR, key, IMAGE_CACHE_VERSION, payload );
+}
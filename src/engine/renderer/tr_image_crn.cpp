@@ -154,7 +154,7 @@ void LoadCRN(const char* name, byte **data, int *width, int *height,
              int *numLayers, int *numMips, int *bits, byte)
 {
     std::error_code err;
-    std::string buff = FS::PakPath::ReadFile( name, err );
+    std::string buff = R_ReadImageFile( name, err );
     *numLayers = 0;
     if ( err ) {
         return;
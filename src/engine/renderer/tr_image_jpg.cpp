@@ -96,7 +96,7 @@ void LoadJPG( const char *filename, unsigned char **pic, int *width, int *height
 	byte *buf;
 
 	std::error_code err;
-	std::string data = FS::PakPath::ReadFile( filename, err );
+	std::string data = R_ReadImageFile( filename, err );
 	if ( err )
 	{
 		return;
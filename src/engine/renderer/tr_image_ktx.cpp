@@ -754,7 +754,7 @@ void LoadKTX( const char *name, byte **pic, int *width, int *height,
 	*numLayers = 0;
 
 	std::error_code err;
-	std::string ktxData = FS::PakPath::ReadFile( name, err );
+	std::string ktxData = R_ReadImageFile( name, err );
 	if ( err ) {
 		return;
 	}
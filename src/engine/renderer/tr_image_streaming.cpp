@@ -0,0 +1,829 @@
+/*
+===========================================================================
+
+Daemon GPL Source Code
+Copyright (C) 2026 Daemon Developers
+
+This file is part of the Daemon GPL Source Code (Daemon Source Code).
+
+Daemon Source Code is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Daemon Source Code is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Daemon Source Code.  If not, see <http://www.gnu.org/licenses/>.
+
+===========================================================================
+*/
+
+// tr_image_streaming.cpp: mip levels of the images loaded as they are needed
+//
+// The images R_FindImageFile loads are first uploaded from a small mip level.
+// While drawsurfs are added, the front end records for each image the finest
+// level its projected size needs. Once per frame the images missing levels
+// are decoded by a loader thread, from the image cache or from their file
+// which the main thread reads, and the levels are uploaded within
+// r_textureStreamingBudget, the images unused for the longest time falling
+// back to their small level when it is full. The decoded levels are kept
+// until they are all uploaded.
+
+#include "tr_local.h"
+#include "InternalImage.h"
+#include "TextureStreaming.h"
+#include <condition_variable>
+#include <deque>
+#include <thread>
+
+static Cvar::Cvar<bool> r_textureStreaming(
+	"r_textureStreaming", "load the mip levels of the images as they are needed, for the images loaded after it is set",
+	Cvar::NONE, false );
+static Cvar::Range<Cvar::Cvar<int>> r_textureStreamingBudget(
+	"r_textureStreamingBudget", "video memory in MiB the streamed images can use",
+	Cvar::NONE, 256, 8, 65536 );
+static Cvar::Range<Cvar::Cvar<int>> r_textureStreamingLowSize(
+	"r_textureStreamingLowSize", "largest dimension of the streamed images before their levels are loaded",
+	Cvar::NONE, 64, 1, 1024 );
+static Cvar::Range<Cvar::Cvar<int>> r_textureStreamingUploads(
+	"r_textureStreamingUploads", "streamed levels uploaded per frame",
+	Cvar::NONE, 4, 1, 64 );
+
+// images being decoded at the same time, each one holds its pixels
+static const int STREAMING_MAX_LOADS = 16;
+
+// consecutive mip levels of an image, from level down
+struct streamLevel_t
+{
+	int               level = 0;
+	int               width = 0;
+	int               height = 0;
+	std::vector<byte> data;
+	std::vector<size_t> mipOffsets;
+};
+
+struct streamedImage_t
+{
+	image_t       *image;
+	int           index; // in streaming.images and streaming.budget
+	int           loader; // given by R_FindImageFileName, to decode the file when it isn't in the image cache
+	std::string   fileName;
+	std::string   cacheKey; // empty if the image isn't in the image cache
+	imageParams_t params;
+	int           numMips; // given by the loader, 1 for the uncompressed images
+	int           blockSize; // 0 for the uncompressed images
+
+	int           minLevel; // the finest level, after picmip
+	int           lowLevel; // the level the image falls back to
+	int           residentLevel;
+	streamLevel_t lowData; // to fall back without loading anything
+	streamLevel_t decoded; // the levels from minLevel, until they are all uploaded
+
+	int           requiredLevel; // finest level the front end asked for in the frame it last used the image
+	bool          loading;
+};
+
+namespace {
+struct streamLoad_t
+{
+	streamedImage_t *streamed;
+	int             loader;
+	std::string     fileName;
+	std::string     cacheKey;
+	int             width, height, bits;
+	int             firstLevel, lastLevel;
+
+	// the file is read by the main thread, as the paks can be changed
+	// by it at any time, so it is only read when there is no cache key
+	std::string     fileData;
+
+	// filled by the loader thread
+	bool            loaded = false;
+	bool            cacheMissed = false; // load it again from fileData
+	streamLevel_t   pixels;
+};
+
+struct streamingState_t
+{
+	std::vector<std::unique_ptr<streamedImage_t>> images;
+	TextureStreaming::Budget budget;
+
+	std::mutex               mutex;
+	std::condition_variable  wakeLoader;
+	std::thread              loader;
+	std::deque<streamLoad_t> loads;
+	std::vector<streamLoad_t> loaded;
+	int                      numLoads = 0;
+	bool                     quit = false;
+};
+}
+
+static streamingState_t streaming;
+
+static int R_Log2Floor( int value )
+{
+	int level = 0;
+
+	while ( value >>= 1 )
+	{
+		level++;
+	}
+
+	return level;
+}
+
+/*
+================
+R_HalveStreamLevel
+
+Box filters an uncompressed level into the next one
+================
+*/
+static void R_HalveStreamLevel( const byte *in, int width, int height, byte *out, int outWidth, int outHeight )
+{
+	for ( int y = 0; y < outHeight; y++ )
+	{
+		const byte *row = in + 4 * width * std::min( 2 * y, height - 1 );
+		const byte *row2 = in + 4 * width * std::min( 2 * y + 1, height - 1 );
+
+		for ( int x = 0; x < outWidth; x++ )
+		{
+			int x1 = 4 * std::min( 2 * x, width - 1 );
+			int x2 = 4 * std::min( 2 * x + 1, width - 1 );
+
+			for ( int c = 0; c < 4; c++ )
+			{
+				*out++ = ( row[ x1 + c ] + row[ x2 + c ] + row2[ x1 + c ] + row2[ x2 + c ] + 2 ) >> 2;
+			}
+		}
+	}
+}
+
+/*
+================
+R_ExtractStreamLevels
+
+Copies the levels of a loaded image from firstLevel to lastLevel. The
+uncompressed images only have their first level, each one is halved
+once from the previous one. The compressed images keep all the levels
+below firstLevel, which are uploaded with it
+================
+*/
+static void R_ExtractStreamLevels( const byte * const *pic, int width, int height, int numMips, int bits,
+                                   int firstLevel, int lastLevel, streamLevel_t &out )
+{
+	out.level = firstLevel;
+	out.width = std::max( width >> firstLevel, 1 );
+	out.height = std::max( height >> firstLevel, 1 );
+	out.data.clear();
+	out.mipOffsets.clear();
+
+	if ( !IsImageCompressed( bits ) )
+	{
+		std::vector<byte> half, previous;
+		const byte *in = pic[ 0 ];
+
+		for ( int i = 0; i <= lastLevel; i++ )
+		{
+			if ( i >= firstLevel )
+			{
+				out.mipOffsets.push_back( out.data.size() );
+				out.data.insert( out.data.end(), in, in + width * height * 4 );
+			}
+
+			int halfWidth = std::max( width >> 1, 1 );
+			int halfHeight = std::max( height >> 1, 1 );
+
+			if ( i < lastLevel )
+			{
+				half.resize( halfWidth * halfHeight * 4 );
+				R_HalveStreamLevel( in, width, height, half.data(), halfWidth, halfHeight );
+
+				std::swap( half, previous );
+				in = previous.data();
+			}
+
+			width = halfWidth;
+			height = halfHeight;
+		}
+
+		return;
+	}
+
+	int blockSize = ( bits & ( IF_BC1 | IF_BC4 ) ) ? 8 : 16;
+	int mipWidth = out.width;
+	int mipHeight = out.height;
+
+	for ( int i = firstLevel; i < std::max( numMips, 1 ); i++ )
+	{
+		size_t size = ( ( mipWidth + 3 ) >> 2 ) * ( ( mipHeight + 3 ) >> 2 ) * blockSize;
+
+		out.mipOffsets.push_back( out.data.size() );
+		out.data.insert( out.data.end(), pic[ i ], pic[ i ] + size );
+
+		mipWidth = std::max( mipWidth >> 1, 1 );
+		mipHeight = std::max( mipHeight >> 1, 1 );
+	}
+}
+
+static size_t R_StreamLevelSize( const streamedImage_t *streamed, int level )
+{
+	return TextureStreaming::LevelSize( streamed->image->width, streamed->image->height, streamed->numMips, streamed->blockSize, level );
+}
+
+/*
+================
+R_UploadStreamLevel
+
+Uploads level from levels, which has it
+================
+*/
+static void R_UploadStreamLevel( streamedImage_t *streamed, const streamLevel_t &levels, int level )
+{
+	image_t *image = streamed->image;
+	std::vector<const byte *> mips;
+
+	size_t first = level - levels.level;
+
+	// the uncompressed images get the other levels from glGenerateMipmap
+	size_t count = streamed->blockSize ? levels.mipOffsets.size() : first + 1;
+
+	for ( size_t i = first; i < count; i++ )
+	{
+		mips.push_back( levels.data.data() + levels.mipOffsets[ i ] );
+	}
+
+	// R_UploadImage takes the size of what it is given, while the rest
+	// of the renderer expects the size of the source image
+	uint16_t width = image->width;
+	uint16_t height = image->height;
+
+	image->width = std::max( levels.width >> first, 1 );
+	image->height = std::max( levels.height >> first, 1 );
+
+	R_UploadImage( mips.data(), 1, mips.size(), image, streamed->params );
+
+	image->width = width;
+	image->height = height;
+
+	streamed->residentLevel = level;
+	streaming.budget.SetSize( streamed->index, R_StreamLevelSize( streamed, level ) );
+}
+
+/*
+================
+R_LoadStreamLevels
+
+Decodes the image again, from the image cache when it has a cache key or
+else from the file the main thread read, which is all the loader thread
+does. Returns false if the image can't be loaded anymore
+================
+*/
+static bool R_LoadStreamLevels( streamLoad_t &load )
+{
+	byte *pic[ MAX_TEXTURE_MIPS * MAX_TEXTURE_LAYERS ];
+	int  width = 0, height = 0, numLayers = 0, numMips = 0;
+	int  bits = load.bits;
+
+	pic[ 0 ] = nullptr;
+
+	if ( !load.cacheKey.empty() )
+	{
+		if ( !R_LoadCachedImage( load.cacheKey, pic, &width, &height, &numMips, &bits ) )
+		{
+			load.cacheMissed = true;
+			return false;
+		}
+	}
+	else
+	{
+		// the loaders drop on bad data, which must not leave the thread
+		try
+		{
+			R_LoadImageFile( load.loader, load.fileName, pic, &width, &height, &numLayers, &numMips, &bits, &load.fileData );
+		}
+		catch ( const Sys::DropErr &err )
+		{
+			Log::Warn( "Could not stream %s: %s", load.fileName, err.what() );
+			return false;
+		}
+	}
+
+	if ( !pic[ 0 ] )
+	{
+		return false;
+	}
+
+	// the file changed since the image was created
+	bool loaded = numLayers == 0 && width == load.width && height == load.height && bits == load.bits;
+
+	if ( loaded )
+	{
+		R_ExtractStreamLevels( pic, width, height, numMips, bits, load.firstLevel, load.lastLevel, load.pixels );
+	}
+
+	ri.Free( pic[ 0 ] );
+	return loaded;
+}
+
+static void R_TextureStreamingLoader()
+{
+	std::unique_lock<std::mutex> lock( streaming.mutex );
+
+	while ( true )
+	{
+		streaming.wakeLoader.wait( lock, [] {
+			return streaming.quit || !streaming.loads.empty();
+		} );
+
+		if ( streaming.quit )
+		{
+			return;
+		}
+
+		streamLoad_t load = std::move( streaming.loads.front() );
+		streaming.loads.pop_front();
+
+		lock.unlock();
+		load.loaded = R_LoadStreamLevels( load );
+		lock.lock();
+
+		streaming.loaded.push_back( std::move( load ) );
+	}
+}
+
+/*
+================
+R_CreateStreamedImage
+
+Creates the image from a small level if it can be streamed, returns
+nullptr otherwise
+================
+*/
+image_t *R_CreateStreamedImage( const char *name, int loader, const std::string &fileName, const std::string &cacheKey,
+                                const byte * const *pic, int width, int height, int numMips, const imageParams_t &imageParams )
+{
+	if ( !r_textureStreaming.Get() || imageParams.filterType != filterType_t::FT_DEFAULT || loader < 0 )
+	{
+		return nullptr;
+	}
+
+	// the formats the image cache keeps, whose levels are all built the same way
+	if ( imageParams.bits & ( IF_NOPICMIP | IF_LIGHTMAP | IF_RGBE | IF_RGBA16F | IF_RGBA32F | IF_TWOCOMP16F | IF_TWOCOMP32F
+	                          | IF_ONECOMP16F | IF_ONECOMP32F | IF_RGBA16 | IF_RGBA32UI ) )
+	{
+		return nullptr;
+	}
+
+	bool compressed = IsImageCompressed( imageParams.bits );
+
+	// the levels R_UploadImage converts aren't kept
+	if ( compressed && ( ( !GLEW_EXT_texture_compression_dxt1 && !GLEW_EXT_texture_compression_s3tc )
+	                     || ( ( imageParams.bits & ( IF_BC4 | IF_BC5 ) ) && !glConfig2.textureCompressionRGTCAvailable ) ) )
+	{
+		return nullptr;
+	}
+
+	numMips = std::max( numMips, 1 );
+
+	int maxDimension = std::max( width, height );
+	int maxLevel = compressed ? numMips - 1 : R_Log2Floor( maxDimension );
+
+	// same as R_UploadImage does for the images that aren't streamed
+	image_t temp{};
+	temp.width = width;
+	temp.height = height;
+	temp.bits = imageParams.bits;
+	int minLevel = std::min( R_GetImageCustomScalingStep( &temp, imageParams ), maxLevel );
+
+	int lowLevel = minLevel;
+
+	while ( lowLevel < maxLevel && ( maxDimension >> lowLevel ) > r_textureStreamingLowSize.Get() )
+	{
+		lowLevel++;
+	}
+
+	if ( lowLevel == minLevel )
+	{
+		return nullptr;
+	}
+
+	image_t *image = R_AllocImage( name, true );
+
+	if ( !image )
+	{
+		return nullptr;
+	}
+
+	image->type = GL_TEXTURE_2D;
+	image->width = width;
+	image->height = height;
+	image->bits = imageParams.bits;
+	image->filterType = imageParams.filterType;
+	image->wrapType = imageParams.wrapType;
+
+	streaming.images.emplace_back( new streamedImage_t{} );
+	streamedImage_t *streamed = streaming.images.back().get();
+
+	streamed->image = image;
+	streamed->loader = loader;
+	streamed->fileName = fileName;
+	streamed->cacheKey = cacheKey;
+	streamed->params = imageParams;
+	streamed->numMips = numMips;
+	streamed->blockSize = !compressed ? 0 : ( imageParams.bits & ( IF_BC1 | IF_BC4 ) ) ? 8 : 16;
+	streamed->minLevel = minLevel;
+	streamed->lowLevel = lowLevel;
+	streamed->residentLevel = lowLevel;
+	streamed->requiredLevel = lowLevel;
+	streamed->index = streaming.budget.Add( R_StreamLevelSize( streamed, lowLevel ) );
+
+	image->streamed = streamed;
+
+	R_ExtractStreamLevels( pic, width, height, numMips, imageParams.bits, lowLevel, lowLevel, streamed->lowData );
+	R_UploadStreamLevel( streamed, streamed->lowData, lowLevel );
+
+	return image;
+}
+
+/*
+================
+R_DrawSurfProjectedSize
+
+Diameter in pixels of the bounding sphere of a surface, 0 if unknown
+================
+*/
+static float R_DrawSurfProjectedSize( const surfaceType_t *surface, bool bspSurface )
+{
+	vec3_t origin;
+	float  radius;
+
+	if ( bspSurface && ( *surface == surfaceType_t::SF_FACE || *surface == surfaceType_t::SF_GRID
+	                     || *surface == surfaceType_t::SF_TRIANGLES || *surface == surfaceType_t::SF_VBO_MESH ) )
+	{
+		const srfGeneric_t *gen = reinterpret_cast<const srfGeneric_t *>( surface );
+
+		VectorCopy( gen->origin, origin );
+		radius = gen->radius;
+	}
+	else if ( tr.currentEntity != &tr.worldEntity )
+	{
+		const trRefEntity_t *ent = tr.currentEntity;
+
+		VectorAdd( ent->worldBounds[ 0 ], ent->worldBounds[ 1 ], origin );
+		VectorScale( origin, 0.5f, origin );
+		radius = Distance( ent->worldBounds[ 0 ], ent->worldBounds[ 1 ] ) * 0.5f;
+
+		if ( radius <= 0.0f )
+		{
+			VectorCopy( ent->e.origin, origin );
+			radius = ent->e.radius;
+		}
+	}
+	else
+	{
+		return 0.0f;
+	}
+
+	float distance = Distance( origin, tr.viewParms.orientation.origin ) - radius;
+
+	if ( radius <= 0.0f || distance < 1.0f )
+	{
+		return 0.0f;
+	}
+
+	float pixelsPerUnit = tr.viewParms.viewportWidth / ( 2.0f * distance * tanf( DEG2RAD( tr.viewParms.fovX * 0.5f ) ) );
+
+	return 2.0f * radius * pixelsPerUnit;
+}
+
+/*
+================
+R_RequestStreamedImages
+
+Records the levels the images of a drawsurf need, from its projected size
+================
+*/
+void R_RequestStreamedImages( const surfaceType_t *surface, const shader_t *shader, bool bspSurface )
+{
+	if ( streaming.images.empty() )
+	{
+		return;
+	}
+
+	float size = -1.0f;
+
+	for ( int i = 0; i < shader->numStages; i++ )
+	{
+		const shaderStage_t *stage = shader->stages[ i ];
+
+		for ( const textureBundle_t &bundle : stage->bundle )
+		{
+			for ( int j = 0; j < bundle.numImages; j++ )
+			{
+				streamedImage_t *streamed = bundle.image[ j ] ? bundle.image[ j ]->streamed : nullptr;
+
+				if ( !streamed )
+				{
+					continue;
+				}
+
+				if ( size < 0.0f )
+				{
+					size = R_DrawSurfProjectedSize( surface, bspSurface );
+				}
+
+				int level = streamed->minLevel;
+
+				if ( size > 0.0f )
+				{
+					int maxDimension = std::max( streamed->image->width, streamed->image->height );
+					int texelsPerPixel = maxDimension / std::max( static_cast<int>( size ), 1 );
+
+					if ( texelsPerPixel > 1 )
+					{
+						level = Math::Clamp( R_Log2Floor( texelsPerPixel ), streamed->minLevel, streamed->lowLevel );
+					}
+				}
+
+				if ( streaming.budget.LastUsed( streamed->index ) != tr.frameCount )
+				{
+					streaming.budget.Use( streamed->index, tr.frameCount );
+					streamed->requiredLevel = level;
+				}
+				else
+				{
+					streamed->requiredLevel = std::min( streamed->requiredLevel, level );
+				}
+			}
+		}
+	}
+}
+
+/*
+================
+R_UploadDecodedLevel
+
+Uploads the level an image needs from its decoded levels, if it fits in
+the budget once the images unused for the longest time are put back to
+their low level
+================
+*/
+static bool R_UploadDecodedLevel( streamedImage_t *streamed )
+{
+	int level = std::max( streamed->requiredLevel, streamed->decoded.level );
+	size_t size = R_StreamLevelSize( streamed, level );
+	size_t budget = static_cast<size_t>( r_textureStreamingBudget.Get() ) << 20;
+	size_t resident = streaming.budget.Size( streamed->index );
+	std::vector<int> evicted;
+
+	if ( size > resident && !streaming.budget.Evict( size - resident, budget, streamed->index, tr.frameCount, evicted ) )
+	{
+		return false;
+	}
+
+	for ( int index : evicted )
+	{
+		streamedImage_t *other = streaming.images[ index ].get();
+
+		R_UploadStreamLevel( other, other->lowData, other->lowLevel );
+
+		// decoded again if it is needed again, so that the memory they
+		// keep stays close to what is resident
+		other->decoded = {};
+	}
+
+	R_UploadStreamLevel( streamed, streamed->decoded, level );
+
+	if ( streamed->residentLevel == streamed->decoded.level )
+	{
+		streamed->decoded = {};
+	}
+
+	return true;
+}
+
+/*
+================
+R_UpdateTextureStreaming
+
+Uploads the levels the images of the last frame need from the ones
+the loader thread decoded, and sends it the images it has to decode
+================
+*/
+void R_UpdateTextureStreaming()
+{
+	if ( streaming.images.empty() )
+	{
+		return;
+	}
+
+	std::vector<streamLoad_t> loaded;
+
+	{
+		std::lock_guard<std::mutex> lock( streaming.mutex );
+		loaded.swap( streaming.loaded );
+	}
+
+	for ( streamLoad_t &load : loaded )
+	{
+		streamedImage_t *streamed = load.streamed;
+
+		streamed->loading = false;
+		streaming.numLoads--;
+
+		if ( load.loaded )
+		{
+			streamed->decoded = std::move( load.pixels );
+		}
+		else if ( load.cacheMissed )
+		{
+			// the cache file was pruned, read the file from now on
+			streamed->cacheKey.clear();
+		}
+		else
+		{
+			// don't try again every frame
+			streamed->minLevel = streamed->residentLevel;
+			streamed->lowLevel = streamed->residentLevel;
+		}
+	}
+
+	std::vector<streamedImage_t *> wanted;
+
+	for ( auto &streamed : streaming.images )
+	{
+		if ( !streamed->loading && streaming.budget.LastUsed( streamed->index ) == tr.frameCount
+		     && streamed->requiredLevel < streamed->residentLevel )
+		{
+			wanted.push_back( streamed.get() );
+		}
+	}
+
+	// the images furthest from the level they need first
+	std::sort( wanted.begin(), wanted.end(), []( const streamedImage_t *a, const streamedImage_t *b ) {
+		return a->residentLevel - a->requiredLevel > b->residentLevel - b->requiredLevel;
+	} );
+
+	int uploads = r_textureStreamingUploads.Get();
+	std::vector<streamLoad_t> loads;
+
+	for ( streamedImage_t *streamed : wanted )
+	{
+		if ( !streamed->decoded.data.empty() )
+		{
+			if ( uploads > 0 && R_UploadDecodedLevel( streamed ) )
+			{
+				uploads--;
+			}
+
+			continue;
+		}
+
+		if ( streaming.numLoads + static_cast<int>( loads.size() ) >= STREAMING_MAX_LOADS )
+		{
+			continue;
+		}
+
+		streamLoad_t load;
+
+		load.streamed = streamed;
+		load.loader = streamed->loader;
+		load.fileName = streamed->fileName;
+		load.cacheKey = streamed->cacheKey;
+		load.width = streamed->image->width;
+		load.height = streamed->image->height;
+		load.bits = streamed->params.bits;
+		load.firstLevel = streamed->minLevel;
+		load.lastLevel = streamed->lowLevel - 1;
+
+		if ( load.cacheKey.empty() )
+		{
+			std::error_code err;
+			load.fileData = FS::PakPath::ReadFile( load.fileName, err );
+
+			if ( err )
+			{
+				// don't try again every frame
+				streamed->minLevel = streamed->residentLevel;
+				streamed->lowLevel = streamed->residentLevel;
+				continue;
+			}
+		}
+
+		streamed->loading = true;
+		loads.push_back( std::move( load ) );
+	}
+
+	if ( loads.empty() )
+	{
+		return;
+	}
+
+	streaming.numLoads += loads.size();
+
+	{
+		std::lock_guard<std::mutex> lock( streaming.mutex );
+
+		for ( streamLoad_t &load : loads )
+		{
+			streaming.loads.push_back( std::move( load ) );
+		}
+
+		if ( !streaming.loader.joinable() )
+		{
+			try
+			{
+				streaming.loader = std::thread( R_TextureStreamingLoader );
+			}
+			catch ( std::system_error &err )
+			{
+				Log::Warn( "Could not start the texture streaming thread: %s", err.what() );
+			}
+		}
+	}
+
+	if ( streaming.loader.joinable() )
+	{
+		streaming.wakeLoader.notify_one();
+	}
+	else
+	{
+		// load them here instead
+		std::vector<streamLoad_t> pending;
+
+		{
+			std::lock_guard<std::mutex> lock( streaming.mutex );
+			pending.assign( std::make_move_iterator( streaming.loads.begin() ), std::make_move_iterator( streaming.loads.end() ) );
+			streaming.loads.clear();
+		}
+
+		for ( streamLoad_t &load : pending )
+		{
+			load.loaded = R_LoadStreamLevels( load );
+			streaming.loaded.push_back( std::move( load ) );
+		}
+	}
+}
+
+/*
+================
+R_ShutdownTextureStreaming
+
+Forgets the streamed images, which stay at the level they have
+================
+*/
+void R_ShutdownTextureStreaming()
+{
+	if ( streaming.loader.joinable() )
+	{
+		{
+			std::lock_guard<std::mutex> lock( streaming.mutex );
+			streaming.quit = true;
+		}
+
+		streaming.wakeLoader.notify_one();
+		streaming.loader.join();
+	}
+
+	for ( auto &streamed : streaming.images )
+	{
+		streamed->image->streamed = nullptr;
+	}
+
+	streaming.images.clear();
+	streaming.budget.Clear();
+	streaming.loads.clear();
+	streaming.loaded.clear();
+	streaming.numLoads = 0;
+	streaming.quit = false;
+}
+
+/*
+================
+R_TextureStreamingInfo_f
+================
+*/
+void R_TextureStreamingInfo_f()
+{
+	int numFull = 0;
+	size_t decodedSize = 0;
+
+	for ( auto &streamed : streaming.images )
+	{
+		if ( streamed->residentLevel == streamed->minLevel )
+		{
+			numFull++;
+		}
+
+		decodedSize += streamed->decoded.data.size();
+	}
+
+	Log::Notice( "%d streamed images, %d fully loaded, %d being loaded", streaming.images.size(), numFull, streaming.numLoads );
+	Log::Notice( "%.1f MiB used out of %d MiB", streaming.budget.Used() / 1048576.0, r_textureStreamingBudget.Get() );
+	Log::Notice( "%.1f MiB of decoded levels waiting to be uploaded", decodedSize / 1048576.0 );
+}
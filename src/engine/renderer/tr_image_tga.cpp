@@ -44,7 +44,7 @@ void LoadTGA( const char *name, byte **pic, int *width, int *height,
 	// load the file
 	//
 	std::error_code err;
-	std::string buffer = FS::PakPath::ReadFile( name, err );
+	std::string buffer = R_ReadImageFile( name, err );
 
 	if ( err )
 	{
@@ -309,7 +309,7 @@ breakOut:
 
 		//Log::Warn("'%s' TGA file header declares top-down image, flipping", name);
 
-		flip = ( unsigned char * ) ri.Hunk_AllocateTempMemory( columns * 4 );
+		flip = ( unsigned char * ) ri.Z_Malloc( columns * 4 );
 
 		for ( row = 0; row < (int) rows / 2; row++ )
 		{
@@ -321,6 +321,6 @@ breakOut:
 			memcpy( dst, flip, columns * 4 );
 		}
 
-		ri.Hunk_FreeTempMemory( flip );
+		ri.Free( flip );
 	}
 }
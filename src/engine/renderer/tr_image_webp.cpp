@@ -61,7 +61,7 @@ void LoadWEBP( const char *path, byte **pic, int *width, int *height, int *, int
 	*pic = nullptr;
 	
 	std::error_code err;
-	std::string webpData = FS::PakPath::ReadFile( path, err );
+	std::string webpData = R_ReadImageFile( path, err );
 	if ( err ) {
 		return;
 	}
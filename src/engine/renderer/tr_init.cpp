@@ -96,6 +96,9 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 	cvar_t      *r_arb_buffer_storage;
 	cvar_t      *r_arb_map_buffer_range;
 	cvar_t      *r_arb_sync;
+	cvar_t      *r_arb_instanced_arrays;
+	cvar_t      *r_arb_multi_draw_indirect;
+	cvar_t      *r_khr_parallel_shader_compile;
 	cvar_t      *r_arb_uniform_buffer_object;
 	cvar_t      *r_arb_texture_gather;
 	cvar_t      *r_arb_gpu_shader5;
@@ -1086,6 +1089,9 @@ ScreenshotCmd screenshotPNGRegistration("screenshotPNG", ssFormat_t::SSF_PNG, "p
 		r_arb_buffer_storage = Cvar_Get( "r_arb_buffer_storage", "1", CVAR_CHEAT | CVAR_LATCH );
 		r_arb_map_buffer_range = Cvar_Get( "r_arb_map_buffer_range", "1", CVAR_CHEAT | CVAR_LATCH );
 		r_arb_sync = Cvar_Get( "r_arb_sync", "1", CVAR_CHEAT | CVAR_LATCH );
+		r_arb_instanced_arrays = Cvar_Get( "r_arb_instanced_arrays", "1", CVAR_CHEAT | CVAR_LATCH );
+		r_arb_multi_draw_indirect = Cvar_Get( "r_arb_multi_draw_indirect", "1", CVAR_CHEAT | CVAR_LATCH );
+		r_khr_parallel_shader_compile = Cvar_Get( "r_khr_parallel_shader_compile", "1", CVAR_CHEAT | CVAR_LATCH );
 		r_arb_uniform_buffer_object = Cvar_Get( "r_arb_uniform_buffer_object", "1", CVAR_CHEAT | CVAR_LATCH );
 		r_arb_texture_gather = Cvar_Get( "r_arb_texture_gather", "1", CVAR_CHEAT | CVAR_LATCH );
 		r_arb_gpu_shader5 = Cvar_Get( "r_arb_gpu_shader5", "1", CVAR_CHEAT | CVAR_LATCH );
@@ -1344,6 +1350,7 @@ ScreenshotCmd screenshotPNGRegistration("screenshotPNG", ssFormat_t::SSF_PNG, "p
 
 		// make sure all the commands added here are also removed in R_Shutdown
 		ri.Cmd_AddCommand( "imagelist", R_ImageList_f );
+		ri.Cmd_AddCommand( "texturestreaminginfo", R_TextureStreamingInfo_f );
 		ri.Cmd_AddCommand( "shaderlist", R_ShaderList_f );
 		ri.Cmd_AddCommand( "shaderexp", R_ShaderExp_f );
 		ri.Cmd_AddCommand( "skinlist", R_SkinList_f );
@@ -1467,6 +1474,9 @@ ScreenshotCmd screenshotPNGRegistration("screenshotPNG", ssFormat_t::SSF_PNG, "p
 
 		R_ToggleSmpFrame();
 
+		// before the caches are read
+		R_PruneCacheFiles();
+
 		R_InitImages();
 
 		R_InitFBOs();
@@ -1511,6 +1521,7 @@ ScreenshotCmd screenshotPNGRegistration("screenshotPNG", ssFormat_t::SSF_PNG, "p
 
 		ri.Cmd_RemoveCommand( "modellist" );
 		ri.Cmd_RemoveCommand( "imagelist" );
+		ri.Cmd_RemoveCommand( "texturestreaminginfo" );
 		ri.Cmd_RemoveCommand( "shaderlist" );
 		ri.Cmd_RemoveCommand( "shaderexp" );
 		ri.Cmd_RemoveCommand( "skinlist" );
@@ -1535,10 +1546,13 @@ ScreenshotCmd screenshotPNGRegistration("screenshotPNG", ssFormat_t::SSF_PNG, "p
 			R_ShutdownVBOs();
 			R_ShutdownFBOs();
 			R_ShutdownVisTests();
+			R_ShutdownSceneBuffers();
 		}
 
 		R_DoneFreeType();
 
+		R_ShutdownJobs();
+
 		// shut down platform specific OpenGL stuff
 		if ( destroyWindow )
 		{
@@ -1569,6 +1583,10 @@ ScreenshotCmd screenshotPNGRegistration("screenshotPNG", ssFormat_t::SSF_PNG, "p
 		{
 			GLSL_FinishGPUShaders();
 		}
+		else if ( r_lazyShaders->integer == 2 )
+		{
+			GLSL_PrewarmGPUShaders();
+		}
 	}
 
 	/*
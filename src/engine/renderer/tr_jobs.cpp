@@ -0,0 +1,244 @@
+/*
+===========================================================================
+
+Daemon GPL Source Code
+Copyright (C) 2026 Daemon Developers
+
+This file is part of the Daemon GPL Source Code (Daemon Source Code).
+
+Daemon Source Code is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Daemon Source Code is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Daemon Source Code.  If not, see <http://www.gnu.org/licenses/>.
+
+===========================================================================
+*/
+
+// tr_jobs.cpp: worker threads for the renderer front end
+//
+// R_RunJobs splits a loop over a batch of independent jobs between the
+// calling thread and the workers, and returns once all of them are done.
+// Jobs must not touch the global renderer state nor throw: they write into
+// their own buffers, that the caller merges afterwards.
+
+#include "tr_local.h"
+#include <condition_variable>
+#include <thread>
+
+static Cvar::Range<Cvar::Cvar<int>> r_jobThreads(
+	"r_jobThreads", "worker threads helping the renderer front end, -1 for one less than the number of cores",
+	Cvar::NONE, -1, -1, 63 );
+
+namespace {
+struct jobQueue_t
+{
+	std::mutex                         mutex;
+	std::condition_variable            wakeWorkers;
+	std::condition_variable            batchDone;
+	std::vector<std::thread>           workers;
+	int                                numWorkersWanted = 0;
+
+	// the current batch, changes when generation is incremented
+	const std::function<void( int )>   *job = nullptr;
+	int                                numJobs = 0;
+	std::atomic<int>                   nextJob{ 0 };
+	int                                runningWorkers = 0;
+	unsigned                           generation = 0;
+	bool                               quit = false;
+
+	// set while a batch runs, so that a job running more jobs does them itself
+	std::atomic<bool>                  busy{ false };
+};
+}
+
+static jobQueue_t jobQueue;
+
+static void R_RunQueuedJobs( const std::function<void( int )> &job, int numJobs )
+{
+	int i;
+
+	while ( ( i = jobQueue.nextJob++ ) < numJobs )
+	{
+		job( i );
+	}
+}
+
+// the generation isn't reset when the workers are restarted, a new worker
+// is given the one at its start and only wakes up for the batches after it
+static void R_JobWorker( unsigned generation )
+{
+	std::unique_lock<std::mutex> lock( jobQueue.mutex );
+
+	while ( true )
+	{
+		jobQueue.wakeWorkers.wait( lock, [ & ] {
+			return jobQueue.quit || jobQueue.generation != generation;
+		} );
+
+		if ( jobQueue.quit )
+		{
+			return;
+		}
+
+		generation = jobQueue.generation;
+
+		const std::function<void( int )> *job = jobQueue.job;
+		int numJobs = jobQueue.numJobs;
+
+		lock.unlock();
+		R_RunQueuedJobs( *job, numJobs );
+		lock.lock();
+
+		// every worker takes part in every batch, so the batch can't be
+		// replaced while one of them still looks at it
+		if ( --jobQueue.runningWorkers == 0 )
+		{
+			jobQueue.batchDone.notify_one();
+		}
+	}
+}
+
+/*
+===============
+R_ShutdownJobs
+===============
+*/
+void R_ShutdownJobs()
+{
+	{
+		std::lock_guard<std::mutex> lock( jobQueue.mutex );
+		jobQueue.quit = true;
+	}
+
+	jobQueue.wakeWorkers.notify_all();
+
+	for ( std::thread &worker : jobQueue.workers )
+	{
+		worker.join();
+	}
+
+	jobQueue.workers.clear();
+	jobQueue.quit = false;
+}
+
+/*
+===============
+R_UpdateJobThreads
+
+Starts or stops workers when r_jobThreads changes
+===============
+*/
+static void R_UpdateJobThreads()
+{
+	int wanted = r_jobThreads.Get();
+
+	if ( wanted < 0 )
+	{
+		wanted = std::max( 0, static_cast<int>( std::thread::hardware_concurrency() ) - 1 );
+		wanted = std::min( wanted, 63 );
+	}
+
+	if ( wanted == jobQueue.numWorkersWanted && static_cast<int>( jobQueue.workers.size() ) == wanted )
+	{
+		return;
+	}
+
+	R_ShutdownJobs();
+
+	jobQueue.numWorkersWanted = wanted;
+
+	std::lock_guard<std::mutex> lock( jobQueue.mutex );
+
+	try
+	{
+		for ( int i = 0; i < wanted; i++ )
+		{
+			jobQueue.workers.emplace_back( R_JobWorker, jobQueue.generation );
+		}
+	}
+	catch ( std::system_error &err )
+	{
+		Log::Warn( "Could only start %d renderer job threads: %s", static_cast<int>( jobQueue.workers.size() ), err.what() );
+	}
+}
+
+/*
+===============
+R_NumJobThreads
+
+Number of threads running jobs, including the calling one
+===============
+*/
+int R_NumJobThreads()
+{
+	if ( !jobQueue.busy.exchange( true ) )
+	{
+		R_UpdateJobThreads();
+		jobQueue.busy = false;
+	}
+
+	return 1 + jobQueue.workers.size();
+}
+
+/*
+===============
+R_RunJobs
+
+Calls job for every number in [0, numJobs) and waits for all of them
+===============
+*/
+void R_RunJobs( int numJobs, const std::function<void( int )> &job )
+{
+	// a single thread claims the queue, the workers are only restarted
+	// by the thread holding it
+	if ( numJobs <= 1 || jobQueue.busy.exchange( true ) )
+	{
+		for ( int i = 0; i < numJobs; i++ )
+		{
+			job( i );
+		}
+
+		return;
+	}
+
+	R_UpdateJobThreads();
+
+	if ( jobQueue.workers.empty() )
+	{
+		for ( int i = 0; i < numJobs; i++ )
+		{
+			job( i );
+		}
+
+		jobQueue.busy = false;
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock( jobQueue.mutex );
+		jobQueue.job = &job;
+		jobQueue.numJobs = numJobs;
+		jobQueue.nextJob = 0;
+		jobQueue.runningWorkers = jobQueue.workers.size();
+		jobQueue.generation++;
+	}
+
+	jobQueue.wakeWorkers.notify_all();
+
+	R_RunQueuedJobs( job, numJobs );
+
+	{
+		std::unique_lock<std::mutex> lock( jobQueue.mutex );
+		jobQueue.batchDone.wait( lock, [] { return jobQueue.runningWorkers == 0; } );
+	}
+
+	jobQueue.busy = false;
+}
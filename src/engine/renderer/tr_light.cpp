@@ -22,6 +22,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 */
 // tr_light.c
 #include "tr_local.h"
+#include "common/RadixSort.h"
 
 /*
 =============
@@ -895,9 +896,14 @@ bool R_AddLightInteraction( trRefLight_t *light, surfaceType_t *surface, shader_
 		return false;
 	}
 
-	// instead of checking for overflow, we just mask the index
-	// so it wraps around
-	iaIndex = tr.refdef.numInteractions & INTERACTION_MASK;
+	// same as R_AddDrawSurf, the buffer is grown for the next frames
+	if ( tr.refdef.numInteractions >= tr.refdef.maxInteractions )
+	{
+		backEndData[ tr.smpFrame ]->numDroppedInteractions++;
+		return false;
+	}
+
+	iaIndex = tr.refdef.numInteractions;
 	ia = &tr.refdef.interactions[ iaIndex ];
 	tr.refdef.numInteractions++;
 
@@ -957,47 +963,26 @@ bool R_AddLightInteraction( trRefLight_t *light, surfaceType_t *surface, shader_
 
 /*
 =================
-InteractionCompare
-compare function for qsort()
+InteractionSortKey
+
+Shader first, then the world entity, then the other entities
 =================
 */
-static int InteractionCompare( const void *a, const void *b )
+static uint64_t InteractionSortKey( const interaction_t &ia )
 {
-	// shader first
-	if ( ( ( interaction_t * ) a )->shaderNum < ( ( interaction_t * ) b )->shaderNum )
-	{
-		return -1;
-	}
-
-	else if ( ( ( interaction_t * ) a )->shaderNum > ( ( interaction_t * ) b )->shaderNum )
-	{
-		return 1;
-	}
+	uint64_t entityNum = 0;
 
-	// then entity
-	if ( ( ( interaction_t * ) a )->entity == &tr.worldEntity && ( ( interaction_t * ) b )->entity != &tr.worldEntity )
+	if ( ia.entity != &tr.worldEntity )
 	{
-		return -1;
+		entityNum = ia.entity - tr.refdef.entities + 1;
 	}
 
-	else if ( ( ( interaction_t * ) a )->entity != &tr.worldEntity && ( ( interaction_t * ) b )->entity == &tr.worldEntity )
-	{
-		return 1;
-	}
-
-	else if ( ( ( interaction_t * ) a )->entity < ( ( interaction_t * ) b )->entity )
-	{
-		return -1;
-	}
-
-	else if ( ( ( interaction_t * ) a )->entity > ( ( interaction_t * ) b )->entity )
-	{
-		return 1;
-	}
-
-	return 0;
+	return ( uint64_t( uint32_t( ia.shaderNum ) ) << 32 ) | entityNum;
 }
 
+// keeps its buffers from a light to the next
+static Util::RadixSorter<interaction_t> interactionSorter;
+
 /*
 =================
 R_SortInteractions
@@ -1025,7 +1010,7 @@ void R_SortInteractions( trRefLight_t *light )
 	iaFirstIndex = light->firstInteraction - tr.refdef.interactions;
 
 	// sort by material etc. for geometry batching in the renderer backend
-	qsort( iaFirst, light->numInteractions, sizeof( interaction_t ), InteractionCompare );
+	interactionSorter.Sort( iaFirst, light->numInteractions, InteractionSortKey );
 
 	// fix linked list
 	iaLast = nullptr;
@@ -187,11 +187,10 @@ static inline void halfToFloat( const f16vec4_t in, vec4_t out )
 
 #define MAX_IN_GAME_VIDEOS 32
 
-#define MAX_DRAWSURFS      0x10000
-#define DRAWSURF_MASK      ( MAX_DRAWSURFS - 1 )
-
-#define MAX_INTERACTIONS   ( MAX_DRAWSURFS * 8 )
-#define INTERACTION_MASK   ( MAX_INTERACTIONS - 1 )
+// the drawsurf and interaction buffers start at the min size and are
+// resized to what the frames need, see R_ToggleSmpFrame
+#define MIN_DRAWSURFS      0x4000
+#define MIN_INTERACTIONS   0x10000
 
 // 16x16 pixels per tile
 #define TILE_SHIFT 4
@@ -701,6 +700,8 @@ enum class deluxeMode_t { NONE, GRID, MAP };
 		int maxDimension = 0;
 	};
 
+	struct streamedImage_t;
+
 	struct image_t
 	{
 		char name[ MAX_QPATH ];
@@ -719,6 +720,8 @@ enum class deluxeMode_t { NONE, GRID, MAP };
 		filterType_t   filterType;
 		wrapType_t     wrapType;
 
+		streamedImage_t *streamed; // mip levels loaded by tr_image_streaming.cpp, or nullptr
+
 		image_t *next;
 	};
 
@@ -764,6 +767,10 @@ enum class deluxeMode_t { NONE, GRID, MAP };
 		// GPU vertex animations
 		ATTR_INDEX_POSITION2,
 		ATTR_INDEX_QTANGENT2,
+
+		// GPU instancing, sourced from the instance VBO
+		ATTR_INDEX_INSTANCE_ROTATION,
+		ATTR_INDEX_INSTANCE_TRANSLATION,
 		ATTR_INDEX_MAX
 	};
 
@@ -777,7 +784,9 @@ enum class deluxeMode_t { NONE, GRID, MAP };
 		"attr_Orientation",
 		"attr_BoneFactors",
 		"attr_Position2",
-		"attr_QTangent2"
+		"attr_QTangent2",
+		"attr_InstanceRotation",
+		"attr_InstanceTranslation"
 	};
 
 	enum
@@ -796,6 +805,12 @@ enum class deluxeMode_t { NONE, GRID, MAP };
 
 	  ATTR_INTERP_BITS = ATTR_POSITION2 | ATTR_QTANGENT2,
 
+	  // one transform_t per instance
+	  ATTR_INSTANCE_ROTATION    = BIT( ATTR_INDEX_INSTANCE_ROTATION ),
+	  ATTR_INSTANCE_TRANSLATION = BIT( ATTR_INDEX_INSTANCE_TRANSLATION ),
+
+	  ATTR_INSTANCE_BITS = ATTR_INSTANCE_ROTATION | ATTR_INSTANCE_TRANSLATION,
+
 	  ATTR_BITS = ATTR_POSITION |
 	              ATTR_TEXCOORD |
 	              ATTR_QTANGENT |
@@ -1496,6 +1511,9 @@ enum class deluxeMode_t { NONE, GRID, MAP };
 		GLint    *uniformLocations;
 		GLuint   *uniformBlockIndexes;
 		byte     *uniformFirewall;
+		bool      pending; // still being built by the driver, see GLShaderManager::FinishPermutation
+		bool      fromBinary; // loaded from the program binary cache
+		bool      used; // bound since it was built, see GLShaderManager::SavePrewarmList
 	};
 
 // trRefdef_t holds everything that comes in refdef_t,
@@ -1535,12 +1553,15 @@ enum class deluxeMode_t { NONE, GRID, MAP };
 		struct srfDecal_t       *decals;
 
 		int                     numDrawSurfs;
+		int                     maxDrawSurfs;
 		struct drawSurf_t       *drawSurfs;
 
 		int                     numInteractions;
+		int                     maxInteractions;
 		struct interaction_t    *interactions;
 
 		byte                    *pixelTarget; //set this to Non Null to copy to a buffer after scene rendering
+		GLuint                  pixelTargetPBO; // if not 0 the copy goes to this PBO instead of pixelTarget
 		int                     pixelTargetWidth;
 		int                     pixelTargetHeight;
 
@@ -1700,9 +1721,9 @@ enum class deluxeMode_t { NONE, GRID, MAP };
 	// 2. lightmapNum
 	// 3. entityNum
 	// 4. fogNum
-	// 5. index
+	// the sort is stable, so the surfaces with the same key stay in the
+	// order they were added, see R_SortDrawSurfs
 
-	static const uint64_t SORT_INDEX_BITS = 16;
 	static const uint64_t SORT_FOGNUM_BITS = 13;
 	static const uint64_t SORT_ENTITYNUM_BITS = 10;
 	static const uint64_t SORT_LIGHTMAP_BITS = 9;
@@ -1711,23 +1732,19 @@ enum class deluxeMode_t { NONE, GRID, MAP };
 	static_assert( SORT_SHADER_BITS +
 		SORT_LIGHTMAP_BITS +
 		SORT_ENTITYNUM_BITS +
-		SORT_FOGNUM_BITS +
-		SORT_INDEX_BITS == 64, "invalid number of drawSurface sort bits" );
+		SORT_FOGNUM_BITS <= 64, "invalid number of drawSurface sort bits" );
 
-	static const uint64_t SORT_FOGNUM_SHIFT = SORT_INDEX_BITS;
+	static const uint64_t SORT_FOGNUM_SHIFT = 0;
 	static const uint64_t SORT_ENTITYNUM_SHIFT = SORT_FOGNUM_BITS + SORT_FOGNUM_SHIFT;
 	static const uint64_t SORT_LIGHTMAP_SHIFT = SORT_ENTITYNUM_BITS + SORT_ENTITYNUM_SHIFT;
 	static const uint64_t SORT_SHADER_SHIFT = SORT_LIGHTMAP_BITS + SORT_LIGHTMAP_SHIFT;
 
 #define MASKBITS( b ) ( 1 << (b) ) - 1
-	static const uint32_t SORT_INDEX_MASK = MASKBITS( SORT_INDEX_BITS );
 	static const uint32_t SORT_FOGNUM_MASK = MASKBITS( SORT_FOGNUM_BITS );
 	static const uint32_t SORT_ENTITYNUM_MASK = MASKBITS( SORT_ENTITYNUM_BITS );
 	static const uint32_t SORT_LIGHTMAP_MASK = MASKBITS( SORT_LIGHTMAP_BITS );
 	static const uint32_t SORT_SHADER_MASK = MASKBITS( SORT_SHADER_BITS );
 
-	static_assert( SORT_INDEX_MASK >= MAX_DRAWSURFS - 1, "not enough index bits" );
-
 	// need space for 0 fog (no fog), in addition to MAX_MAP_FOGS
 	static_assert( SORT_FOGNUM_MASK >= MAX_MAP_FOGS, "not enough fognum bits" );
 
@@ -1747,9 +1764,6 @@ enum class deluxeMode_t { NONE, GRID, MAP };
 		uint64_t      sort;
 		bool          bspSurface;
 
-		inline int index() const {
-			return int( ( sort & SORT_INDEX_MASK ) );
-		}
 		inline int entityNum() const {
 			return int( ( sort >> SORT_ENTITYNUM_SHIFT ) & SORT_ENTITYNUM_MASK ) - 1;
 		}
@@ -1763,11 +1777,10 @@ enum class deluxeMode_t { NONE, GRID, MAP };
 			return int( sort >> SORT_SHADER_SHIFT );
 		}
 
-		inline void setSort( int shaderNum, int lightmapNum, int entityNum, int fogNum, int index ) {
+		inline void setSort( int shaderNum, int lightmapNum, int entityNum, int fogNum ) {
 			entityNum = entityNum + 1; //world entity is -1
 			lightmapNum = lightmapNum + 1; //no lightmap is -1
-			sort = uint64_t( index & SORT_INDEX_MASK ) |
-				( uint64_t( fogNum & SORT_FOGNUM_MASK ) << SORT_FOGNUM_SHIFT ) |
+			sort = ( uint64_t( fogNum & SORT_FOGNUM_MASK ) << SORT_FOGNUM_SHIFT ) |
 				( uint64_t( entityNum & SORT_ENTITYNUM_MASK ) << SORT_ENTITYNUM_SHIFT ) |
 				( uint64_t( lightmapNum & SORT_LIGHTMAP_MASK ) << SORT_LIGHTMAP_SHIFT ) |
 				( uint64_t( shaderNum & SORT_SHADER_MASK ) << SORT_SHADER_SHIFT );
@@ -2041,6 +2054,18 @@ enum class deluxeMode_t { NONE, GRID, MAP };
 		surfaceType_t   *data; // any of srf*_t
 	};
 
+// a large convex world face that hides what is behind it, see OcclusionCull.h
+#define MAX_OCCLUDER_POINTS 16
+
+	struct occluder_t
+	{
+		vec3_t   bounds[ 2 ];
+		cplane_t plane;
+
+		int      numPoints;
+		vec3_t   points[ MAX_OCCLUDER_POINTS ];
+	};
+
 // ydnar: bsp model decal surfaces
 	struct decal_t
 	{
@@ -2072,6 +2097,16 @@ enum class deluxeMode_t { NONE, GRID, MAP };
 
 		int          firstMarkSurface;
 		int          numMarkSurfaces;
+
+		int          flatIndex; // into the world_t flat node arrays
+	};
+
+	// bounds of a flattened node, kept as center and half size so that the
+	// distance of the box to a plane is a dot product each
+	struct bspNodeBounds_t
+	{
+		vec3_t center;
+		vec3_t extents;
 	};
 
 	struct bspModel_t
@@ -2125,6 +2160,15 @@ enum class deluxeMode_t { NONE, GRID, MAP };
 		int           numSkyNodes;
 		bspNode_t     **skyNodes; // ydnar: don't walk the entire bsp when rendering sky
 
+		// the nodes again in depth first order, split into the few arrays
+		// the world walk reads so that it doesn't go through bspNode_t
+		bspNode_t       **flatNodes;
+		bspNodeBounds_t *flatBounds;
+		int             ( *flatChildren )[ 2 ]; // 0 for leafs, the root is never a child
+		vec4_t          *flatPlanes; // normal and dist of the splitting plane
+		int             *flatParents; // -1 for the root
+		int             *flatVisCounts; // numnodes per vis index
+
 		int           numVerts;
 		srfVert_t     *verts;
 		VBO_t         *vbo;
@@ -2174,6 +2218,11 @@ enum class deluxeMode_t { NONE, GRID, MAP };
 
 		int                clusterBytes;
 		const byte         *vis; // may be passed in by CM_LoadMap to save space
+		const int          *clusterLeafOffsets; // numClusters + 2, nullptr without vis
+		const int          *clusterLeaves; // flat indexes of the leafs of each cluster, then of those without one
+
+		int                numOccluders;
+		occluder_t         *occluders;
 		byte       *visvis; // clusters visible from visible clusters
 		byte               *novis; // clusterBytes of 0xff
 
@@ -2531,6 +2580,9 @@ enum class deluxeMode_t { NONE, GRID, MAP };
 		int c_pyramidTests;
 		int c_pyramid_cull_ent_in, c_pyramid_cull_ent_clip, c_pyramid_cull_ent_out;
 
+		int c_occluders;
+		int c_occlusion_cull_node_in, c_occlusion_cull_node_out, c_occlusion_cull_ent_out;
+
 		int c_nodes;
 		int c_leafs;
 
@@ -2624,6 +2676,14 @@ enum class deluxeMode_t { NONE, GRID, MAP };
 		int   c_multiDrawElements;
 		int   c_multiDrawPrimitives;
 		int   c_multiVboIndexes;
+		int   c_multiDrawIndirect;
+
+		int   c_instancedDraws;
+		int   c_instances;
+
+		int   c_dynamicBufferBytes;
+		int   c_dynamicBufferStalls; // waits for the GPU to release a ring buffer segment
+		int   c_dynamicBufferOrphans; // buffers reallocated when there is no ring buffer
 
 		int   msec; // total msec for backend run
 	};
@@ -2852,12 +2912,12 @@ enum class deluxeMode_t { NONE, GRID, MAP };
 		FBO_t           *fbos[ MAX_FBOS ];
 
 		GLuint          dlightUBO;
+		GLintptr        dlightOffset; // lights of the current view in dlightUBO
 		image_t         *dlightImage; // if the UBO is not available
 
 		growList_t      vbos;
 		growList_t      ibos;
 
-		byte            *cubeTemp[ 6 ]; // 6 textures for cubemap storage
 		growList_t      cubeProbes; // all cubemaps in a linear growing list
 		vertexHash_t    **cubeHashTable; // hash table for faster access
 
@@ -2980,6 +3040,9 @@ enum class deluxeMode_t { NONE, GRID, MAP };
 	extern cvar_t *r_arb_buffer_storage;
 	extern cvar_t *r_arb_map_buffer_range;
 	extern cvar_t *r_arb_sync;
+	extern cvar_t *r_arb_instanced_arrays;
+	extern cvar_t *r_arb_multi_draw_indirect;
+	extern cvar_t *r_khr_parallel_shader_compile;
 	extern cvar_t *r_arb_uniform_buffer_object;
 	extern cvar_t *r_arb_texture_gather;
 	extern cvar_t *r_arb_gpu_shader5;
@@ -3349,6 +3412,13 @@ inline bool checkGLErrors()
 	image_t *R_AllocImage( const char *name, bool linkIntoHashTable );
 	void R_UploadImage( const byte **dataArray, int numLayers, int numMips, image_t *image, const imageParams_t &imageParams );
 
+	image_t *R_CreateStreamedImage( const char *name, int loader, const std::string &fileName, const std::string &cacheKey,
+	                                const byte * const *pic, int width, int height, int numMips, const imageParams_t &imageParams );
+	void R_RequestStreamedImages( const surfaceType_t *surface, const shader_t *shader, bool bspSurface );
+	void R_UpdateTextureStreaming();
+	void R_ShutdownTextureStreaming();
+	void R_TextureStreamingInfo_f();
+
 	void    RE_GetTextureSize( int textureID, int *width, int *height );
 
 	void    R_InitFogTable();
@@ -3415,6 +3485,16 @@ inline bool checkGLErrors()
 
 #define MAX_MULTIDRAW_PRIMITIVES 1000
 
+	// layout defined by ARB_draw_indirect
+	struct drawElementsIndirectCommand_t {
+		GLuint count;
+		GLuint instanceCount;
+		GLuint firstIndex;
+		GLint  baseVertex;
+		GLuint baseInstance;
+	};
+#define MAX_INSTANCES            1024
+
 	struct shaderVertex_t {
 		vec3_t    xyz;
 		Color::Color32Bit color;
@@ -3470,6 +3550,12 @@ inline bool checkGLErrors()
 		glIndex_t    *multiDrawIndexes[ MAX_MULTIDRAW_PRIMITIVES ];
 		int         multiDrawCounts[ MAX_MULTIDRAW_PRIMITIVES ];
 
+		// the multidraw primitives as indirect draw commands, when
+		// they can't be written to the indirect buffer directly
+		drawElementsIndirectCommand_t drawCommands[ MAX_MULTIDRAW_PRIMITIVES ];
+		uint32_t    drawCommandsWritten, drawCommandBase;
+		GLuint      drawCommandsBuffer;
+
 		bool    vboVertexSkinning;
 		int         numBones;
 		transform_t bones[ MAX_BONES ];
@@ -3478,6 +3564,12 @@ inline bool checkGLErrors()
 		bool    vboVertexSprite;
 		bool    buildingVBO;
 
+		// when > 0 the surface is drawn once for each transform_t
+		// starting at instanceBase in instanceVBO
+		int         numInstances;
+		uint32_t    instancesWritten, instanceBase;
+		GLuint      instanceVBO;
+
 		// info extracted from current shader or backend mode
 		void ( *stageIteratorFunc )();
 		void ( *stageIteratorFunc2 )();
@@ -3492,6 +3584,8 @@ inline bool checkGLErrors()
 #ifdef GL_ARB_sync
 		glRingbuffer_t  vertexRB;
 		glRingbuffer_t  indexRB;
+		glRingbuffer_t  instanceRB;
+		glRingbuffer_t  drawCommandsRB;
 #endif
 	};
 
@@ -3500,6 +3594,7 @@ inline bool checkGLErrors()
 	void                    GLSL_InitGPUShaders();
 	void                    GLSL_ShutdownGPUShaders();
 	void                    GLSL_FinishGPUShaders();
+	void                    GLSL_PrewarmGPUShaders();
 
 // *INDENT-OFF*
 	void Tess_Begin( void ( *stageIteratorFunc )(),
@@ -3548,6 +3643,11 @@ inline bool checkGLErrors()
 	void Tess_InstantQuad( vec4_t quadVerts[ 4 ] );
 	void Tess_MapVBOs( bool forceCPU );
 	void Tess_UpdateVBOs();
+	void Tess_UploadInstances( const transform_t *instances, int numInstances );
+	void Tess_UploadDrawCommands();
+
+	shaderLight_t *R_MapDynamicLights( int numLights );
+	void R_UnmapDynamicLights();
 
 	void RB_ShowImages();
 
@@ -3561,6 +3661,7 @@ inline bool checkGLErrors()
 
 	void     R_AddBSPModelSurfaces( trRefEntity_t *e );
 	void     R_AddWorldSurfaces();
+	void     R_OcclusionCullEntity( trRefEntity_t *ent );
 	bool R_inPVS( const vec3_t p1, const vec3_t p2 );
 	bool R_inPVVS( const vec3_t p1, const vec3_t p2 );
 
@@ -3737,6 +3838,7 @@ inline bool checkGLErrors()
 	*/
 
 	void R_ToggleSmpFrame();
+	void R_ShutdownSceneBuffers();
 
 	void RE_ClearScene();
 	void RE_AddRefEntityToScene( const refEntity_t *ent );
@@ -3759,6 +3861,19 @@ inline bool checkGLErrors()
 	void R_UpdateVisTests();
 	void R_InitVisTests();
 	void R_ShutdownVisTests();
+
+	/*
+	=============================================================
+
+	FRONT END JOBS, tr_jobs.cpp
+
+	=============================================================
+	*/
+
+	void R_ShutdownJobs();
+	int  R_NumJobThreads();
+	void R_RunJobs( int numJobs, const std::function<void( int )> &job );
+
 	/*
 	=============================================================
 
@@ -4015,8 +4130,15 @@ inline bool checkGLErrors()
 // on an SMP machine
 	struct backEndData_t
 	{
-		drawSurf_t          drawSurfs[ MAX_DRAWSURFS ];
-		interaction_t       interactions[ MAX_INTERACTIONS ];
+		// sized at the start of the frame, what doesn't fit is dropped
+		// and counted so that the next frames get bigger buffers
+		drawSurf_t          *drawSurfs;
+		int                 maxDrawSurfs;
+		int                 numDroppedDrawSurfs;
+
+		interaction_t       *interactions;
+		int                 maxInteractions;
+		int                 numDroppedInteractions;
 
 		trRefLight_t        lights[ MAX_REF_LIGHTS ];
 		trRefEntity_t       entities[ MAX_REF_ENTITIES ];
@@ -4072,6 +4194,8 @@ inline bool checkGLErrors()
 	void                                RE_BeginFrame();
 	void                                RE_EndFrame( int *frontEndMsec, int *backEndMsec );
 
+	std::string                         R_ReadImageFile( Str::StringRef name, std::error_code &err );
+
 	void                                LoadTGA( const char *name, byte **pic, int *width, int *height, int *numLayers, int *numMips, int *bits, byte alphaByte );
 
 	void                                LoadJPG( const char *filename, unsigned char **pic, int *width, int *height, int *numLayers, int *numMips, int *bits, byte alphaByte );
@@ -4087,6 +4211,41 @@ inline bool checkGLErrors()
 	void                                LoadKTX( const char *name, byte **pic, int *width, int *height, int *numLayers, int *numMips, int *bits, byte alphaByte);
 	void                                SaveImageKTX( const char *name, image_t *img );
 
+	// reads the payload of a cache file, none of the reads go past its end
+	struct cacheReader_t
+	{
+		explicit cacheReader_t( const std::string &payload ) : data( payload ), offset( 0 ) {}
+
+		bool Read( void *out, size_t size );
+
+		template<typename T>
+		bool Read( T &out )
+		{
+			return Read( &out, sizeof( T ) );
+		}
+
+		size_t Left() const
+		{
+			return data.size() - offset;
+		}
+
+		bool Done() const
+		{
+			return offset == data.size();
+		}
+
+		const std::string &data;
+		size_t            offset;
+	};
+
+	std::string                         R_PakFileRevision( const std::string &fileName );
+	bool                                R_ReadCacheFile( const char *dir, const std::string &key, uint32_t version, std::string &payload );
+	void                                R_WriteCacheFile( const char *dir, const std::string &key, uint32_t version, const std::string &payload, bool compress = true );
+	void                                R_PruneCacheFiles();
+	std::string                         R_ImageCacheKey( const std::string &fileName, int bits );
+	bool                                R_LoadCachedImage( const std::string &key, byte **pic, int *width, int *height, int *numMips, int *bits );
+	void                                R_SaveCachedImage( const std::string &key, const byte * const *pic, int width, int height, int numMips, int bits );
+
 
 // video stuff
 	const void *RB_TakeVideoFrameCmd( const void *data );
@@ -22,6 +22,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 */
 // tr_main.c -- main control flow for each frame
 #include "tr_local.h"
+#include "common/RadixSort.h"
 
 trGlobals_t tr;
 
@@ -1961,9 +1962,17 @@ void R_AddDrawSurf( surfaceType_t *surface, shader_t *shader, int lightmapNum, i
 	int        index;
 	drawSurf_t *drawSurf;
 
-	// instead of checking for overflow, we just mask the index
-	// so it wraps around
-	index = tr.refdef.numDrawSurfs & DRAWSURF_MASK;
+	// the buffer can't move while views point into it, so what
+	// doesn't fit is dropped and the next frames get a bigger one
+	if ( tr.refdef.numDrawSurfs >= tr.refdef.maxDrawSurfs )
+	{
+		backEndData[ tr.smpFrame ]->numDroppedDrawSurfs++;
+		return;
+	}
+
+	R_RequestStreamedImages( surface, shader, bspSurface );
+
+	index = tr.refdef.numDrawSurfs;
 
 	drawSurf = &tr.refdef.drawSurfs[ index ];
 
@@ -1983,12 +1992,7 @@ void R_AddDrawSurf( surfaceType_t *surface, shader_t *shader, int lightmapNum, i
 		entityNum = tr.currentEntity - tr.refdef.entities;
 	}
 
-	if (shader->sort > Util::ordinal(shaderSort_t::SS_OPAQUE))
-	{
-		index = MAX_DRAWSURFS - index; // reverse the sorting (front:back -> back:front)
-	}
-
-	drawSurf->setSort( shader->sortedIndex, lightmapNum, entityNum, fogNum, index );
+	drawSurf->setSort( shader->sortedIndex, lightmapNum, entityNum, fogNum );
 
 	tr.refdef.numDrawSurfs++;
 
@@ -1997,6 +2001,9 @@ void R_AddDrawSurf( surfaceType_t *surface, shader_t *shader, int lightmapNum, i
 	}
 }
 
+// keeps its buffers from a view to the next
+static Util::RadixSorter<drawSurf_t> drawSurfSorter;
+
 /*
 =================
 R_SortDrawSurfs
@@ -2016,32 +2023,30 @@ static void R_SortDrawSurfs()
 		return;
 	}
 
-	// if we overflowed MAX_DRAWSURFS, the drawsurfs
-	// wrapped around in the buffer and we will be missing
-	// the first surfaces, not the last ones
-	if ( tr.viewParms.numDrawSurfs > MAX_DRAWSURFS )
-	{
-		tr.viewParms.numDrawSurfs = MAX_DRAWSURFS;
-	}
+	// the surfaces with the same key stay in the order they were added
+	drawSurfSorter.Sort( tr.viewParms.drawSurfs, tr.viewParms.numDrawSurfs,
+	                     []( const drawSurf_t &drawSurf ) {
+	                         return drawSurf.sort;
+	                     } );
 
-	// if we overflowed MAX_INTERACTIONS, the interactions
-	// wrapped around in the buffer and we will be missing
-	// the first interactions, not the last ones
-	if ( tr.viewParms.numInteractions > MAX_INTERACTIONS )
+	// reverse the translucent ones with the same key (front:back -> back:front)
+	for ( i = 0; i < tr.viewParms.numDrawSurfs; )
 	{
-		interaction_t *ia;
+		drawSurf = &tr.viewParms.drawSurfs[ i ];
+		int last = i + 1;
 
-		tr.viewParms.numInteractions = MAX_INTERACTIONS;
+		while ( last < tr.viewParms.numDrawSurfs && tr.viewParms.drawSurfs[ last ].sort == drawSurf->sort )
+		{
+			last++;
+		}
 
-		// reset last interaction's next pointer
-		ia = &tr.viewParms.interactions[ tr.viewParms.numInteractions - 1 ];
-		ia->next = nullptr;
-	}
+		if ( drawSurf->shader->sort > Util::ordinal( shaderSort_t::SS_OPAQUE ) )
+		{
+			std::reverse( drawSurf, tr.viewParms.drawSurfs + last );
+		}
 
-	std::sort( tr.viewParms.drawSurfs, tr.viewParms.drawSurfs + tr.viewParms.numDrawSurfs,
-	           []( const drawSurf_t &a, const drawSurf_t &b ) {
-	               return a.sort < b.sort;
-	           } );
+		i = last;
+	}
 
 	// compute the offsets of the first surface of each SS_* type
 	sort = Util::ordinal( shaderSort_t::SS_BAD ) - 1;
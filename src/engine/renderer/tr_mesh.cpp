@@ -296,6 +296,7 @@ void R_AddMDVSurfaces( trRefEntity_t *ent )
 	// cull the entire model if merged bounding box of both frames
 	// is outside the view frustum.
 	R_CullMDV( model, ent );
+	R_OcclusionCullEntity( ent );
 
 	if ( ent->cull == CULL_OUT )
 	{
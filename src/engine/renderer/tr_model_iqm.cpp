@@ -988,6 +988,7 @@ void R_AddIQMSurfaces( trRefEntity_t *ent ) {
 	// is outside the view frustum.
 	//
 	R_CullIQM( ent );
+	R_OcclusionCullEntity( ent );
 
 	// HACK: Never cull first-person models, due to issues with a certain model's bounds
 	// A first-person model not in the player's sight seems like something that should not happen in any case
@@ -97,6 +97,9 @@ struct glconfig2_t
 	bool uniformBufferObjectAvailable;
 	bool mapBufferRangeAvailable;
 	bool syncAvailable;
+	bool instancedArraysAvailable;
+	bool multiDrawIndirectAvailable;
+	bool parallelShaderCompileAvailable;
 
 	int dynamicLight;
 };
@@ -26,6 +26,17 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 static int r_firstSceneDrawSurf;
 static int r_firstSceneInteraction;
 
+// the most drawsurfs and interactions a frame asked for, the peaks of
+// the current window of frames replace them when it ends so that the
+// buffers shrink back when the frames are lighter
+static const int SCENE_BUFFERS_WINDOW = 1000;
+
+static int r_drawSurfsHighWater;
+static int r_interactionsHighWater;
+static int r_drawSurfsWindowPeak;
+static int r_interactionsWindowPeak;
+static int r_sceneBuffersFrames;
+
 static int r_numLights;
 static int r_firstSceneLight;
 
@@ -47,6 +58,65 @@ int        r_numDecals;
 int r_numVisTests;
 int r_firstSceneVisTest;
 
+/*
+====================
+R_SizeSceneBuffer
+
+Makes sure buffer holds needed elements, and isn't more than twice
+what is needed, the contents are lost
+====================
+*/
+template<typename T>
+static void R_SizeSceneBuffer( T **buffer, int *size, int needed, int minSize )
+{
+	// leave room for the frames to get a bit busier
+	int newSize = std::max( needed + needed / 4, minSize );
+
+	if ( *buffer && *size >= needed && *size <= 2 * newSize )
+	{
+		return;
+	}
+
+	if ( *buffer )
+	{
+		ri.Free( *buffer );
+	}
+
+	*buffer = ( T * ) ri.Z_Malloc( newSize * sizeof( T ) );
+	*size = newSize;
+}
+
+/*
+====================
+R_ShutdownSceneBuffers
+====================
+*/
+void R_ShutdownSceneBuffers()
+{
+	for ( backEndData_t *data : backEndData )
+	{
+		if ( !data )
+		{
+			continue;
+		}
+
+		if ( data->drawSurfs )
+		{
+			ri.Free( data->drawSurfs );
+			data->drawSurfs = nullptr;
+		}
+
+		if ( data->interactions )
+		{
+			ri.Free( data->interactions );
+			data->interactions = nullptr;
+		}
+
+		data->maxDrawSurfs = 0;
+		data->maxInteractions = 0;
+	}
+}
+
 /*
 ====================
 R_ToggleSmpFrame
@@ -54,6 +124,31 @@ R_ToggleSmpFrame
 */
 void R_ToggleSmpFrame()
 {
+	backEndData_t *data = backEndData[ tr.smpFrame ];
+
+	// remember what the frame that just ended asked for, including
+	// what didn't fit
+	if ( data->numDroppedDrawSurfs || data->numDroppedInteractions )
+	{
+		Log::Debug( "dropped %i drawsurfs and %i interactions",
+		            data->numDroppedDrawSurfs, data->numDroppedInteractions );
+	}
+
+	r_drawSurfsWindowPeak = std::max( r_drawSurfsWindowPeak, r_firstSceneDrawSurf + data->numDroppedDrawSurfs );
+	r_interactionsWindowPeak = std::max( r_interactionsWindowPeak, r_firstSceneInteraction + data->numDroppedInteractions );
+
+	r_drawSurfsHighWater = std::max( r_drawSurfsHighWater, r_drawSurfsWindowPeak );
+	r_interactionsHighWater = std::max( r_interactionsHighWater, r_interactionsWindowPeak );
+
+	if ( ++r_sceneBuffersFrames == SCENE_BUFFERS_WINDOW )
+	{
+		r_drawSurfsHighWater = r_drawSurfsWindowPeak;
+		r_interactionsHighWater = r_interactionsWindowPeak;
+		r_drawSurfsWindowPeak = 0;
+		r_interactionsWindowPeak = 0;
+		r_sceneBuffersFrames = 0;
+	}
+
 	if ( r_smp->integer )
 	{
 		// use the other buffers next frame, because another CPU
@@ -65,7 +160,14 @@ void R_ToggleSmpFrame()
 		tr.smpFrame = 0;
 	}
 
-	backEndData[ tr.smpFrame ]->commands.used = 0;
+	data = backEndData[ tr.smpFrame ];
+	data->commands.used = 0;
+
+	// the back end is done with these buffers, so they can be replaced
+	R_SizeSceneBuffer( &data->drawSurfs, &data->maxDrawSurfs, r_drawSurfsHighWater, MIN_DRAWSURFS );
+	R_SizeSceneBuffer( &data->interactions, &data->maxInteractions, r_interactionsHighWater, MIN_INTERACTIONS );
+	data->numDroppedDrawSurfs = 0;
+	data->numDroppedInteractions = 0;
 
 	r_firstSceneDrawSurf = 0;
 	r_firstSceneInteraction = 0;
@@ -536,9 +638,11 @@ void RE_RenderScene( const refdef_t *fd )
 	tr.refdef.floatTime = float(double(tr.refdef.time) * 0.001);
 
 	tr.refdef.numDrawSurfs = r_firstSceneDrawSurf;
+	tr.refdef.maxDrawSurfs = backEndData[ tr.smpFrame ]->maxDrawSurfs;
 	tr.refdef.drawSurfs = backEndData[ tr.smpFrame ]->drawSurfs;
 
 	tr.refdef.numInteractions = r_firstSceneInteraction;
+	tr.refdef.maxInteractions = backEndData[ tr.smpFrame ]->maxInteractions;
 	tr.refdef.interactions = backEndData[ tr.smpFrame ]->interactions;
 
 	tr.refdef.numEntities = r_numEntities - r_firstSceneEntity;
@@ -284,6 +284,13 @@ void GLSL_FinishGPUShaders()
 	gl_shaderManager.buildAll();
 }
 
+void GLSL_PrewarmGPUShaders()
+{
+	R_SyncRenderThread();
+
+	gl_shaderManager.prewarmPermutations();
+}
+
 /*
 ==================
 Tess_DrawElements
@@ -303,7 +310,18 @@ void Tess_DrawElements()
 	{
 		if ( tess.multiDrawPrimitives )
 		{
-			glMultiDrawElements( GL_TRIANGLES, tess.multiDrawCounts, GL_INDEX_TYPE, ( const GLvoid ** ) tess.multiDrawIndexes, tess.multiDrawPrimitives );
+			if ( glConfig2.multiDrawIndirectAvailable )
+			{
+				Tess_UploadDrawCommands();
+
+				glMultiDrawElementsIndirect( GL_TRIANGLES, GL_INDEX_TYPE, BUFFER_OFFSET( tess.drawCommandBase * sizeof( drawElementsIndirectCommand_t ) ), tess.multiDrawPrimitives, 0 );
+
+				backEnd.pc.c_multiDrawIndirect++;
+			}
+			else
+			{
+				glMultiDrawElements( GL_TRIANGLES, tess.multiDrawCounts, GL_INDEX_TYPE, ( const GLvoid ** ) tess.multiDrawIndexes, tess.multiDrawPrimitives );
+			}
 
 			backEnd.pc.c_multiDrawElements++;
 			backEnd.pc.c_multiDrawPrimitives += tess.multiDrawPrimitives;
@@ -324,7 +342,17 @@ void Tess_DrawElements()
 				base = tess.indexBase * sizeof( glIndex_t );
 			}
 
-			glDrawRangeElements( GL_TRIANGLES, 0, tess.numVertexes, tess.numIndexes, GL_INDEX_TYPE, BUFFER_OFFSET( base ) );
+			if ( tess.numInstances > 0 )
+			{
+				glDrawElementsInstanced( GL_TRIANGLES, tess.numIndexes, GL_INDEX_TYPE, BUFFER_OFFSET( base ), tess.numInstances );
+
+				backEnd.pc.c_instancedDraws++;
+				backEnd.pc.c_instances += tess.numInstances;
+			}
+			else
+			{
+				glDrawRangeElements( GL_TRIANGLES, 0, tess.numVertexes, tess.numIndexes, GL_INDEX_TYPE, BUFFER_OFFSET( base ) );
+			}
 
 			backEnd.pc.c_drawElements++;
 
@@ -412,6 +440,7 @@ static void DrawTris()
 
 	gl_genericShader->SetVertexSkinning( glConfig2.vboVertexSkinningAvailable && tess.vboVertexSkinning );
 	gl_genericShader->SetVertexAnimation( tess.vboVertexAnimation );
+	gl_genericShader->SetVertexInstancing( tess.numInstances > 0 );
 	gl_genericShader->SetVertexSprite( tess.vboVertexSprite );
 	gl_genericShader->SetTCGenEnvironment( false );
 	gl_genericShader->SetTCGenLightmap( false );
@@ -708,6 +737,7 @@ static void Render_generic( shaderStage_t *pStage )
 	// choose right shader program ----------------------------------
 	gl_genericShader->SetVertexSkinning( glConfig2.vboVertexSkinningAvailable && tess.vboVertexSkinning );
 	gl_genericShader->SetVertexAnimation( tess.vboVertexAnimation );
+	gl_genericShader->SetVertexInstancing( tess.numInstances > 0 );
 
 	gl_genericShader->SetTCGenEnvironment( pStage->tcGen_Environment );
 	gl_genericShader->SetTCGenLightmap( pStage->tcGen_Lightmap );
@@ -1008,6 +1038,8 @@ static void Render_lightMapping( shaderStage_t *pStage )
 
 	gl_lightMappingShader->SetVertexAnimation( tess.vboVertexAnimation );
 
+	gl_lightMappingShader->SetVertexInstancing( tess.numInstances > 0 );
+
 	gl_lightMappingShader->SetBspSurface( tess.bspSurface );
 
 	gl_lightMappingShader->SetDeluxeMapping( enableDeluxeMapping );
@@ -1061,7 +1093,7 @@ static void Render_lightMapping( shaderStage_t *pStage )
 
 	if( glConfig2.dynamicLight > 0 && backEnd.refdef.numShaderLights > 0 ) {
 		if( glConfig2.uniformBufferObjectAvailable ) {
-			gl_lightMappingShader->SetUniformBlock_Lights( tr.dlightUBO );
+			gl_lightMappingShader->SetUniformBlock_Lights( tr.dlightUBO, tr.dlightOffset );
 		} else {
 			GL_BindToTMU( BIND_LIGHTS, tr.dlightImage );
 		}
@@ -3261,6 +3293,7 @@ void Tess_End()
 
 	tess.vboVertexSkinning = false;
 	tess.vboVertexAnimation = false;
+	tess.numInstances = 0;
 
 	// clear shader so we can tell we don't have any unclosed surfaces
 	tess.multiDrawPrimitives = 0;
@@ -31,8 +31,16 @@ static shaderTable_t *shaderTableHashTable[ MAX_SHADERTABLE_HASH ];
 static const int FILE_HASH_SIZE       = 1024;
 static shader_t      *shaderHashTable[ FILE_HASH_SIZE ];
 
+// the shader names are extracted once when the shader files are loaded,
+// so that looking for a shader doesn't have to parse the text
+struct shaderTextEntry_t
+{
+	const char *name;
+	const char *text; // right after the name
+};
+
 static const int MAX_SHADERTEXT_HASH  = 2048;
-static const char          **shaderTextHashTable[ MAX_SHADERTEXT_HASH ];
+static shaderTextEntry_t *shaderTextHashTable[ MAX_SHADERTEXT_HASH ];
 
 static char          *s_shaderText;
 
@@ -79,6 +87,9 @@ Cvar::Cvar<bool> r_dpBlend("r_dpBlend", "Enable DarkPlaces blend compatibility,
 static Cvar::Cvar<float> r_portalDefaultRange(
 	"r_portalDefaultRange", "Default portal range", Cvar::NONE, 1024);
 
+static Cvar::Cvar<bool> r_shaderCache(
+	"r_shaderCache", "keep the combined shader files in the homepath so that they load faster", Cvar::NONE, true);
+
 /*
 ================
 return a hash value for the filename
@@ -5799,20 +5810,13 @@ If found, it will return a valid shader
 */
 static const char    *FindShaderInShaderText( const char *shaderName )
 {
-	const char *token, *p;
-
-	int  i, hash;
-
-	hash = generateHashValue( shaderName, MAX_SHADERTEXT_HASH );
+	int hash = generateHashValue( shaderName, MAX_SHADERTEXT_HASH );
 
-	for ( i = 0; shaderTextHashTable[ hash ][ i ]; i++ )
+	for ( const shaderTextEntry_t *entry = shaderTextHashTable[ hash ]; entry->name; entry++ )
 	{
-		p = shaderTextHashTable[ hash ][ i ];
-		token = COM_ParseExt2( &p, true );
-
-		if ( !Q_stricmp( token, shaderName ) )
+		if ( !Q_stricmp( entry->name, shaderName ) )
 		{
-			return p;
+			return entry->text;
 		}
 	}
 
@@ -6405,35 +6409,194 @@ void R_ShaderExp_f()
 
 /*
 ====================
-ScanAndLoadShaderFiles
+ParseShaderTable
 
-Finds and loads all .shader files, combining them into
-a single large text block that can be scanned for shader names
+Parses a shader table after its "table" keyword
 =====================
 */
-static void ScanAndLoadShaderFiles()
+static void ParseShaderTable( const char **text )
 {
-	std::vector<std::string> buffers;
-	const char *p;
-	const char *oldp, *token;
-	char *textEnd;
-	const char **hashMem;
-	int  shaderTextHashTableSizes[ MAX_SHADERTEXT_HASH ], hash, size;
-	char filename[ MAX_QPATH ];
-	size_t sum = 0;
+	const char    *token;
+	int           depth;
+	float         values[ FUNCTABLE_SIZE ];
+	int           numValues;
+	shaderTable_t *tb;
+	bool      alreadyCreated;
+	int           hash;
 
-	Log::Debug("----- ScanAndLoadShaderFiles -----" );
+	// zeroes all shaders, booleans can be assumed as false
+	memset( &table, 0, sizeof( table ) );
 
-	// load and parse shader files
-	for ( const std::string& basename : FS::PakPath::ListFiles("scripts") )
+	token = COM_ParseExt2( text, true );
+
+	Q_strncpyz( table.name, token, sizeof( table.name ) );
+
+	// check if already created
+	alreadyCreated = false;
+	hash = generateHashValue( table.name, MAX_SHADERTABLE_HASH );
+
+	for ( tb = shaderTableHashTable[ hash ]; tb; tb = tb->next )
 	{
-		if ( !Str::IsISuffix( ".shader", basename ) )
+		if ( Q_stricmp( tb->name, table.name ) == 0 )
+		{
+			// match found
+			alreadyCreated = true;
+			break;
+		}
+	}
+
+	depth = 0;
+	numValues = 0;
+
+	do
+	{
+		token = COM_ParseExt2( text, true );
+
+		if ( !Q_stricmp( token, "snap" ) )
+		{
+			table.snap = true;
+		}
+		else if ( !Q_stricmp( token, "clamp" ) )
+		{
+			table.clamp = true;
+		}
+		else if ( token[ 0 ] == '{' )
+		{
+			depth++;
+		}
+		else if ( token[ 0 ] == '}' )
+		{
+			depth--;
+		}
+		else if ( token[ 0 ] == ',' )
 		{
 			continue;
 		}
+		else
+		{
+			if ( numValues == FUNCTABLE_SIZE )
+			{
+				Log::Warn("FUNCTABLE_SIZE hit" );
+				break;
+			}
+
+			values[ numValues++ ] = atof( token );
+		}
+	}
+	while ( depth && *text );
+
+	if ( !alreadyCreated )
+	{
+		Log::Debug("...generating '%s'", table.name );
+		GeneratePermanentShaderTable( values, numValues );
+	}
+}
+
+// a definition found in the combined shader text, tables have no name
+struct shaderTextDef_t
+{
+	uint32_t    offset; // of the "table" keyword, or right after the shader name
+	std::string name;
+};
+
+static const char     SHADER_CACHE_DIR[] = "shaders";
+static const uint32_t SHADER_CACHE_VERSION = 1;
+
+/*
+====================
+LoadShaderCache
+
+Loads the combined shader text and its definitions saved by SaveShaderCache
+for the same shader files
+=====================
+*/
+static bool LoadShaderCache( const std::string &key, std::string &text, std::vector<shaderTextDef_t> &defs )
+{
+	std::string content;
+
+	if ( !R_ReadCacheFile( SHADER_CACHE_DIR, key, SHADER_CACHE_VERSION, content ) )
+	{
+		return false;
+	}
+
+	cacheReader_t reader( content );
+	uint32_t      textLength, numDefs;
+
+	if ( !reader.Read( textLength ) || !reader.Read( numDefs ) || reader.Left() < textLength )
+	{
+		Log::Warn( "shader cache is corrupt" );
+		return false;
+	}
+
+	text = content.substr( reader.offset, textLength );
+	reader.offset += textLength;
+	defs.clear();
+
+	// each definition is its offset followed by its name
+	for ( uint32_t i = 0; i < numDefs; i++ )
+	{
+		shaderTextDef_t def;
+
+		if ( !reader.Read( def.offset ) )
+		{
+			Log::Warn( "shader cache is corrupt" );
+			return false;
+		}
+
+		size_t end = content.find( '\0', reader.offset );
+
+		if ( end == std::string::npos || def.offset > text.size() )
+		{
+			Log::Warn( "shader cache is corrupt" );
+			return false;
+		}
+
+		def.name = content.substr( reader.offset, end - reader.offset );
+		reader.offset = end + 1;
+
+		defs.push_back( std::move( def ) );
+	}
+
+	return true;
+}
+
+/*
+====================
+SaveShaderCache
+=====================
+*/
+static void SaveShaderCache( const std::string &key, const std::string &text, const std::vector<shaderTextDef_t> &defs )
+{
+	uint32_t    counts[ 2 ] = { uint32_t( text.size() ), uint32_t( defs.size() ) };
+	std::string content( reinterpret_cast<const char *>( counts ), sizeof( counts ) );
+
+	content += text;
+
+	for ( const shaderTextDef_t &def : defs )
+	{
+		content.append( reinterpret_cast<const char *>( &def.offset ), sizeof( uint32_t ) );
+		content.append( def.name.c_str(), def.name.size() + 1 );
+	}
 
-		Com_sprintf( filename, sizeof( filename ), "scripts/%s", basename.c_str() );
+	R_WriteCacheFile( SHADER_CACHE_DIR, key, SHADER_CACHE_VERSION, content );
+}
 
+/*
+====================
+LoadShaderFiles
+
+Loads all the given .shader files, combining them into a single
+large text block, and finds the shaders and tables defined in it
+=====================
+*/
+static void LoadShaderFiles( const std::vector<std::string> &fileNames, std::string &text, std::vector<shaderTextDef_t> &defs )
+{
+	std::vector<std::string> buffers;
+	const char *p;
+	const char *token;
+
+	for ( const std::string &filename : fileNames )
+	{
 		Log::Debug("loading '%s' shader file", filename );
 		std::error_code err;
 		std::string buffer = FS::PakPath::ReadFile( filename, err );
@@ -6479,168 +6642,157 @@ static void ScanAndLoadShaderFiles()
 
 		if ( !syntaxError )
 		{
-			sum += buffer.size();
 			buffers.push_back( std::move( buffer ) );
 		}
 	}
 
 	// build single large buffer
-	s_shaderText = (char*) ri.Hunk_Alloc( sum + buffers.size() * 2, ha_pref::h_low );
-	s_shaderText[ 0 ] = '\0';
-	textEnd = s_shaderText;
+	text.clear();
 
 	for ( auto i = buffers.rbegin(); i != buffers.rend(); ++i )
 	{
-		strcat( textEnd, i->c_str() );
-		strcat( textEnd, "\n" );
-		textEnd += strlen( textEnd );
+		text += *i;
+		text += '\n';
 	}
 
 	// ydnar: unixify all shaders
-	COM_FixPath( s_shaderText );
+	COM_FixPath( &text[ 0 ] );
 
-	COM_Compress( s_shaderText );
+	text.resize( COM_Compress( &text[ 0 ] ) );
 
-	memset( shaderTextHashTableSizes, 0, sizeof( shaderTextHashTableSizes ) );
-	size = 0;
+	defs.clear();
 
-	p = s_shaderText;
+	p = text.c_str();
 
 	// look for shader names
 	while ( true )
 	{
-		token = COM_ParseExt2( &p, true );
+		const char *oldp = p;
+		token = COM_ParseExt( &p, true );
 
 		if ( token[ 0 ] == 0 )
 		{
 			break;
 		}
 
-		// skip shader tables
 		if ( !Q_stricmp( token, "table" ) )
 		{
-			// skip table name
-			token = COM_ParseExt2( &p, true );
+			defs.push_back( { uint32_t( oldp - text.c_str() ), "" } );
 
-			SkipBracedSection( &p );
+			// skip table name
+			COM_ParseExt2( &p, true );
 		}
 		else
 		{
-			hash = generateHashValue( token, MAX_SHADERTEXT_HASH );
-			shaderTextHashTableSizes[ hash ]++;
-			size++;
-			SkipBracedSection( &p );
+			defs.push_back( { uint32_t( p - text.c_str() ), token } );
 		}
+
+		SkipBracedSection( &p );
 	}
+}
 
-	size += MAX_SHADERTEXT_HASH;
+/*
+====================
+ScanAndLoadShaderFiles
 
-	hashMem = (const char**) ri.Hunk_Alloc( size * sizeof( char * ), ha_pref::h_low );
+Finds and loads all .shader files, combining them into
+a single large text block that can be scanned for shader names
+=====================
+*/
+static void ScanAndLoadShaderFiles()
+{
+	std::vector<std::string> fileNames;
+	std::string key;
+	std::string text;
+	std::vector<shaderTextDef_t> defs;
+	int shaderTextHashTableSizes[ MAX_SHADERTEXT_HASH ];
+	int hash;
 
-	for ( int i = 0; i < MAX_SHADERTEXT_HASH; i++ )
+	Log::Debug("----- ScanAndLoadShaderFiles -----" );
+
+	for ( const std::string& basename : FS::PakPath::ListFiles("scripts") )
 	{
-		shaderTextHashTable[ i ] = hashMem;
-		hashMem += shaderTextHashTableSizes[ i ] + 1;
+		if ( Str::IsISuffix( ".shader", basename ) )
+		{
+			fileNames.push_back( "scripts/" + basename );
+		}
 	}
 
-	memset( shaderTextHashTableSizes, 0, sizeof( shaderTextHashTableSizes ) );
+	// the cache is only used if all the shader files are identified by their pak
+	if ( r_shaderCache.Get() )
+	{
+		for ( const std::string &filename : fileNames )
+		{
+			std::string revision = R_PakFileRevision( filename );
 
-	p = s_shaderText;
+			if ( revision.empty() )
+			{
+				key.clear();
+				break;
+			}
 
-	// look for shader names
-	while ( true )
+			key += Str::Format( "%s %s\n", filename, revision );
+		}
+	}
+
+	if ( key.empty() || !LoadShaderCache( key, text, defs ) )
 	{
-		oldp = p;
-		token = COM_ParseExt( &p, true );
+		LoadShaderFiles( fileNames, text, defs );
 
-		if ( token[ 0 ] == 0 )
+		if ( !key.empty() )
 		{
-			break;
+			SaveShaderCache( key, text, defs );
 		}
+	}
 
-		// parse shader tables
-		if ( !Q_stricmp( token, "table" ) )
-		{
-			int           depth;
-			float         values[ FUNCTABLE_SIZE ];
-			int           numValues;
-			shaderTable_t *tb;
-			bool      alreadyCreated;
-
-			// zeroes all shaders, booleans can be assumed as false
-			memset( &table, 0, sizeof( table ) );
+	s_shaderText = (char*) ri.Hunk_Alloc( text.size() + 1, ha_pref::h_low );
+	memcpy( s_shaderText, text.c_str(), text.size() + 1 );
 
-			token = COM_ParseExt2( &p, true );
+	// put the names next to the hash table entries
+	size_t size = MAX_SHADERTEXT_HASH * sizeof( shaderTextEntry_t );
 
-			Q_strncpyz( table.name, token, sizeof( table.name ) );
-
-			// check if already created
-			alreadyCreated = false;
-			hash = generateHashValue( table.name, MAX_SHADERTABLE_HASH );
+	memset( shaderTextHashTableSizes, 0, sizeof( shaderTextHashTableSizes ) );
 
-			for ( tb = shaderTableHashTable[ hash ]; tb; tb = tb->next )
-			{
-				if ( Q_stricmp( tb->name, table.name ) == 0 )
-				{
-					// match found
-					alreadyCreated = true;
-					break;
-				}
-			}
+	for ( const shaderTextDef_t &def : defs )
+	{
+		if ( !def.name.empty() )
+		{
+			hash = generateHashValue( def.name.c_str(), MAX_SHADERTEXT_HASH );
+			shaderTextHashTableSizes[ hash ]++;
+			size += sizeof( shaderTextEntry_t ) + def.name.size() + 1;
+		}
+	}
 
-			depth = 0;
-			numValues = 0;
+	byte *hashMem = (byte*) ri.Hunk_Alloc( size, ha_pref::h_low );
+	char *names = reinterpret_cast<char*>( hashMem ) + size;
 
-			do
-			{
-				token = COM_ParseExt2( &p, true );
+	for ( int i = 0; i < MAX_SHADERTEXT_HASH; i++ )
+	{
+		shaderTextHashTable[ i ] = reinterpret_cast<shaderTextEntry_t*>( hashMem );
+		hashMem += ( shaderTextHashTableSizes[ i ] + 1 ) * sizeof( shaderTextEntry_t );
+	}
 
-				if ( !Q_stricmp( token, "snap" ) )
-				{
-					table.snap = true;
-				}
-				else if ( !Q_stricmp( token, "clamp" ) )
-				{
-					table.clamp = true;
-				}
-				else if ( token[ 0 ] == '{' )
-				{
-					depth++;
-				}
-				else if ( token[ 0 ] == '}' )
-				{
-					depth--;
-				}
-				else if ( token[ 0 ] == ',' )
-				{
-					continue;
-				}
-				else
-				{
-					if ( numValues == FUNCTABLE_SIZE )
-					{
-						Log::Warn("FUNCTABLE_SIZE hit" );
-						break;
-					}
+	memset( shaderTextHashTableSizes, 0, sizeof( shaderTextHashTableSizes ) );
 
-					values[ numValues++ ] = atof( token );
-				}
-			}
-			while ( depth && p );
+	for ( const shaderTextDef_t &def : defs )
+	{
+		const char *p = s_shaderText + def.offset;
 
-			if ( !alreadyCreated )
-			{
-				Log::Debug("...generating '%s'", table.name );
-				GeneratePermanentShaderTable( values, numValues );
-			}
-		}
-		else
+		// parse shader tables
+		if ( def.name.empty() )
 		{
-			hash = generateHashValue( token, MAX_SHADERTEXT_HASH );
-			shaderTextHashTable[ hash ][ shaderTextHashTableSizes[ hash ]++ ] = oldp;
+			// skip the "table" keyword
+			COM_ParseExt2( &p, true );
 
-			SkipBracedSection( &p );
+			ParseShaderTable( &p );
+			continue;
 		}
+
+		names -= def.name.size() + 1;
+		memcpy( names, def.name.c_str(), def.name.size() + 1 );
+
+		hash = generateHashValue( def.name.c_str(), MAX_SHADERTEXT_HASH );
+		shaderTextHashTable[ hash ][ shaderTextHashTableSizes[ hash ]++ ] = { names, p };
 	}
 }
 
@@ -439,6 +439,9 @@ static void R_CopyVertexData( VBO_t *vbo, byte *outData, vboData_t inData )
 /*
 ============
 R_InitRingbuffer
+
+The mapping is coherent, so writes to the active segment
+don't need to be flushed before drawing from it
 ============
 */
 static void R_InitRingbuffer( GLenum target, GLsizei elementSize,
@@ -447,11 +450,12 @@ static void R_InitRingbuffer( GLenum target, GLsizei elementSize,
 	int i;
 
 	glBufferStorage( target, totalSize, nullptr,
-			 GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT );
+			 GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT |
+			 GL_MAP_COHERENT_BIT );
 	rb->baseAddr = glMapBufferRange( target, 0, totalSize,
 					 GL_MAP_WRITE_BIT |
 					 GL_MAP_PERSISTENT_BIT |
-					 GL_MAP_FLUSH_EXPLICIT_BIT );
+					 GL_MAP_COHERENT_BIT );
 	rb->elementSize = elementSize;
 	rb->segmentElements = segmentElements;
 	rb->activeSegment = 0;
@@ -472,11 +476,17 @@ static GLsizei R_RotateRingbuffer( glRingbuffer_t *rb ) {
 	if( rb->activeSegment >= DYN_BUFFER_SEGMENTS )
 		rb->activeSegment = 0;
 
-	// wait until next segment is ready in 1 sec intervals
-	while( glClientWaitSync( rb->syncs[ rb->activeSegment ], GL_SYNC_FLUSH_COMMANDS_BIT,
-				 10000000 ) == GL_TIMEOUT_EXPIRED ) {
-		Log::Warn("long wait for GL buffer" );
-	};
+	// the GPU is still reading the next segment
+	if( glClientWaitSync( rb->syncs[ rb->activeSegment ], GL_SYNC_FLUSH_COMMANDS_BIT,
+			      0 ) == GL_TIMEOUT_EXPIRED ) {
+		backEnd.pc.c_dynamicBufferStalls++;
+
+		// wait until next segment is ready in 1 sec intervals
+		while( glClientWaitSync( rb->syncs[ rb->activeSegment ], GL_SYNC_FLUSH_COMMANDS_BIT,
+					 10000000 ) == GL_TIMEOUT_EXPIRED ) {
+			Log::Warn("long wait for GL buffer" );
+		};
+	}
 	glDeleteSync( rb->syncs[ rb->activeSegment ] );
 
 	return rb->activeSegment * rb->segmentElements;
@@ -987,6 +997,247 @@ static void R_InitTileVBO()
 
 const int vertexCapacity = DYN_BUFFER_SIZE / sizeof( shaderVertex_t );
 const int indexCapacity = DYN_BUFFER_SIZE / sizeof( glIndex_t );
+const int instanceCapacity = 16 * MAX_INSTANCES;
+
+const int drawCommandsCapacity = 16 * MAX_MULTIDRAW_PRIMITIVES;
+
+/*
+============
+R_InitDrawCommandsBuffer
+============
+*/
+static void R_InitDrawCommandsBuffer()
+{
+	glGenBuffers( 1, &tess.drawCommandsBuffer );
+	glBindBuffer( GL_DRAW_INDIRECT_BUFFER, tess.drawCommandsBuffer );
+
+#if defined( GL_ARB_buffer_storage ) && defined( GL_ARB_sync )
+	if( glConfig2.bufferStorageAvailable &&
+	    glConfig2.syncAvailable ) {
+		R_InitRingbuffer( GL_DRAW_INDIRECT_BUFFER, sizeof( drawElementsIndirectCommand_t ),
+				  drawCommandsCapacity, &tess.drawCommandsRB );
+	} else
+#endif
+	{
+		glBufferData( GL_DRAW_INDIRECT_BUFFER, drawCommandsCapacity * sizeof( drawElementsIndirectCommand_t ), nullptr, GL_DYNAMIC_DRAW );
+	}
+
+	// nothing else uses the indirect buffer binding, it stays bound
+	tess.drawCommandsWritten = tess.drawCommandBase = 0;
+}
+
+/*
+============
+R_ShutdownDrawCommandsBuffer
+============
+*/
+static void R_ShutdownDrawCommandsBuffer()
+{
+	if ( !tess.drawCommandsBuffer )
+	{
+		return;
+	}
+
+#if defined( GL_ARB_buffer_storage ) && defined( GL_ARB_sync )
+	if( glConfig2.bufferStorageAvailable &&
+	    glConfig2.syncAvailable ) {
+		glBindBuffer( GL_DRAW_INDIRECT_BUFFER, tess.drawCommandsBuffer );
+		R_ShutdownRingbuffer( GL_DRAW_INDIRECT_BUFFER, &tess.drawCommandsRB );
+	}
+#endif
+
+	glBindBuffer( GL_DRAW_INDIRECT_BUFFER, 0 );
+	glDeleteBuffers( 1, &tess.drawCommandsBuffer );
+	tess.drawCommandsBuffer = 0;
+}
+
+// when dlightRingbuffer is set, the dynamic lights of the views of a frame
+// are written one after the other to a segment that is rotated once per
+// frame, else tr.dlightUBO is orphaned for every view
+static const int DLIGHT_VIEWS_PER_SEGMENT = 8;
+
+static bool dlightRingbuffer;
+#if defined( GL_ARB_buffer_storage ) && defined( GL_ARB_sync )
+static glRingbuffer_t dlightRB;
+static int dlightFrame; // the frame of the views in the active segment
+static int dlightViews; // views written to it
+#endif
+
+static GLenum R_DynamicLightsTarget()
+{
+	return glConfig2.uniformBufferObjectAvailable ? GL_UNIFORM_BUFFER : GL_PIXEL_UNPACK_BUFFER;
+}
+
+/*
+============
+R_InitDynamicLightsBuffer
+============
+*/
+static void R_InitDynamicLightsBuffer()
+{
+	GLenum target = R_DynamicLightsTarget();
+
+	glGenBuffers( 1, &tr.dlightUBO );
+	glBindBuffer( target, tr.dlightUBO );
+
+	tr.dlightOffset = 0;
+	dlightRingbuffer = false;
+
+#if defined( GL_ARB_buffer_storage ) && defined( GL_ARB_sync )
+	if( glConfig2.bufferStorageAvailable &&
+	    glConfig2.syncAvailable ) {
+		GLint alignment = 1;
+
+		// each segment is bound as a whole uniform block
+		if( glConfig2.uniformBufferObjectAvailable ) {
+			glGetIntegerv( GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment );
+		}
+
+		dlightRingbuffer = alignment > 0 && ( MAX_REF_LIGHTS * sizeof( shaderLight_t ) ) % alignment == 0;
+	}
+
+	if( dlightRingbuffer ) {
+		R_InitRingbuffer( target, sizeof( shaderLight_t ),
+				  MAX_REF_LIGHTS * DLIGHT_VIEWS_PER_SEGMENT, &dlightRB );
+		dlightFrame = -1;
+		dlightViews = 0;
+	} else
+#endif
+	{
+		glBufferData( target, MAX_REF_LIGHTS * sizeof( shaderLight_t ), nullptr, GL_DYNAMIC_DRAW );
+	}
+
+	glBindBuffer( target, 0 );
+}
+
+/*
+============
+R_ShutdownDynamicLightsBuffer
+============
+*/
+static void R_ShutdownDynamicLightsBuffer()
+{
+#if defined( GL_ARB_buffer_storage ) && defined( GL_ARB_sync )
+	if( dlightRingbuffer ) {
+		GLenum target = R_DynamicLightsTarget();
+
+		glBindBuffer( target, tr.dlightUBO );
+		R_ShutdownRingbuffer( target, &dlightRB );
+		glBindBuffer( target, 0 );
+	}
+#endif
+
+	glDeleteBuffers( 1, &tr.dlightUBO );
+	tr.dlightUBO = 0;
+	dlightRingbuffer = false;
+}
+
+/*
+============
+R_MapDynamicLights
+
+Leaves tr.dlightUBO bound and returns where the lights
+of the view are written, they start at tr.dlightOffset
+============
+*/
+shaderLight_t *R_MapDynamicLights( int numLights )
+{
+	GLenum target = R_DynamicLightsTarget();
+	GLsizeiptr size = numLights * sizeof( shaderLight_t );
+
+	glBindBuffer( target, tr.dlightUBO );
+
+	backEnd.pc.c_dynamicBufferBytes += size;
+
+#if defined( GL_ARB_buffer_storage ) && defined( GL_ARB_sync )
+	if( dlightRingbuffer ) {
+		// each view takes a whole block, the next frame or a frame with
+		// more views than a segment holds goes on to the next segment
+		if( dlightFrame != tr.frameCount || dlightViews >= DLIGHT_VIEWS_PER_SEGMENT ) {
+			R_RotateRingbuffer( &dlightRB );
+			dlightFrame = tr.frameCount;
+			dlightViews = 0;
+		}
+
+		GLsizei first = dlightRB.activeSegment * dlightRB.segmentElements + dlightViews * MAX_REF_LIGHTS;
+
+		dlightViews++;
+		tr.dlightOffset = first * sizeof( shaderLight_t );
+
+		return ( shaderLight_t * ) dlightRB.baseAddr + first;
+	}
+#endif
+
+	tr.dlightOffset = 0;
+	backEnd.pc.c_dynamicBufferOrphans++;
+
+	return ( shaderLight_t * ) glMapBufferRange( target, 0, size,
+						     GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT );
+}
+
+/*
+============
+R_UnmapDynamicLights
+============
+*/
+void R_UnmapDynamicLights()
+{
+	if( !dlightRingbuffer ) {
+		glUnmapBuffer( R_DynamicLightsTarget() );
+	}
+}
+
+/*
+============
+R_InitInstanceVBO
+============
+*/
+static void R_InitInstanceVBO()
+{
+	glGenBuffers( 1, &tess.instanceVBO );
+	glBindBuffer( GL_ARRAY_BUFFER, tess.instanceVBO );
+
+#if defined( GL_ARB_buffer_storage ) && defined( GL_ARB_sync )
+	if( glConfig2.bufferStorageAvailable &&
+	    glConfig2.syncAvailable ) {
+		R_InitRingbuffer( GL_ARRAY_BUFFER, sizeof( transform_t ),
+				  instanceCapacity, &tess.instanceRB );
+	} else
+#endif
+	{
+		glBufferData( GL_ARRAY_BUFFER, instanceCapacity * sizeof( transform_t ), nullptr, GL_DYNAMIC_DRAW );
+	}
+
+	glBindBuffer( GL_ARRAY_BUFFER, 0 );
+
+	tess.instancesWritten = tess.instanceBase = 0;
+	tess.numInstances = 0;
+}
+
+/*
+============
+R_ShutdownInstanceVBO
+============
+*/
+static void R_ShutdownInstanceVBO()
+{
+	if ( !tess.instanceVBO )
+	{
+		return;
+	}
+
+#if defined( GL_ARB_buffer_storage ) && defined( GL_ARB_sync )
+	if( glConfig2.bufferStorageAvailable &&
+	    glConfig2.syncAvailable ) {
+		glBindBuffer( GL_ARRAY_BUFFER, tess.instanceVBO );
+		R_ShutdownRingbuffer( GL_ARRAY_BUFFER, &tess.instanceRB );
+		glBindBuffer( GL_ARRAY_BUFFER, 0 );
+	}
+#endif
+
+	glDeleteBuffers( 1, &tess.instanceVBO );
+	tess.instanceVBO = 0;
+}
 
 /*
 ============
@@ -1018,6 +1269,16 @@ void R_InitVBOs()
 	}
 
 
+	if ( glConfig2.instancedArraysAvailable )
+	{
+		R_InitInstanceVBO();
+	}
+
+	if ( glConfig2.multiDrawIndirectAvailable )
+	{
+		R_InitDrawCommandsBuffer();
+	}
+
 	R_InitUnitCubeVBO();
 	R_InitTileVBO();
 
@@ -1029,17 +1290,7 @@ void R_InitVBOs()
 		      nullptr, GL_STREAM_COPY );
 	glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
 
-	if( glConfig2.uniformBufferObjectAvailable ) {
-		glGenBuffers( 1, &tr.dlightUBO );
-		glBindBuffer( GL_UNIFORM_BUFFER, tr.dlightUBO );
-		glBufferData( GL_UNIFORM_BUFFER, MAX_REF_LIGHTS * sizeof( shaderLight_t ), nullptr, GL_DYNAMIC_DRAW );
-		glBindBuffer( GL_UNIFORM_BUFFER, 0 );
-	} else {
-		glGenBuffers( 1, &tr.dlightUBO );
-		glBindBuffer( GL_PIXEL_UNPACK_BUFFER, tr.dlightUBO );
-		glBufferData( GL_PIXEL_UNPACK_BUFFER, MAX_REF_LIGHTS * sizeof( shaderLight_t ), nullptr, GL_DYNAMIC_DRAW );
-		glBindBuffer( GL_PIXEL_UNPACK_BUFFER, 0 );
-	}
+	R_InitDynamicLightsBuffer();
 
 	GL_CheckErrors();
 }
@@ -1084,6 +1335,9 @@ void R_ShutdownVBOs()
 	R_BindNullVBO();
 	R_BindNullIBO();
 
+	R_ShutdownInstanceVBO();
+	R_ShutdownDrawCommandsBuffer();
+
 	glDeleteBuffers( 1, &tr.colorGradePBO );
 
 	for ( i = 0; i < tr.vbos.currentElements; i++ )
@@ -1112,10 +1366,7 @@ void R_ShutdownVBOs()
 	Com_Free_Aligned( tess.vertsBuffer );
 	Com_Free_Aligned( tess.indexesBuffer );
 
-	if( glConfig2.uniformBufferObjectAvailable ) {
-		glDeleteBuffers( 1, &tr.dlightUBO );
-		tr.dlightUBO = 0;
-	}
+	R_ShutdownDynamicLightsBuffer();
 
 	tess.verts = tess.vertsBuffer = nullptr;
 	tess.indexes = tess.indexesBuffer = nullptr;
@@ -1155,6 +1406,7 @@ void Tess_MapVBOs( bool forceCPU ) {
 				// buffer is full, allocate a new one
 				glBufferData( GL_ARRAY_BUFFER, vertexCapacity * sizeof( shaderVertex_t ), nullptr, GL_DYNAMIC_DRAW );
 				tess.vertsWritten = 0;
+				backEnd.pc.c_dynamicBufferOrphans++;
 			}
 			tess.verts = ( shaderVertex_t *) glMapBufferRange( 
 				GL_ARRAY_BUFFER, tess.vertsWritten * sizeof( shaderVertex_t ),
@@ -1182,6 +1434,7 @@ void Tess_MapVBOs( bool forceCPU ) {
 				// buffer is full, allocate a new one
 				glBufferData( GL_ELEMENT_ARRAY_BUFFER, indexCapacity * sizeof( glIndex_t ), nullptr, GL_DYNAMIC_DRAW );
 				tess.indexesWritten = 0;
+				backEnd.pc.c_dynamicBufferOrphans++;
 			}
 			tess.indexes = ( glIndex_t *) glMapBufferRange( 
 				GL_ELEMENT_ARRAY_BUFFER, tess.indexesWritten * sizeof( glIndex_t ),
@@ -1217,18 +1470,16 @@ void Tess_UpdateVBOs()
 			GLimp_LogComment( va( "glBufferSubData( vbo = '%s', numVertexes = %i )\n", tess.vbo->name, tess.numVertexes ) );
 		}
 
+		backEnd.pc.c_dynamicBufferBytes += size;
+
 		if( !glConfig2.mapBufferRangeAvailable ) {
 			R_BindVBO( tess.vbo );
 			glBufferSubData( GL_ARRAY_BUFFER, 0, size, tess.verts );
 		} else {
 			R_BindVBO( tess.vbo );
-			if( glConfig2.bufferStorageAvailable &&
-			    glConfig2.syncAvailable ) {
-				GLsizei offset = tess.vertexBase * sizeof( shaderVertex_t );
-
-				glFlushMappedBufferRange( GL_ARRAY_BUFFER,
-							  offset, size );
-			} else {
+			// nothing to do for the coherent ring buffer
+			if( !glConfig2.bufferStorageAvailable ||
+			    !glConfig2.syncAvailable ) {
 				glFlushMappedBufferRange( GL_ARRAY_BUFFER,
 							  0, size );
 				glUnmapBuffer( GL_ARRAY_BUFFER );
@@ -1247,6 +1498,8 @@ void Tess_UpdateVBOs()
 	{
 		GLsizei size = tess.numIndexes * sizeof( glIndex_t );
 
+		backEnd.pc.c_dynamicBufferBytes += size;
+
 		if( !glConfig2.mapBufferRangeAvailable ) {
 			R_BindIBO( tess.ibo );
 			glBufferSubData( GL_ELEMENT_ARRAY_BUFFER, 0, size,
@@ -1254,13 +1507,8 @@ void Tess_UpdateVBOs()
 		} else {
 			R_BindIBO( tess.ibo );
 
-			if( glConfig2.bufferStorageAvailable &&
-			    glConfig2.syncAvailable ) {
-				GLsizei offset = tess.indexBase * sizeof( glIndex_t );
-
-				glFlushMappedBufferRange( GL_ELEMENT_ARRAY_BUFFER,
-							  offset, size );
-			} else {
+			if( !glConfig2.bufferStorageAvailable ||
+			    !glConfig2.syncAvailable ) {
 				glFlushMappedBufferRange( GL_ELEMENT_ARRAY_BUFFER,
 							  0, size );
 				glUnmapBuffer( GL_ELEMENT_ARRAY_BUFFER );
@@ -1275,6 +1523,107 @@ void Tess_UpdateVBOs()
 	GL_CheckErrors();
 }
 
+/*
+==============
+Tess_UploadInstances
+
+Copy the transforms of an instanced draw into the instance VBO,
+GL_VertexAttribPointers sources the instance attributes from there
+==============
+*/
+void Tess_UploadInstances( const transform_t *instances, int numInstances )
+{
+	GLsizei size = numInstances * sizeof( transform_t );
+
+	GLimp_LogComment( "--- Tess_UploadInstances ---\n" );
+
+	glBindBuffer( GL_ARRAY_BUFFER, tess.instanceVBO );
+
+#if defined( GL_ARB_buffer_storage ) && defined( GL_ARB_sync )
+	if( glConfig2.bufferStorageAvailable &&
+	    glConfig2.syncAvailable ) {
+		GLsizei segmentEnd = ( tess.instanceRB.activeSegment + 1 ) * tess.instanceRB.segmentElements;
+		if( tess.instancesWritten + numInstances > (unsigned) segmentEnd ) {
+			tess.instancesWritten = R_RotateRingbuffer( &tess.instanceRB );
+		}
+		memcpy( ( transform_t * ) tess.instanceRB.baseAddr + tess.instancesWritten, instances, size );
+	} else
+#endif
+	{
+		if( instanceCapacity - tess.instancesWritten < (unsigned) numInstances ) {
+			// buffer is full, allocate a new one
+			glBufferData( GL_ARRAY_BUFFER, instanceCapacity * sizeof( transform_t ), nullptr, GL_DYNAMIC_DRAW );
+			tess.instancesWritten = 0;
+			backEnd.pc.c_dynamicBufferOrphans++;
+		}
+		glBufferSubData( GL_ARRAY_BUFFER, tess.instancesWritten * sizeof( transform_t ), size, instances );
+	}
+
+	backEnd.pc.c_dynamicBufferBytes += size;
+
+	tess.instanceBase = tess.instancesWritten;
+	tess.instancesWritten += numInstances;
+	tess.numInstances = numInstances;
+
+	// restore the binding R_BindVBO keeps track of
+	glBindBuffer( GL_ARRAY_BUFFER, glState.currentVBO ? glState.currentVBO->vertexesVBO : 0 );
+
+	GL_CheckErrors();
+}
+
+/*
+==============
+Tess_UploadDrawCommands
+
+Turn the multidraw primitives into indirect draw commands, they are
+written for every draw as comparing them would cost as much
+==============
+*/
+void Tess_UploadDrawCommands()
+{
+	drawElementsIndirectCommand_t *commands = tess.drawCommands;
+	GLsizei size = tess.multiDrawPrimitives * sizeof( drawElementsIndirectCommand_t );
+	int i;
+
+	GLimp_LogComment( "--- Tess_UploadDrawCommands ---\n" );
+
+#if defined( GL_ARB_buffer_storage ) && defined( GL_ARB_sync )
+	if( glConfig2.bufferStorageAvailable &&
+	    glConfig2.syncAvailable ) {
+		GLsizei segmentEnd = ( tess.drawCommandsRB.activeSegment + 1 ) * tess.drawCommandsRB.segmentElements;
+		if( tess.drawCommandsWritten + tess.multiDrawPrimitives > (unsigned) segmentEnd ) {
+			tess.drawCommandsWritten = R_RotateRingbuffer( &tess.drawCommandsRB );
+		}
+		// written straight to the coherent mapping
+		commands = ( drawElementsIndirectCommand_t * ) tess.drawCommandsRB.baseAddr + tess.drawCommandsWritten;
+	}
+#endif
+
+	for ( i = 0; i < tess.multiDrawPrimitives; i++ )
+	{
+		commands[ i ].count = tess.multiDrawCounts[ i ];
+		commands[ i ].instanceCount = 1;
+		commands[ i ].firstIndex = ( uintptr_t ) tess.multiDrawIndexes[ i ] / sizeof( glIndex_t );
+		commands[ i ].baseVertex = 0;
+		commands[ i ].baseInstance = 0;
+	}
+
+	if( commands == tess.drawCommands ) {
+		if( drawCommandsCapacity - tess.drawCommandsWritten < (unsigned) tess.multiDrawPrimitives ) {
+			// buffer is full, allocate a new one
+			glBufferData( GL_DRAW_INDIRECT_BUFFER, drawCommandsCapacity * sizeof( drawElementsIndirectCommand_t ), nullptr, GL_DYNAMIC_DRAW );
+			tess.drawCommandsWritten = 0;
+			backEnd.pc.c_dynamicBufferOrphans++;
+		}
+		glBufferSubData( GL_DRAW_INDIRECT_BUFFER, tess.drawCommandsWritten * sizeof( drawElementsIndirectCommand_t ), size, tess.drawCommands );
+	}
+
+	backEnd.pc.c_dynamicBufferBytes += size;
+
+	tess.drawCommandBase = tess.drawCommandsWritten;
+	tess.drawCommandsWritten += tess.multiDrawPrimitives;
+}
+
 /*
 ============
 R_VBOList_f
@@ -24,40 +24,74 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "tr_local.h"
 #include "gl_shader.h"
+#include "FrustumCull.h"
+#include "OcclusionCull.h"
 
 static Cvar::Modified<Cvar::Cvar<bool>> r_showCluster(
 	"r_showCluster", "print PVS cluster at current location", Cvar::CHEAT, false );
 
+static Cvar::Cvar<bool> r_occlusionCulling(
+	"r_occlusionCulling", "cull the world and the entities hidden behind large world faces", Cvar::NONE, false );
+
+static_assert( MAX_OCCLUDER_POINTS <= OcclusionCull::MAX_POINTS, "occluders have too many points" );
+
+// the occluders of the current view, drawn by R_DrawOccluders
+#define OCCLUSION_WIDTH  256
+#define OCCLUSION_HEIGHT 128
+
+static OcclusionCull::DepthBuffer occlusionBuffer;
+static bool                       occlusionActive;
+
+// what culling found for a surface, so that the world walk jobs can cull a
+// surface once for each leaf it is in but only count it when it is added
+enum
+{
+	SURFACE_CULL_TYPE = 1 << 0, // not drawn in the main view
+	SURFACE_CULL_PLANE_IN = 1 << 1,
+	SURFACE_CULL_PLANE_OUT = 1 << 2,
+	SURFACE_CULL_BOX_IN = 1 << 3,
+	SURFACE_CULL_BOX_CLIP = 1 << 4,
+	SURFACE_CULL_BOX_OUT = 1 << 5,
+
+	SURFACE_CULLED = SURFACE_CULL_TYPE | SURFACE_CULL_PLANE_OUT | SURFACE_CULL_BOX_OUT
+};
+
 /*
 ================
-R_CullSurface
+R_CountSurfaceCull
+================
+*/
+static void R_CountSurfaceCull( int cull )
+{
+	tr.pc.c_plane_cull_in += !!( cull & SURFACE_CULL_PLANE_IN );
+	tr.pc.c_plane_cull_out += !!( cull & SURFACE_CULL_PLANE_OUT );
+	tr.pc.c_box_cull_in += !!( cull & SURFACE_CULL_BOX_IN );
+	tr.pc.c_box_cull_clip += !!( cull & SURFACE_CULL_BOX_CLIP );
+	tr.pc.c_box_cull_out += !!( cull & SURFACE_CULL_BOX_OUT );
+}
 
-Tries to back face cull surfaces before they are lighted or
-added to the sorting list.
+/*
+================
+R_CullSurfacePlane
 
-This will also allow mirrors on both sides of a model without recursion.
+R_CullSurface without the box culling, for callers that cull the
+boxes of many surfaces together. Returns SURFACE_CULL_* bits
 ================
 */
-static bool R_CullSurface( surfaceType_t *surface, shader_t *shader, int planeBits )
+static int R_CullSurfacePlane( surfaceType_t *surface, shader_t *shader )
 {
 	srfGeneric_t *gen;
 	float        d;
 
-	// allow culling to be disabled
-	if ( r_nocull->integer )
-	{
-		return false;
-	}
-
 	// ydnar: made surface culling generic, inline with q3map2 surface classification
 	if ( *surface == surfaceType_t::SF_GRID && r_nocurves->integer )
 	{
-		return true;
+		return SURFACE_CULL_TYPE;
 	}
 
 	if ( *surface != surfaceType_t::SF_FACE && *surface != surfaceType_t::SF_TRIANGLES && *surface != surfaceType_t::SF_VBO_MESH && *surface != surfaceType_t::SF_GRID )
 	{
-		return true;
+		return SURFACE_CULL_TYPE;
 	}
 
 	// get generic surface
@@ -76,52 +110,63 @@ static bool R_CullSurface( surfaceType_t *surface, shader_t *shader, int planeBi
 		{
 			if ( d < -8.0f )
 			{
-				tr.pc.c_plane_cull_out++;
-				return true;
+				return SURFACE_CULL_PLANE_OUT;
 			}
 		}
 		else if ( shader->cullType == CT_BACK_SIDED )
 		{
 			if ( d > 8.0f )
 			{
-				tr.pc.c_plane_cull_out++;
-				return true;
+				return SURFACE_CULL_PLANE_OUT;
 			}
 		}
 
-		tr.pc.c_plane_cull_in++;
+		return SURFACE_CULL_PLANE_IN;
 	}
 
-	if ( planeBits )
+	return 0;
+}
+
+/*
+================
+R_CullSurface
+
+Tries to back face cull surfaces before they are lighted or
+added to the sorting list.
+
+This will also allow mirrors on both sides of a model without recursion.
+================
+*/
+static bool R_CullSurface( surfaceType_t *surface, shader_t *shader, int planeBits )
+{
+	// allow culling to be disabled
+	if ( r_nocull->integer )
+	{
+		return false;
+	}
+
+	int cull = R_CullSurfacePlane( surface, shader );
+
+	if ( !( cull & SURFACE_CULLED ) && planeBits )
 	{
-		cullResult_t cull;
+		srfGeneric_t *gen = ( srfGeneric_t * ) surface;
+		cullResult_t boxCull;
 
 		if ( tr.currentEntity != &tr.worldEntity )
 		{
-			cull = R_CullLocalBox( gen->bounds );
+			boxCull = R_CullLocalBox( gen->bounds );
 		}
 		else
 		{
-			cull = R_CullBox( gen->bounds );
+			boxCull = R_CullBox( gen->bounds );
 		}
 
-		if ( cull == CULL_OUT )
-		{
-			tr.pc.c_box_cull_out++;
-			return true;
-		}
-		else if ( cull == CULL_CLIP )
-		{
-			tr.pc.c_box_cull_clip++;
-		}
-		else
-		{
-			tr.pc.c_box_cull_in++;
-		}
+		cull |= boxCull == CULL_OUT ? SURFACE_CULL_BOX_OUT : boxCull == CULL_CLIP ? SURFACE_CULL_BOX_CLIP : SURFACE_CULL_BOX_IN;
 	}
 
-	// must be visible
-	return false;
+	R_CountSurfaceCull( cull );
+
+	return cull & SURFACE_CULLED;
 }
 
 static bool R_CullLightSurface( surfaceType_t *surface, shader_t *shader, trRefLight_t *light, byte *cubeSideBits )
@@ -340,6 +385,7 @@ void R_AddBSPModelSurfaces( trRefEntity_t *ent )
 	VectorScale( boundsCenter, 0.5f, boundsCenter );
 
 	ent->cull = R_CullBox( ent->worldBounds );
+	R_OcclusionCullEntity( ent );
 
 	if ( ent->cull == CULL_OUT )
 	{
@@ -365,12 +411,61 @@ void R_AddBSPModelSurfaces( trRefEntity_t *ent )
 =============================================================
 */
 
-static void R_AddLeafSurfaces( bspNode_t *node, int decalBits, int planeBits )
+// The world is walked by front end jobs that each take a subtree, and record
+// the visible leaves along with the culling of their surfaces. The surfaces
+// are then added in the order a single walk would have found them.
+// Nodes are referred to by their index in the world_t flat node arrays.
+struct worldLeaf_t
 {
-	int          c;
-	bspSurface_t **mark;
-	bspSurface_t **view;
+	bspNode_t *node;
+	int       decalBits;
+	int       firstSurface; // into worldJob_t::surfaceCull
+};
 
+struct worldStackEntry_t
+{
+	int node;
+	int planeBits;
+	int decalBits;
+};
+
+struct worldJob_t
+{
+	int                            node;
+	int                            planeBits;
+	int                            decalBits;
+
+	std::vector<worldStackEntry_t> stack;
+	std::vector<bspNode_t *>       traversal;
+	std::vector<worldLeaf_t>       leaves;
+	std::vector<byte>              surfaceCull; // SURFACE_CULL_* bits, counted when the surface is added
+	frontEndCounters_t             pc;
+
+	// boxes of the surfaces that passed R_CullSurfacePlane
+	FrustumCull::Boxes             boxes;
+	std::vector<int>               boxSurfaces; // into surfaceCull
+	FrustumCull::Result            boxCull;
+};
+
+static std::vector<worldJob_t> worldJobs;
+static int                     numWorldJobs;
+
+// the view frustum planes, transposed so that a box can be tested
+// against four of them at once
+#define WORLD_FRUSTUM_GROUPS ( ( FRUSTUM_PLANES + 3 ) / 4 )
+
+struct worldFrustum_t
+{
+	float normal[ WORLD_FRUSTUM_GROUPS ][ 3 ][ 4 ];
+	float absNormal[ WORLD_FRUSTUM_GROUPS ][ 3 ][ 4 ];
+	float dist[ WORLD_FRUSTUM_GROUPS ][ 4 ];
+};
+
+static worldFrustum_t      worldFrustum;
+static FrustumCull::Frustum worldCullFrustum;
+
+static void R_AddLeafBounds( bspNode_t *node )
+{
 	tr.pc.c_leafs++;
 
 	// add to z buffer bounds
@@ -403,6 +498,15 @@ static void R_AddLeafSurfaces( bspNode_t *node, int decalBits, int planeBits )
 	{
 		tr.viewParms.visBounds[ 1 ][ 2 ] = node->maxs[ 2 ];
 	}
+}
+
+static void R_AddLeafSurfaces( bspNode_t *node, int decalBits, int planeBits )
+{
+	int          c;
+	bspSurface_t **mark;
+	bspSurface_t **view;
+
+	R_AddLeafBounds( node );
 
 	// add the individual surfaces
 	mark = tr.world->markSurfaces + node->firstMarkSurface;
@@ -427,93 +531,408 @@ static void R_AddLeafSurfaces( bspNode_t *node, int decalBits, int planeBits )
 
 /*
 ================
-R_RecursiveWorldNode
+R_AddCulledLeafSurfaces
+
+Same as R_AddLeafSurfaces, with the surfaces already culled by a job
 ================
 */
-static void R_RecursiveWorldNode( bspNode_t *node, int planeBits, int decalBits )
+static void R_AddCulledLeafSurfaces( bspNode_t *node, int decalBits, const byte *cull )
 {
-	do
+	int          c;
+	bspSurface_t **mark;
+	bspSurface_t **view;
+
+	R_AddLeafBounds( node );
+
+	mark = tr.world->markSurfaces + node->firstMarkSurface;
+	c = node->numMarkSurfaces;
+	view = tr.world->viewSurfaces + node->firstMarkSurface;
+
+	while ( c-- )
 	{
-		// if the node wasn't marked as potentially visible, exit
-		if ( node->visCounts[ tr.visIndex ] != tr.visCounts[ tr.visIndex ] )
+		// the surface may have already been added if it
+		// spans multiple leafs
+		if ( ( *view )->viewCount != tr.viewCountNoReset )
 		{
-			return;
+			( *view )->viewCount = tr.viewCountNoReset;
+
+			R_CountSurfaceCull( *cull );
+
+			if ( !( *cull & SURFACE_CULLED ) )
+			{
+				R_AddDrawSurf( ( *view )->data, ( *view )->shader, ( *view )->lightmapNum, ( *view )->fogIndex, true );
+			}
+
+			R_AddDecalSurface( *mark, decalBits );
 		}
 
-		if ( node->contents != -1 && !node->numMarkSurfaces )
+		( *mark )->viewCount = tr.viewCountNoReset;
+
+		mark++;
+		view++;
+		cull++;
+	}
+}
+
+/*
+================
+R_SetupWorldFrustum
+================
+*/
+static void R_SetupWorldFrustum()
+{
+	for ( int i = 0; i < WORLD_FRUSTUM_GROUPS * 4; i++ )
+	{
+		int group = i / 4;
+		int lane = i % 4;
+
+		if ( i < FRUSTUM_PLANES )
 		{
-			// don't waste time dealing with this empty leaf
-			return;
+			const cplane_t *plane = &tr.viewParms.frustums[ 0 ][ i ];
+
+			for ( int j = 0; j < 3; j++ )
+			{
+				worldFrustum.normal[ group ][ j ][ lane ] = plane->normal[ j ];
+				worldFrustum.absNormal[ group ][ j ][ lane ] = fabsf( plane->normal[ j ] );
+			}
+
+			worldFrustum.dist[ group ][ lane ] = plane->dist;
 		}
+		else
+		{
+			// padding, everything is in front of it
+			for ( int j = 0; j < 3; j++ )
+			{
+				worldFrustum.normal[ group ][ j ][ lane ] = 0.0f;
+				worldFrustum.absNormal[ group ][ j ][ lane ] = 0.0f;
+			}
 
-		// if the bounding volume is outside the frustum, nothing
-		// inside can be visible
-		if ( !r_nocull->integer )
+			worldFrustum.dist[ group ][ lane ] = -1.0f;
+		}
+	}
+
+	worldCullFrustum.numPlanes = FRUSTUM_PLANES;
+
+	for ( int i = 0; i < FRUSTUM_PLANES; i++ )
+	{
+		worldCullFrustum.SetPlane( i, tr.viewParms.frustums[ 0 ][ i ].normal, tr.viewParms.frustums[ 0 ][ i ].dist );
+	}
+}
+
+/*
+================
+R_CullNodeBounds
+
+Same as BoxOnPlaneSide for all the planes in planeBits, four planes at a
+time. Returns true if the bounds are behind one of them, otherwise removes
+the planes the bounds are entirely in front of
+================
+*/
+static bool R_CullNodeBounds( const bspNodeBounds_t *bounds, int *planeBits )
+{
+	int front = 0;
+	int back = 0;
+
+	for ( int group = 0; group < WORLD_FRUSTUM_GROUPS; group++ )
+	{
+		if ( !( ( *planeBits >> ( group * 4 ) ) & 15 ) )
 		{
-			int i;
-			int r;
+			continue;
+		}
 
-			for ( i = 0; i < FRUSTUM_PLANES; i++ )
+		float dist[ 4 ], radius[ 4 ];
+
+		for ( int k = 0; k < 4; k++ )
+		{
+			dist[ k ] = bounds->center[ 0 ] * worldFrustum.normal[ group ][ 0 ][ k ]
+			          + bounds->center[ 1 ] * worldFrustum.normal[ group ][ 1 ][ k ]
+			          + bounds->center[ 2 ] * worldFrustum.normal[ group ][ 2 ][ k ]
+			          - worldFrustum.dist[ group ][ k ];
+
+			radius[ k ] = bounds->extents[ 0 ] * worldFrustum.absNormal[ group ][ 0 ][ k ]
+			            + bounds->extents[ 1 ] * worldFrustum.absNormal[ group ][ 1 ][ k ]
+			            + bounds->extents[ 2 ] * worldFrustum.absNormal[ group ][ 2 ][ k ];
+		}
+
+		for ( int k = 0; k < 4; k++ )
+		{
+			front |= ( dist[ k ] - radius[ k ] >= 0 ) << ( group * 4 + k );
+			back |= ( dist[ k ] + radius[ k ] < 0 ) << ( group * 4 + k );
+		}
+	}
+
+	if ( back & *planeBits )
+	{
+		return true; // culled
+	}
+
+	// all descendants will also be in front
+	*planeBits &= ~front;
+	return false;
+}
+
+/*
+================
+R_CullWorldNode
+
+Returns true if nothing in the node can be visible, otherwise removes
+the planes and the decals the node is entirely on the good side of
+================
+*/
+static bool R_CullWorldNode( int index, int *planeBits, int *decalBits )
+{
+	const world_t *world = tr.world;
+
+	// if the node wasn't marked as potentially visible, exit
+	if ( world->flatVisCounts[ tr.visIndex * world->numnodes + index ] != tr.visCounts[ tr.visIndex ] )
+	{
+		return true;
+	}
+
+	if ( !world->flatChildren[ index ][ 0 ] && !world->flatNodes[ index ]->numMarkSurfaces )
+	{
+		// don't waste time dealing with this empty leaf
+		return true;
+	}
+
+	// if the bounding volume is outside the frustum, nothing
+	// inside can be visible
+	if ( !r_nocull->integer && *planeBits )
+	{
+		if ( R_CullNodeBounds( &world->flatBounds[ index ], planeBits ) )
+		{
+			return true;
+		}
+	}
+
+	// ydnar: cull decals
+	if ( *decalBits )
+	{
+		bspNode_t *node = world->flatNodes[ index ];
+		int       i;
+
+		for ( i = 0; i < tr.refdef.numDecalProjectors; i++ )
+		{
+			if ( *decalBits & ( 1 << i ) )
 			{
-				if ( planeBits & ( 1 << i ) )
+				// test decal bounds against node bounds
+				if ( tr.refdef.decalProjectors[ i ].shader == nullptr ||
+				     !R_TestDecalBoundingBox( &tr.refdef.decalProjectors[ i ], node->mins, node->maxs ) )
 				{
-					r = BoxOnPlaneSide( node->mins, node->maxs, &tr.viewParms.frustums[ 0 ][ i ] );
+					*decalBits &= ~( 1 << i );
+				}
+			}
+		}
+	}
 
-					if ( r == 2 )
-					{
-						return; // culled
-					}
+	return false;
+}
 
-					if ( r == 1 )
-					{
-						planeBits &= ~( 1 << i );  // all descendants will also be in front
-					}
-				}
+/*
+================
+R_FrontWorldChild
+
+Returns which child is on the same side as the view
+================
+*/
+static int R_FrontWorldChild( int index )
+{
+	const float *plane = tr.world->flatPlanes[ index ];
+	float       d = DotProduct( tr.viewParms.orientation.viewOrigin, plane ) - plane[ 3 ];
+
+	return d <= 0;
+}
+
+/*
+================
+R_WalkWorldNodes
+
+Walks the subtree of a job front to back with an explicit stack.
+Runs in a job, only writes to the job
+================
+*/
+static void R_WalkWorldNodes( worldJob_t *job )
+{
+	const world_t *world = tr.world;
+
+	job->stack.push_back( { job->node, job->planeBits, job->decalBits } );
+
+	while ( !job->stack.empty() )
+	{
+		worldStackEntry_t entry = job->stack.back();
+		job->stack.pop_back();
+
+		if ( R_CullWorldNode( entry.node, &entry.planeBits, &entry.decalBits ) )
+		{
+			continue;
+		}
+
+		bspNode_t *node = world->flatNodes[ entry.node ];
+		const int *children = world->flatChildren[ entry.node ];
+
+		if ( occlusionActive )
+		{
+			if ( occlusionBuffer.Occluded( node->mins, node->maxs ) )
+			{
+				job->pc.c_occlusion_cull_node_out++;
+				continue;
 			}
+
+			job->pc.c_occlusion_cull_node_in++;
 		}
 
-		backEndData[ tr.smpFrame ]->traversalList[ backEndData[ tr.smpFrame ]->traversalLength++ ] = node;
+		job->traversal.push_back( node );
 
-		// ydnar: cull decals
-		if ( decalBits )
+		if ( children[ 0 ] )
 		{
-			int i;
+			int side = R_FrontWorldChild( entry.node );
 
-			for ( i = 0; i < tr.refdef.numDecalProjectors; i++ )
+			// the back side is pushed first so that the front side is walked first
+			job->stack.push_back( { children[ side ^ 1 ], entry.planeBits, entry.decalBits } );
+			job->stack.push_back( { children[ side ], entry.planeBits, entry.decalBits } );
+			continue;
+		}
+
+		worldLeaf_t  leaf;
+		int          c;
+		bspSurface_t **view;
+
+		leaf.node = node;
+		leaf.decalBits = entry.decalBits;
+		leaf.firstSurface = job->surfaceCull.size();
+
+		// try to cull before lighting or adding, the boxes are
+		// culled all at once at the end
+		c = node->numMarkSurfaces;
+		view = world->viewSurfaces + node->firstMarkSurface;
+
+		while ( c-- )
+		{
+			int cull = 0;
+
+			if ( !r_nocull->integer )
 			{
-				if ( decalBits & ( 1 << i ) )
+				cull = R_CullSurfacePlane( ( *view )->data, ( *view )->shader );
+
+				if ( !( cull & SURFACE_CULLED ) && entry.planeBits )
 				{
-					// test decal bounds against node bounds
-					if ( tr.refdef.decalProjectors[ i ].shader == nullptr ||
-					     !R_TestDecalBoundingBox( &tr.refdef.decalProjectors[ i ], node->mins, node->maxs ) )
-					{
-						decalBits &= ~( 1 << i );
-					}
+					srfGeneric_t *gen = ( srfGeneric_t * ) ( *view )->data;
+
+					job->boxSurfaces.push_back( job->surfaceCull.size() );
+					job->boxes.Add( gen->bounds[ 0 ], gen->bounds[ 1 ] );
 				}
 			}
+
+			job->surfaceCull.push_back( cull );
+			view++;
 		}
 
-		if ( node->contents != -1 )
+		job->leaves.push_back( leaf );
+	}
+
+	// same as R_CullBox on every box
+	FrustumCull::Cull( worldCullFrustum, FRUSTUM_CLIPALL, job->boxes, job->boxCull );
+
+	for ( size_t i = 0; i < job->boxSurfaces.size(); i++ )
+	{
+		job->surfaceCull[ job->boxSurfaces[ i ] ] |= job->boxCull.Outside( i ) ? SURFACE_CULL_BOX_OUT
+		                                           : job->boxCull.Clipped( i ) ? SURFACE_CULL_BOX_CLIP : SURFACE_CULL_BOX_IN;
+	}
+}
+
+/*
+================
+R_SplitWorldNode
+
+Walks the top of the tree like R_WalkWorldNodes, and makes a job of
+every subtree found at the given depth, in front to back order
+================
+*/
+static void R_SplitWorldNode( int index, int planeBits, int decalBits, int depth )
+{
+	const int *children = tr.world->flatChildren[ index ];
+
+	if ( depth > 0 && children[ 0 ] )
+	{
+		if ( R_CullWorldNode( index, &planeBits, &decalBits ) )
 		{
-			break;
+			return;
 		}
 
-		float d = DotProduct(tr.viewParms.orientation.viewOrigin, node->plane->normal) - node->plane->dist;
+		backEndData[ tr.smpFrame ]->traversalList[ backEndData[ tr.smpFrame ]->traversalLength++ ] = tr.world->flatNodes[ index ];
 
-		uint32_t side = d <= 0;
+		int side = R_FrontWorldChild( index );
 
-		// recurse down the children, front side first
-		R_RecursiveWorldNode( node->children[ side ], planeBits, decalBits );
+		R_SplitWorldNode( children[ side ], planeBits, decalBits, depth - 1 );
+		R_SplitWorldNode( children[ side ^ 1 ], planeBits, decalBits, depth - 1 );
+		return;
+	}
 
-		// tail recurse
-		node = node->children[ side ^ 1 ];
+	if ( numWorldJobs == static_cast<int>( worldJobs.size() ) )
+	{
+		worldJobs.emplace_back();
+	}
+
+	worldJob_t &job = worldJobs[ numWorldJobs++ ];
+	job.node = index;
+	job.planeBits = planeBits;
+	job.decalBits = decalBits;
+}
+
+/*
+================
+R_AddWorldNodes
+
+Walks the world in parallel, then adds the visible surfaces
+================
+*/
+static void R_AddWorldNodes()
+{
+	int numThreads = R_NumJobThreads();
+	int depth = 0;
+
+	// a few jobs per thread, so that one of them being slow doesn't
+	// keep the others waiting
+	while ( ( 1 << depth ) < numThreads * 4 && depth < 8 && numThreads > 1 )
+	{
+		depth++;
 	}
-	while ( true );
 
-	if ( node->numMarkSurfaces )
+	R_SetupWorldFrustum();
+
+	numWorldJobs = 0;
+	R_SplitWorldNode( 0, FRUSTUM_CLIPALL, tr.refdef.decalBits, depth );
+
+	R_RunJobs( numWorldJobs, []( int i ) {
+		worldJob_t &job = worldJobs[ i ];
+
+		job.stack.clear();
+		job.traversal.clear();
+		job.leaves.clear();
+		job.surfaceCull.clear();
+		job.boxes.Clear();
+		job.boxSurfaces.clear();
+		ResetStruct( job.pc );
+
+		R_WalkWorldNodes( &job );
+	} );
+
+	for ( int i = 0; i < numWorldJobs; i++ )
 	{
-		// ydnar: moved off to separate function
-		R_AddLeafSurfaces( node, decalBits, planeBits );
+		const worldJob_t &job = worldJobs[ i ];
+
+		for ( bspNode_t *node : job.traversal )
+		{
+			backEndData[ tr.smpFrame ]->traversalList[ backEndData[ tr.smpFrame ]->traversalLength++ ] = node;
+		}
+
+		tr.pc.c_occlusion_cull_node_in += job.pc.c_occlusion_cull_node_in;
+		tr.pc.c_occlusion_cull_node_out += job.pc.c_occlusion_cull_node_out;
+
+		for ( const worldLeaf_t &leaf : job.leaves )
+		{
+			R_AddCulledLeafSurfaces( leaf.node, leaf.decalBits, job.surfaceCull.data() + leaf.firstSurface );
+		}
 	}
 }
 
@@ -736,6 +1155,63 @@ bool R_inPVVS( const vec3_t p1, const vec3_t p2 )
 	return true;
 }
 
+/*
+===============
+R_MarkLeaf
+
+Marks a leaf in the pvs and its parents, unless its area is closed
+===============
+*/
+static void R_MarkLeaf( bspNode_t *leaf, int visCount, int *flatVisCounts )
+{
+	// check if outside map
+	if (leaf->area == -1) {
+		// can't be visible
+		return;
+	}
+
+	// check for door connection
+	if ( ( tr.refdef.areamask[ leaf->area >> 3 ] & ( 1 << ( leaf->area & 7 ) ) ) )
+	{
+		// not visible
+		return;
+	}
+
+	// ydnar: don't want to walk the entire bsp to add skybox surfaces
+	if ( tr.refdef.rdflags & RDF_SKYBOXPORTAL )
+	{
+		// this only happens once, as game/cgame know the origin of the skybox
+		// this also means the skybox portal cannot move, as this list is calculated once and never again
+		if ( tr.world->numSkyNodes < WORLD_MAX_SKY_NODES )
+		{
+			tr.world->skyNodes[ tr.world->numSkyNodes++ ] = leaf;
+		}
+
+		R_AddLeafSurfaces( leaf, 0, FRUSTUM_CLIPALL );
+		return;
+	}
+
+	if ( leaf->flatIndex < 0 )
+	{
+		// not reachable from the root
+		leaf->visCounts[ tr.visIndex ] = visCount;
+		return;
+	}
+
+	// mark the leaf and its parents through the flat arrays, the
+	// walk only reads flatVisCounts
+	for ( int parent = leaf->flatIndex; parent >= 0; parent = tr.world->flatParents[ parent ] )
+	{
+		if ( flatVisCounts[ parent ] == visCount )
+		{
+			break;
+		}
+
+		flatVisCounts[ parent ] = visCount;
+		tr.world->flatNodes[ parent ]->visCounts[ tr.visIndex ] = visCount;
+	}
+}
+
 /*
 ===============
 R_MarkLeaves
@@ -747,9 +1223,11 @@ cluster
 static void R_MarkLeaves()
 {
 	const byte *vis;
-	bspNode_t  *leaf, *parent;
+	bspNode_t  *leaf;
 	int        i;
 	int        cluster;
+	int        visCount;
+	int        *flatVisCounts;
 
 	// lockpvs lets designers walk around to determine the
 	// extent of the current pvs
@@ -799,13 +1277,21 @@ static void R_MarkLeaves()
 		Log::Notice("update cluster:%i  area:%i  index:%i", cluster, leaf->area, tr.visIndex );
 	}
 
+	visCount = tr.visCounts[ tr.visIndex ];
+	flatVisCounts = tr.world->flatVisCounts + tr.visIndex * tr.world->numnodes;
+
 	if ( r_novis->integer || tr.visClusters[ tr.visIndex ] == -1 )
 	{
 		for ( i = 0; i < tr.world->numnodes; i++ )
 		{
 			if ( tr.world->nodes[ i ].contents != CONTENTS_SOLID )
 			{
-				tr.world->nodes[ i ].visCounts[ tr.visIndex ] = tr.visCounts[ tr.visIndex ];
+				tr.world->nodes[ i ].visCounts[ tr.visIndex ] = visCount;
+			}
+
+			if ( tr.world->flatNodes[ i ] && tr.world->flatNodes[ i ]->contents != CONTENTS_SOLID )
+			{
+				flatVisCounts[ i ] = visCount;
 			}
 		}
 
@@ -813,6 +1299,45 @@ static void R_MarkLeaves()
 	}
 
 	vis = R_ClusterPVS( tr.visClusters[ tr.visIndex ] );
+	cluster = tr.visClusters[ tr.visIndex ];
+
+	if ( tr.world->clusterLeaves && cluster >= 0 && cluster < tr.world->numClusters )
+	{
+		// only go through the leafs of the clusters in the pvs, and
+		// those without a cluster
+		const int *offsets = tr.world->clusterLeafOffsets;
+		const int *leafs = tr.world->clusterLeaves;
+
+		for ( i = offsets[ tr.world->numClusters ]; i < offsets[ tr.world->numClusters + 1 ]; i++ )
+		{
+			R_MarkLeaf( tr.world->flatNodes[ leafs[ i ] ], visCount, flatVisCounts );
+		}
+
+		for ( int visByte = 0; visByte < tr.world->clusterBytes; visByte++ )
+		{
+			if ( !vis[ visByte ] )
+			{
+				continue;
+			}
+
+			for ( int bit = 0; bit < 8; bit++ )
+			{
+				cluster = visByte * 8 + bit;
+
+				if ( cluster >= tr.world->numClusters || !( vis[ visByte ] & ( 1 << bit ) ) )
+				{
+					continue;
+				}
+
+				for ( i = offsets[ cluster ]; i < offsets[ cluster + 1 ]; i++ )
+				{
+					R_MarkLeaf( tr.world->flatNodes[ leafs[ i ] ], visCount, flatVisCounts );
+				}
+			}
+		}
+
+		return;
+	}
 
 	for ( i = 0, leaf = tr.world->nodes; i < tr.world->numnodes; i++, leaf++ )
 	{
@@ -830,46 +1355,89 @@ static void R_MarkLeaves()
 			}
 		}
 
-		// check if outside map
-		if (leaf->area == -1) {
-			// can't be visible
-			continue;
-		}
+		R_MarkLeaf( leaf, visCount, flatVisCounts );
+	}
+}
+
+/*
+=============
+R_DrawOccluders
 
-		// check for door connection
-		if ( ( tr.refdef.areamask[ leaf->area >> 3 ] & ( 1 << ( leaf->area & 7 ) ) ) )
+Draws the occluders in front of the view into the occlusion buffer, the
+world walk and the entities are then tested against it
+=============
+*/
+static void R_DrawOccluders()
+{
+	if ( !r_occlusionCulling.Get() || r_nocull->integer || !tr.world->numOccluders )
+	{
+		return;
+	}
+
+	// the buffer only sees through the view, not through portals
+	if ( tr.viewParms.portalLevel > 0 )
+	{
+		return;
+	}
+
+	if ( occlusionBuffer.Width() != OCCLUSION_WIDTH || occlusionBuffer.Height() != OCCLUSION_HEIGHT )
+	{
+		occlusionBuffer.Resize( OCCLUSION_WIDTH, OCCLUSION_HEIGHT );
+	}
+
+	matrix_t modelViewProjection;
+
+	MatrixMultiply( tr.viewParms.projectionMatrix, tr.viewParms.world.modelViewMatrix, modelViewProjection );
+
+	occlusionBuffer.SetView( modelViewProjection, tr.viewParms.zNear );
+	occlusionBuffer.Clear();
+
+	for ( int i = 0; i < tr.world->numOccluders; i++ )
+	{
+		occluder_t *occluder = &tr.world->occluders[ i ];
+
+		// what is behind the back side of a face can be seen through it
+		if ( DotProduct( tr.viewParms.orientation.viewOrigin, occluder->plane.normal ) - occluder->plane.dist <= 0 )
 		{
-			// not visible
 			continue;
 		}
 
-		// ydnar: don't want to walk the entire bsp to add skybox surfaces
-		if ( tr.refdef.rdflags & RDF_SKYBOXPORTAL )
+		if ( R_CullBox( occluder->bounds ) == cullResult_t::CULL_OUT )
 		{
-			// this only happens once, as game/cgame know the origin of the skybox
-			// this also means the skybox portal cannot move, as this list is calculated once and never again
-			if ( tr.world->numSkyNodes < WORLD_MAX_SKY_NODES )
-			{
-				tr.world->skyNodes[ tr.world->numSkyNodes++ ] = leaf;
-			}
-
-			R_AddLeafSurfaces( leaf, 0, FRUSTUM_CLIPALL );
 			continue;
 		}
 
-		parent = leaf;
+		occlusionBuffer.DrawPolygon( occluder->points, occluder->numPoints );
+		tr.pc.c_occluders++;
+	}
 
-		do
-		{
-			if ( parent->visCounts[ tr.visIndex ] == tr.visCounts[ tr.visIndex ] )
-			{
-				break;
-			}
+	occlusionActive = true;
+}
 
-			parent->visCounts[ tr.visIndex ] = tr.visCounts[ tr.visIndex ];
-			parent = parent->parent;
-		}
-		while ( parent );
+/*
+=============
+R_OcclusionCullEntity
+
+Culls the entity if its world bounds are hidden by the occluders
+=============
+*/
+void R_OcclusionCullEntity( trRefEntity_t *ent )
+{
+	if ( !occlusionActive || ent->cull == cullResult_t::CULL_OUT )
+	{
+		return;
+	}
+
+	// drawn over the world
+	if ( ent->e.renderfx & ( RF_FIRST_PERSON | RF_DEPTHHACK ) )
+	{
+		return;
+	}
+
+	if ( occlusionBuffer.Occluded( ent->worldBounds[ 0 ], ent->worldBounds[ 1 ] ) )
+	{
+		ent->cull = cullResult_t::CULL_OUT;
+		tr.pc.c_occlusion_cull_ent_out++;
 	}
 }
 
@@ -880,6 +1448,8 @@ R_AddWorldSurfaces
 */
 void R_AddWorldSurfaces()
 {
+	occlusionActive = false;
+
 	if ( !r_drawworld->integer )
 	{
 		return;
@@ -911,11 +1481,13 @@ void R_AddWorldSurfaces()
 		// determine which leaves are in the PVS / areamask
 		R_MarkLeaves();
 
+		R_DrawOccluders();
+
 		// clear traversal list
 		backEndData[ tr.smpFrame ]->traversalLength = 0;
 
 		// update visbounds and add surfaces that weren't cached with VBOs
-		R_RecursiveWorldNode( tr.world->nodes, FRUSTUM_CLIPALL, tr.refdef.decalBits );
+		R_AddWorldNodes();
 
 		// ydnar: add decal surfaces
 		R_AddDecalSurfaces( tr.world->models );
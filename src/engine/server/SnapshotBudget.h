@@ -0,0 +1,112 @@
+/*
+===========================================================================
+Daemon BSD Source Code
+Copyright (c) 2026, Daemon Developers
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Daemon developers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL DAEMON DEVELOPERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+===========================================================================
+*/
+
+#ifndef SNAPSHOTBUDGET_H
+#define SNAPSHOTBUDGET_H
+
+#include <algorithm>
+#include <vector>
+
+/*
+ * Chooses which entity updates go in a snapshot when they don't all fit in
+ * the bytes a client can receive per snapshot. Updates that are not sent are
+ * carried over: the server keeps the state the client already has for them
+ * and they get a higher priority as they age, so every entity is eventually
+ * updated and the nearby ones are updated first.
+ */
+namespace SnapshotBudget {
+
+    struct Candidate
+    {
+        int number;      // entity number, only used by the caller
+        int cost;        // bytes needed to send the update, 0 if unchanged
+        float priority;  // higher is sent first
+        bool required;   // always sent, e.g. SVF_BROADCAST entities
+        bool send;       // output
+    };
+
+    /*
+     * Distances under this are considered equally near
+     */
+    static const float MIN_DISTANCE = 64.0f;
+
+    /*
+     * Priority of an update that has not been sent for age msec to a client
+     * at the given distance of the entity
+     */
+    inline float Priority( float distance, int age )
+    {
+        return ( std::max( age, 0 ) + 1.0f ) / std::max( distance, MIN_DISTANCE );
+    }
+
+    /*
+     * Marks the candidates to send in this snapshot and returns the number
+     * of bytes they use. Required and unchanged entities are always sent,
+     * then the others by decreasing priority until budget is reached. An
+     * update that does not fit doesn't stop smaller ones from being sent.
+     */
+    inline int Schedule( std::vector<Candidate>& candidates, int budget )
+    {
+        std::vector<Candidate*> optional;
+        int used = 0;
+
+        for ( Candidate& c : candidates )
+        {
+            c.send = c.required || c.cost == 0;
+
+            if ( c.send )
+            {
+                used += c.cost;
+            }
+            else
+            {
+                optional.push_back( &c );
+            }
+        }
+
+        std::stable_sort( optional.begin(), optional.end(), []( const Candidate* a, const Candidate* b ) {
+            return a->priority > b->priority;
+        } );
+
+        for ( Candidate* c : optional )
+        {
+            if ( used + c->cost <= budget )
+            {
+                c->send = true;
+                used += c->cost;
+            }
+        }
+
+        return used;
+    }
+
+} // namespace SnapshotBudget
+
+#endif // SNAPSHOTBUDGET_H
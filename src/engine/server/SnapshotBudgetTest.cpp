@@ -0,0 +1,143 @@
+/*
+===========================================================================
+Daemon BSD Source Code
+Copyright (c) 2026, Daemon Developers
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Daemon developers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL DAEMON DEVELOPERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+===========================================================================
+*/
+
+#include <gtest/gtest.h>
+#include "SnapshotBudget.h"
+
+namespace SnapshotBudget {
+namespace {
+
+TEST(SnapshotBudgetTest, EverythingFits)
+{
+    std::vector<Candidate> candidates = {{1, 10, 1.0f, false, false}, {2, 20, 0.5f, false, false}};
+    ASSERT_EQ(30, Schedule(candidates, 100));
+    ASSERT_TRUE(candidates[0].send);
+    ASSERT_TRUE(candidates[1].send);
+}
+
+TEST(SnapshotBudgetTest, RequiredAndUnchangedAlwaysSent)
+{
+    std::vector<Candidate> candidates = {
+        {1, 50, 0.1f, true, false}, {2, 0, 0.0f, false, false}, {3, 10, 9.0f, false, false}};
+    ASSERT_EQ(50, Schedule(candidates, 20));
+    ASSERT_TRUE(candidates[0].send);
+    ASSERT_TRUE(candidates[1].send);
+    ASSERT_FALSE(candidates[2].send);
+}
+
+TEST(SnapshotBudgetTest, HighestPriorityFirst)
+{
+    std::vector<Candidate> candidates = {
+        {1, 40, 1.0f, false, false}, {2, 40, 3.0f, false, false},
+        {3, 40, 2.0f, false, false}, {4, 10, 0.5f, false, false}};
+    ASSERT_EQ(90, Schedule(candidates, 100));
+    ASSERT_FALSE(candidates[0].send);
+    ASSERT_TRUE(candidates[1].send);
+    ASSERT_TRUE(candidates[2].send);
+    // a smaller update still fits after a bigger one didn't
+    ASSERT_TRUE(candidates[3].send);
+}
+
+TEST(SnapshotBudgetTest, PriorityOrder)
+{
+    ASSERT_GT(Priority(100.0f, 50), Priority(1000.0f, 50));
+    ASSERT_GT(Priority(1000.0f, 500), Priority(1000.0f, 50));
+    ASSERT_EQ(Priority(0.0f, 50), Priority(MIN_DISTANCE, 50));
+}
+
+/*
+ * Loopback simulation: a client with a limited number of bytes per snapshot
+ * sees entities at increasing distances that all change every frame.
+ */
+struct SimulationResult
+{
+    std::vector<int> maxAge; // per entity, in frames
+    int maxBytes;
+};
+
+SimulationResult Simulate(int numEntities, int updateCost, int budget, int frames)
+{
+    SimulationResult result;
+    std::vector<int> lastSent(numEntities, 0);
+    result.maxAge.assign(numEntities, 0);
+    result.maxBytes = 0;
+
+    for (int frame = 1; frame <= frames; frame++) {
+        std::vector<Candidate> candidates;
+        for (int i = 0; i < numEntities; i++) {
+            float distance = 100.0f * (i + 1);
+            candidates.push_back({i, updateCost, Priority(distance, frame - lastSent[i]), false, false});
+        }
+
+        result.maxBytes = std::max(result.maxBytes, Schedule(candidates, budget));
+
+        for (const Candidate& c : candidates) {
+            result.maxAge[c.number] = std::max(result.maxAge[c.number], frame - lastSent[c.number]);
+            if (c.send) {
+                lastSent[c.number] = frame;
+            }
+        }
+    }
+
+    return result;
+}
+
+TEST(SnapshotBudgetTest, SimulationRespectsRate)
+{
+    // 64 entities of 30 bytes, 480 bytes per snapshot: a quarter of them fits
+    SimulationResult result = Simulate(64, 30, 480, 400);
+    ASSERT_LE(result.maxBytes, 480);
+}
+
+TEST(SnapshotBudgetTest, SimulationNearEntitiesFirst)
+{
+    SimulationResult result = Simulate(64, 30, 480, 400);
+
+    // the nearest entities are updated about every frame
+    ASSERT_LE(result.maxAge[0], 2);
+    ASSERT_LE(result.maxAge[1], 2);
+
+    // the far ones are updated less often, but not starved
+    ASSERT_GT(result.maxAge[63], result.maxAge[0]);
+    for (int age : result.maxAge) {
+        ASSERT_LT(age, 400);
+    }
+}
+
+TEST(SnapshotBudgetTest, SimulationUnlimited)
+{
+    SimulationResult result = Simulate(64, 30, 64 * 30, 50);
+    for (int age : result.maxAge) {
+        ASSERT_EQ(1, age);
+    }
+}
+
+} // namespace
+} // namespace SnapshotBudget
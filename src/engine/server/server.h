@@ -192,6 +192,7 @@ struct client_t
 	int              ping;
 	int              rate; // bytes / second
 	int              snapshotMsec; // requests a snapshot every snapshotMsec unless rate choked
+	int              entityLastSent[ MAX_GENTITIES ]; // svs.time an update of the entity was last put in a snapshot, see SV_BudgetSnapshotEntities
 	netchan_t        netchan;
 	// TTimo
 	// queuing outgoing fragmented messages to send them properly, without udp packet bursts
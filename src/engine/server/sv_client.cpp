@@ -426,6 +426,9 @@ void SV_ClientEnterWorld( client_t *client, usercmd_t *cmd )
 	client->nextSnapshotTime = svs.time; // generate a snapshot immediately
 	client->lastUsercmd = *cmd;
 
+	// the entity numbers may be used by other entities since the last map
+	memset( client->entityLastSent, 0, sizeof( client->entityLastSent ) );
+
 	// call the game begin function
 	gvm.GameClientBegin( client - svs.clients );
 }
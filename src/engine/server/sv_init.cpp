@@ -74,11 +74,64 @@ void SV_SetConfigstring( int index, const char *val )
 	sv.configstringsmodified[ index ] = true;
 }
 
+/*
+===============
+SV_SendBigConfigstring
+
+Sends a configstring that does not fit in a single server command as a
+bcs0 / bcs1 / bcs2 sequence, see CL_HandleServerCommand
+===============
+*/
+static void SV_SendBigConfigstring( client_t *client, int index, int maxChunkSize )
+{
+	int  sent = 0;
+	int  remaining = strlen( sv.configstrings[ index ] );
+	const char *cmd;
+	char buf[ MAX_STRING_CHARS ];
+
+	while ( remaining > 0 )
+	{
+		if ( sent == 0 )
+		{
+			cmd = "bcs0";
+		}
+		else if ( remaining < maxChunkSize )
+		{
+			cmd = "bcs2";
+		}
+		else
+		{
+			cmd = "bcs1";
+		}
+
+		Q_strncpyz( buf, &sv.configstrings[ index ][ sent ], maxChunkSize );
+
+		SV_SendServerCommand( client, "%s %i %s\n", cmd, index, Cmd_QuoteString( buf ) );
+
+		sent += ( maxChunkSize - 1 );
+		remaining -= ( maxChunkSize - 1 );
+	}
+}
+
+/*
+===============
+SV_UpdateConfigStrings
+
+Sends the configstrings modified since the last call to the clients.
+Setting the same configstring several times in a frame only sends the
+last value, and the small updates for a client are packed together in
+"cs <index> <string> [<index> <string> ...]" commands so that a mass
+update (map restart, team changes) does not use one reliable command
+per configstring.
+===============
+*/
 void SV_UpdateConfigStrings()
 {
-	int      len, i, index;
+	int      i, index;
 	client_t *client;
 	int      maxChunkSize = MAX_STRING_CHARS - 64;
+	int      modified[ MAX_CONFIGSTRINGS ];
+	int      numModified = 0;
 
 	for ( index = 0; index < MAX_CONFIGSTRINGS; index++ )
 	{
@@ -88,63 +141,63 @@ void SV_UpdateConfigStrings()
 		}
 
 		sv.configstringsmodified[ index ] = false;
+		modified[ numModified++ ] = index;
+	}
 
-		// send it to all the clients if we aren't
-		// spawning a new server
-		if ( sv.state == serverState_t::SS_GAME || sv.restarting )
+	// send them to all the clients if we aren't
+	// spawning a new server
+	if ( !numModified || ( sv.state != serverState_t::SS_GAME && !sv.restarting ) )
+	{
+		return;
+	}
+
+	// send the data to all relevent clients
+	for ( i = 0, client = svs.clients; i < sv_maxclients->integer; i++, client++ )
+	{
+		if ( client->state < clientState_t::CS_PRIMED )
 		{
-			len = strlen( sv.configstrings[ index ] );
+			continue;
+		}
+
+		std::string batch;
 
-			// send the data to all relevent clients
-			for ( i = 0, client = svs.clients; i < sv_maxclients->integer; i++, client++ )
+		for ( int j = 0; j < numModified; j++ )
+		{
+			index = modified[ j ];
+
+			// do not always send server info to all clients
+			if ( index == CS_SERVERINFO && client->gentity && ( client->gentity->r.svFlags & SVF_NOSERVERINFO ) )
 			{
-				if ( client->state < clientState_t::CS_PRIMED )
-				{
-					continue;
-				}
+				continue;
+			}
 
-				// do not always send server info to all clients
-				if ( index == CS_SERVERINFO && client->gentity && ( client->gentity->r.svFlags & SVF_NOSERVERINFO ) )
+			if ( (int) strlen( sv.configstrings[ index ] ) >= maxChunkSize )
+			{
+				// keep the updates in order
+				if ( !batch.empty() )
 				{
-					continue;
+					SV_SendServerCommand( client, "cs%s\n", batch.c_str() );
+					batch.clear();
 				}
 
-				if ( len >= maxChunkSize )
-				{
-					int  sent = 0;
-					int  remaining = len;
-					const char *cmd;
-					char buf[ MAX_STRING_CHARS ];
+				SV_SendBigConfigstring( client, index, maxChunkSize );
+				continue;
+			}
 
-					while ( remaining > 0 )
-					{
-						if ( sent == 0 )
-						{
-							cmd = "bcs0";
-						}
-						else if ( remaining < maxChunkSize )
-						{
-							cmd = "bcs2";
-						}
-						else
-						{
-							cmd = "bcs1";
-						}
-
-						Q_strncpyz( buf, &sv.configstrings[ index ][ sent ], maxChunkSize );
-
-						SV_SendServerCommand( client, "%s %i %s\n", cmd, index, Cmd_QuoteString( buf ) );
-
-						sent += ( maxChunkSize - 1 );
-						remaining -= ( maxChunkSize - 1 );
-					}
-				}
-				else
-				{
-					// standard cs, just send it
-					SV_SendServerCommand( client, "cs %i %s\n", index, Cmd_QuoteString( sv.configstrings[ index ] ) );
-				}
+			std::string update = Str::Format( " %i %s", index, Cmd_QuoteString( sv.configstrings[ index ] ) );
+
+			if ( batch.size() + update.size() >= (size_t) maxChunkSize )
+			{
+				SV_SendServerCommand( client, "cs%s\n", batch.c_str() );
+				batch.clear();
 			}
+
+			batch += update;
+		}
+
+		if ( !batch.empty() )
+		{
+			SV_SendServerCommand( client, "cs%s\n", batch.c_str() );
 		}
 	}
 }
@@ -33,8 +33,16 @@ Maryland 20850 USA.
 */
 
 #include "server.h"
+#include "SnapshotBudget.h"
 #include "qcommon/sys.h"
 
+static Cvar::Cvar<bool> sv_snapshotBudget("sv_snapshotBudget",
+	"when a snapshot doesn't fit in a client's rate, send the nearest and oldest entity updates first and delay the others",
+	Cvar::NONE, true);
+static Cvar::Range<Cvar::Cvar<int>> sv_snapshotBudgetLocalRate("sv_snapshotBudgetLocalRate",
+	"rate in bytes/s simulated for loopback and LAN clients to test the snapshot budget, 0 to not limit them",
+	Cvar::CHEAT, 0, 0, 1000000);
+
 /*
 =============================================================================
 
@@ -62,9 +70,10 @@ A server packet will look something like:
 SV_EmitPacketEntities
 
 Writes a delta update of an entityState_t list to the message.
+If entityBits isn't nullptr, it gets the bits written for each entity of to.
 =============
 */
-static void SV_EmitPacketEntities( const clientSnapshot_t *from, clientSnapshot_t *to, msg_t *msg )
+static void SV_EmitPacketEntities( const clientSnapshot_t *from, clientSnapshot_t *to, msg_t *msg, int *entityBits )
 {
 	entityState_t *oldent, *newent;
 	int           oldindex, newindex;
@@ -118,7 +127,14 @@ static void SV_EmitPacketEntities( const clientSnapshot_t *from, clientSnapshot_
 			// delta update from old position
 			// because the force parm is false, this will not result
 			// in any bytes being emitted if the entity has not changed at all
+			int bit = msg->bit;
 			MSG_WriteDeltaEntity( msg, oldent, newent, false );
+
+			if ( entityBits )
+			{
+				entityBits[ newindex ] = msg->bit - bit;
+			}
+
 			oldindex++;
 			newindex++;
 			continue;
@@ -127,7 +143,14 @@ static void SV_EmitPacketEntities( const clientSnapshot_t *from, clientSnapshot_
 		if ( newnum < oldnum )
 		{
 			// this is a new entity, send it from the baseline
+			int bit = msg->bit;
 			MSG_WriteDeltaEntity( msg, &sv.svEntities[ newnum ].baseline, newent, true );
+
+			if ( entityBits )
+			{
+				entityBits[ newindex ] = msg->bit - bit;
+			}
+
 			newindex++;
 			continue;
 		}
@@ -146,48 +169,73 @@ static void SV_EmitPacketEntities( const clientSnapshot_t *from, clientSnapshot_
 
 /*
 ==================
-SV_WriteSnapshotToClient
+SV_DeltaFrame
+
+Returns the frame the snapshot being created for the client will be delta
+compressed from, or nullptr if it must be sent in full
 ==================
 */
-static void SV_WriteSnapshotToClient( client_t *client, msg_t *msg )
+static clientSnapshot_t *SV_DeltaFrame( client_t *client, int *lastframe, bool verbose )
 {
-	clientSnapshot_t *frame, *oldframe;
-	int              lastframe;
-	int              i;
-	int              snapFlags;
+	clientSnapshot_t *oldframe;
 
-	// this is the snapshot we are creating
-	frame = &client->frames[ client->netchan.outgoingSequence & PACKET_MASK ];
+	*lastframe = 0;
 
-	// try to use a previous frame as the source for delta compressing the snapshot
 	if ( client->deltaMessage <= 0 || client->state != clientState_t::CS_ACTIVE )
 	{
 		// client is asking for a retransmit
-		oldframe = nullptr;
-		lastframe = 0;
+		return nullptr;
 	}
-	else if ( client->netchan.outgoingSequence - client->deltaMessage >= ( PACKET_BACKUP - 3 ) )
+
+	if ( client->netchan.outgoingSequence - client->deltaMessage >= ( PACKET_BACKUP - 3 ) )
 	{
 		// client hasn't gotten a good message through in a long time
-		Log::Debug( "%s^*: Delta request from out of date packet.", client->name );
-		oldframe = nullptr;
-		lastframe = 0;
+		if ( verbose )
+		{
+			Log::Debug( "%s^*: Delta request from out of date packet.", client->name );
+		}
+
+		return nullptr;
 	}
-	else
-	{
-		// we have a valid snapshot to delta from
-		oldframe = &client->frames[ client->deltaMessage & PACKET_MASK ];
-		lastframe = client->netchan.outgoingSequence - client->deltaMessage;
 
-		// the snapshot's entities may still have rolled off the buffer, though
-		if ( oldframe->first_entity <= svs.nextSnapshotEntities - svs.numSnapshotEntities )
+	// we have a valid snapshot to delta from
+	oldframe = &client->frames[ client->deltaMessage & PACKET_MASK ];
+
+	// the snapshot's entities may still have rolled off the buffer, though
+	if ( oldframe->first_entity <= svs.nextSnapshotEntities - svs.numSnapshotEntities )
+	{
+		if ( verbose )
 		{
 			Log::Debug( "%s^*: Delta request from out of date entities.", client->name );
-			oldframe = nullptr;
-			lastframe = 0;
 		}
+
+		return nullptr;
 	}
 
+	*lastframe = client->netchan.outgoingSequence - client->deltaMessage;
+	return oldframe;
+}
+
+/*
+==================
+SV_WriteSnapshotToClient
+
+entityBits is given to SV_EmitPacketEntities
+==================
+*/
+static void SV_WriteSnapshotToClient( client_t *client, msg_t *msg, int *entityBits )
+{
+	clientSnapshot_t *frame, *oldframe;
+	int              lastframe;
+	int              i;
+	int              snapFlags;
+
+	// this is the snapshot we are creating
+	frame = &client->frames[ client->netchan.outgoingSequence & PACKET_MASK ];
+
+	// try to use a previous frame as the source for delta compressing the snapshot
+	oldframe = SV_DeltaFrame( client, &lastframe, true );
+
 	MSG_WriteByte( msg, svc_snapshot );
 
 	// NOTE, MRE: now sent at the start of every message from server to client
@@ -232,7 +280,7 @@ static void SV_WriteSnapshotToClient( client_t *client, msg_t *msg )
 	}
 
 	// delta encode the entities
-	SV_EmitPacketEntities( oldframe, frame, msg );
+	SV_EmitPacketEntities( oldframe, frame, msg, entityBits );
 
 	// padding for rate debugging
 	if ( sv_padPackets->integer )
@@ -249,18 +297,28 @@ static void SV_WriteSnapshotToClient( client_t *client, msg_t *msg )
 SV_UpdateServerCommandsToClient
 
 (re)send all server commands the client hasn't acknowledged yet
+
+The commands are consecutive so they are written in blocks that only
+carry the sequence number of the first one.
 ==================
 */
 void SV_UpdateServerCommandsToClient( client_t *client, msg_t *msg )
 {
-	int i;
+	int i, j, count;
 
 	// write any unacknowledged serverCommands
-	for ( i = client->reliableAcknowledge + 1; i <= client->reliableSequence; i++ )
+	for ( i = client->reliableAcknowledge + 1; i <= client->reliableSequence; i += count )
 	{
-		MSG_WriteByte( msg, svc_serverCommand );
+		count = std::min( client->reliableSequence - i + 1, 255 );
+
+		MSG_WriteByte( msg, svc_serverCommandBlock );
 		MSG_WriteLong( msg, i );
-		MSG_WriteString( msg, client->reliableCommands[ i & ( MAX_RELIABLE_COMMANDS - 1 ) ] );
+		MSG_WriteByte( msg, count );
+
+		for ( j = i; j < i + count; j++ )
+		{
+			MSG_WriteString( msg, client->reliableCommands[ j & ( MAX_RELIABLE_COMMANDS - 1 ) ] );
+		}
 	}
 
 	client->reliableSent = client->reliableSequence;
@@ -644,6 +702,225 @@ static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *fra
 	}
 }
 
+/*
+====================
+SV_IsLocalClient
+
+Local clients are not rate limited
+====================
+*/
+static bool SV_IsLocalClient( client_t *client )
+{
+	// TTimo - show_bug.cgi?id=491
+	// added sv_lanForceRate check
+	return client->netchan.remoteAddress.type == netadrtype_t::NA_LOOPBACK ||
+	       ( sv_lanForceRate->integer && Sys_IsLANAddress( client->netchan.remoteAddress ) );
+}
+
+/*
+====================
+SV_ClientRate
+
+Return the bytes / second the client can receive
+TTimo - use sv_maxRate or sv_dl_maxRate depending on regular or downloading client
+====================
+*/
+static const int HEADER_RATE_BYTES = 48; // include our header, IP header, and some overhead
+static int SV_ClientRate( client_t *client )
+{
+	int rate;
+	int maxRate;
+
+	// low watermark for sv_maxRate, never 0 < sv_maxRate < 1000 (0 is no limitation)
+	if ( sv_maxRate->integer && sv_maxRate->integer < 1000 )
+	{
+		Cvar_Set( "sv_MaxRate", "1000" );
+	}
+
+	rate = client->rate;
+
+	// work on the appropriate max rate (client or download)
+	if ( !*client->downloadName )
+	{
+		maxRate = sv_maxRate->integer;
+	}
+	else
+	{
+		maxRate = sv_dl_maxRate->integer;
+	}
+
+	if ( maxRate )
+	{
+		if ( maxRate < rate )
+		{
+			rate = maxRate;
+		}
+	}
+
+	return rate;
+}
+
+/*
+=============
+SV_SnapshotViewpoint
+
+Where the entities of the client's snapshots are seen from
+=============
+*/
+static void SV_SnapshotViewpoint( const sharedEntity_t *clent, const OpaquePlayerState *ps, vec3_t org )
+{
+	if ( clent->r.svFlags & SVF_SELF_PORTAL_EXCLUSIVE )
+	{
+		// find the client's viewpoint
+		VectorCopy( clent->s.origin2, org );
+	}
+	else
+	{
+		VectorCopy( ps->origin, org );
+	}
+
+	org[ 2 ] += ps->viewheight;
+}
+
+/*
+=============
+SV_SnapshotBudget
+
+Returns the bytes the client can receive per snapshot, or 0 if its
+snapshots aren't limited
+=============
+*/
+static int SV_SnapshotBudget( client_t *client )
+{
+	if ( !sv_snapshotBudget.Get() || SV_IsBot( client ) || client->snapshotMsec <= 0 )
+	{
+		return 0;
+	}
+
+	// local clients aren't limited unless a rate is simulated for them
+	int rate = SV_IsLocalClient( client ) ? sv_snapshotBudgetLocalRate.Get() : SV_ClientRate( client );
+
+	if ( !rate )
+	{
+		return 0;
+	}
+
+	return std::max( rate * client->snapshotMsec / 1000 - HEADER_RATE_BYTES, 1 );
+}
+
+/*
+=============
+SV_BudgetSnapshotEntities
+
+Called when the snapshot written for the client doesn't fit in the bytes
+it can receive per snapshot, instead of sending a snapshot that delays the
+next ones. entityBits has the size of each entity update as it was
+written, budget the bytes left for them.
+
+An entity that doesn't fit keeps the state it has in the frame the
+snapshot is delta compressed from, which costs nothing, and is added later
+if it isn't in that frame. Its priority grows until it gets sent. Returns
+false if the snapshot isn't delta compressed, which must have all the
+entities.
+=============
+*/
+static bool SV_BudgetSnapshotEntities( client_t *client, const int *entityBits, int budget )
+{
+	clientSnapshot_t                      *frame, *oldframe;
+	int                                   lastframe;
+	int                                   i, oldindex, numEntities;
+	vec3_t                                org;
+	std::vector<SnapshotBudget::Candidate> candidates;
+	std::vector<entityState_t *>          oldStates;
+
+	oldframe = SV_DeltaFrame( client, &lastframe, false );
+
+	if ( !oldframe )
+	{
+		return false;
+	}
+
+	frame = &client->frames[ client->netchan.outgoingSequence & PACKET_MASK ];
+
+	SV_SnapshotViewpoint( client->gentity, &frame->ps, org );
+
+	candidates.reserve( frame->num_entities );
+	oldStates.reserve( frame->num_entities );
+	oldindex = 0;
+
+	for ( i = 0; i < frame->num_entities; i++ )
+	{
+		entityState_t  *state = &svs.snapshotEntities[( frame->first_entity + i ) % svs.numSnapshotEntities ];
+		int            num = state->number;
+		sharedEntity_t *ent = SV_GentityNum( num );
+		entityState_t  *oldstate = nullptr;
+		vec3_t         center;
+
+		// both entity lists are sorted
+		while ( oldindex < oldframe->num_entities )
+		{
+			entityState_t *old = &svs.snapshotEntities[( oldframe->first_entity + oldindex ) % svs.numSnapshotEntities ];
+
+			if ( old->number >= num )
+			{
+				if ( old->number == num )
+				{
+					oldstate = old;
+				}
+
+				break;
+			}
+
+			oldindex++;
+		}
+
+		VectorAdd( ent->r.absmin, ent->r.absmax, center );
+		VectorScale( center, 0.5f, center );
+
+		SnapshotBudget::Candidate candidate;
+		candidate.number = num;
+		candidate.cost = ( entityBits[ i ] + 7 ) >> 3;
+		candidate.priority = SnapshotBudget::Priority( Distance( center, org ), svs.time - client->entityLastSent[ num ] );
+		candidate.required = ( ent->r.svFlags & SVF_BROADCAST ) != 0;
+		candidate.send = true;
+
+		candidates.push_back( candidate );
+		oldStates.push_back( oldstate );
+	}
+
+	SnapshotBudget::Schedule( candidates, budget );
+
+	// the frame's entities are the last ones added, so the ones left out
+	// are removed by moving the others down
+	numEntities = 0;
+
+	for ( i = 0; i < frame->num_entities; i++ )
+	{
+		entityState_t *state = &svs.snapshotEntities[( frame->first_entity + numEntities ) % svs.numSnapshotEntities ];
+
+		if ( candidates[ i ].send )
+		{
+			*state = svs.snapshotEntities[( frame->first_entity + i ) % svs.numSnapshotEntities ];
+			client->entityLastSent[ candidates[ i ].number ] = svs.time;
+		}
+		else if ( oldStates[ i ] )
+		{
+			*state = *oldStates[ i ];
+		}
+		else
+		{
+			continue;
+		}
+
+		numEntities++;
+	}
+
+	svs.nextSnapshotEntities -= frame->num_entities - numEntities;
+	frame->num_entities = numEntities;
+
+	return true;
+}
+
 /*
 =============
 SV_BuildClientSnapshot
@@ -706,17 +983,7 @@ static void SV_BuildClientSnapshot( client_t *client )
 
 	svEnt->snapshotCounter = sv.snapshotCounter;
 
-	if ( clent->r.svFlags & SVF_SELF_PORTAL_EXCLUSIVE )
-	{
-		// find the client's viewpoint
-		VectorCopy( clent->s.origin2, org );
-	}
-	else
-	{
-		VectorCopy( ps->origin, org );
-	}
-
-	org[ 2 ] += ps->viewheight;
+	SV_SnapshotViewpoint( clent, ps, org );
 
 	// add all the entities directly visible to the eye, which
 	// may include portal entities that merge other viewpoints
@@ -763,15 +1030,11 @@ SV_RateMsec
 
 Return the number of msec a given size message is supposed
 to take to clear, based on the current rate
-TTimo - use sv_maxRate or sv_dl_maxRate depending on regular or downloading client
 ====================
 */
-static const int HEADER_RATE_BYTES = 48; // include our header, IP header, and some overhead
 static int SV_RateMsec( client_t *client, int messageSize )
 {
 	int rate;
-	int rateMsec;
-	int maxRate;
 
 	// individual messages will never be larger than fragment size
 	if ( messageSize > 1500 )
@@ -779,35 +1042,9 @@ static int SV_RateMsec( client_t *client, int messageSize )
 		messageSize = 1500;
 	}
 
-	// low watermark for sv_maxRate, never 0 < sv_maxRate < 1000 (0 is no limitation)
-	if ( sv_maxRate->integer && sv_maxRate->integer < 1000 )
-	{
-		Cvar_Set( "sv_MaxRate", "1000" );
-	}
-
-	rate = client->rate;
-
-	// work on the appropriate max rate (client or download)
-	if ( !*client->downloadName )
-	{
-		maxRate = sv_maxRate->integer;
-	}
-	else
-	{
-		maxRate = sv_dl_maxRate->integer;
-	}
+	rate = SV_ClientRate( client );
 
-	if ( maxRate )
-	{
-		if ( maxRate < rate )
-		{
-			rate = maxRate;
-		}
-	}
-
-	rateMsec = ( messageSize + HEADER_RATE_BYTES ) * 1000 / rate;
-
-	return rateMsec;
+	return ( messageSize + HEADER_RATE_BYTES ) * 1000 / rate;
 }
 
 /*
@@ -834,8 +1071,7 @@ void SV_SendMessageToClient( msg_t *msg, client_t *client )
 	// local clients get snapshots every frame
 	// TTimo - show_bug.cgi?id=491
 	// added sv_lanForceRate check
-	if ( client->netchan.remoteAddress.type == netadrtype_t::NA_LOOPBACK ||
-	     ( sv_lanForceRate->integer && Sys_IsLANAddress( client->netchan.remoteAddress ) ) )
+	if ( SV_IsLocalClient( client ) && !sv_snapshotBudgetLocalRate.Get() )
 	{
 		client->nextSnapshotTime = svs.time - 1;
 		return;
@@ -899,7 +1135,7 @@ void SV_SendClientIdle( client_t *client )
 
 	// send over all the relevant entityState_t
 	// and the playerState_t
-//  SV_WriteSnapshotToClient( client, &msg );
+//  SV_WriteSnapshotToClient( client, &msg, nullptr );
 
 	// Add any download data if the client is downloading
 	SV_WriteDownloadToClient( client, &msg );
@@ -920,6 +1156,25 @@ void SV_SendClientIdle( client_t *client )
 	sv.ubpsTotalBytes += msg.uncompsize / 8; // NERVE - SMF - net debugging
 }
 
+/*
+=======================
+SV_RewindMessage
+
+Puts the message back to the size it had when saved was copied from it,
+so that what follows can be written again
+=======================
+*/
+static void SV_RewindMessage( msg_t *msg, const msg_t &saved )
+{
+	*msg = saved;
+
+	// the bits are ORed into the last byte, clear the ones written after
+	if ( msg->bit & 7 )
+	{
+		msg->data[ msg->bit >> 3 ] &= ( 1 << ( msg->bit & 7 ) ) - 1;
+	}
+}
+
 /*
 =======================
 SV_SendClientSnapshot
@@ -966,7 +1221,41 @@ void SV_SendClientSnapshot( client_t *client )
 
 	// send over all the relevant entityState_t
 	// and the playerState_t
-	SV_WriteSnapshotToClient( client, &msg );
+	static int entityBits[ MAX_SNAPSHOT_ENTITIES ];
+	msg_t      beforeSnapshot = msg;
+	int        budget = SV_SnapshotBudget( client );
+
+	SV_WriteSnapshotToClient( client, &msg, budget ? entityBits : nullptr );
+
+	clientSnapshot_t *frame = &client->frames[ client->netchan.outgoingSequence & PACKET_MASK ];
+	bool             allSent = true;
+
+	// leave some entity updates for later if they don't fit in the
+	// client's rate, and write the snapshot again without them
+	if ( budget && msg.cursize > budget )
+	{
+		int bits = 0;
+
+		for ( int i = 0; i < frame->num_entities; i++ )
+		{
+			bits += entityBits[ i ];
+		}
+
+		if ( SV_BudgetSnapshotEntities( client, entityBits, budget - ( msg.cursize - bits / 8 ) ) )
+		{
+			SV_RewindMessage( &msg, beforeSnapshot );
+			SV_WriteSnapshotToClient( client, &msg, nullptr );
+			allSent = false;
+		}
+	}
+
+	if ( allSent )
+	{
+		for ( int i = 0; i < frame->num_entities; i++ )
+		{
+			client->entityLastSent[ svs.snapshotEntities[( frame->first_entity + i ) % svs.numSnapshotEntities ].number ] = svs.time;
+		}
+	}
 
 	// Add any download data if the client is downloading
 	SV_WriteDownloadToClient( client, &msg );
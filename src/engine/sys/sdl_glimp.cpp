@@ -1931,6 +1931,26 @@ static void GLimp_InitExtensions()
 	// made required in OpenGL 3.2
 	glConfig2.syncAvailable = LOAD_EXTENSION_WITH_TEST( ExtFlag_CORE, ARB_sync, r_arb_sync->value );
 
+	// made required in OpenGL 3.3, the core entry points are used
+	glConfig2.instancedArraysAvailable = LOAD_EXTENSION_WITH_TEST( ExtFlag_CORE, ARB_instanced_arrays, r_arb_instanced_arrays->value
+		&& glVertexAttribDivisor != nullptr && glDrawElementsInstanced != nullptr );
+
+	// made required in OpenGL 4.3
+	glConfig2.multiDrawIndirectAvailable = LOAD_EXTENSION_WITH_TEST( ExtFlag_NONE, ARB_multi_draw_indirect, r_arb_multi_draw_indirect->value
+		&& glMultiDrawElementsIndirect != nullptr );
+
+	glConfig2.parallelShaderCompileAvailable = false;
+#ifdef GL_KHR_parallel_shader_compile
+	glConfig2.parallelShaderCompileAvailable = LOAD_EXTENSION_WITH_TEST( ExtFlag_NONE, KHR_parallel_shader_compile, r_khr_parallel_shader_compile->value
+		&& glMaxShaderCompilerThreadsKHR != nullptr );
+
+	if ( glConfig2.parallelShaderCompileAvailable )
+	{
+		// let the driver use as many threads as it wants
+		glMaxShaderCompilerThreadsKHR( 0xFFFFFFFF );
+	}
+#endif
+
 	GL_CheckErrors();
 }
 
@@ -47,9 +47,9 @@ class ExitException {};
 #endif
 
 // Common initialization code for both VM types
-static void CommonInit(Sys::OSHandle rootSocket)
+static void CommonInit(IPC::Channel rootChannel)
 {
-	VM::rootChannel = IPC::Channel(IPC::Socket::FromHandle(rootSocket));
+	VM::rootChannel = std::move(rootChannel);
 
 	// Send syscall ABI version, also acts as a sign that the module loaded
 	Util::Writer writer;
@@ -96,12 +96,12 @@ void Sys::Error(Str::StringRef message)
 
 #ifdef BUILD_VM_IN_PROCESS
 
-// Entry point called in a new thread inside the existing process
-extern "C" DLLEXPORT ALIGN_STACK_FOR_MINGW void vmMain(Sys::OSHandle rootSocket)
+// Common entry point code for in-process VMs
+static void InProcessMain(IPC::Channel rootChannel)
 {
 	try {
 		try {
-			CommonInit(rootSocket);
+			CommonInit(std::move(rootChannel));
 		} catch (ExitException&) {
 			return;
 		} catch (Sys::DropErr& err) {
@@ -114,6 +114,19 @@ extern "C" DLLEXPORT ALIGN_STACK_FOR_MINGW void vmMain(Sys::OSHandle rootSocket)
 	} catch (...) {}
 }
 
+// Entry point called in a new thread inside the existing process
+extern "C" DLLEXPORT ALIGN_STACK_FOR_MINGW void vmMain(Sys::OSHandle rootSocket)
+{
+	InProcessMain(IPC::Channel(IPC::Socket::FromHandle(rootSocket)));
+}
+
+// Same as vmMain but the engine talks to us through an in-memory pipe instead
+// of a socket pair, the engine keeps the pipe alive until this returns.
+extern "C" DLLEXPORT ALIGN_STACK_FOR_MINGW void vmMainInProcessPipe(IPC::InProcessPipe* pipe)
+{
+	InProcessMain(IPC::Channel(pipe, IPC::InProcessPipe::VM_SIDE));
+}
+
 #else
 
 // Entry point called in a new process
@@ -143,7 +156,7 @@ int main(int argc, char** argv)
 	// the exception message or a crash dump with a useful backtrace, not both. The trace
 	// seems more informative on average.
 	try {
-		CommonInit(rootSocket);
+		CommonInit(IPC::Channel(IPC::Socket::FromHandle(rootSocket)));
 	} catch (Sys::DropErr& err) {
 		Sys::Error(err.what());
 #ifndef __native_client__
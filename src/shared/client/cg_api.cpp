@@ -69,8 +69,94 @@ void trap_GetCurrentSnapshotNumber( int *snapshotNumber, int *serverTime )
 	VM::SendMsg<GetCurrentSnapshotNumberMsg>(*snapshotNumber, *serverTime);
 }
 
+// The snapshot ring is shared with the engine which writes every snapshot it
+// parses in it. The engine only writes to it while we are not running (it
+// parses packets between cgame frames) so the generation check is only a
+// safety net.
+static IPC::SharedMemory snapshotShm;
+static const sharedSnapshotRing_t *snapshotRing = nullptr;
+
+static const sharedSnapshot_t *FindSharedSnapshot( int snapshotNumber )
+{
+	if ( !snapshotRing )
+	{
+		snapshotShm = IPC::SharedMemory::Create( sizeof( sharedSnapshotRing_t ) );
+		VM::SendMsg<SnapshotLocateMsg>( snapshotShm );
+		snapshotRing = static_cast<const sharedSnapshotRing_t*>( snapshotShm.GetBase() );
+	}
+
+	const sharedSnapshot_t *slot = &snapshotRing->snapshots[ snapshotNumber & SHARED_SNAPSHOT_MASK ];
+	uint32_t generation = slot->generation.load( std::memory_order_acquire );
+
+	if ( ( generation & 1 ) || slot->messageNum != snapshotNumber || slot->numEntities < 0 )
+	{
+		return nullptr;
+	}
+
+	return slot;
+}
+
+// Returns nullptr if the snapshot cannot be read in place, trap_GetSnapshot
+// must be used in that case.
+const sharedSnapshot_t *trap_GetSharedSnapshot( int snapshotNumber, std::vector<std::string> &serverCommands )
+{
+	const sharedSnapshot_t *slot = FindSharedSnapshot( snapshotNumber );
+
+	if ( !slot )
+	{
+		return nullptr;
+	}
+
+	// The engine still decides whether the snapshot is valid and owns the server commands
+	bool res;
+	VM::SendMsg<GetSnapshotCommandsMsg>( snapshotNumber, res, serverCommands );
+
+	return res ? slot : nullptr;
+}
+
+// Reads of a slot the engine was writing meanwhile are tried again this many
+// times before asking the engine for the snapshot instead
+static const int SHARED_SNAPSHOT_READ_TRIES = 4;
+
 bool trap_GetSnapshot( int snapshotNumber, snapshot_t *snapshot )
 {
+	for ( int i = 0; i < SHARED_SNAPSHOT_READ_TRIES; i++ )
+	{
+		const sharedSnapshot_t *slot = FindSharedSnapshot( snapshotNumber );
+
+		// Snapshots with too many entities for the shared ring go through the socket
+		if ( !slot )
+		{
+			break;
+		}
+
+		uint32_t generation = slot->generation.load( std::memory_order_acquire );
+		int numEntities = slot->numEntities;
+
+		if ( numEntities < 0 || numEntities > MAX_ENTITIES_IN_SNAPSHOT )
+		{
+			continue;
+		}
+
+		snapshot->snapFlags = slot->snapFlags;
+		snapshot->ping = slot->ping;
+		snapshot->serverTime = slot->serverTime;
+		memcpy( snapshot->areamask, slot->areamask, sizeof( snapshot->areamask ) );
+		memcpy( &snapshot->ps, &slot->ps, sizeof( snapshot->ps ) );
+		snapshot->entities.assign( slot->entities, slot->entities + numEntities );
+
+		std::atomic_thread_fence( std::memory_order_acquire );
+
+		if ( slot->generation.load( std::memory_order_relaxed ) != generation )
+		{
+			continue;
+		}
+
+		bool res;
+		VM::SendMsg<GetSnapshotCommandsMsg>( snapshotNumber, res, snapshot->serverCommands );
+		return res;
+	}
+
 	bool res;
 	VM::SendMsg<GetSnapshotMsg>(snapshotNumber, res, *snapshot);
 	return res;